@@ -0,0 +1,113 @@
+#ifndef NSWCALIBRATION_BCIDSTATISTICS_H
+#define NSWCALIBRATION_BCIDSTATISTICS_H
+
+/**
+ * \brief Statistics of the PFEB BCIDs seen by the pad trigger, over repeated reads
+ *
+ * Keeps a histogram of the BCIDs of each PFEB in the current iteration,
+ * summarised by:
+ *
+ *   - mode: most frequent BCID
+ *   - fraction: fraction of the reads at the mode
+ *   - spread: largest distance of a read to the mode, modulo NUM_BCIDS
+ *   - stable: fraction at least \c stableFraction
+ *
+ * The histograms of an iteration can be recorded for the setting (delay,
+ * phase) of each PFEB, and are merged with the ones of the same setting. A
+ * setting is good for a PFEB if it is stable, and its neighbouring settings
+ * are stable with the same mode. The best setting of a PFEB is the center
+ * of its longest run of good settings, and the best common setting the
+ * center of the longest run of settings good for the most PFEBs.
+ */
+
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <optional>
+#include <utility>
+#include <vector>
+
+namespace nsw {
+
+  class BcidStatistics {
+  public:
+    /// The pad trigger publishes the 4 LSB of the BCIDs
+    static constexpr std::uint32_t NUM_BCIDS{16};
+
+    struct Summary {
+      std::uint32_t mode{0};
+      std::uint32_t spread{0};
+      double fraction{0};
+      std::size_t reads{0};
+      bool stable{false};
+    };
+
+    /// Summaries of all PFEBs, as tree branches
+    struct Columns {
+      std::vector<std::uint32_t> mode{};
+      std::vector<std::uint32_t> spread{};
+      std::vector<double> fraction{};
+      std::vector<bool> stable{};
+    };
+
+    using Reader = std::function<std::vector<std::uint32_t>()>;
+    using RawCallback = std::function<void(std::size_t read, const std::vector<std::uint32_t>& bcids)>;
+
+    /**
+     * \param numPfebs Number of PFEBs
+     * \param stableFraction Fraction of the reads at the mode for a stable BCID
+     */
+    explicit BcidStatistics(std::size_t numPfebs, double stableFraction = 1.0);
+
+    /// Start an iteration
+    void reset();
+
+    /// Add the BCIDs of one read, per PFEB
+    void add(const std::vector<std::uint32_t>& bcids);
+
+    /**
+     * \brief Read and add the BCIDs \c numReads times
+     *
+     * \param raw Called with each read, if given
+     */
+    void read(const Reader& reader, std::size_t numReads, const RawCallback& raw = {});
+
+    [[nodiscard]] Summary getSummary(std::size_t pfeb) const;
+    [[nodiscard]] Columns getColumns() const;
+
+    /// Record the current iteration for the setting of each PFEB
+    void record(const std::vector<std::uint32_t>& settings);
+
+    /// Record the current iteration for the same setting of all PFEBs
+    void record(std::uint32_t setting);
+
+    /**
+     * \brief Best setting of a PFEB, if it has a good one
+     *
+     * \param circular Whether the last recorded setting neighbours the first (phases)
+     */
+    [[nodiscard]] std::optional<std::uint32_t> getBest(std::size_t pfeb, bool circular) const;
+
+    /// Best setting common to all PFEBs, if any PFEB has a good one
+    [[nodiscard]] std::optional<std::uint32_t> getBestCommon(bool circular) const;
+
+  private:
+    using Histogram = std::map<std::uint32_t, std::size_t>;
+
+    [[nodiscard]] Summary summarise(const Histogram& histogram) const;
+
+    /// Recorded settings of a PFEB, and whether each one is good
+    [[nodiscard]] std::vector<std::pair<std::uint32_t, bool>> getGood(std::size_t pfeb, bool circular) const;
+
+    /// Center of the longest run of true, if any
+    [[nodiscard]] static std::optional<std::size_t> center(const std::vector<bool>& values, bool circular);
+
+    std::size_t m_numPfebs;
+    double m_stableFraction;
+    std::vector<Histogram> m_current{};                        //!< Per PFEB
+    std::vector<std::map<std::uint32_t, Histogram>> m_recorded{};  //!< Per PFEB, per setting
+  };
+
+}  // namespace nsw
+
+#endif
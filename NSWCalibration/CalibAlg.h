@@ -9,7 +9,15 @@
 #include <functional>
 #include <string>
 #include <chrono>
+#include <condition_variable>
 #include <filesystem>
+#include <fstream>
+#include <map>
+#include <mutex>
+#include <set>
+#include <stop_token>
+#include <string_view>
+#include <utility>
 #include <vector>
 
 #include "NSWCalibration/Commands.h"
@@ -17,6 +25,8 @@
 #include "NSWConfiguration/hw/DeviceManager.h"
 
 class ISInfoDictionary;
+class TFile;
+class TTree;
 
 namespace nsw {
 
@@ -82,8 +92,29 @@ namespace nsw {
      * \param is_db_name Name of the IS server storing the parameters
      */
     virtual void setCalibParamsFromIS(const ISInfoDictionary& is_dictionary, const std::string& is_db_name);
+
+    /*!
+     * \brief Configure the calibration from a calibration parameter string
+     *
+     * Counterpart of \c setCalibParamsFromIS used when no partition
+     * is available, e.g. by the standalone \c nsw_calib_run driver.
+     * The format of the string is the one expected in
+     * \tt <dbISName>.Calib.calibParams by the derived class.
+     *
+     * \param calibParams Calibration parameter string
+     */
+    virtual void setCalibParams(const std::string& calibParams);
     virtual void setCalibKeyToIS(const ISInfoDictionary&){};
 
+    /*!
+     * \brief Set the IS name of the calibration key published by \c setCalibKeyToIS
+     *
+     * Calibrations running together each need their own key
+     */
+    void setCalibKeyName(std::string name) { m_calib_key_name = std::move(name); }
+    [[nodiscard]] const std::string& calibKeyName() const { return m_calib_key_name; }
+    static constexpr std::string_view DEFAULT_CALIB_KEY_NAME{"Monitoring.NSWCalibration.triggerCalibrationKey"};
+
     /*!
      * \brief Increments the iteration counter and checks if there are
      *        more iterations to do
@@ -92,6 +123,56 @@ namespace nsw {
      */
     void next() { ++m_counter; };
 
+    /*!
+     * \brief Start the calibration loop from the first iteration
+     *
+     * Called by the \c reset UserCmd. Leaves resume mode if it was active.
+     */
+    void restart();
+
+    /*!
+     * \brief Save the calibration progress to the checkpoint file
+     *
+     * Records the next iteration to run and the names of the output
+     * files, and saves the TTrees attached with \c attachTree up to the
+     * current entry. Called after \c next. The checkpoint is removed
+     * once the last iteration is done.
+     */
+    void checkpoint();
+
+    /*!
+     * \brief Continue an interrupted calibration from its checkpoint
+     *
+     * Sets the counter to the first iteration not completed by the
+     * previous process. Output files registered with
+     * \c outputFileName keep their previous names and are reopened in
+     * update mode.
+     *
+     * \throws nsw::calib::Issue if there is no checkpoint, or it was
+     *         written by a different calibration
+     */
+    void resume();
+
+    /*!
+     * \brief Request the calibration to stop as soon as possible
+     *
+     * Thread safe: may be called while another thread runs
+     * \c configure, \c acquire or \c unconfigure. Sleeping calibration
+     * steps wake up immediately, and steps checking \c checkAbort throw
+     * nsw::calib::Aborted. Cleared by \c restart.
+     */
+    virtual void abort() { std::scoped_lock lock(m_stopMutex); m_stop.request_stop(); }
+    bool aborted() const { std::scoped_lock lock(m_stopMutex); return m_stop.stop_requested(); }
+
+    /*!
+     * \brief Write and close the TTrees attached with \c attachTree
+     *
+     * Used after an abort, so that the output of the iterations already
+     * done is kept. The checkpoint is left in place, so the calibration
+     * can still be resumed.
+     */
+    virtual void closeOutputs();
+
     /*!
      * \brief Prints the overall calibration progress
      *
@@ -101,10 +182,22 @@ namespace nsw {
 
     std::size_t counter() const {return m_counter;};
     std::size_t total() const {return m_total;};
+    bool resuming() const {return m_resuming;}
+
+    /*!
+     * \brief Whether this is the first iteration run by this process
+     *
+     * Equivalent to counter() == 0 unless the calibration was resumed.
+     * One-time setup (opening output files, masking, starting watchdogs)
+     * should be done when this is true, so that it is repeated on resume.
+     */
+    bool isFirstIteration() const {return m_counter == m_first_counter;}
     bool wait4swrod() const {return m_wait4swrod;}
     bool simulation() const {return m_simulation;}
     std::string applicationName() const {return m_name;}
     std::uint32_t runNumber() const {return m_run_number;}
+    std::time_t runStart() const {return m_run_start;}
+    const std::string& outputPath() const {return m_out_path;}
 
     void setCounter(const std::size_t ctr) {m_counter = ctr;}
     void setTotal(const std::size_t tot) {m_total = tot;}
@@ -113,6 +206,14 @@ namespace nsw {
     void setApplicationName(const std::string& name) {m_name = name;}
     void setRunNumber(const std::uint32_t val) {m_run_number = val;}
 
+    /*!
+     * \brief Set the base directory for calibration output files
+     *
+     * Taken from the \tt CalibOutput OKS attribute by \c NSWCalibRc, or
+     * from the command line by the standalone driver
+     */
+    void setOutputPath(const std::string& path) {m_out_path = path;}
+
     /*!
      * \brief Obtain the current run number, start of run time, and set the run
      *        string based on the RunParams ISInfoDictionary
@@ -126,11 +227,34 @@ namespace nsw {
   protected:
     [[nodiscard]] const hw::DeviceManager& getDeviceManager() const { return m_deviceManager.get(); }
 
+    /*!
+     * \brief Throw nsw::calib::Aborted if an abort was requested
+     *
+     * To be called in long loops, e.g. over devices or polling iterations
+     */
+    void checkAbort() const;
+
+    /*!
+     * \brief Sleep which is interrupted by \c abort
+     *
+     * To be used instead of std::this_thread::sleep_for in the calibration steps
+     *
+     * \throws nsw::calib::Aborted if an abort was requested
+     */
+    template<typename Rep, typename Period>
+    void sleepFor(const std::chrono::duration<Rep, Period>& duration) const {
+      {
+        std::unique_lock lock(m_sleepMutex);
+        m_sleepCondition.wait_for(lock, stopToken(), duration, []() { return false; });
+      }
+      checkAbort();
+    }
+
     /*!
      * \brief Construct the output path for calibration output files for a given run
      *
-     * The format will be the base output directory taken from OKS
-     * (m_out_path), the calibration type (m_calibType), and the run
+     * The format will be the base output directory (m_out_path, see
+     * \c setOutputPath), the calibration type (m_calibType), and the run
      * identifier (m_run_string)
      *
      * \returns std::filesystem::path corresponding to the location
@@ -142,8 +266,8 @@ namespace nsw {
     /*!
      * \brief Construct the full path for an output file
      *
-     * The format will be the base output directory taken from OKS
-     * (m_out_path), the calibration type (m_calibType), the run
+     * The format will be the base output directory (m_out_path, see
+     * \c setOutputPath), the calibration type (m_calibType), the run
      * identifier (m_run_string), and finally the filename (fname)
      *
      * \param fname Name of the output file
@@ -153,12 +277,56 @@ namespace nsw {
     [[nodiscard]]
     std::filesystem::path getOutputPath(const std::string& fname) const { return getOutputDir()/fname;}
 
+    /*!
+     * \brief Register an output file so that it is recorded in the checkpoint
+     *
+     * \param key Identifies the output within the calibration, e.g. "nsw"
+     * \param fname Name to use for a new output file
+     *
+     * \returns fname, or the name used by the interrupted process when resuming
+     */
+    std::string outputFileName(const std::string& key, const std::string& fname) const;
+
+    /*!
+     * \brief Open a text output file registered with \c outputFileName
+     *
+     * The file is truncated when it is first opened by a calibration which
+     * is not resuming, and appended to otherwise, so that it can be opened
+     * again at every iteration.
+     *
+     * \param key Identifies the output within the calibration, e.g. "txt"
+     * \param fname Name to use for a new output file
+     */
+    std::ofstream openOutputText(const std::string& key, const std::string& fname) const;
+
+    /*!
+     * \brief TFile mode for output files: "recreate", or "update" when resuming
+     */
+    [[nodiscard]]
+    const char* outputFileMode() const { return m_resuming ? "update" : "recreate"; }
+
+    /*!
+     * \brief Make a TTree part of the checkpoint
+     *
+     * To be called once the branches are created. When resuming, the
+     * entries saved by the interrupted process are copied into the tree
+     * before any new entry is filled.
+     */
+    void attachTree(TFile& file, TTree& tree);
+
+    /*!
+     * \brief Write an attached TTree and close its file
+     */
+    void writeTree(TFile& file, TTree& tree);
+
   private:
+    [[nodiscard]] std::filesystem::path getCheckpointPath() const;
+
     // "progress bar"
     void setStartTime() {m_time_start = std::chrono::system_clock::now();}
     void setElapsedSeconds() {m_elapsed_seconds = std::chrono::system_clock::now() - m_time_start;}
     double elapsedSeconds() const {return m_elapsed_seconds.count();}
-    double rate() const {return elapsedSeconds() > 0 ? static_cast<double>(m_counter) / elapsedSeconds() : -1;}
+    double rate() const {return elapsedSeconds() > 0 ? static_cast<double>(m_counter - m_first_counter) / elapsedSeconds() : -1;}
     double remainingSeconds() const {return static_cast<double>(m_total-m_counter)/rate();}
 
   protected:
@@ -174,7 +342,23 @@ namespace nsw {
   private:
     std::reference_wrapper<const hw::DeviceManager> m_deviceManager;  //!< Device Manager
     std::string m_name;      //!< Calibration application nam
-    std::string m_out_path;  //!< Calibration output base path, taken from OKS
+    std::string m_out_path;  //!< Calibration output base path, taken from OKS or the command line
+    std::string m_calib_key_name{DEFAULT_CALIB_KEY_NAME};  //!< IS name of the calibration key
+
+    std::size_t m_first_counter{0};  //!< First iteration run by this process
+    bool m_resuming{false};          //!< Calibration continues from a checkpoint
+    mutable std::mutex m_output_mutex;  //!< Output files can be registered from worker threads
+    mutable std::map<std::string, std::string> m_output_files;  //!< Output files recorded in the checkpoint
+    mutable std::set<std::string> m_text_outputs;  //!< Text outputs opened by this process
+    std::vector<std::pair<TFile*, TTree*>> m_attached_trees;  //!< TTrees saved at each checkpoint
+
+    //! Token of the current abort requests, which \c restart replaces
+    std::stop_token stopToken() const { std::scoped_lock lock(m_stopMutex); return m_stop.get_token(); }
+
+    std::stop_source m_stop{};                           //!< Abort requests, guarded by m_stopMutex
+    mutable std::mutex m_stopMutex;                      //!< abort may be called from another thread
+    mutable std::mutex m_sleepMutex;                     //!< Used by sleepFor
+    mutable std::condition_variable_any m_sleepCondition;  //!< Woken up by abort
 
     std::chrono::time_point<std::chrono::system_clock> m_time_start;  //!< Calibration start time
     std::chrono::duration<double> m_elapsed_seconds{0};  //!< Duration of the calibration
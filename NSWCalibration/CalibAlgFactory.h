@@ -0,0 +1,28 @@
+#ifndef NSWCALIBRATION_CALIBALGFACTORY_H
+#define NSWCALIBRATION_CALIBALGFACTORY_H
+
+#include <memory>
+#include <string>
+
+#include "NSWCalibration/CalibAlg.h"
+
+namespace nsw {
+  /*!
+   * \brief Create the calibration algorithm corresponding to a calibration type
+   *
+   * Shared by the run control application (\c NSWCalibRc) and the
+   * standalone driver (\c nsw_calib_run), so that both support the
+   * same set of calibration types.
+   *
+   * \param calibType Calibration type, e.g. \tt MMARTPhase or \tt sTGCPadTriggerInputDelays
+   * \param deviceManager Devices the calibration will act on
+   *
+   * \returns the calibration object, not yet set up
+   *
+   * \throws std::runtime_error if the calibration type is unknown
+   */
+  [[nodiscard]] std::unique_ptr<CalibAlg> makeCalibAlg(const std::string& calibType,
+                                                       const hw::DeviceManager& deviceManager);
+}  // namespace nsw
+
+#endif
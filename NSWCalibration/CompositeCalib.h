@@ -0,0 +1,131 @@
+#ifndef NSWCALIBRATION_COMPOSITECALIB_H
+#define NSWCALIBRATION_COMPOSITECALIB_H
+
+/**
+ * \brief Run several calibrations on disjoint sets of devices in one run
+ *
+ * Each sub-calibration is created with the calibration factory and
+ * gets its own DeviceManager, holding only the elements of the
+ * configuration whose name contains one of its filters. The sets of
+ * devices must not overlap.
+ *
+ * The calibration parameters list the sub-calibrations, separated by ';':
+ *   <calibType>@<filter>[+<filter>...][:<calibParams>]
+ * and optionally the mode:
+ *   mode=lockstep (default): all sub-calibrations are iterated together,
+ *     the calibration has as many iterations as the longest one
+ *   mode=independent: sub-calibrations which do not need the ALTI run
+ *     their own loop in a separate thread, the others are iterated
+ *     together
+ *
+ * e.g.
+ *   RocPhase40MHzCore@MMFE8;sTGCPadTriggerInputDelays@PadTrig;mode=independent
+ *
+ * The ALTI sequences of the iterated sub-calibrations are merged: for
+ * each period (before, during, after), all sub-calibrations requesting
+ * commands must request the same ones.
+ *
+ * Resuming a composite calibration from a checkpoint is not supported.
+ */
+
+#include <future>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <ers/Issue.h>
+
+#include "NSWCalibration/CalibAlg.h"
+#include "NSWCalibration/Commands.h"
+
+ERS_DECLARE_ISSUE(nsw,
+                  NSWCompositeCalibIssue,
+                  message,
+                  ((std::string)message)
+                  )
+
+namespace nsw {
+
+  class CompositeCalib : public CalibAlg {
+
+  public:
+    /**
+     * \brief Description of a sub-calibration, as given in the calibration parameters
+     */
+    struct SubCalibParameters {
+      std::string calibType{};
+      std::vector<std::string> filters{};
+      std::string calibParams{};
+    };
+
+    struct Parameters {
+      std::vector<SubCalibParameters> subCalibs{};
+      bool independent{false};
+    };
+
+    CompositeCalib(std::string calibType, const hw::DeviceManager& deviceManager);
+
+    void setup(const std::string& db) override;
+    void configure() override;
+    void acquire() override;
+    void unconfigure() override;
+    [[nodiscard]] nsw::commands::Commands getAltiSequences() const override;
+    void setCalibParamsFromIS(const ISInfoDictionary& is_dictionary, const std::string& is_db_name) override;
+    void setCalibParams(const std::string& calibParams) override;
+    void setCalibKeyToIS(const ISInfoDictionary& is_dictionary) override;
+    void abort() override;
+    void closeOutputs() override;
+
+    /**
+     * \brief Parse the calibration parameter string
+     *
+     * \throws NSWCompositeCalibIssue if the string is malformed
+     */
+    static Parameters parseCalibParams(const std::string& calibParams);
+
+    /**
+     * \brief Merge the ALTI sequences of several calibrations
+     *
+     * \throws NSWCompositeCalibIssue if two calibrations request
+     *         different commands in the same period
+     */
+    static nsw::commands::Commands mergeAltiSequences(const std::vector<nsw::commands::Commands>& sequences);
+
+  private:
+    struct SubCalib {
+      SubCalibParameters params{};
+      std::unique_ptr<hw::DeviceManager> devices{};
+      std::unique_ptr<CalibAlg> calib{};
+      bool freeRunning{false};
+    };
+
+    /**
+     * \brief Build the device sets and the sub-calibration objects
+     */
+    void makeSubCalibs(const std::string& db);
+
+    /**
+     * \brief Pass the application settings of the composite to a sub-calibration
+     */
+    void forwardSettings(CalibAlg& calib) const;
+
+    /**
+     * \brief Run the full loop of a sub-calibration which does not need the ALTI
+     */
+    static void runFreely(CalibAlg& calib);
+
+    /**
+     * \brief Wait for the free running sub-calibrations, and rethrow their failures
+     */
+    void joinFreeRunning();
+
+    [[nodiscard]] bool active(const SubCalib& sub) const;
+
+    Parameters m_params{};
+    std::vector<SubCalib> m_subCalibs{};
+    std::vector<std::future<void>> m_freeRunning{};
+  };
+
+}  // namespace nsw
+
+#endif
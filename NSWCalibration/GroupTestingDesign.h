@@ -0,0 +1,69 @@
+#ifndef NSWCALIBRATION_GROUPTESTINGDESIGN_H
+#define NSWCALIBRATION_GROUPTESTINGDESIGN_H
+
+/**
+ * \brief Pooled measurement of channel rates (sTGCPadsHitRateScaMultiplexed)
+ *
+ * Instead of opening one channel per measurement, each measurement opens a
+ * set of channels and measures the sum of their rates:
+ *
+ *   y_row = sum over the open channels of x_channel
+ *
+ * Row 0 opens all channels. In the other rows, each channel is open in a
+ * fixed number of rows, and no two channels are open in the same rows (a
+ * constant weight code, in a fixed pseudo-random order), so that a single
+ * active channel is identified exactly and the rows are balanced.
+ *
+ * The rates are decoded with non-negative least squares (Lawson-Hanson).
+ * With fewer rows than channels this is exact only if few channels have a
+ * rate, which is the case of noisy channels above the nominal threshold.
+ * The residual of the fit is given to spot the measurements where it is
+ * not.
+ */
+
+#include <cstdint>
+#include <vector>
+
+namespace nsw {
+
+  class GroupTestingDesign {
+  public:
+    struct Decoded {
+      std::vector<double> rates{};  //!< Per channel
+      double residual{0};           //!< Norm of the difference between the measured and the fitted rows
+    };
+
+    /**
+     * \param numChannels Number of channels
+     * \param numRows Number of measurements
+     *
+     * \throws std::runtime_error if there are not enough rows for distinct channels
+     */
+    GroupTestingDesign(std::size_t numChannels, std::size_t numRows);
+
+    /// Smallest number of rows for distinct channels
+    [[nodiscard]] static std::size_t minRows(std::size_t numChannels);
+
+    [[nodiscard]] std::size_t getNumChannels() const { return m_numChannels; }
+    [[nodiscard]] std::size_t getNumRows() const { return m_rows.size(); }
+
+    [[nodiscard]] bool isOpen(std::size_t row, std::size_t channel) const;
+
+    /// Channels open in a row
+    [[nodiscard]] std::vector<std::uint32_t> getOpenChannels(std::size_t row) const;
+
+    /**
+     * \brief Rates of the channels from the rates of the rows
+     *
+     * \throws std::runtime_error if the number of rates is not the number of rows
+     */
+    [[nodiscard]] Decoded decode(const std::vector<double>& rowRates) const;
+
+  private:
+    std::size_t m_numChannels;
+    std::vector<std::vector<bool>> m_rows{};
+  };
+
+}  // namespace nsw
+
+#endif
@@ -59,6 +59,19 @@ namespace nsw {
                       ((std::string)setCommand)
                       ((std::string)paramDefault)
                       )
+
+    /**
+     * \brief Thrown from a calibration step interrupted by an abort request
+     *
+     * \param calibType is the calibration type
+     * \param iteration is the iteration which was interrupted
+     */
+    ERS_DECLARE_ISSUE(calib,
+                      Aborted,
+                      fmt::format("{} aborted at iteration {}", calibType, iteration),
+                      ((std::string)calibType)
+                      ((std::size_t)iteration)
+                      )
 }
 
 #endif
@@ -0,0 +1,122 @@
+#ifndef NSWCALIBRATION_MMARTCONNECTIVITYANALYZER_H
+#define NSWCALIBRATION_MMARTCONNECTIVITYANALYZER_H
+
+/**
+ * \brief Online analysis of the ART hit counters of MMARTConnectivityTest
+ *
+ * After each iteration, the increase of the hit counter of every ART
+ * input is compared with the test pulses of the iteration. An input
+ * responds to an iteration if its counter increased by at least
+ * \c minHits. The response is accumulated per group of pulsed MMFE8s
+ * (the MMFE8 names of the iteration) and per pulsed channel, identified
+ * by its MMFE8, VMM and channel number. An ART input carries one VMM of
+ * one of the MMFE8s of the ART, so only the pulsed channels of that VMM
+ * are credited to it.
+ *
+ * At the end, the home group of an input is the group it responds to
+ * most often. For each input:
+ *   - efficiency: response fraction to its home group, per channel and
+ *     in total
+ *   - crosstalk: response fraction to the other groups
+ *   - status: dead (no response), crosstalk (responds to other groups
+ *     more than \c maxCrosstalk), inefficient (a channel of the home group
+ *     responds less than \c minEfficiency), or ok
+ *
+ * Only the iterations seen by this process are analyzed: after a resume,
+ * the summary covers the iterations since the resume.
+ */
+
+#include <compare>
+#include <cstdint>
+#include <map>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include <boost/property_tree/ptree.hpp>
+
+#include "NSWCalibration/MMTriggerPlan.h"
+
+namespace nsw {
+
+  class MMARTConnectivityAnalyzer {
+  public:
+    /// Hit counters of all inputs, per ART
+    using Counters = std::map<std::string, std::vector<std::uint32_t>>;
+
+    /// A pulsed channel, on one VMM of one MMFE8
+    struct Channel {
+      std::string feb{};
+      std::size_t vmm{};
+      std::size_t channel{};
+
+      [[nodiscard]] std::string toString() const;  //!< MMFE8/VMM/channel, e.g. MMFE8_L1P1_HOR/3/17
+      auto operator<=>(const Channel&) const = default;
+    };
+
+    struct Verdict {
+      std::string art{};
+      std::size_t input{};
+      std::string status{};
+      std::optional<std::size_t> home{};  //!< Index of the home group, none if dead
+      double efficiency{0};
+      double crosstalk{0};
+      std::vector<Channel> failingChannels{};  //!< Channels of the home group below minEfficiency
+    };
+
+    explicit MMARTConnectivityAnalyzer(std::uint32_t minHits = 1, double minEfficiency = 0.5, double maxCrosstalk = 0.1);
+
+    /**
+     * \brief Set the counters before the first test pulse
+     */
+    void setBaseline(const Counters& counters);
+
+    /**
+     * \brief Accumulate the counters read after an iteration
+     *
+     * A counter lower than the previous reading was reset, and its value
+     * is taken as the increase. Iterations without pulsed channels only
+     * update the previous readings.
+     */
+    void addIteration(const mmtrigger::Iteration& iteration, const Counters& counters);
+
+    /**
+     * \brief Verdicts of all inputs, ordered by ART and input
+     */
+    [[nodiscard]] std::vector<Verdict> getVerdicts() const;
+
+    /**
+     * \brief Summary of the groups and of the verdicts and response fractions of all inputs
+     */
+    [[nodiscard]] boost::property_tree::ptree getSummary() const;
+
+    [[nodiscard]] const std::vector<std::string>& getGroups() const { return m_groups; }
+    [[nodiscard]] std::size_t getNumIterations() const { return m_iterations; }
+
+  private:
+    struct Response {
+      std::size_t pulsed{0};
+      std::size_t responded{0};
+    };
+
+    struct Input {
+      std::uint32_t last{0};
+      std::map<std::size_t, std::map<Channel, Response>> responses{};  //!< Per group, per channel
+    };
+
+    /// VMM read out by an ART input, the inputs are ordered by MMFE8 then VMM
+    [[nodiscard]] static std::size_t vmmOf(std::size_t input);
+    [[nodiscard]] std::size_t groupIndex(const mmtrigger::Iteration& iteration);
+    [[nodiscard]] Verdict judge(const std::string& art, std::size_t index, const Input& input) const;
+
+    std::uint32_t m_minHits;
+    double m_minEfficiency;
+    double m_maxCrosstalk;
+    std::size_t m_iterations{0};
+    std::vector<std::string> m_groups{};
+    std::map<std::string, std::vector<Input>> m_arts{};
+  };
+
+}  // namespace nsw
+
+#endif
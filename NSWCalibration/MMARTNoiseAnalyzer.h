@@ -0,0 +1,90 @@
+#ifndef NSWCALIBRATION_MMARTNOISEANALYZER_H
+#define NSWCALIBRATION_MMARTNOISEANALYZER_H
+
+/**
+ * \brief Noise rates of the ART inputs, sampled continuously (MMCableNoiseSampling)
+ *
+ * The ART hit counters are read at a fixed cadence without any test
+ * pulse. Each reading gives the rate of every input since the previous
+ * one. Per input, the mean and variance of the rate are accumulated
+ * (Welford), and the rate time series is kept to find bursts.
+ *
+ * A sample is a burst if its rate exceeds the median rate of the input by
+ * more than \c threshold times its spread. The spread is the larger of the
+ * median absolute deviation (scaled to a gaussian sigma) and the Poisson
+ * error of the median, so that a quiet input does not flag single hits.
+ * The median is used rather than the mean so that the bursts themselves do
+ * not hide each other.
+ */
+
+#include <cstdint>
+#include <map>
+#include <string>
+#include <vector>
+
+#include <boost/property_tree/ptree.hpp>
+
+namespace nsw {
+
+  class MMARTNoiseAnalyzer {
+  public:
+    /// Hit counters of all inputs, per ART
+    using Counters = std::map<std::string, std::vector<std::uint32_t>>;
+
+    struct InputSummary {
+      std::size_t samples{0};
+      double mean{0};      //!< Hz
+      double variance{0};  //!< Hz^2
+      double max{0};       //!< Hz
+      std::vector<std::size_t> bursts{};  //!< Samples above the burst threshold
+    };
+
+    /**
+     * \param threshold Burst threshold, in units of the spread of the rate
+     */
+    explicit MMARTNoiseAnalyzer(double threshold = 5.);
+
+    /**
+     * \brief Accumulate the counters read at \c time (seconds)
+     *
+     * The first reading is the baseline. A counter lower than the previous
+     * reading was reset, and its value is taken as the increase.
+     */
+    void addSample(const Counters& counters, double time);
+
+    /**
+     * \brief Statistics of one input, the bursts are searched on each call
+     */
+    [[nodiscard]] InputSummary getInputSummary(const std::string& art, std::size_t input) const;
+
+    /**
+     * \brief Per ART: total rate, noisy inputs and bursts, and the statistics of all inputs
+     */
+    [[nodiscard]] boost::property_tree::ptree getSummary() const;
+
+    /// Number of rate samples, the baseline excluded
+    [[nodiscard]] std::size_t getNumSamples() const { return m_intervals.size(); }
+
+    /// Total sampled time, in seconds
+    [[nodiscard]] double getLiveTime() const;
+
+  private:
+    struct Input {
+      std::uint32_t last{0};
+      double mean{0};
+      double m2{0};  //!< Sum of the squared deviations from the mean
+      std::vector<float> rates{};
+    };
+
+    std::vector<std::size_t> findBursts(const Input& input) const;
+
+    double m_threshold;
+    bool m_hasBaseline{false};
+    double m_lastTime{0};
+    std::vector<double> m_intervals{};  //!< Duration of each sample, in seconds
+    std::map<std::string, std::vector<Input>> m_arts{};
+  };
+
+}  // namespace nsw
+
+#endif
@@ -0,0 +1,91 @@
+#ifndef NSWCALIBRATION_MMARTPHASESCAN_H
+#define NSWCALIBRATION_MMARTPHASESCAN_H
+
+/**
+ * \brief Adaptive scan of the ART input phases (MMARTPhase)
+ *
+ * MMARTPhase pulses each connectivity pattern once per ART input phase.
+ * After each phase, the ART hit counters are compared with the previous
+ * reading: the score of an ART for the phase is the number of its inputs
+ * whose counter increased by at least \c minHits. A phase is good for an
+ * ART if its score is not 0 and at least \c fraction of the best score
+ * of the ART in the same pattern.
+ *
+ * An ART converges once a window of at least \c width contiguous good
+ * phases is bracketed by bad phases. Its center phase is kept for the rest
+ * of the run. Once all ARTs converged, the remaining iterations can be
+ * skipped.
+ */
+
+#include <cstdint>
+#include <map>
+#include <optional>
+#include <string>
+#include <vector>
+
+namespace nsw {
+
+  class MMARTPhaseScan {
+  public:
+    /// Hit counters of all inputs, per ART
+    using Counters = std::map<std::string, std::vector<std::uint32_t>>;
+
+    struct Window {
+      int first{};   //!< First good phase
+      int last{};    //!< Last good phase
+      int center{};  //!< Phase to use
+    };
+
+    /**
+     * \param arts ARTs to scan, all of them must converge
+     * \param phases Phases in the order they are scanned
+     * \param width Minimum number of contiguous good phases
+     * \param minHits Minimum counter increase of a responding input
+     * \param fraction Minimum score of a good phase, relative to the best
+     *
+     * \throws std::runtime_error if the width is 0 or larger than the number of phases
+     */
+    MMARTPhaseScan(std::vector<std::string> arts, std::vector<int> phases, std::size_t width,
+                   std::uint32_t minHits = 1, double fraction = 1.);
+
+    /**
+     * \brief Set the counters before the first test pulse
+     */
+    void setBaseline(const Counters& counters);
+
+    /**
+     * \brief Accumulate the counters read after pulsing with a phase
+     *
+     * The scores of the previous pattern are cleared when the first phase
+     * is scanned again.
+     */
+    void addPhase(int phase, const Counters& counters);
+
+    [[nodiscard]] bool isConverged(const std::string& art) const;
+    [[nodiscard]] bool allConverged() const;
+    [[nodiscard]] std::size_t numConverged() const;
+
+    /**
+     * \brief Good window of an ART, if it converged
+     */
+    [[nodiscard]] std::optional<Window> getWindow(const std::string& art) const;
+
+  private:
+    struct Art {
+      std::vector<std::uint32_t> last{};        //!< Previous counters
+      std::map<int, std::size_t> scores{};      //!< Score per phase, in the current pattern
+      std::optional<Window> window{};
+    };
+
+    [[nodiscard]] std::optional<Window> findWindow(const Art& art) const;
+
+    std::vector<int> m_phases;
+    std::size_t m_width;
+    std::uint32_t m_minHits;
+    double m_fraction;
+    std::map<std::string, Art> m_arts{};
+  };
+
+}  // namespace nsw
+
+#endif
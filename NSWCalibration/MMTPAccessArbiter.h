@@ -0,0 +1,99 @@
+#ifndef NSWCALIBRATION_MMTPACCESSARBITER_H
+#define NSWCALIBRATION_MMTPACCESSARBITER_H
+
+/**
+ * \brief Serializes the SCAX accesses to the MMTPs of a calibration
+ *
+ * The TP configuration and the monitoring of the TP registers (e.g. the
+ * ADDC-TP watchdog) run in different threads, and must not access the
+ * SCAX at the same time. A thread holds the access for a whole batch of
+ * register accesses, through the \ref Access returned by \ref acquire.
+ *
+ * Waiting threads are served by priority, then in order of arrival:
+ * a pending configuration is granted the access before any pending
+ * monitoring read. The number of accesses and the time spent waiting
+ * are counted for each priority.
+ */
+
+#include <array>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <utility>
+
+namespace nsw {
+
+  class MMTPAccessArbiter {
+  public:
+    enum class Priority : std::size_t {
+      Configuration = 0,  //!< Writes of the TP configuration, served first
+      Monitoring = 1,     //!< Reads of the TP registers
+    };
+
+    /**
+     * \brief Access to the SCAX, released when destroyed
+     */
+    class Access {
+    public:
+      Access(const Access&) = delete;
+      Access& operator=(const Access&) = delete;
+      Access(Access&& other) noexcept : m_arbiter{std::exchange(other.m_arbiter, nullptr)} {}
+      Access& operator=(Access&&) = delete;
+      ~Access() {
+        if (m_arbiter != nullptr) {
+          m_arbiter->release();
+        }
+      }
+
+    private:
+      friend class MMTPAccessArbiter;
+      explicit Access(MMTPAccessArbiter& arbiter) : m_arbiter{&arbiter} {}
+
+      MMTPAccessArbiter* m_arbiter;
+    };
+
+    struct Statistics {
+      std::size_t accesses{0};   //!< Number of accesses granted
+      std::size_t contended{0};  //!< Accesses which had to wait
+      std::chrono::microseconds waited{0};     //!< Total time spent waiting
+      std::chrono::microseconds maxWaited{0};  //!< Longest wait
+    };
+
+    /**
+     * \brief Wait for the access to the SCAX
+     *
+     * \param priority Priority of the access
+     * \returns The access, released when it goes out of scope
+     */
+    [[nodiscard]] Access acquire(Priority priority);
+
+    /**
+     * \brief Statistics of the accesses with a given priority
+     */
+    [[nodiscard]] Statistics getStatistics(Priority priority) const;
+
+    /**
+     * \brief Log the statistics of all priorities
+     *
+     * \param name Name of the owner, for the log message
+     */
+    void logStatistics(const std::string& name) const;
+
+  private:
+    void release();
+
+    static constexpr std::size_t NUM_PRIORITIES{2};
+
+    mutable std::mutex m_mutex;
+    std::condition_variable m_condition;
+    bool m_busy{false};
+    std::array<std::uint64_t, NUM_PRIORITIES> m_nextTicket{};  //!< Next ticket handed out, per priority
+    std::array<std::uint64_t, NUM_PRIORITIES> m_served{};      //!< Tickets granted so far, per priority
+    std::array<Statistics, NUM_PRIORITIES> m_statistics{};
+  };
+
+}  // namespace nsw
+
+#endif
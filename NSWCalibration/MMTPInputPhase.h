@@ -10,6 +10,7 @@
 #include <vector>
 
 #include "NSWCalibration/CalibAlg.h"
+#include "NSWCalibration/MMTPAccessArbiter.h"
 #include "NSWConfiguration/hw/MMTP.h"
 
 #include "ers/Issue.h"
@@ -43,6 +44,10 @@ namespace nsw {
     int configure_tp(const nsw::hw::MMTP & tp, uint32_t phase, uint32_t AddcOffset) const;
     int read_tp     (const nsw::hw::MMTP & tp, uint32_t phase, uint32_t AddcOffset);
 
+  private:
+    /// serializes the TP SCAX accesses of configure_tp and read_tp
+    mutable MMTPAccessArbiter m_tpAccess;
+
   private:
     /// output text file of TP SCAX reads
     std::ofstream m_myfile;
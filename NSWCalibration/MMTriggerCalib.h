@@ -6,10 +6,17 @@
 //
 
 #include <future>
+#include <set>
 #include <string>
 #include <vector>
 
 #include "NSWCalibration/CalibAlg.h"
+#include "NSWCalibration/MMARTConnectivityAnalyzer.h"
+#include "NSWCalibration/MMARTNoiseAnalyzer.h"
+#include "NSWCalibration/MMARTPhaseScan.h"
+#include "NSWCalibration/MMTPAccessArbiter.h"
+#include "NSWCalibration/MMTriggerDeviceIndex.h"
+#include "NSWCalibration/MMTriggerPlan.h"
 
 #include "NSWConfiguration/hw/MMTP.h"
 
@@ -28,6 +35,7 @@ ERS_DECLARE_ISSUE(nsw,
 namespace nsw {
   namespace hw {
     class ADDC;
+    class ART;
   }
 
   class MMTriggerCalib: public CalibAlg {
@@ -43,16 +51,31 @@ namespace nsw {
     nsw::commands::Commands getAltiSequences() const override;
     void setCalibParamsFromIS(const ISInfoDictionary& is_dictionary, const std::string& is_db_name) override;
 
+    //
+    // For MMTrackPulserTest, the calibration parameter is the track pattern file.
+    // For MMARTPhase, key=value parameters of the adaptive phase scan:
+    //   adaptive (1), window (3), min_hits (1), fraction (1)
+    // For MMCableNoiseSampling, key=value parameters of the sampling:
+    //   period (1 s), duration (100 s), threshold (5 sigma)
+    //
+    void setCalibParams(const std::string& calibParams) override;
+
   public:
-    boost::property_tree::ptree patterns() const;
+    //
+    // Generate the patterns of all iterations, once in setup
+    //
+    mmtrigger::Plan makePlan() const;
     template <class T>
       std::vector<T> make_objects(const std::string& cfg, std::string element_type, std::string name = "");
-    int pattern_number(const std::string& name) const;
-    int configure_febs_from_ptree(const boost::property_tree::ptree& tr, bool unmask);
-    int configure_addcs_from_ptree(const boost::property_tree::ptree& tr);
-    int configure_vmms(nsw::hw::FEB feb, const boost::property_tree::ptree& febpatt, bool unmask) const ;
+    //
+    // Report the MMFE8s and ADDCs of the plan which are not in the configuration
+    //
+    void checkPlanDevices() const;
+    int configure_febs(const mmtrigger::Iteration& iteration, bool unmask);
+    int configure_addcs(const mmtrigger::Iteration& iteration);
+    int configure_vmms(nsw::hw::FEB feb, const mmtrigger::FebPattern& febpatt, bool unmask) const ;
     int configure_art_input_phase(const nsw::hw::ADDC& addc, uint phase) const;
-    int configure_tps(const boost::property_tree::ptree& tr);
+    int configure_tps();
     int addc_tp_watchdog();
     void recordPattern();
 
@@ -65,29 +88,74 @@ namespace nsw {
     //
     int read_arts_counters();
 
+    //
+    // Read the hit counters of all ART ASICs in parallel, keyed by art_key
+    //
+    MMARTConnectivityAnalyzer::Counters read_all_art_counters() const;
+    static std::string art_key(const nsw::hw::ADDC& addc, const nsw::hw::ART& art);
+
+    //
+    // On the last iteration: close the ROOT file, write the summaries
+    //
+    void close_arts_counters();
+
+    //
+    // Write the connectivity summary (json) and the failing inputs (txt)
+    //
+    void write_connectivity_summary() const;
+
+    //
+    // Write the center of the good ART phase window of each ART (json),
+    // by ADDC SCA address and ART name
+    //
+    void write_art_phase_patch() const;
+
+    //
+    // MMCableNoiseSampling: read the ART counters every m_noisePeriod
+    // during m_noiseDuration, and write the noise summary (json)
+    //
+    void sample_arts_noise();
+    void write_noise_summary() const;
+
     //
     // https://espace.cern.ch/ATLAS-NSW-ELX/Shared%20Documents/ART/art2_registers_v.xlsx
     //
     std::vector<uint32_t> read_art_counters(const nsw::hw::ART& art) const;
     int wait_until_done();
-    int announce(const std::string& name, const boost::property_tree::ptree& tr, bool unmask) const;
+    int announce(const mmtrigger::FebPatternSet& set, bool unmask) const;
 
   private:
     std::string                    m_trackPatternFile;
     std::vector<int>               m_phases = {};
 
     bool m_connectivity = false;
+    bool m_analyzeConnectivity = false;
     bool m_tracks = false;
     bool m_noise = false;
+    bool m_noiseSampling = false;
     bool m_latency = false;
     bool m_staircase = false;
     bool m_dry_run = false;
     bool m_reset_vmm = false;
-    boost::property_tree::ptree m_patterns;
+    mmtrigger::Plan m_plan;  //!< Patterns, indexed by iteration
+    std::unique_ptr<MMTriggerDeviceIndex> m_devices;  //!< MMFE8s and ADDCs by name, built in setup
+    std::unique_ptr<MMARTConnectivityAnalyzer> m_analyzer;  //!< Connectivity verdicts, if m_analyzeConnectivity
+    std::unique_ptr<MMARTPhaseScan> m_phaseScan;  //!< Adaptive MMARTPhase scan, if m_adaptivePhases
+    std::set<std::string> m_centeredArts{};  //!< Converged ARTs already set to their center phase
+    bool m_adaptivePhases = true;
+    std::size_t m_phaseWindow = 3;
+    std::uint32_t m_phaseMinHits = 1;
+    double m_phaseFraction = 1.;
+    std::unique_ptr<MMARTNoiseAnalyzer> m_noiseAnalyzer;  //!< Noise rates, if m_noiseSampling
+    double m_noisePeriod = 1.;      //!< s
+    double m_noiseDuration = 100.;  //!< s
+    double m_noiseThreshold = 5.;
+    bool m_skipIteration = false;  //!< Iteration not needed by the adaptive scan
+    bool m_febsUnmasked = false;   //!< Test pulse enabled by configure_febs
     std::unique_ptr<std::vector<std::future<int> > > m_threads = nullptr;
     std::future<int>  m_watchdog;
     std::future<void> m_writePattern;
-    mutable std::atomic<bool> m_tpscax_busy = false;
+    MMTPAccessArbiter m_tpAccess;  //!< Between configure_tps and addc_tp_watchdog
 
     std::unique_ptr<TFile> m_art_rfile;
     std::shared_ptr<TTree> m_art_rtree;
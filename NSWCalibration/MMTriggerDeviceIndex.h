@@ -0,0 +1,67 @@
+#ifndef NSWCALIBRATION_MMTRIGGERDEVICEINDEX_H
+#define NSWCALIBRATION_MMTRIGGERDEVICEINDEX_H
+
+/**
+ * \brief Lookup of the MMFE8s and ADDCs named in MM trigger patterns
+ *
+ * Patterns refer to MMFE8s by their legacy name (MMFE8_L1P1_HOR) or
+ * SCA address, optionally with a geo name (L7/R0) matching the end of
+ * the SCA address, and to ADDCs by SCA address or by a part of it.
+ * The index is built once, so that configuring a pattern does not
+ * compare every name of the pattern with every device.
+ */
+
+#include <map>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "NSWConfiguration/hw/DeviceManager.h"
+
+namespace nsw {
+  namespace hw {
+    class ADDC;
+    class FEB;
+  }
+
+  class MMTriggerDeviceIndex {
+  public:
+    explicit MMTriggerDeviceIndex(const hw::DeviceManager& deviceManager);
+
+    /**
+     * \brief Find the MMFE8 of a pattern
+     *
+     * \param name Legacy name or SCA address
+     * \param geoName Geo name, e.g. L7/R0. Ignored if empty.
+     *
+     * \returns the device, or nullptr if it is not in the configuration
+     */
+    [[nodiscard]] const hw::FEB* findFeb(const std::string& name, const std::string& geoName = "") const;
+
+    /**
+     * \brief Find the ADDCs to configure in a pattern
+     *
+     * All ADDCs are returned if either name is empty, as in the patterns
+     * which do not target ADDCs. Otherwise, the ADDCs with SCA address
+     * \c nameOld or whose address contains \c nameGeo. The result of the
+     * search for a geo name is cached.
+     */
+    [[nodiscard]] std::vector<const hw::ADDC*> findAddcs(const std::string& nameOld, const std::string& nameGeo) const;
+
+    /**
+     * \brief Geo name of an SCA address: its last two components (e.g. L7/R0)
+     */
+    [[nodiscard]] static std::string geoNameOf(const std::string& address);
+
+  private:
+    std::unordered_map<std::string, const hw::FEB*> m_febsByAddress{};
+    std::unordered_map<std::string, const hw::FEB*> m_febsByGeoName{};
+    std::vector<const hw::ADDC*> m_addcs{};
+
+    mutable std::mutex m_mutex;
+    mutable std::map<std::string, std::vector<const hw::ADDC*>> m_addcSearches{};  //!< Memoized searches
+  };
+}  // namespace nsw
+
+#endif
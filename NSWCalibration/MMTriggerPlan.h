@@ -0,0 +1,120 @@
+#ifndef NSWCALIBRATION_MMTRIGGERPLAN_H
+#define NSWCALIBRATION_MMTRIGGERPLAN_H
+
+/**
+ * \brief Iteration plan of the MM trigger calibrations (MMTriggerCalib)
+ *
+ * The patterns of all iterations are generated once, in setup, as a
+ * vector indexed by the iteration number. Each iteration refers to the
+ * set of MMFE8 test pulse patterns it uses; the sets are shared between
+ * iterations which only differ by the ART input phase, and between the
+ * patterns of a file which have the same name and content.
+ *
+ * The plan can be converted from and to the json layout used by the
+ * pattern record and by the track pulser pattern files. Numbers may be
+ * given as json numbers or as strings:
+ * \code{.json}
+ * {
+ *   "pattern_0": {
+ *     "tp_latency": "-1",
+ *     "art_input_phase": "0",
+ *     "addc_old": "...", "addc_geo": "...",
+ *     "febpattern_0": {
+ *       "MMFE8_L1P1_HOR": {"0": ["0", "1"], "1": ["0"], "geo_name": "L7/R0"}
+ *     }
+ *   }
+ * }
+ * \endcode
+ */
+
+#include <array>
+#include <cstdint>
+#include <istream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <boost/property_tree/ptree.hpp>
+
+#include "NSWConfiguration/Constants.h"
+
+namespace nsw::mmtrigger {
+
+  /**
+   * \brief Channels pulsed on one MMFE8
+   */
+  struct FebPattern {
+    std::string name{};     //!< Legacy name (MMFE8_L1P1_HOR) or SCA address
+    std::string geoName{};  //!< Geo name suffix (L7/R0), empty if not given
+    std::array<std::uint64_t, nsw::MAX_NUMBER_OF_VMM> channels{};  //!< One bit per channel, per VMM
+
+    void addChannel(std::size_t vmm, std::size_t channel);
+    [[nodiscard]] bool hasChannel(std::size_t vmm, std::size_t channel) const;
+    [[nodiscard]] std::vector<std::size_t> getChannels(std::size_t vmm) const;
+    [[nodiscard]] std::size_t countChannels() const;  //!< Channels of all VMMs
+
+    bool operator==(const FebPattern&) const = default;
+  };
+
+  /**
+   * \brief A named set of MMFE8 patterns, configured together
+   */
+  struct FebPatternSet {
+    std::string name{};  //!< e.g. febpattern_3
+    std::vector<FebPattern> febs{};
+
+    [[nodiscard]] std::size_t countChannels() const;  //!< Channels of all MMFE8s
+
+    bool operator==(const FebPatternSet&) const = default;
+  };
+
+  /**
+   * \brief Everything configured in one iteration
+   */
+  struct Iteration {
+    int tpLatency{-1};      //!< -1: not changed
+    int artInputPhase{-1};  //!< -1: not changed
+    std::string addcOld{};  //!< ADDC to configure (legacy name), empty for all
+    std::string addcGeo{};  //!< ADDC to configure (geo name), empty for all
+    std::vector<std::shared_ptr<const FebPatternSet>> febPatterns{};
+  };
+
+  using Plan = std::vector<Iteration>;
+
+  /**
+   * \brief Convert the plan to the json layout of the pattern files
+   */
+  [[nodiscard]] boost::property_tree::ptree toPtree(const Plan& plan);
+
+  /**
+   * \brief Build the plan from the json layout of the pattern files
+   *
+   * The iterations are ordered by the number of the pattern_N keys.
+   *
+   * \throws std::runtime_error if the pattern numbers are not 0 ... N-1,
+   *         or a VMM or channel is out of range
+   */
+  [[nodiscard]] Plan fromPtree(const boost::property_tree::ptree& tree);
+
+  /**
+   * \brief Build the plan from a pattern file, without a ptree
+   *
+   * The json is parsed as it is read, straight into the plan, so that large
+   * track pulser pattern files only take the memory of the plan. Same
+   * ordering and checks as fromPtree.
+   *
+   * \throws std::runtime_error if the json is malformed, in addition to
+   *         the errors of fromPtree
+   */
+  [[nodiscard]] Plan readPlan(std::istream& stream);
+
+  /**
+   * \brief Build the plan from a pattern file, see readPlan(std::istream&)
+   *
+   * \throws std::runtime_error if the file cannot be opened
+   */
+  [[nodiscard]] Plan readPlan(const std::string& filename);
+
+}  // namespace nsw::mmtrigger
+
+#endif
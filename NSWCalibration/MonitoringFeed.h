@@ -0,0 +1,173 @@
+#ifndef NSWCALIBRATION_MONITORINGFEED_H
+#define NSWCALIBRATION_MONITORINGFEED_H
+
+/**
+ * \brief Live feed of the monitoring readings, in POSIX shared memory
+ *
+ * The watchdogs which read counters or registers periodically (ART hit
+ * counters, TP fiber alignment) publish each reading in a ring buffer in
+ * shared memory (/dev/shm/<name>), which any number of readers can tail
+ * (see nsw_calib_monitor) without extra SCA reads.
+ *
+ * There is a single writer per feed, and no lock: each record is
+ * protected by its own sequence number (seqlock). Binary layout, native
+ * endianness:
+ *
+ * \code
+ * Header (64 bytes)
+ *   0  uint32  magic       0x4e535746 ("NSWF")
+ *   4  uint16  version     2
+ *   6  uint16  recordSize  216
+ *   8  uint32  capacity    number of records in the ring
+ *  12  uint32  (unused)
+ *  16  uint64  written     number of records written so far (atomic)
+ *  24  ...     (unused)
+ * Record i, at 64 + (i % capacity) * 216
+ *   0  uint64  sequence    2i+1 while being written, 2i+2 once complete (atomic)
+ *   8  uint64  time        ns since the epoch (system clock)
+ *  16  uint32  kind        1: ART hit rates, 2: TP fiber alignment
+ *  20  uint32  size        number of valid words in data
+ *  24  char[56] source     ADDC.ART or TP SCA address, null terminated
+ *  80  uint32[34] data     ART: rates in Hz per input (float bits)
+ *                          TP: alignment word, then one BCID per fiber
+ * \endcode
+ *
+ * The data holds the alignment word and the BCIDs of the 32 TP fibers,
+ * and is padded to 8 bytes. Longer data is not truncated: publishing it
+ * throws.
+ *
+ * A reader accepts record i only if its sequence is 2i+2 before and after
+ * copying it; otherwise the record was overwritten by the writer, and is
+ * counted as lost.
+ */
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <span>
+#include <string>
+#include <vector>
+
+namespace nsw {
+
+  namespace monitoring {
+    constexpr std::uint32_t MAGIC{0x4e535746};
+    constexpr std::uint16_t VERSION{2};
+    constexpr std::size_t SOURCE_SIZE{56};
+    constexpr std::size_t DATA_SIZE{34};
+
+    enum class Kind : std::uint32_t {
+      ArtRates = 1,
+      TpAlignment = 2,
+    };
+
+    struct Header {
+      std::uint32_t magic;
+      std::uint16_t version;
+      std::uint16_t recordSize;
+      std::uint32_t capacity;
+      std::uint32_t unused;
+      std::atomic<std::uint64_t> written;
+      std::array<std::uint8_t, 40> reserved;
+    };
+
+    struct Record {
+      std::atomic<std::uint64_t> sequence;
+      std::uint64_t time;
+      Kind kind;
+      std::uint32_t size;
+      std::array<char, SOURCE_SIZE> source;
+      std::array<std::uint32_t, DATA_SIZE> data;
+    };
+
+    static_assert(std::atomic<std::uint64_t>::is_always_lock_free);
+    static_assert(sizeof(Header) == 64);
+    static_assert(sizeof(Record) == 216);
+
+    /**
+     * \brief Copy of a record, as returned to the readers
+     */
+    struct Reading {
+      std::uint64_t index{};
+      std::uint64_t time{};  //!< ns since the epoch
+      Kind kind{};
+      std::string source{};
+      std::vector<std::uint32_t> data{};
+
+      /// Data of an ArtRates record
+      [[nodiscard]] std::vector<float> rates() const;
+    };
+
+    /// Name of the shared memory object: a leading '/' and no other
+    [[nodiscard]] std::string sharedMemoryName(const std::string& name);
+  }  // namespace monitoring
+
+  /**
+   * \brief Writer of a monitoring feed
+   *
+   * Creates the shared memory object, or resets it if it exists. The object
+   * is kept when the writer is destroyed, so that the last readings can
+   * still be read.
+   *
+   * \throws std::runtime_error if the shared memory cannot be created
+   */
+  class MonitoringFeed {
+  public:
+    explicit MonitoringFeed(const std::string& name, std::uint32_t capacity = 1024);
+    ~MonitoringFeed();
+    MonitoringFeed(const MonitoringFeed&) = delete;
+    MonitoringFeed& operator=(const MonitoringFeed&) = delete;
+
+    /// \throws std::runtime_error if there are more than DATA_SIZE rates
+    void publishArtRates(const std::string& source, std::span<const double> rates);
+
+    /// \throws std::runtime_error if there are more than DATA_SIZE - 1 BCIDs
+    void publishTpAlignment(const std::string& source, std::uint32_t alignment, std::span<const std::uint8_t> bcids);
+
+    [[nodiscard]] const std::string& getName() const { return m_name; }
+
+  private:
+    void publish(monitoring::Kind kind, const std::string& source, std::span<const std::uint32_t> data);
+
+    std::string m_name;
+    std::size_t m_size{0};
+    int m_fd{-1};
+    monitoring::Header* m_header{nullptr};
+    monitoring::Record* m_records{nullptr};
+  };
+
+  /**
+   * \brief Reader of a monitoring feed
+   *
+   * \throws std::runtime_error if the shared memory does not exist or is
+   *         not a monitoring feed
+   */
+  class MonitoringFeedReader {
+  public:
+    explicit MonitoringFeedReader(const std::string& name);
+    ~MonitoringFeedReader();
+    MonitoringFeedReader(const MonitoringFeedReader&) = delete;
+    MonitoringFeedReader& operator=(const MonitoringFeedReader&) = delete;
+
+    /**
+     * \brief Records written since the previous call
+     *
+     * The first call returns the records still in the ring.
+     */
+    [[nodiscard]] std::vector<monitoring::Reading> poll();
+
+    /// Number of records overwritten before they could be read
+    [[nodiscard]] std::uint64_t getLost() const { return m_lost; }
+
+  private:
+    std::size_t m_size{0};
+    int m_fd{-1};
+    const monitoring::Header* m_header{nullptr};
+    const monitoring::Record* m_records{nullptr};
+    std::uint64_t m_next{0};
+    std::uint64_t m_lost{0};
+  };
+
+}  // namespace nsw
+
+#endif
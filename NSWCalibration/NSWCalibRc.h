@@ -3,14 +3,20 @@
 
 #include <string>
 #include <vector>
+#include <map>
 #include <memory>
+#include <functional>
 #include <future>
+#include <mutex>
+#include <chrono>
+#include <condition_variable>
 
 #include <ers/Issue.h>
 
 #include <ipc/partition.h>
 #include <is/infodictionary.h>
 #include <is/inforeceiver.h>
+#include <is/callbackinfo.h>
 
 #include <RunControl/RunControl.h>
 #include <RunControl/Common/RunControlCommands.h>
@@ -66,14 +72,50 @@ class NSWCalibRc: public daq::rc::Controllable {
     void handler();
     void loop_content();
     void publish4swrod();
+
+    //! Wait for the swROD readback of the counter. Only called from publish4swrod,
+    //! whose body is commented out: the handshake is not used for now.
     void wait4swrod();
 
  private:
+    //! Subscribe to an integer handshake value in IS, e.g. the swROD readback counter
+    void subscribeHandshake(const std::string& name);
+    void unsubscribeHandshakes();
+
+    //! IS callback: stores the new handshake value and wakes up any waiting thread
+    void handshakeCallback(ISCallbackInfo* isc);
+
+    //! Read a handshake value directly from IS, for values published before subscribing
+    void readHandshake(const std::string& name);
+
+    /**
+     * \brief Wait until a handshake value in IS reaches the expected value
+     *
+     * Returns as soon as the IS callback delivers the value. If the
+     * subscription could not be made, IS is read periodically instead.
+     *
+     * \returns true if the value arrived before the timeout
+     */
+    bool waitForHandshake(const std::string& name, int expected, std::chrono::milliseconds timeout);
+
+    /**
+     * \brief Run a calibration step, returning once it is done
+     *
+     * The command is only answered after the step, so that the orchestrator
+     * never runs ahead of it and its failures reach run control. If the step
+     * is aborted, the output files are closed and the abort is reported as a
+     * warning. Other failures are rethrown.
+     */
+    void runStep(const std::function<void()>& step);
+
+    //! Handles the \c abort UserCmd: interrupts the running calibration step
+    void abortCalibration();
 
     std::unique_ptr<CalibAlg> calib;
     std::string m_calibType             = "";
     std::string m_calibCounter          = "Monitoring.NSWCalibration.triggerCalibrationKey";
     std::string m_calibCounter_readback = "Monitoring.NSWCalibration.swrodCalibrationKey";
+    std::string m_startIteration        = "NswParams.Calib.startIteration";
     std::string m_appname = "";
 
     const nsw::dal::NSWCalibApplication* m_nswApp;
@@ -89,6 +131,16 @@ class NSWCalibRc: public daq::rc::Controllable {
     std::string                 m_is_db_name;
     IPCPartition                m_ipcpartition;
     std::unique_ptr<ISInfoDictionary> is_dictionary;
+    std::unique_ptr<ISInfoReceiver>   m_isReceiver;
+
+    // handshake values received from IS callbacks
+    std::mutex                  m_handshakeMutex;
+    std::condition_variable     m_handshakeCondition;
+    std::map<std::string, int>  m_handshakeValues;
+    std::vector<std::string>    m_handshakeSubscriptions;
+    std::string m_handshakeLatency = "Monitoring.NSWCalibration.swrodHandshakeLatency";
+    static constexpr std::chrono::milliseconds SWROD_TIMEOUT{5000};
+    static constexpr std::chrono::milliseconds HANDSHAKE_POLL_INTERVAL{1000};
 
 };
 }  // namespace nsw
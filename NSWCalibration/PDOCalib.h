@@ -145,6 +145,15 @@ namespace nsw {
      *  values of 100,200,300 and recording time of 6000 milliseconds
      */
     void setCalibParamsFromIS(const ISInfoDictionary& is_dictionary, const std::string& is_db_name) override;
+
+    /*!
+     * \copydoc CalibAlg::setCalibParams
+     *
+     * Same format as in \c setCalibParamsFromIS, e.g. \tt 8,100,200,300,*6000*
+     *
+     * \throws nsw::PDOParameterIssue when the extraction of calib parameters fails
+     */
+    void setCalibParams(const std::string& calibParams) override;
     void setCalibKeyToIS(const ISInfoDictionary&) override;
 
     /*!
@@ -0,0 +1,70 @@
+#ifndef NSWCALIBRATION_POISSONDWELL_H
+#define NSWCALIBRATION_POISSONDWELL_H
+
+/**
+ * \brief Acquisition time driven by the Poisson precision of a count
+ *
+ * The hits counted so far are added with the time they were counted in,
+ * per channel (e.g. per PFEB). The acquisition is done once the relative
+ * uncertainty of the count of every channel, 1/sqrt(N) with N the smallest
+ * count, is at most the target and the minimum time is reached, or once
+ * the maximum time is reached.
+ */
+
+#include <chrono>
+#include <vector>
+
+namespace nsw {
+
+  class PoissonDwell {
+  public:
+    /**
+     * \param target Relative uncertainty to reach, e.g. 0.05 for 400 hits
+     * \param minTime Minimum acquisition time
+     * \param maxTime Maximum acquisition time
+     *
+     * \throws std::runtime_error if the target is not positive or the times are inconsistent
+     */
+    PoissonDwell(double target, std::chrono::milliseconds minTime, std::chrono::milliseconds maxTime);
+
+    /**
+     * \brief Add the hits of each channel counted during \c elapsed
+     *
+     * \throws std::runtime_error if the number of channels changed
+     */
+    void add(const std::vector<double>& hits, std::chrono::milliseconds elapsed);
+
+    /// Add the hits at \c rates (Hz) of each channel during \c elapsed
+    void addRates(const std::vector<double>& rates, std::chrono::milliseconds elapsed);
+
+    /// Add the hits of a single channel counted during \c elapsed
+    void add(double hits, std::chrono::milliseconds elapsed) { add(std::vector{hits}, elapsed); }
+
+    /// Add the hits at \c rate (Hz) of a single channel during \c elapsed
+    void addRate(double rate, std::chrono::milliseconds elapsed) { addRates(std::vector{rate}, elapsed); }
+
+    [[nodiscard]] bool done() const;
+
+    /// Relative uncertainty of the smallest count, infinite without hits
+    [[nodiscard]] double getRelativeError() const;
+
+    /// Hits of all channels
+    [[nodiscard]] double getHits() const;
+
+    /// Hits of the channel with the fewest hits
+    [[nodiscard]] double getMinHits() const;
+
+    [[nodiscard]] const std::vector<double>& getChannelHits() const { return m_hits; }
+    [[nodiscard]] std::chrono::milliseconds getLiveTime() const { return m_liveTime; }
+
+  private:
+    double m_target;
+    std::chrono::milliseconds m_minTime;
+    std::chrono::milliseconds m_maxTime;
+    std::vector<double> m_hits{};
+    std::chrono::milliseconds m_liveTime{0};
+  };
+
+}  // namespace nsw
+
+#endif
@@ -117,9 +117,9 @@ class RocPhaseCalibrationBase : public nsw::CalibAlg
    *
    * \param result Values of status registers after iteration of phase loop
    *
-   * \param filename Filename of output file
+   * \param roc ROC of the output file
    */
-  void saveResult(const StatusRegisters& result, const std::string& filename) const;
+  void saveResult(const StatusRegisters& result, const nsw::hw::ROC& roc) const;
 
   /**
    * \brief Configure ROC phase value for current iteration of phase loop
@@ -129,18 +129,11 @@ class RocPhaseCalibrationBase : public nsw::CalibAlg
   void setRegisters(const nsw::hw::ROC& roc) const;
 
   /**
-   * \brief Write file header of output file
+   * \brief Write file header of output file, unless resuming
    *
-   * \param filename Filename of output file
+   * \param roc ROC of the output file
    */
-  void writeFileHeader(const std::string& filename) const;
-
-  /**
-   * \brief Get the output path from the partition
-   *
-   * \param path directory
-   */
-  [[nodiscard]] std::string getOutputPath() const;
+  void writeFileHeader(const nsw::hw::ROC& roc) const;
 
   /**
    * \brief Create output filename (<directory>/<prefix>_<time>_<FEB name>.csv)
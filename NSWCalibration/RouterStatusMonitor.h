@@ -0,0 +1,94 @@
+#ifndef NSWCALIBRATION_ROUTERSTATUSMONITOR_H
+#define NSWCALIBRATION_ROUTERSTATUSMONITOR_H
+
+/**
+ * \brief Polls the status of a set of links in the background
+ *
+ * One thread per link reads its status (e.g. the ClkReady of a router, or
+ * the PRBS lock of a TDS) every \c poll, and wakes up the waiting thread
+ * when it changes, instead of the waiting thread reading all the links
+ * itself at a fixed interval. The time of the last change of each link,
+ * since the monitor was created, is kept as its time to lock.
+ *
+ * The links are only read while the monitor exists: destroy it before
+ * reading the same registers elsewhere.
+ */
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace nsw {
+
+  class RouterStatusMonitor {
+  public:
+    using Reader = std::function<std::uint64_t(std::size_t link)>;
+    using Predicate = std::function<bool(const std::vector<std::uint64_t>& values)>;
+
+    /**
+     * \param numLinks Number of links
+     * \param reader Reads the status of a link, from the thread of the link
+     * \param poll Interval between two reads of a link
+     */
+    RouterStatusMonitor(std::size_t numLinks, Reader reader, std::chrono::milliseconds poll);
+    RouterStatusMonitor(const RouterStatusMonitor&) = delete;
+    RouterStatusMonitor& operator=(const RouterStatusMonitor&) = delete;
+    RouterStatusMonitor(RouterStatusMonitor&&) = delete;
+    RouterStatusMonitor& operator=(RouterStatusMonitor&&) = delete;
+    ~RouterStatusMonitor() = default;
+
+    /**
+     * \brief Wait until all links were read and the predicate holds for their status
+     *
+     * \returns false on timeout
+     * \throws std::runtime_error if reading a link failed
+     */
+    bool waitFor(const Predicate& predicate, std::chrono::milliseconds timeout);
+
+    /**
+     * \brief Wait until all links were read and none changed for \c interval
+     *
+     * \returns false on timeout
+     * \throws std::runtime_error if reading a link failed
+     */
+    bool waitForStable(std::chrono::milliseconds interval, std::chrono::milliseconds timeout);
+
+    /// Last status of each link
+    [[nodiscard]] std::vector<std::uint64_t> getValues() const;
+
+    /// Time of the last change of each link since the monitor was created, if it was read
+    [[nodiscard]] std::vector<std::optional<std::chrono::milliseconds>> getLockTimes() const;
+
+  private:
+    using Clock = std::chrono::steady_clock;
+
+    struct Link {
+      std::uint64_t value{0};
+      bool read{false};
+      Clock::time_point changed{};
+    };
+
+    void poll(const std::stop_token& stop, std::size_t link);
+
+    /// Throws if a read failed, with the lock held
+    void checkError() const;
+
+    Reader m_reader;
+    std::chrono::milliseconds m_poll;
+    Clock::time_point m_start;
+    mutable std::mutex m_mutex;
+    std::condition_variable_any m_condition;
+    std::vector<Link> m_links;
+    std::optional<std::string> m_error{};
+    std::vector<std::jthread> m_threads{};  //!< Declared last: stopped and joined first
+  };
+
+}  // namespace nsw
+
+#endif
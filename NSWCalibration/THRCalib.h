@@ -85,6 +85,15 @@ namespace nsw {
      */
     void setCalibParamsFromIS(const ISInfoDictionary& is_dictionary, const std::string& is_db_name) override;
 
+    /*!
+     * \copydoc CalibAlg::setCalibParams
+     *
+     * Same format as in \c setCalibParamsFromIS, e.g. \tt BLN,10,9,0
+     *
+     * \throws nsw::THRParameterIssue when the extraction of calib parameters fails
+     */
+    void setCalibParams(const std::string& calibParams) override;
+
     /*!
      * \brief Updates an input config file with per FEB information stored in a separate JSON
      *
@@ -1,6 +1,7 @@
 #ifndef NSWCALIBRATION_UTILITY_H_
 #define NSWCALIBRATION_UTILITY_H_
 
+#include <map>
 #include <string>
 
 #include "NSWCalibration/Commands.h"
@@ -40,6 +41,20 @@ namespace nsw {
        *          arguments, delimited by ':'
        */
       std::string commandToString(const nsw::commands::Command& command);
+
+      /**
+       * \brief Parse calibration parameters of the form \tt key=value,key=value
+       *
+       * Whitespace around keys and values is ignored, as are empty entries.
+       *
+       * \param params String to parse, e.g. \tt "window=3,min_hits=10"
+       * \param separator Delimiter of the entries
+       *
+       * \returns map of the values by key
+       * \throws std::runtime_error if an entry has no '=' or a key is repeated
+       */
+      std::map<std::string, std::string> parseKeyValues(const std::string& params,
+                                                        const std::string& separator = ",");
     }  // namespace utils
   }    // namespace calib
 }  // namespace nsw
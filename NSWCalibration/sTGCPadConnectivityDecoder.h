@@ -0,0 +1,90 @@
+#ifndef NSWCALIBRATION_STGCPADCONNECTIVITYDECODER_H
+#define NSWCALIBRATION_STGCPADCONNECTIVITYDECODER_H
+
+/**
+ * \brief Pad trigger connectivity from grouped PFEB pulses (sTGCPadConnectivityScaGrouped)
+ *
+ * PFEB i (the pad trigger input it should feed) has the signature i+1, so
+ * that no PFEB has the signature of a silent input. Iteration 2k pulses the
+ * PFEBs with bit k of their signature set, iteration 2k+1 the others. The
+ * pad trigger rate of each input then gives the signature of the PFEB
+ * connected to it, bit by bit:
+ *
+ *   - hits in iteration 2k only: bit k set
+ *   - hits in iteration 2k+1 only: bit k clear
+ *   - hits in both: collision, several PFEBs (or noise) on the input
+ *   - hits in none: no PFEB on the input
+ *
+ * An input has hits in an iteration if its rate is at least \c fraction of
+ * its largest rate. PFEBs which are not found on exactly one input are
+ * pulsed again on their own (addRetest).
+ */
+
+#include <cstdint>
+#include <map>
+#include <optional>
+#include <string>
+#include <vector>
+
+namespace nsw {
+
+  class sTGCPadConnectivityDecoder {
+  public:
+    enum class Status {
+      Connected,   //!< The expected PFEB
+      Swapped,     //!< Another PFEB
+      Collision,   //!< Inconsistent signature
+      Dead,        //!< No hits
+    };
+
+    struct Result {
+      Status status{Status::Dead};
+      std::optional<std::size_t> pfeb{};  //!< Decoded PFEB
+    };
+
+    /**
+     * \param numPfebs Number of PFEBs, i.e. of pad trigger inputs
+     * \param fraction Fraction of the largest rate of an input to count as hits
+     */
+    explicit sTGCPadConnectivityDecoder(std::size_t numPfebs, double fraction = 0.2);
+
+    /// Number of grouped iterations
+    [[nodiscard]] std::size_t getNumIterations() const { return 2 * m_numBits; }
+
+    /// Whether a PFEB is pulsed in a grouped iteration
+    [[nodiscard]] bool isPulsed(std::size_t iteration, std::size_t pfeb) const;
+
+    /**
+     * \brief Rates of the inputs in a grouped iteration
+     *
+     * \throws std::runtime_error if the iteration is out of range
+     */
+    void addRates(std::size_t iteration, const std::vector<std::uint32_t>& rates);
+
+    /// Result of each input
+    [[nodiscard]] std::vector<Result> decode() const;
+
+    /// PFEBs found on no input or on several
+    [[nodiscard]] std::vector<std::size_t> getRetests() const;
+
+    /// Rates of the inputs with a single PFEB pulsed
+    void addRetest(std::size_t pfeb, const std::vector<std::uint32_t>& rates);
+
+    /// Inputs with hits when the PFEB was pulsed on its own, if it was
+    [[nodiscard]] std::optional<std::vector<std::size_t>> getRetest(std::size_t pfeb) const;
+
+    [[nodiscard]] static std::string toString(Status status);
+
+  private:
+    [[nodiscard]] std::vector<std::size_t> inputsWithHits(const std::vector<std::uint32_t>& rates) const;
+
+    std::size_t m_numPfebs;
+    double m_fraction;
+    std::size_t m_numBits{0};
+    std::vector<std::vector<std::uint32_t>> m_rates{};  //!< Per iteration, per input
+    std::map<std::size_t, std::vector<std::size_t>> m_retests{};
+  };
+
+}  // namespace nsw
+
+#endif
@@ -10,9 +10,17 @@
  * for each TDS BCID offset
  *   set the TDS BCID offset
  *   read the pad trigger alignment register
+ *
+ * sTGCPadTdsBcidOffsetSearch searches the offset of each PFEB instead of
+ *   writing all offsets (see sTGCPadTdsBcidOffsetSearch.h), and writes the
+ *   verified offsets as a json patch of the PFEB configuration. Parameters,
+ *   as key=value in calibParams: step (16), verify (3) and sweep (0, 1 to
+ *   measure all offsets, for PFEBs whose window is narrower than the step).
  */
 
+#include <map>
 #include <memory>
+#include <vector>
 
 #include <ers/Issue.h>
 
@@ -21,6 +29,7 @@
 #include <TTree.h>
 
 #include "NSWCalibration/CalibAlg.h"
+#include "NSWCalibration/sTGCPadTdsBcidOffsetSearch.h"
 #include "NSWConfiguration/Constants.h"
 
 ERS_DECLARE_ISSUE(nsw,
@@ -59,9 +68,18 @@ namespace nsw {
      */
     void unconfigure() override;
 
+    void setCalibParamsFromIS(const ISInfoDictionary& is_dictionary, const std::string& is_db_name) override;
+
+    /**
+     * \brief Parameters of the search, key=value: step, verify, sweep
+     */
+    void setCalibParams(const std::string& calibParams) override;
+
   private:
     /**
      * \brief Check the number of pad triggers and PFEBs in the configuration database
+     *
+     * \throws std::runtime_error if the search does not have exactly 1 pad trigger
      */
     void checkObjects() const;
 
@@ -75,6 +93,26 @@ namespace nsw {
      */
     void setTdsBcidOffset(const nsw::hw::FEB& dev) const;
 
+    /**
+     * \brief Read which PFEBs send hits, one bit per PFEB like the error word
+     */
+    std::uint64_t readPfebHits(const nsw::hw::PadTrigger& dev) const;
+
+    /**
+     * \brief Offset to write to a PFEB in this iteration
+     */
+    std::uint32_t getTdsBcidOffset(const nsw::hw::FEB& dev) const;
+
+    /**
+     * \brief Find the bit of each PFEB in the pad trigger error word
+     */
+    void mapPfebs();
+
+    /**
+     * \brief Write the verified offsets of the search, by PFEB and TDS (json)
+     */
+    void writePatch() const;
+
     /**
      * \brief Open a ROOT TTree and set the branches
      */
@@ -93,12 +131,22 @@ namespace nsw {
     static constexpr std::string_view m_tdsReg{"BCID_Offset"};
     static constexpr std::uint64_t m_numBcPerOrbit{3564};
 
+    // search
+    bool m_search{false};
+    std::uint32_t m_searchStep{16};
+    std::size_t m_searchVerify{3};
+    bool m_searchSweep{false};
+    std::unique_ptr<sTGCPadTdsBcidOffsetSearch> m_searchState{nullptr};
+    std::map<std::string, std::size_t> m_pfebIndex{};  //!< Bit in the error word, by SCA address
+
     // ROOT output
     std::string m_rname{""};
     std::unique_ptr<TFile> m_rfile{nullptr};
     std::shared_ptr<TTree> m_rtree{nullptr};
     std::uint64_t m_pad_trigger_bcid_offset{0};
     std::uint64_t m_tds_bcid_offset{0};
+    std::vector<std::uint32_t> m_tds_bcid_offsets{};  //!< Per PFEB bit
+    std::string m_stage{"sweep"};
     std::uint64_t m_pfeb_bcid_error{0};
     std::uint64_t m_runnumber{0};
     std::string m_pad_trigger{""};
@@ -0,0 +1,139 @@
+#ifndef NSWCALIBRATION_STGCPADTDSBCIDOFFSETSEARCH_H
+#define NSWCALIBRATION_STGCPADTDSBCIDOFFSETSEARCH_H
+
+/**
+ * \brief Search of the pad TDS BCID offset of each PFEB (sTGCPadTdsBcidOffsetSearch)
+ *
+ * Instead of writing all 3564 offsets, the offsets of the PFEBs are
+ * searched independently, relying on the good offsets of a PFEB (no
+ * pfeb_bcid_error in the pad trigger) being one window, modulo the orbit:
+ *
+ *   - coarse: offsets 0, step, 2 step, ... The longest run of good coarse
+ *     offsets is the window of the PFEB.
+ *   - lower edge: bisection between the bad coarse offset before the run
+ *     and its first good offset.
+ *   - upper edge: bisection between the last good coarse offset and the
+ *     bad one after the run.
+ *   - verification: the center of the window is written \c numVerify times,
+ *     and must not give an error.
+ *
+ * A PFEB whose window is narrower than the step has no good coarse offset,
+ * and is reported without window. The sweep mode is for these PFEBs: the
+ * coarse stage is followed by all other offsets (sweep), for all PFEBs,
+ * and the window of each PFEB is the longest run of good offsets. Every
+ * offset is then measured once, so there is no bisection nor verification.
+ *
+ * A PFEB without hits during the coarse stage (see addResult) is dead.
+ *
+ * Each PFEB gets its own offset in every iteration, so all PFEBs are
+ * searched at the same time, in a fixed number of iterations: with a step
+ * of 16, 223 coarse + 2 x 4 bisection + verification, or the 3564 offsets
+ * in the sweep mode.
+ */
+
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <vector>
+
+namespace nsw {
+
+  class sTGCPadTdsBcidOffsetSearch {
+  public:
+    enum class Status {
+      Searching,
+      NoWindow,       //!< No good offset
+      NoTransition,   //!< All coarse offsets are good
+      Failed,         //!< Error at the chosen offset during the verification
+      Verified,
+      Excluded,       //!< Not searched, see exclude
+      Dead,           //!< No hits
+    };
+
+    struct Result {
+      Status status{Status::Searching};
+      std::uint32_t first{0};   //!< First good offset
+      std::uint32_t last{0};    //!< Last good offset
+      std::uint32_t offset{0};  //!< Chosen offset, center of the window
+      std::size_t windows{0};   //!< Number of separate runs of good coarse (or swept) offsets
+      bool swept{false};        //!< Window found by the sweep mode
+    };
+
+    /**
+     * \param numPfebs Number of PFEBs, i.e. bits of the error word
+     * \param numOffsets Number of offsets, the BCs of an orbit
+     * \param step Distance between two coarse offsets
+     * \param numVerify Number of iterations of the verification, not used by the sweep mode
+     * \param sweep Measure all offsets after the coarse stage, instead of bisecting the edges
+     *
+     * \throws std::runtime_error if the step is 0 or not smaller than the number of offsets
+     */
+    sTGCPadTdsBcidOffsetSearch(std::size_t numPfebs, std::uint32_t numOffsets, std::uint32_t step,
+                               std::size_t numVerify, bool sweep = false);
+
+    /**
+     * \brief Do not search the offset of a PFEB, e.g. an input without PFEB
+     *
+     * Its errors are ignored. To be called before the first result.
+     */
+    void exclude(std::size_t pfeb);
+
+    /// Number of iterations of the search
+    [[nodiscard]] std::size_t getNumIterations() const;
+
+    /// Stage of an iteration, e.g. coarse
+    [[nodiscard]] std::string getStage(std::size_t iteration) const;
+
+    /**
+     * \brief Offset to write to each PFEB in the next iteration
+     */
+    [[nodiscard]] const std::vector<std::uint32_t>& getOffsets() const { return m_offsets; }
+
+    /**
+     * \brief Give the error word read with the offsets of getOffsets
+     *
+     * Bit i is set if PFEB i has a BCID error. Bit i of \c hits is set if
+     * PFEB i sent hits. Moves to the next iteration.
+     */
+    void addResult(std::uint64_t errors, std::uint64_t hits = ~std::uint64_t{0});
+
+    [[nodiscard]] bool done() const { return m_iteration >= getNumIterations(); }
+    [[nodiscard]] const Result& getResult(std::size_t pfeb) const { return m_pfebs.at(pfeb).result; }
+
+    [[nodiscard]] static std::string toString(Status status);
+
+  private:
+    struct Pfeb {
+      std::vector<bool> coarse{};  //!< Good coarse offsets
+      std::vector<bool> good{};    //!< Good offsets, by offset
+      bool hits{false};            //!< Hits during the coarse stage
+      std::uint32_t from{0};       //!< Bisection: known offset before the edge
+      std::uint32_t to{0};         //!< Bisection: known offset after the edge
+      std::uint32_t after{0};      //!< Bad coarse offset after the window
+      Result result{};
+    };
+
+    [[nodiscard]] std::size_t numBisections() const;
+    [[nodiscard]] std::uint32_t distance(std::uint32_t from, std::uint32_t to) const;
+    [[nodiscard]] std::uint32_t advance(std::uint32_t from, std::uint32_t steps) const;
+    [[nodiscard]] std::uint32_t coarseOffset(std::size_t index) const;
+    [[nodiscard]] std::uint32_t sweepOffset(std::size_t index) const;
+    void findWindow(Pfeb& pfeb) const;
+    void findSweptWindow(Pfeb& pfeb) const;
+    void next();
+    void prepare();
+
+    std::uint32_t m_numOffsets;
+    std::uint32_t m_step;
+    bool m_sweep;
+    std::size_t m_numVerify;
+    std::size_t m_numCoarse;
+    std::size_t m_numSweep;
+    std::size_t m_iteration{0};
+    std::vector<Pfeb> m_pfebs;
+    std::vector<std::uint32_t> m_offsets;
+  };
+
+}  // namespace nsw
+
+#endif
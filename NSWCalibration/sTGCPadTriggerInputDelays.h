@@ -12,12 +12,20 @@
  * There are 16 possible delays, i.e. the data of each PFEB can be delayed by
  *   as much as 66.6ns at the PT input.
  * The 4 LSB of the PFEB BCIDs are published as status registers.
- * The results of the calibration are saved as a ROOT TTree within a TFile.
+ * The BCIDs are read NUM_PFEB_BCID_READS times per delay, and summarised
+ *   per PFEB (see BcidStatistics.h) in one entry of a ROOT TTree per delay,
+ *   with the number of reads it summarises in nreads.
+ * The delay at which the most PFEBs are stable is written as a json patch.
+ * Parameters, as key=value in calibParams: raw (0), 1 to write every read
+ *   to a second ("raw") file, and stable (1.0), the fraction of the reads at
+ *   the most frequent BCID for a stable PFEB.
  */
 
+#include <memory>
 #include <string>
 #include <vector>
 
+#include "NSWCalibration/BcidStatistics.h"
 #include "NSWCalibration/CalibAlg.h"
 
 #include "ers/Issue.h"
@@ -40,27 +48,45 @@ namespace nsw {
     sTGCPadTriggerInputDelays(std::string calibType, const hw::DeviceManager& deviceManager);
     sTGCPadTriggerInputDelays(const sTGCPadTriggerInputDelays&) = delete;
     sTGCPadTriggerInputDelays& operator=(const sTGCPadTriggerInputDelays&) = delete;
-    void setup(const std::string& /* db */) override {};
+    void setup(const std::string& /* db */) override;
     void configure() override;
     void unconfigure() override;
+    void setCalibParamsFromIS(const ISInfoDictionary& is_dictionary, const std::string& is_db_name) override;
+
+    /**
+     * \brief Parameters, key=value: raw, stable
+     */
+    void setCalibParams(const std::string& calibParams) override;
 
   private:
     void checkObjects();
     void setupTree();
+    void setupRawTree();
     void closeTree();
     void setDelays(const nsw::hw::PadTrigger& pt) const;
     void fillTree();
+    void writePatch() const;
+
+    bool m_raw{false};
+    double m_stableFraction{1.0};
+    std::unique_ptr<BcidStatistics> m_stats{nullptr};
 
     /// output ROOT file
     std::uint32_t m_delay = 0;
+    std::uint32_t m_reads = 0;
+    std::uint32_t m_read = 0;
     std::string m_now = "";
     std::string m_rname = "";
+    std::string m_raw_rname = "";
     std::string m_opcserverip = "";
     std::string m_address = "";
     std::vector<std::uint32_t> m_bcid{};
     std::vector<std::uint32_t> m_pfeb{};
+    BcidStatistics::Columns m_columns{};
     std::unique_ptr<TFile> m_rfile;
     std::shared_ptr<TTree> m_rtree;
+    std::unique_ptr<TFile> m_raw_rfile{nullptr};
+    std::shared_ptr<TTree> m_raw_rtree{nullptr};
   };
 
 }
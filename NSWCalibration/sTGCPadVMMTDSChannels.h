@@ -1,10 +1,12 @@
 #ifndef NSWCALIBRATION_STGCPADVMMTDSCHANNELS_H_
 #define NSWCALIBRATION_STGCPADVMMTDSCHANNELS_H_
 
+#include <set>
 #include <string>
 #include <vector>
 
 #include "NSWCalibration/CalibAlg.h"
+#include "NSWConfiguration/Constants.h"
 #include "NSWConfiguration/FEBConfig.h"
 #include "NSWConfiguration/hw/PadTrigger.h"
 
@@ -31,6 +33,17 @@ namespace nsw {
    * The "calibration" works by looping through each available VMM channel,
    * generating test pulses for that channel, and reading L1A data from
    * the pad trigger.
+   *
+   * sTGCPadVMMTDSChannelsCoded pulses many channels per iteration instead:
+   * the pad channels (VMM channels of the pad VMMs, numbered from the first
+   * one) with bit k set in iteration 2k, and the complement in iteration
+   * 2k+1. The VMM channel of each TDS channel is then the bits in which it
+   * fired, in 2*log2(N) iterations instead of N (nsw_pads_vmm_tds_channels.py
+   * --coded). Both modes write the iteration to the pad trigger "sector",
+   * so that the readout can be split by iteration.
+   *
+   * With calibParams channels=p1,p2,... only these pad channels are pulsed,
+   * one per iteration, e.g. the ambiguous ones of a coded run.
    */
   class sTGCPadVMMTDSChannels: public CalibAlg {
 
@@ -39,7 +52,8 @@ namespace nsw {
      * \brief Simple constructor.
      */
     sTGCPadVMMTDSChannels(std::string calibType, const hw::DeviceManager& deviceManager) :
-      CalibAlg(std::move(calibType), deviceManager)
+      CalibAlg(std::move(calibType), deviceManager),
+      m_coded{m_calibType == "sTGCPadVMMTDSChannelsCoded"}
         {};
 
     /**
@@ -58,6 +72,13 @@ namespace nsw {
      */
     void configure() override;
 
+    void setCalibParamsFromIS(const ISInfoDictionary& is_dictionary, const std::string& is_db_name) override;
+
+    /**
+     * \brief Pad channels to pulse, key=value: channels (separated by commas)
+     */
+    void setCalibParams(const std::string& calibParams) override;
+
   private:
     /**
      * \brief Configure the PFEB VMMs for test pulsing.
@@ -77,14 +98,30 @@ namespace nsw {
 
     /**
      * \brief Configure the pad trigger for readout
+     *
+     * The iteration is written as the "sector" of the pad trigger data.
      */
     void configurePadTrigger() const;
 
+    /**
+     * \brief Pad channels to pulse in this iteration
+     */
+    std::set<std::size_t> getPulsedChannels() const;
+
+    /**
+     * \brief Number of bits of a pad channel, i.e. of pairs of coded iterations
+     */
+    static std::size_t getNumBits();
+
     /**
      * \brief Check NSWConfig objects
      */
     void checkObjects() const;
 
+    static constexpr std::size_t m_numPadChannels{nsw::NUM_PAD_VMM_PER_PFEB * nsw::vmm::NUM_CH_PER_VMM};
+
+    bool m_coded{false};
+    std::vector<std::size_t> m_channels{};  //!< Targeted pad channels
   };
 
 }
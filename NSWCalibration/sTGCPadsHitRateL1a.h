@@ -7,13 +7,27 @@
  * The purpose of this classes is to record L1A data with the pad trigger,
  *   for various VMM thresholds in the PFEBs. Given a nominal configuration,
  *   this calibration will record data with variations on that configuration.
+ *
+ * The readout is enabled for a fixed time per threshold, given in seconds
+ *   as calibParams (e.g. "2") or as key=value: time (1). With precision,
+ *   the pad trigger PFEB rates are polled every poll (500) ms while the
+ *   readout is enabled, and the acquisition stops once the relative Poisson
+ *   uncertainty of the number of hits of every connected PFEB, of every pad
+ *   trigger, is at most precision (see PoissonDwell.h), or after max_time
+ *   (10) seconds, with a warning for each PFEB without hits. In
+ *   simulation, the pad trigger counts no hits, and the readout is enabled
+ *   for the fixed time. The live time of each threshold is written to a
+ *   txt file, to normalise the rates.
  */
 
 #include <array>
 #include <chrono>
+#include <optional>
 #include <string>
+#include <vector>
 #include <ers/Issue.h>
 #include "NSWCalibration/CalibAlg.h"
+#include "NSWCalibration/PoissonDwell.h"
 #include "NSWConfiguration/Constants.h"
 
 
@@ -29,19 +43,38 @@ namespace nsw {
 
   public:
     sTGCPadsHitRateL1a(std::string calibType, const hw::DeviceManager& deviceManager);
-    void setup(const std::string& /* db */) override {};
+    void setup(const std::string& /* db */) override;
     void configure() override;
     void acquire() override;
     void setCalibParamsFromIS(const ISInfoDictionary& is_dictionary, const std::string& is_db_name) override;
+    void setCalibParams(const std::string& calibParams) override;
 
   private:
     void checkObjects() const;
+    void mapPfebs();
     void setPadTriggerSector() const;
     void setFebThresholds() const;
     void setFebThreshold(const nsw::hw::FEB& dev) const;
     void checkThresholdAdjustment(std::uint32_t thr, int adj) const;
+
+    /**
+     * \brief Wait with the readout enabled, until the precision or the max time is reached
+     */
+    PoissonDwell acquireAdaptive() const;
+
+    /**
+     * \brief Rates of the connected PFEBs seen by each pad trigger (Hz)
+     */
+    std::vector<double> readPadTriggerRates() const;
+
+    void writeLiveTime(std::chrono::milliseconds liveTime, const std::optional<PoissonDwell>& dwell) const;
+
     static constexpr std::array m_thresholdAdjustments{-20, -10, 0, 10, 20, 30, 40, 50, 60, 70, 80};
     std::chrono::seconds m_acquire_time{1};
+    std::optional<double> m_precision{};
+    std::chrono::seconds m_max_time{10};
+    std::chrono::milliseconds m_poll{500};
+    std::vector<std::size_t> m_inputs{};
   };
 
 }
@@ -15,8 +15,21 @@
  *   for each PFEB
  *     set the PFEB
  *     read the PFEB rate
+ *
+ * sTGCPadsHitRateScaMultiplexed opens a set of TDS channels per iteration
+ *   instead of one (see GroupTestingDesign.h), and decodes the rate of each
+ *   channel from the rates of all sets at the end of each threshold. This
+ *   is only done at and above the nominal threshold, where few channels
+ *   are noisy: below it, the channels are measured one at a time. The
+ *   decoded rates are written like the ones of sTGCPadsHitRateSca, with
+ *   the branches decoded, residual and large_residual. A decoding is
+ *   flagged as large_residual if its residual is above a fraction of the
+ *   total rate of the PFEB. The rates of the sets go to a second ("raw")
+ *   file. Parameters, as key=value in calibParams: rows (13), the number of
+ *   sets per threshold, and residual (0.1), the flagged fraction.
  */
 
+#include <memory>
 #include <string>
 #include <vector>
 
@@ -27,6 +40,7 @@
 #include <TTree.h>
 
 #include "NSWCalibration/CalibAlg.h"
+#include "NSWCalibration/GroupTestingDesign.h"
 #include "NSWConfiguration/Constants.h"
 
 ERS_DECLARE_ISSUE(nsw,
@@ -41,9 +55,11 @@ namespace nsw {
 
   public:
     sTGCPadsHitRateSca(std::string calibType, const hw::DeviceManager& deviceManager);
-    void setup(const std::string& /* db */) override {};
+    void setup(const std::string& /* db */) override;
     void configure() override;
     void acquire() override;
+    void setCalibParamsFromIS(const ISInfoDictionary& is_dictionary, const std::string& is_db_name) override;
+    void setCalibParams(const std::string& calibParams) override;
 
   private:
     void checkObjects() const;
@@ -51,6 +67,12 @@ namespace nsw {
     void fillTree(const std::uint32_t pfeb,
                   const std::uint32_t rate);
     void closeTree();
+    void setupRawTree();
+    void fillRawTree(const std::uint32_t pfeb,
+                     const std::uint32_t rate);
+    void decodeRates();
+    bool isMultiplexed(std::size_t threshold) const;
+    std::size_t getNumIterationsPerThreshold(std::size_t threshold) const;
     std::size_t getCurrentVmmThreshold() const;
     std::size_t getCurrentTdsChannel() const;
     __uint128_t getCurrentTdsChannelMask() const;
@@ -63,6 +85,13 @@ namespace nsw {
     static constexpr std::array m_thresholdAdjustments{-30, -20, -10, 0, 10, 20, 30, 40, 50, 60, 70};
     static constexpr std::uint8_t m_regAddressChannelMask{0x2};
 
+    // multiplexed channels
+    bool m_multiplexed{false};
+    std::size_t m_numRows{13};
+    double m_maxResidual{0.1};  //!< Of the total rate of a PFEB
+    std::unique_ptr<GroupTestingDesign> m_design{nullptr};
+    std::vector<std::vector<double>> m_rowRates{};  //!< Per PFEB, per row of the current threshold
+
     // ROOT output
     std::string m_rname{""};
     std::unique_ptr<TFile> m_rfile{nullptr};
@@ -77,6 +106,17 @@ namespace nsw {
     std::string m_now{""};
     std::string m_pt_name{""};
 
+    // ROOT output of the channel sets, in multiplexed mode
+    std::string m_raw_rname{""};
+    std::unique_ptr<TFile> m_raw_rfile{nullptr};
+    std::shared_ptr<TTree> m_raw_rtree{nullptr};
+    std::uint32_t m_row{0};
+    std::vector<std::uint32_t> m_tds_chans{};
+    double m_decoded_rate{0};
+    double m_residual{0};
+    bool m_decoded{false};
+    bool m_large_residual{false};
+
   };
 
 }
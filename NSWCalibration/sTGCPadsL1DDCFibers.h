@@ -8,11 +8,30 @@
  *   which controls data processing in the TDS and therefore affects
  *   data received by the pad trigger. The motivation is to correct for
  *   fiber length differences between L-side and R-side STGC L1DDCs.
+ *
+ * sTGCPadsL1DDCFibers scans all pairs of L-side and R-side phases.
+ * sTGCPadsL1DDCFibers_Separable sets the same phase on both sides, since
+ *   the BCID of a PFEB only depends on the phase of its own side, and
+ *   rebuilds the pairs from the BCIDs of each side at the end: N instead
+ *   of N^2 iterations, and the same output tree. The BCIDs are kept in
+ *   memory until then, so after a resume only the phases scanned since
+ *   the resume are combined.
+ *
+ * The BCIDs are read m_numReads times per iteration and summarised per
+ *   PFEB (see BcidStatistics.h) in one entry of the TTree, with the number
+ *   of reads it summarises in nreads. The best phase of each PFEB is
+ *   written as a json patch. Parameters, as key=value in
+ *   calibParams: raw (0), 1 to write every read to a second ("raw") file,
+ *   and stable (1.0), the fraction of the reads at the most frequent BCID
+ *   for a stable PFEB.
  */
 
+#include <map>
+#include <memory>
 #include <string>
 #include <vector>
 
+#include "NSWCalibration/BcidStatistics.h"
 #include "NSWCalibration/CalibAlg.h"
 #include "NSWConfiguration/Constants.h"
 #include "NSWConfiguration/hw/PadTrigger.h"
@@ -36,15 +55,24 @@ namespace nsw {
 
   public:
     sTGCPadsL1DDCFibers(std::string calibType, const hw::DeviceManager& deviceManager);
-    void setup(const std::string& /* db */) override {};
+    void setup(const std::string& /* db */) override;
     void configure() override;
     void unconfigure() override;
+    void setCalibParamsFromIS(const ISInfoDictionary& is_dictionary, const std::string& is_db_name) override;
+
+    /**
+     * \brief Parameters, key=value: raw, stable
+     */
+    void setCalibParams(const std::string& calibParams) override;
 
   private:
     void checkObjects() const;
     void setupTree();
+    void setupRawTree();
     void closeTree();
+    void writePatch() const;
     void fillTree();
+    void fillSeparableTree();
     void setPhases();
     void setROCPhases() const;
     void setROCPhase(const nsw::hw::FEB& feb) const;
@@ -59,19 +87,32 @@ namespace nsw {
     /// output ROOT file
     std::uint32_t m_step{0};
     std::uint32_t m_reads{0};
+    std::uint32_t m_read{0};
     std::uint32_t m_phase_L{0};
     std::uint32_t m_phase_R{0};
     std::uint32_t m_runnumber{0};
     std::string m_app_name{""};
     std::string m_now{""};
     std::string m_rname{""};
+    std::string m_raw_rname{""};
     std::string m_pt_name{""};
     std::unique_ptr<TFile> m_rfile{nullptr};
     std::shared_ptr<TTree> m_rtree{nullptr};
+    std::unique_ptr<TFile> m_raw_rfile{nullptr};
+    std::shared_ptr<TTree> m_raw_rtree{nullptr};
     std::vector<std::uint32_t> m_pfeb{};
     std::vector<std::uint32_t> m_bcid{};
     std::vector<bool>          m_mask{};
     std::vector<bool>          m_left{};
+    BcidStatistics::Columns    m_columns{};
+
+    bool m_raw{false};
+    double m_stableFraction{1.0};
+    std::unique_ptr<BcidStatistics> m_stats{nullptr};
+
+    /// separable scan: summary of the PFEB BCIDs, per phase
+    bool m_separable{false};
+    std::map<std::uint32_t, BcidStatistics::Columns> m_separableColumns{};
   };
 
 }
@@ -8,9 +8,34 @@
  *   which controls data processing in the TDS and therefore affects
  *   data received by the pad trigger. The motivation is to correct for
  *   fiber length differences between L-side and R-side STGC L1DDCs.
+ *
+ * sTGCPadsRocTds40MhzSearch finds the stable phase window of each PFEB at
+ *   a nominal pad trigger input delay, and then scans the delays and TDS
+ *   BCID offsets with each PFEB at the center of its window (see
+ *   sTGCPadsRocTds40MhzSearch.h). The chosen phases, offsets and delay are
+ *   written as a json patch. Parameters, as key=value in calibParams:
+ *   delay (0), the nominal delay.
+ *
+ * The BCIDs are read m_numReads times per iteration and summarised per
+ *   PFEB (see BcidStatistics.h) in one entry of the TTree, with the number
+ *   of reads it summarises in nreads. Without the search, the best phase
+ *   of each PFEB at delay 0 and offset 0 is written
+ *   as a json patch. Parameters of both, as key=value in calibParams: raw
+ *   (0), 1 to write every read to a second ("raw") file, and stable (1.0),
+ *   the fraction of the reads at the most frequent BCID for a stable PFEB.
+ *
+ * Settings which did not change since the previous iteration are not
+ *   written again.
  */
 
+#include <map>
+#include <memory>
+#include <optional>
+
+#include "NSWCalibration/BcidStatistics.h"
 #include "NSWCalibration/CalibAlg.h"
+#include "NSWCalibration/sTGCPadsRocTds40MhzSearch.h"
+#include "NSWConfiguration/Constants.h"
 
 #include <ers/Issue.h>
 
@@ -35,9 +60,9 @@ namespace nsw {
     sTGCPadsRocTds40Mhz(std::string calibType, const hw::DeviceManager& deviceManager);
 
     /**
-     * \brief Empty setup
+     * \brief Setup of the search, if any
      */
-    void setup(const std::string& /* db */) override {};
+    void setup(const std::string& /* db */) override;
 
     /**
      * \brief Configure the ROC/TDS phase and pad trigger input delay, and open TTree
@@ -54,7 +79,21 @@ namespace nsw {
      */
     void unconfigure() override;
 
+    void setCalibParamsFromIS(const ISInfoDictionary& is_dictionary, const std::string& is_db_name) override;
+
+    /**
+     * \brief Parameters, key=value: delay (search only), raw, stable
+     */
+    void setCalibParams(const std::string& calibParams) override;
+
   private:
+    /// ROC/TDS settings of a PFEB
+    struct FebSettings {
+      std::uint32_t phase{0};
+      std::uint32_t offset{0};
+      bool operator==(const FebSettings&) const = default;
+    };
+
     /**
      * \brief Check the number of pad triggers and PFEBs in the configuration database
      */
@@ -66,7 +105,12 @@ namespace nsw {
     void openTree();
 
     /**
-     * \brief Close the TTree and write to disk
+     * \brief Open a second ROOT TTree for every BCID read
+     */
+    void openRawTree();
+
+    /**
+     * \brief Close the TTrees and write to disk
      */
     void closeTree();
 
@@ -78,17 +122,39 @@ namespace nsw {
     /**
      * \brief Set pad trigger input delays
      */
-    void setPadTriggerDelays() const;
+    void setPadTriggerDelays();
 
     /**
      * \brief Launch threads for setting ROC/TDS phase and TDS BCID offset
      */
-    void setFebsParameters() const;
+    void setFebsParameters();
 
     /**
-     * \brief Set ROC/TDS phase and TDS BCID offset
+     * \brief Set ROC/TDS phase and TDS BCID offset, if they changed
+     *
+     * \returns false if the PFEB is unreachable
      */
-    void setFebParameters(const nsw::hw::FEB& feb) const;
+    bool setFebParameters(const nsw::hw::FEB& feb) const;
+
+    /**
+     * \brief ROC/TDS phase and TDS BCID offset of a PFEB in this iteration
+     */
+    std::optional<FebSettings> getFebSettings(const nsw::hw::FEB& feb) const;
+
+    /**
+     * \brief Find the index of each PFEB in the pad trigger BCIDs
+     */
+    void mapPfebs();
+
+    /**
+     * \brief Write the settings found by the search, by PFEB (json)
+     */
+    void writePatch() const;
+
+    /**
+     * \brief Write the best phase of each PFEB, without the search (json)
+     */
+    void writePhasePatch() const;
 
     /**
      * \brief Get TDS BCIDs observed in the pad trigger
@@ -107,9 +173,26 @@ namespace nsw {
     static constexpr std::uint32_t m_numTdsBcidOffsets{2};
     static constexpr std::string_view m_tdsBcidOffset{"BCID_Offset"};
 
+    // search
+    bool m_search{false};
+    std::uint32_t m_nominalDelay{0};
+    std::unique_ptr<sTGCPadsRocTds40MhzSearch> m_searchState{nullptr};
+    std::map<std::string, std::size_t> m_pfebIndex{};  //!< Index in the pad trigger BCIDs, by SCA address
+
+    // BCID statistics
+    bool m_raw{false};
+    double m_stableFraction{1.0};
+    std::unique_ptr<BcidStatistics> m_stats{nullptr};
+    BcidStatistics::Columns m_columns{};
+
+    // last written settings
+    std::map<std::string, FebSettings> m_written{};
+    std::optional<std::uint32_t> m_writtenDelay{};
+
     /// output ROOT file
     std::uint32_t m_step{0};
     std::uint32_t m_reads{0};
+    std::uint32_t m_read{0};
     std::uint32_t m_phase{0};
     std::uint32_t m_offset{0};
     std::uint32_t m_pt_delay{0};
@@ -117,12 +200,17 @@ namespace nsw {
     std::string m_app_name{""};
     std::string m_now{""};
     std::string m_rname{""};
+    std::string m_raw_rname{""};
     std::string m_pt_name{""};
     std::unique_ptr<TFile> m_rfile{nullptr};
     std::shared_ptr<TTree> m_rtree{nullptr};
+    std::unique_ptr<TFile> m_raw_rfile{nullptr};
+    std::shared_ptr<TTree> m_raw_rtree{nullptr};
     std::vector<std::uint32_t> m_pfeb{};
-    std::vector<std::uint32_t> m_bcid{};
+    std::vector<std::uint32_t> m_raw_bcid{};
     std::vector<std::uint32_t> m_error{};
+    std::vector<std::uint32_t> m_pfeb_phase{};
+    std::string m_stage{"scan"};
   };
 
 }
@@ -0,0 +1,134 @@
+#ifndef NSWCALIBRATION_STGCPADSROCTDS40MHZSEARCH_H
+#define NSWCALIBRATION_STGCPADSROCTDS40MHZSEARCH_H
+
+/**
+ * \brief Adaptive search of the ROC/TDS 40MHz phase, pad trigger input delay
+ * and TDS BCID offset (sTGCPadsRocTds40MhzSearch)
+ *
+ * Instead of all phases x delays x offsets, in two stages:
+ *
+ *   - phase: all phases at the nominal delay and offset 0. A phase is
+ *     stable for a PFEB if its BCID is the same as at both neighbouring
+ *     phases. The longest run of stable phases, modulo the phase range, is
+ *     the window of the PFEB, and each PFEB is set to the center of its
+ *     window for the next stage.
+ *   - delay: all delays and offsets, the delay changing fastest.
+ *
+ * At the end, for each delay, the target BCID is the one reached by most
+ * PFEBs with one of their offsets. The delay is the center of the longest
+ * run of delays reaching the most PFEBs with the same target, and each PFEB
+ * gets the smallest offset reaching the target at that delay. Only the
+ * PFEBs with a phase window take part: a PFEB without transition (e.g. a
+ * constant BCID) or without window, and an excluded input, does not.
+ */
+
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace nsw {
+
+  class sTGCPadsRocTds40MhzSearch {
+  public:
+    enum class Status {
+      Searching,
+      NoWindow,       //!< No stable phase
+      NoTransition,   //!< The BCID is the same at all phases, the center of the range is used in the delay stage
+      Misaligned,     //!< Does not reach the target BCID at the chosen delay
+      Aligned,
+      Excluded,       //!< Not searched, see exclude
+    };
+
+    struct Result {
+      Status status{Status::Searching};
+      std::uint32_t first{0};   //!< First phase of the window
+      std::uint32_t last{0};    //!< Last phase of the window
+      std::uint32_t phase{0};   //!< Chosen phase
+      std::uint32_t offset{0};  //!< Chosen TDS BCID offset
+    };
+
+    /**
+     * \param numPfebs Number of PFEBs, i.e. BCIDs read from the pad trigger
+     * \param numPhases Number of phases scanned
+     * \param phaseStep Distance between two scanned phases
+     * \param numDelays Number of pad trigger input delays
+     * \param numOffsets Number of TDS BCID offsets
+     * \param nominalDelay Pad trigger input delay of the phase stage
+     *
+     * \throws std::runtime_error if there are less than 3 phases, or the nominal delay is out of range
+     */
+    sTGCPadsRocTds40MhzSearch(std::size_t numPfebs, std::uint32_t numPhases, std::uint32_t phaseStep,
+                              std::uint32_t numDelays, std::uint32_t numOffsets, std::uint32_t nominalDelay);
+
+    /**
+     * \brief Do not search the settings of a PFEB, e.g. an input without PFEB
+     *
+     * To be called before the first result.
+     */
+    void exclude(std::size_t pfeb);
+
+    /// Number of iterations of the search
+    [[nodiscard]] std::size_t getNumIterations() const;
+
+    /// Stage of an iteration: phase or delay
+    [[nodiscard]] std::string getStage(std::size_t iteration) const;
+
+    /// Phase to write to each PFEB in the next iteration
+    [[nodiscard]] const std::vector<std::uint32_t>& getPhases() const { return m_phases; }
+
+    /// Pad trigger input delay of the next iteration
+    [[nodiscard]] std::uint32_t getDelay() const { return m_delay; }
+
+    /// TDS BCID offset of the next iteration
+    [[nodiscard]] std::uint32_t getOffset() const { return m_offset; }
+
+    /**
+     * \brief Give the BCIDs read with the settings of the iteration, per PFEB
+     *
+     * Moves to the next iteration.
+     */
+    void addResult(const std::vector<std::uint32_t>& bcids);
+
+    [[nodiscard]] bool done() const { return m_iteration >= getNumIterations(); }
+    [[nodiscard]] const Result& getResult(std::size_t pfeb) const { return m_pfebs.at(pfeb).result; }
+
+    /// Chosen pad trigger input delay, when done
+    [[nodiscard]] std::optional<std::uint32_t> getBestDelay() const { return m_bestDelay; }
+
+    /// Target BCID of all PFEBs at the chosen delay, when done
+    [[nodiscard]] std::optional<std::uint32_t> getTargetBcid() const { return m_target; }
+
+    [[nodiscard]] static std::string toString(Status status);
+
+  private:
+    struct Pfeb {
+      std::vector<std::uint32_t> phaseBcids{};               //!< Per phase
+      std::vector<std::vector<std::uint32_t>> delayBcids{};  //!< Per offset, per delay
+      Result result{};
+    };
+
+    /// Most common BCID that each PFEB reaches with one offset, and the number of PFEBs
+    [[nodiscard]] std::pair<std::uint32_t, std::size_t> findTarget(std::uint32_t delay) const;
+    void findWindow(Pfeb& pfeb) const;
+    void finish();
+    void prepare();
+
+    std::uint32_t m_numPhases;
+    std::uint32_t m_phaseStep;
+    std::uint32_t m_numDelays;
+    std::uint32_t m_numOffsets;
+    std::uint32_t m_nominalDelay;
+    std::size_t m_iteration{0};
+    std::vector<Pfeb> m_pfebs;
+    std::vector<std::uint32_t> m_phases;
+    std::uint32_t m_delay{0};
+    std::uint32_t m_offset{0};
+    std::optional<std::uint32_t> m_bestDelay{};
+    std::optional<std::uint32_t> m_target{};
+  };
+
+}  // namespace nsw
+
+#endif
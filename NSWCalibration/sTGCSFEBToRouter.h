@@ -4,7 +4,23 @@
 //
 // Derived class for testing Q1 SFEB to Router connection
 //
+// sTGCSFEBToRouterParallel tests Q1, Q2 and Q3 in the same run: each
+// SFEB gets a unique on/off pattern over the iterations, with the same
+// number of iterations on for every SFEB, and the SFEBs of the same Router
+// (same layer and wedge) never on together. A Router should then drop
+// ClkReady exactly in the iterations of its own SFEBs: its drop pattern is
+// decoded into the SFEBs it is connected to, so that a swap between SFEBs
+// of different Routers is seen. 24 SFEBs need 8 iterations.
+//
+// The wait for the Routers to be ready is aborted after a timeout, given in
+// seconds as key=value in calibParams: timeout (60). The iteration then
+// fails, and the drops observed so far are decoded when the output is
+// closed.
+//
 
+#include <chrono>
+#include <cstdint>
+#include <map>
 #include <string>
 #include <vector>
 #include <future>
@@ -40,6 +56,12 @@ namespace nsw {
     void configure() override;
     void unconfigure() override;
 
+    void setCalibParamsFromIS(const ISInfoDictionary& is_dictionary, const std::string& is_db_name) override;
+    void setCalibParams(const std::string& calibParams) override;
+
+    /// Also decode the Router drops observed so far, and close the watchdog output
+    void closeOutputs() override;
+
   public:
     [[deprecated]]
     boost::property_tree::ptree patterns() const;
@@ -47,15 +69,32 @@ namespace nsw {
     int configure_routers() const;
     int configure_router(const nsw::hw::Router& router) const;
     void gather_sfebs();
-    int router_watchdog(bool open, bool close);
-    void wait_for_routers(size_t expectation) const;
+    void group_sfebs();
+    std::size_t assign_codes(const std::map<std::string, std::vector<std::string>>& routers);
+    void decode_routers();
+    int router_watchdog(bool open, bool close, bool prbs = false);
+    void wait_for_routers(size_t expectation);
     size_t count_ready_routers() const;
     bool router_ClkReady(const nsw::hw::Router& router) const;
+    static std::string router_key(const std::string& sfeb);
 
   private:
+    bool read_ClkReady(const nsw::hw::Router& router) const;
+    int configure_sfebs(bool enable) const;
+    void close_watchdog();
+
+    static constexpr std::chrono::milliseconds m_router_poll{250};
+    std::chrono::seconds m_router_timeout{60};
+
     std::reference_wrapper<const std::vector<hw::Router>> m_routers;
     boost::property_tree::ptree m_patterns;
+    bool m_parallel{false};
     std::vector<std::string> m_sfebs_ordered = {};
+    std::vector<std::vector<std::string>> m_sfebs_pulsed = {};  //!< Per iteration
+    std::map<std::string, std::uint64_t> m_sfeb_codes = {};     //!< Iterations with PRBS, per SFEB
+    std::map<std::string, std::uint64_t> m_router_codes = {};   //!< Expected ClkReady drops, per Router key
+    std::vector<std::uint64_t> m_router_drops = {};             //!< ClkReady drops, per Router
+    std::uint64_t m_observed{0};                                //!< Iterations read in this run
     std::vector<nsw::FEBConfig> m_sfebs = {};
     std::future<int> m_watchdog;
 
@@ -4,11 +4,22 @@
 //
 // Derived class for all things sTGC strips trigger calib
 //
+// After each PRBS toggle, the TDS PRBS lock is waited for with a fixed
+// pause: no register tells when it is reached. The Router links are
+// polled during the pause, from before the toggle, for diagnostics only.
+// Parameters, as key=value in calibParams: pause (15000 ms, 1000 ms in
+// simulation) and poll (250 ms). The status and time to lock of each
+// Router are appended to <calibType>.<run>.<app>.locktime.txt.
+//
+#include <chrono>
+#include <functional>
+#include <optional>
 #include <vector>
 #include <utility>
 
 #include "NSWCalibration/CalibAlg.h"
 #include "NSWConfiguration/FEBConfig.h"
+#include "NSWConfiguration/hw/Router.h"
 
 #include "ers/Issue.h"
 
@@ -30,6 +41,9 @@ namespace nsw {
     void configure() override;
     void unconfigure() override;
 
+    void setCalibParamsFromIS(const ISInfoDictionary& is_dictionary, const std::string& is_db_name) override;
+    void setCalibParams(const std::string& calibParams) override;
+
   public:
     int configure_tds(const std::string& name, const std::vector<std::string>& tdss, bool prbs_e, bool pause);
     int configure_tds(const nsw::FEBConfig& feb, const std::string& tds, bool prbs_e);
@@ -37,8 +51,14 @@ namespace nsw {
     std::vector<std::pair <std::string, std::string > > router_recovery_tds();
     bool dont_touch(const std::string& name, const std::string& tds);
     std::string simplified(const std::string& name) const;
+    void wait_for_lock(const std::string& name, const std::vector<std::string>& tdss, bool prbs_e,
+                       const std::function<void()>& toggle) const;
+    std::uint64_t link_status(const nsw::hw::Router& router) const;
 
   private:
+    std::optional<std::chrono::milliseconds> m_pause{};
+    std::chrono::milliseconds m_poll{250};
+
     std::vector<std::string> m_sfebs_ordered = {};
     std::vector<nsw::FEBConfig> m_sfebs = {};
     std::vector<std::pair <std::string, std::string > > m_router_recovery_tds = {};
@@ -5,6 +5,7 @@
 // Derived class for all things sTGC trigger calib
 //
 
+#include <memory>
 #include <string>
 #include <vector>
 
@@ -14,6 +15,7 @@
 #include <NSWConfiguration/hw/FEB.h>
 
 #include "NSWCalibration/CalibAlg.h"
+#include "NSWCalibration/sTGCPadConnectivityDecoder.h"
 
 ERS_DECLARE_ISSUE(nsw,
                   NSWsTGCTriggerCalibIssue,
@@ -32,15 +34,22 @@ namespace nsw {
     sTGCTriggerCalib(std::string calibType, const nsw::hw::DeviceManager& deviceManager);
 
     /**
-     * \brief Empty setup
+     * \brief Reset the decoding of the grouped connectivity
      */
-    void setup(const std::string& /* db */) override {};
+    void setup(const std::string& /* db */) override;
 
     /**
      * \brief Configure the VMMs and pad trigger for test pulsing
      */
     void configure() override;
 
+    void setCalibParamsFromIS(const ISInfoDictionary& is_dictionary, const std::string& is_db_name) override;
+
+    /**
+     * \brief Parameters of the grouped connectivity, key=value: retests
+     */
+    void setCalibParams(const std::string& calibParams) override;
+
     /**
      * \brief Unconfigure the VMMs from test pulsing
      */
@@ -51,15 +60,40 @@ namespace nsw {
     void checkObjects() const;
     void configureVMMs(const nsw::hw::FEB& feb, bool unmask) const;
     void configurePadTrigger() const;
+    std::vector<std::uint32_t> readPadTriggerRates(const nsw::hw::PadTrigger& pt) const;
     std::string_view getCurrentFebName() const;
     const nsw::hw::FEB& getCurrentFeb() const;
+    const nsw::hw::FEB& getFeb(std::string_view name) const;
     std::uint32_t getLatencyScanOffset() const;
     std::uint32_t getLatencyScanNBC() const;
     std::uint32_t getLatencyScanCurrent() const {return getLatencyScanOffset() + counter();}
     void writeToFile(const std::vector<std::uint32_t>& rates) const;
 
   private:
+    /**
+     * \brief Pulse a group of PFEBs (sTGCPadConnectivityScaGrouped)
+     *
+     * The first iterations pulse the groups of sTGCPadConnectivityDecoder,
+     * the last m_numRetests iterations pulse again on its own each PFEB
+     * which is not found on exactly one pad trigger input. Unused retest
+     * iterations are skipped, and PFEBs beyond m_numRetests are reported as
+     * not retested.
+     */
+    void configureGrouped();
+
+    /// PFEBs (in ORDERED_PFEBS_GEOID order) pulsed in the current iteration
+    std::vector<std::size_t> getGroupedPfebs() const;
+
+    /// Connectivity of each pad trigger input, in a json file
+    void writeGroupedResults() const;
+
     const bool m_latencyScan;
+    const bool m_grouped;
+    std::unique_ptr<sTGCPadConnectivityDecoder> m_decoder{};
+    std::size_t m_numRetests{4};           //!< Iterations reserved to pulse PFEBs on their own
+    std::vector<std::size_t> m_retests{};  //!< PFEBs pulsed on their own
+    std::vector<std::size_t> m_notRetested{};  //!< PFEBs to pulse on their own, beyond m_numRetests
+    std::vector<std::size_t> m_pulsed{};   //!< PFEBs pulsed in the current iteration
 
     static constexpr bool m_unmask{true};
     static constexpr bool m_mask{false};
@@ -1,5 +1,7 @@
 // Program to read ART hit counters
 
+#include <atomic>
+#include <chrono>
 #include <sstream>
 #include <iostream>
 #include <string>
@@ -7,6 +9,7 @@
 #include <thread>
 #include <future>
 
+#include "NSWCalibration/MonitoringFeed.h"
 #include "NSWCalibration/Utility.h"
 
 #include "NSWConfiguration/ConfigReader.h"
@@ -24,8 +27,18 @@
 
 namespace po = boost::program_options;
 
-int addc_hit_watchdog(const std::vector<nsw::ADDCConfig>& addcs, bool simulation);
-std::vector<int> addc_read_register(const nsw::ADDCConfig& addc, int art, bool simulation);
+//
+// Counters of one ART, and when they were read
+//
+struct ArtReading {
+  std::vector<uint32_t> counters;
+  std::chrono::steady_clock::time_point time;
+};
+
+int addc_hit_watchdog(const std::vector<nsw::ADDCConfig>& addcs, bool simulation, std::chrono::microseconds period,
+                      const std::string& feed_name);
+std::vector<ArtReading> addc_read_counters(const nsw::hw::ADDC& addc, bool simulation);
+std::vector<uint32_t> art_read_counters(const nsw::hw::ART& art, bool simulation);
 std::atomic<bool> end(false);
 std::string metadata();
 std::string exec(const char* cmd);
@@ -36,8 +49,10 @@ int main(int argc, const char *argv[])
     std::string config_files = "/afs/cern.ch/user/n/nswdaq/public/sw/config-ttc/config-files";
     std::string config_filename;
     std::string board_name;
+    std::string feed_name;
     bool simulation;
     bool once;
+    double period;
 
     // command line args
     po::options_description desc(std::string("ART hit counters reader"));
@@ -49,6 +64,10 @@ int main(int argc, const char *argv[])
          default_value(false), "Option to disable all I/O with the hardware")
         ("once", po::bool_switch()->
          default_value(false), "Option to read the ART counters once and only once")
+        ("period,p", po::value<double>(&period)->
+         default_value(1.0), "Time between two readings of the counters, in seconds")
+        ("feed,f", po::value<std::string>(&feed_name)->
+         default_value("nsw_art_hit_counters"), "Shared memory feed of the rates, for nsw_calib_monitor. Empty to disable")
         ("name,n", po::value<std::string>(&board_name)->
          default_value(""), "The name of frontend to configure (should start with ADDC_).");
     po::variables_map vm;
@@ -60,6 +79,10 @@ int main(int argc, const char *argv[])
         std::cout << desc << "\n";
         return 1;
     }
+    if (period <= 0) {
+        std::cout << "The period must be positive, got " << period << std::endl;
+        return -1;
+    }
 
     //
     // option to guess configuration from active partition
@@ -88,7 +111,8 @@ int main(int argc, const char *argv[])
     //
     // launch monitoring thread
     //
-    auto watchdog = std::async(std::launch::async, addc_hit_watchdog, addc_configs, simulation);
+    const auto period_us = std::chrono::microseconds(static_cast<long>(period * 1e6));
+    auto watchdog = std::async(std::launch::async, addc_hit_watchdog, addc_configs, simulation, period_us, feed_name);
 
     //
     // wait for user to end, or read once
@@ -105,13 +129,20 @@ int main(int argc, const char *argv[])
     return 0;
 }
 
-int addc_hit_watchdog(const std::vector<nsw::ADDCConfig>& addcs, bool simulation) {
+int addc_hit_watchdog(const std::vector<nsw::ADDCConfig>& addcs, bool simulation, std::chrono::microseconds period,
+                      const std::string& feed_name) {
 
   //
-  // Sorry for all the layers of vectors.
-  // 1 std::vector because looping over ADDCs
-  // 1 std::vector because reading multiple registers
+  // The ADDC objects, and their connections, are made once.
+  // Every period, one thread per ADDC reads the counters of its ARTs.
+  // The rates are the increase of the counters divided by
+  //   the time between two readings of the same ART.
   //
+  auto opcManager = nsw::OpcManager{};
+  std::vector<nsw::hw::ADDC> addcs_hw{};
+  addcs_hw.reserve(addcs.size());
+  for (const auto & addc : addcs)
+    addcs_hw.emplace_back(opcManager, addc);
 
   // output
   auto now = nsw::calib::utils::strf_time();
@@ -122,25 +153,45 @@ int addc_hit_watchdog(const std::vector<nsw::ADDCConfig>& addcs, bool simulation
   std::string addc_address = "";
   std::string art_name     = "";
   int art_index            = -1;
+  double interval          = 0;
   auto art_hits            = std::make_unique< std::vector<int> >();
+  auto art_rates           = std::make_unique< std::vector<double> >();
   rtree->Branch("time",         &now);
   rtree->Branch("event",        &event);
   rtree->Branch("addc_address", &addc_address);
   rtree->Branch("art_name",     &art_name);
   rtree->Branch("art_index",    &art_index);
   rtree->Branch("art_hits",     art_hits.get());
+  rtree->Branch("art_rates",    art_rates.get());
+  rtree->Branch("interval",     &interval);
+
+  // live feed of the rates, optional
+  std::unique_ptr<nsw::MonitoringFeed> feed{};
+  if (!feed_name.empty()) {
+    try {
+      feed = std::make_unique<nsw::MonitoringFeed>(feed_name);
+      std::cout << "Publishing the rates to " << feed->getName() << std::endl;
+    } catch (std::exception & e) {
+      std::cout << "No monitoring feed: " << e.what() << std::endl;
+    }
+  }
+
+  // previous reading of each ART, empty before the first
+  std::vector<ArtReading> previous{};
+  std::size_t missed = 0;
 
   // polling
   try {
 
-    auto threads = std::make_unique< std::vector< std::future< std::vector<int> > > >();
+    auto threads = std::vector< std::future< std::vector<ArtReading> > >{};
+    auto next = std::chrono::steady_clock::now();
 
     while (true) {
 
       //
       // loop init
       //
-      threads->clear();
+      threads.clear();
       event = event + 1;
       now = nsw::calib::utils::strf_time();
 
@@ -148,32 +199,53 @@ int addc_hit_watchdog(const std::vector<nsw::ADDCConfig>& addcs, bool simulation
       // launch threads
       // https://its.cern.ch/jira/browse/OPCUA-2188
       //
-      for (auto & addc : addcs)
-        for (auto art: addc.getARTs())
-          threads->push_back(std::async(std::launch::async, addc_read_register, addc, art.index(), simulation));
+      for (const auto & addc : addcs_hw)
+        threads.push_back(std::async(std::launch::async, addc_read_counters, std::cref(addc), simulation));
 
       //
       // threads results
       //
+      std::vector<ArtReading> readings{};
+      for (auto & thread : threads)
+        for (auto & reading : thread.get())
+          readings.push_back(std::move(reading));
+
       size_t it = 0;
-      for (auto & addc : addcs) {
-        for (auto art: addc.getARTs()) {
-          auto result = threads->at(it).get();
+      for (const auto & addc : addcs_hw) {
+        for (const auto & art : addc.getARTs()) {
+          const auto & reading = readings.at(it);
 
-          addc_address = addc.getAddress();
+          addc_address = addc.getScaAddress();
           art_name     = art.getName();
           art_index    = it;
           art_hits->clear();
-          for (auto val : result)
-            art_hits->push_back(val);
+          art_rates->clear();
+          for (auto val : reading.counters)
+            art_hits->push_back(static_cast<int>(val));
+
+          //
+          // rates since the previous reading.
+          // the counters are 32 bits, and the subtraction wraps around with them.
+          //
+          interval = 0;
+          if (previous.size() == readings.size()) {
+            const auto & last = previous.at(it);
+            interval = std::chrono::duration<double>(reading.time - last.time).count();
+            for (size_t ch = 0; ch < reading.counters.size() && ch < last.counters.size(); ch++) {
+              const uint32_t delta = reading.counters.at(ch) - last.counters.at(ch);
+              art_rates->push_back(interval > 0 ? delta / interval : 0);
+            }
+          }
           rtree->Fill();
+          if (feed && !art_rates->empty())
+            feed->publishArtRates(addc_address + "." + art_name, *art_rates);
 
           //
           // cout for fun
           //
-          std::cout << addc.getAddress() + "." + art.getName() << " " << now << std::endl;
+          std::cout << addc.getScaAddress() + "." + art.getName() << " " << now << std::endl;
           int counter = 0;
-          for (auto val : result) {
+          for (auto val : reading.counters) {
             std::stringstream ss;
             ss << std::hex << std::setfill('0') << std::setw(8) << val;
             std::cout << " 0x" << ss.str();
@@ -184,11 +256,7 @@ int addc_hit_watchdog(const std::vector<nsw::ADDCConfig>& addcs, bool simulation
           it++;
         }
       }
-
-      //
-      // pause
-      //
-      usleep(1e6);
+      previous = std::move(readings);
 
       //
       // end
@@ -197,11 +265,28 @@ int addc_hit_watchdog(const std::vector<nsw::ADDCConfig>& addcs, bool simulation
         std::cout << "Breaking" << std::endl;
         break;
       }
+
+      //
+      // pause until the next period.
+      // the schedule is fixed, so the time spent reading does not add up.
+      // if the reading took longer than a period, skip the missed ones.
+      //
+      next += period;
+      const auto after = std::chrono::steady_clock::now();
+      if (next < after) {
+        const auto behind = (after - next) / period + 1;
+        missed += static_cast<std::size_t>(behind);
+        next += behind * period;
+      }
+      std::this_thread::sleep_until(next);
     }
   } catch (std::exception & e) {
     std::cout << "addc_hit_watchdog caught exception: " << e.what() << std::endl;
   }
 
+  if (missed > 0)
+    std::cout << "Reading was slower than the period, " << missed << " periods were skipped" << std::endl;
+
   //
   // close
   //
@@ -212,19 +297,25 @@ int addc_hit_watchdog(const std::vector<nsw::ADDCConfig>& addcs, bool simulation
   return 0;
 }
 
-std::vector<int> addc_read_register(const nsw::ADDCConfig& addc, int art, bool simulation) {
+std::vector<ArtReading> addc_read_counters(const nsw::hw::ADDC& addc, bool simulation) {
+  std::vector<ArtReading> readings{};
+  for (const auto & art : addc.getARTs()) {
+    auto counters = art_read_counters(art, simulation);
+    readings.push_back({std::move(counters), std::chrono::steady_clock::now()});
+  }
+  return readings;
+}
+
+std::vector<uint32_t> art_read_counters(const nsw::hw::ART& art, bool simulation) {
   //
   // https://espace.cern.ch/ATLAS-NSW-ELX/_layouts/15/WopiFrame.aspx?
   // sourcedoc=/ATLAS-NSW-ELX/Shared%20Documents/ART/art2_registers_v.xlsx&action=default
   //
-  auto opcManager = nsw::OpcManager{};
-  nsw::hw::ADDC addcHW(opcManager, addc);
-  auto & artHW = addcHW.getARTs()[art];
   size_t reg_local  = 0;
-  size_t word32     = 0;
+  uint32_t word32   = 0;
   size_t index      = 0;
   std::vector<uint8_t> readback = {};
-  std::vector<int> results      = {};
+  std::vector<uint32_t> results = {};
 
   //
   // query registers
@@ -238,15 +329,11 @@ std::vector<int> addc_read_register(const nsw::ADDCConfig& addc, int art, bool s
     if ((reg_local % nsw::art::REG_COUNTERS_SIMULT) > 0)
       continue;
 
-    //
-    // register address
-    //
-
     //
     // read the register
     //
     if (!simulation) {
-      readback = artHW.readRegister(artHW.getNameCore(),
+      readback = art.readRegister(art.getNameCore(),
           reg,
           nsw::art::ADDRESS_SIZE,
           nsw::art::REG_COUNTERS_SIMULT);
@@ -256,7 +343,7 @@ std::vector<int> addc_read_register(const nsw::ADDCConfig& addc, int art, bool s
         readback.push_back(static_cast<uint8_t>(it));
     }
     if (readback.size() != static_cast<size_t>(nsw::art::REG_COUNTERS_SIMULT))
-      throw std::runtime_error("Problem reading ART register: " + addc.getAddress());
+      throw std::runtime_error("Problem reading ART register: " + art.getScaAddress());
 
     //
     // convert N 1-byte registers into N/4 32-bit word
@@ -265,9 +352,9 @@ std::vector<int> addc_read_register(const nsw::ADDCConfig& addc, int art, bool s
       index = it % nsw::art::REG_COUNTERS_SIZE;
       if (index == 0)
         word32 = 0;
-      word32 += (readback.at(it) << index*nsw::NUM_BITS_IN_BYTE);
+      word32 += (static_cast<uint32_t>(readback.at(it)) << index*nsw::NUM_BITS_IN_BYTE);
       if (index == nsw::art::REG_COUNTERS_SIZE - 1)
-        results.push_back(static_cast<int>(word32));
+        results.push_back(word32);
     }
 
   }
@@ -0,0 +1,126 @@
+// Program to tail the live monitoring feed of the calibration watchdogs
+//
+// nsw_art_hit_counters and the ADDC-TP watchdog of MMTriggerCalib
+// publish their readings in shared memory (see MonitoringFeed.h).
+// This prints the ART rates, and the TP fiber alignment when it changes,
+// without any access to the hardware.
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <csignal>
+#include <iostream>
+#include <map>
+#include <numeric>
+#include <string>
+#include <thread>
+
+#include <fmt/core.h>
+
+#include "NSWCalibration/MonitoringFeed.h"
+
+#include "boost/program_options.hpp"
+
+namespace po = boost::program_options;
+
+std::atomic<bool> end(false);
+
+void print_art_rates(const nsw::monitoring::Reading& reading);
+void print_tp_alignment(const nsw::monitoring::Reading& reading, std::map<std::string, std::uint32_t>& alignments);
+
+int main(int argc, const char *argv[])
+{
+    std::string feed_name;
+    double period;
+    bool quiet;
+
+    // command line args
+    po::options_description desc(std::string("NSW calibration monitoring feed reader"));
+    desc.add_options()
+        ("help,h", "produce help message")
+        ("name,n", po::value<std::string>(&feed_name)->
+         default_value("nsw_art_hit_counters"), "Name of the feed, e.g. nsw_calib_<application> for MMTriggerCalib")
+        ("period,p", po::value<double>(&period)->
+         default_value(1.0), "Time between two polls of the feed, in seconds")
+        ("quiet,q", po::bool_switch(&quiet)->
+         default_value(false), "Only print the TP alignment changes");
+    po::variables_map vm;
+    po::store(po::parse_command_line(argc, argv, desc), vm);
+    po::notify(vm);
+    if (vm.count("help")) {
+        std::cout << desc << "\n";
+        return 1;
+    }
+    if (period <= 0) {
+        std::cout << "The period must be positive, got " << period << std::endl;
+        return -1;
+    }
+
+    std::signal(SIGINT, [](int) { end = true; });
+    std::signal(SIGTERM, [](int) { end = true; });
+
+    try {
+      auto reader = nsw::MonitoringFeedReader{feed_name};
+      std::cout << "Reading " << nsw::monitoring::sharedMemoryName(feed_name) << ". Ctrl-C to end" << std::endl;
+
+      // last alignment word of each TP
+      std::map<std::string, std::uint32_t> alignments{};
+      std::uint64_t lost = 0;
+      const auto sleep = std::chrono::microseconds(static_cast<long>(period * 1e6));
+
+      while (not end) {
+        for (const auto& reading : reader.poll()) {
+          switch (reading.kind) {
+            case nsw::monitoring::Kind::ArtRates:
+              if (not quiet)
+                print_art_rates(reading);
+              break;
+            case nsw::monitoring::Kind::TpAlignment:
+              print_tp_alignment(reading, alignments);
+              break;
+          }
+        }
+        if (reader.getLost() != lost) {
+          std::cout << fmt::format("Lost {} records, poll faster (--period)", reader.getLost() - lost) << std::endl;
+          lost = reader.getLost();
+        }
+        std::this_thread::sleep_for(sleep);
+      }
+    } catch (std::exception & e) {
+      std::cout << "Caught exception: " << e.what() << std::endl;
+      return -1;
+    }
+
+    return 0;
+}
+
+void print_art_rates(const nsw::monitoring::Reading& reading) {
+  const auto rates = reading.rates();
+  if (rates.empty())
+    return;
+  const auto max = std::max_element(std::cbegin(rates), std::cend(rates));
+  std::cout << fmt::format("{:<40} total {:>12.1f} Hz, max {:>12.1f} Hz (input {:>2}), silent inputs {:>2}",
+                           reading.source,
+                           std::accumulate(std::cbegin(rates), std::cend(rates), 0.),
+                           *max,
+                           std::distance(std::cbegin(rates), max),
+                           std::count(std::cbegin(rates), std::cend(rates), 0.F))
+            << std::endl;
+}
+
+void print_tp_alignment(const nsw::monitoring::Reading& reading, std::map<std::string, std::uint32_t>& alignments) {
+  if (reading.data.empty())
+    return;
+  const auto alignment = reading.data.front();
+  const auto previous = alignments.find(reading.source);
+  if (previous != std::cend(alignments) and previous->second == alignment)
+    return;
+
+  // fibers which lost (or gained) their alignment since the previous reading
+  const auto changed = previous == std::cend(alignments) ? std::uint32_t{0} : previous->second ^ alignment;
+  std::cout << fmt::format("{:<40} alignment 0x{:08x}", reading.source, alignment);
+  if (changed != 0)
+    std::cout << fmt::format(" (was 0x{:08x}, changed 0x{:08x})", previous->second, changed);
+  std::cout << std::endl;
+  alignments[reading.source] = alignment;
+}
@@ -0,0 +1,214 @@
+// Program to run a calibration loop without the TDAQ run control
+//
+// The same calibration classes as in NSWCalibRc are used, but the
+// iterations are driven from the command line:
+//   setup, then { configure, acquire, unconfigure, next } x total
+// ALTI commands are not sent: the sequences are printed, and the
+// user is responsible for the ALTI (or for using --simulation).
+
+#include <chrono>
+#include <ctime>
+#include <iostream>
+#include <memory>
+#include <string>
+
+#include <fmt/core.h>
+
+#include <ers/ers.h>
+
+#include "NSWCalibration/CalibAlg.h"
+#include "NSWCalibration/CalibAlgFactory.h"
+#include "NSWCalibration/Utility.h"
+
+#include "NSWConfiguration/ConfigReader.h"
+#include "NSWConfiguration/hw/DeviceManager.h"
+
+#include "boost/program_options.hpp"
+
+namespace po = boost::program_options;
+
+using Clock = std::chrono::steady_clock;
+
+struct StepTimer {
+  double configure{0};
+  double acquire{0};
+  double unconfigure{0};
+};
+
+double seconds_since(const Clock::time_point& start);
+void print_alti_sequences(const nsw::CalibAlg& calib);
+
+int main(int argc, const char *argv[])
+{
+    std::string config_filename;
+    std::string calib_type;
+    std::string calib_params;
+    std::string output_path;
+    std::string app_name;
+    std::uint32_t run_number{0};
+    std::size_t max_iterations{0};
+    bool simulation{false};
+    bool resume{false};
+
+    // command line args
+    po::options_description desc(std::string("Standalone NSW calibration driver"));
+    desc.add_options()
+        ("help,h", "produce help message")
+        ("config_file,c", po::value<std::string>(&config_filename)->
+         default_value(""), "Configuration file path (json)")
+        ("calib_type,t", po::value<std::string>(&calib_type)->
+         default_value(""), "Calibration type, as in NswParams.Calib.calibType")
+        ("calib_params,p", po::value<std::string>(&calib_params)->
+         default_value(""), "Calibration parameters, as in NswParams.Calib.calibParams")
+        ("output,o", po::value<std::string>(&output_path)->
+         default_value("."), "Base directory for calibration output files")
+        ("run_number,r", po::value<std::uint32_t>(&run_number)->
+         default_value(0), "Run number used to tag output files. 0 means use the start time.")
+        ("name,n", po::value<std::string>(&app_name)->
+         default_value("nsw_calib_run"), "Application name used to tag output files")
+        ("iterations,i", po::value<std::size_t>(&max_iterations)->
+         default_value(0), "Stop after this many iterations. 0 means run all of them.")
+        ("simulation", po::bool_switch(&simulation)->
+         default_value(false), "Run the calibration in simulation mode")
+        ("resume", po::bool_switch(&resume)->
+         default_value(false), "Continue an interrupted calibration from its checkpoint");
+    po::variables_map vm;
+    po::store(po::parse_command_line(argc, argv, desc), vm);
+    po::notify(vm);
+    if (vm.count("help")) {
+        std::cout << desc << "\n";
+        return 1;
+    }
+    if (config_filename.empty() or calib_type.empty()) {
+        std::cout << "Please provide a configuration file (-c) and a calibration type (-t)" << std::endl;
+        std::cout << desc << "\n";
+        return 1;
+    }
+
+    const auto start_time = Clock::now();
+
+    //
+    // devices
+    //
+    const auto cfg = "json://" + config_filename;
+    nsw::ConfigReader reader(cfg);
+    try {
+        reader.readConfig();
+    } catch (std::exception & e) {
+        std::cout << "Make sure the json is formed correctly. "
+                  << "Can't read config file due to : " << e.what() << std::endl;
+        return -1;
+    }
+    nsw::hw::DeviceManager deviceManager{};
+    for (const auto& name: reader.getAllElementNames()) {
+        deviceManager.add(reader.readConfig(name));
+    }
+    std::cout << fmt::format("Read {} elements from {} in {:.1f}s",
+                             reader.getAllElementNames().size(), config_filename,
+                             seconds_since(start_time)) << std::endl;
+
+    //
+    // calibration
+    //
+    std::unique_ptr<nsw::CalibAlg> calib;
+    try {
+        calib = nsw::makeCalibAlg(calib_type, deviceManager);
+    } catch (std::exception & e) {
+        std::cout << e.what() << std::endl;
+        return -1;
+    }
+    calib->setApplicationName(app_name);
+    calib->setOutputPath(output_path);
+    calib->setSimulation(simulation);
+    calib->setCurrentRunParameters({run_number, std::time(nullptr)});
+
+    const auto setup_time = Clock::now();
+    try {
+        if (not calib_params.empty()) {
+            calib->setCalibParams(calib_params);
+        }
+        // most calibrations set their total in setup, which the checkpoint must match
+        calib->setup(cfg);
+        if (resume) {
+            calib->resume();
+        }
+    } catch (std::exception & e) {
+        std::cout << fmt::format("Calibration setup failed: {}", e.what()) << std::endl;
+        return -1;
+    }
+    const auto setup_seconds = seconds_since(setup_time);
+    print_alti_sequences(*calib);
+
+    //
+    // loop
+    //
+    const auto remaining = calib->total() - calib->counter();
+    const auto niterations = (max_iterations > 0) ? std::min(max_iterations, remaining) : remaining;
+    std::cout << fmt::format("Running {} of {} iterations of {}, starting at {}",
+                             niterations, calib->total(), calib_type, calib->counter())
+              << std::endl;
+    StepTimer timer{};
+    const auto loop_time = Clock::now();
+    try {
+        for (std::size_t it = 0; it < niterations; it++) {
+            calib->progressbar();
+            auto step_time = Clock::now();
+            calib->configure();
+            timer.configure += seconds_since(step_time);
+
+            step_time = Clock::now();
+            calib->acquire();
+            timer.acquire += seconds_since(step_time);
+
+            step_time = Clock::now();
+            calib->unconfigure();
+            timer.unconfigure += seconds_since(step_time);
+            calib->next();
+            calib->checkpoint();
+        }
+    } catch (std::exception & e) {
+        std::cout << fmt::format("Calibration failed at iteration {}: {}", calib->counter(), e.what())
+                  << std::endl;
+        return -1;
+    }
+    const auto loop_seconds = seconds_since(loop_time);
+
+    //
+    // timing summary
+    //
+    const auto per_iteration = [niterations](const double val) {
+      return niterations > 0 ? val / static_cast<double>(niterations) : 0.0;
+    };
+    std::cout << std::endl;
+    std::cout << fmt::format("{} finished at {}", calib_type, nsw::calib::utils::strf_time()) << std::endl;
+    std::cout << fmt::format(" setup       {:8.2f}s", setup_seconds) << std::endl;
+    std::cout << fmt::format(" configure   {:8.2f}s ({:.3f}s / iteration)",
+                             timer.configure, per_iteration(timer.configure)) << std::endl;
+    std::cout << fmt::format(" acquire     {:8.2f}s ({:.3f}s / iteration)",
+                             timer.acquire, per_iteration(timer.acquire)) << std::endl;
+    std::cout << fmt::format(" unconfigure {:8.2f}s ({:.3f}s / iteration)",
+                             timer.unconfigure, per_iteration(timer.unconfigure)) << std::endl;
+    std::cout << fmt::format(" loop        {:8.2f}s ({:.3f}s / iteration)",
+                             loop_seconds, per_iteration(loop_seconds)) << std::endl;
+    std::cout << fmt::format(" total       {:8.2f}s", seconds_since(start_time)) << std::endl;
+
+    return 0;
+}
+
+double seconds_since(const Clock::time_point& start) {
+  return std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+void print_alti_sequences(const nsw::CalibAlg& calib) {
+  //
+  // In the partition, these are published to IS for the NSWOrchestrator.
+  // Here they are only printed.
+  //
+  for (const auto& [key, commands]: calib.getAltiSequences().getCommands()) {
+    if (commands.empty()) {
+      continue;
+    }
+    std::cout << fmt::format("ALTI {}: {}", key, nsw::calib::utils::serializeCommands(commands))
+              << std::endl;
+  }
+}
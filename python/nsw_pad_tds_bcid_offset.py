@@ -56,11 +56,13 @@ def plotAndSave(inpath, ttree, outdir):
     hist = ROOT.TH2D("hist", f";{xtitle}; {ytitle}; {ztitle}",
                      NBCS, -0.5, NBCS-0.5,
                      NPFEBS, -0.5, NPFEBS-0.5)
+    search = bool(ttree.GetBranch("tds_bcid_offsets"))
     for ent in range(ttree.GetEntries()):
         _ = ttree.GetEntry(ent)
-        tds_offset = ttree.tds_bcid_offset
         error_word = ttree.pfeb_bcid_error
         for pfeb in range(NPFEBS):
+            # sTGCPadTdsBcidOffsetSearch writes a different offset to each PFEB
+            tds_offset = ttree.tds_bcid_offsets[pfeb] if search else ttree.tds_bcid_offset
             error = (error_word >> pfeb) & 0b1
             hist.Fill(tds_offset, pfeb, not error)
             if not error:
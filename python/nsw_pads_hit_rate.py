@@ -322,9 +322,16 @@ def makeHistogramsSca(ops, ttree, thresholds, nchans, hist, hist2d, mapping):
     # fill histogram
     #
     print(f"Analyzing {ents} entries...")
+    flagged = bool(ttree.GetBranch("large_residual"))
+    nflagged = 0
     for ent in range(ents):
         _ = ttree.GetEntry(ent)
 
+        # decoded rates of sTGCPadsHitRateScaMultiplexed which do not fit the measured sets
+        if flagged and ttree.large_residual:
+            nflagged += 1
+            continue
+
         #
         # TTree interface
         #
@@ -344,6 +351,8 @@ def makeHistogramsSca(ops, ttree, thresholds, nchans, hist, hist2d, mapping):
         key = getKey(pfeb, chan)
         hist[key].Fill(xval, rate)
         hist2d.Fill(xval, chan + sum(nchans[:pfeb]), rate)
+    if nflagged > 0:
+        print(f"Skipped {nflagged} decoded rates with a large residual")
 
 def labSectorRun():
     ops = options()
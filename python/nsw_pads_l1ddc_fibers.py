@@ -93,6 +93,7 @@ def plot(ttree, ofile):
     # fill histogram
     #
     print(f"Entries: {ents}")
+    summarised = bool(ttree.GetBranch("pfeb_bcid_fraction"))
     for ent in range(ents):
         _ = ttree.GetEntry(ent)
 
@@ -140,12 +141,13 @@ def plot(ttree, ofile):
         metadata.SetTextSize(0.030)
 
         #
-        # scale by the number of register reads,
+        # scale by the number of register reads per entry
+        #  (1 when the nreads reads are summarised in one entry),
         #  remembering that some PFEBs may not be connected
         # NB: "2" because difference of pairs
         #
         scaling = (sum(pfeb_mask) / 2) if key=="all" else 1
-        hist[key].Scale(1 / (nreads * scaling))
+        hist[key].Scale(1 / ((1 if summarised else nreads) * scaling))
 
         #
         # draw and save
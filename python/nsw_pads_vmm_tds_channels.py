@@ -1,9 +1,14 @@
 #!/usr/bin/env tdaq_python
 """
 A script for plotting pad trigger TDS channels versus event number
+
+With --coded, decode the VMM channel of each TDS channel from a
+sTGCPadVMMTDSChannelsCoded run: pad channels with bit k set are pulsed
+in iteration 2k, the others in iteration 2k+1.
 """
 import argparse
 import array
+import json
 import os
 import sys
 import time
@@ -11,11 +16,19 @@ import ROOT
 ROOT.gROOT.SetBatch()
 ROOT.gErrorIgnoreLevel = ROOT.kWarning
 
+import nsw_trigger_mapping
+
 NOW = time.strftime("%Y_%m_%d_%Hh%Mm%Ss")
 EOS = "/eos/atlas/atlascerngroupdisk/det-nsw/191/trigger/"
 NPFEBS = 24
 NCHANS = 104
 
+# an iteration fired if it has this fraction of the hits of the busiest iteration
+FIRED_FRACTION = 0.2
+
+# ambiguous TDS channels with more unknown bits are not retried
+MAX_UNKNOWN_BITS = 3
+
 def main():
 
     #
@@ -42,6 +55,8 @@ def main():
     print("")
     print(f"www.cern.ch/nsw191/trigger/padtrigger/{os.path.basename(output())}")
     print("")
+    if ops.coded:
+        decodeCoded(ttree, output().replace(".pdf", ".json"))
 
 def options():
     parser = argparse.ArgumentParser(usage=__doc__, formatter_class=argparse.ArgumentDefaultsHelpFormatter)
@@ -49,6 +64,8 @@ def options():
     parser.add_argument("-o", help="Output ROOT file",      default="")
     parser.add_argument("-s", help="Sector under test",     default="")
     parser.add_argument("-l", help="Lab name, e.g. 191",    default="")
+    parser.add_argument("-c", "--coded", help="Decode a sTGCPadVMMTDSChannelsCoded run", action="store_true")
+    parser.add_argument("--pad-channels", help="Pad VMM channels per PFEB", type=int, default=128)
     return parser.parse_args()
 
 def output():
@@ -127,6 +144,107 @@ def plot(ttree, ofile):
         suffix = "(" if first else ")" if last else ""
         canv.SaveAs(f"{ofile}{suffix}", "pdf")
 
+def countHits(ttree):
+    """
+    Hits per PFEB, TDS channel and iteration. The pad trigger "sector" is
+    the calib counter, i.e. the iteration, so entries of an iteration do
+    not need to be contiguous.
+    """
+    hits = {}
+    niterations = 0
+    for ent in range(ttree.GetEntries()):
+        _ = ttree.GetEntry(ent)
+        iteration = int(ttree.sectId)
+        niterations = max(niterations, iteration + 1)
+        for (pfeb, tds_ch) in zip(list(ttree.v_hit_pfeb), list(ttree.v_hit_tds_ch)):
+            key = (int(pfeb), int(tds_ch))
+            hits.setdefault(key, {})
+            hits[key][iteration] = hits[key].get(iteration, 0) + 1
+    return (hits, niterations)
+
+def decodeSignature(counts, nbits):
+    """
+    Pad channel of a TDS channel, and the bits which are not known:
+    fired in both iterations of a pair (short, noise) or in none (dead).
+    """
+    busiest = max(counts.values())
+    fired = [counts.get(it, 0) >= FIRED_FRACTION * busiest for it in range(2 * nbits)]
+    value, unknown = 0, []
+    for bit in range(nbits):
+        (isSet, isClear) = (fired[2 * bit], fired[2 * bit + 1])
+        if isSet and not isClear:
+            value |= 1 << bit
+        elif isSet == isClear:
+            unknown.append(bit)
+    return (value, unknown)
+
+def candidates(value, unknown, nchans):
+    """
+    Pad channels matching a signature with unknown bits
+    """
+    result = [value]
+    for bit in unknown:
+        result = result + [val | (1 << bit) for val in result]
+    return sorted(val for val in result if val < nchans)
+
+def decodeCoded(ttree, ofile):
+    (hits, niterations) = countHits(ttree)
+    nbits = niterations // 2
+    nchans = options().pad_channels
+    print(f"Found {niterations} iterations, decoding {nbits} bits")
+    if niterations % 2 != 0:
+        print(f"Warning: expected an even number of iterations, ignoring the last one")
+
+    mapping = {pfeb: {} for pfeb in range(NPFEBS)}
+    ambiguous = {pfeb: {} for pfeb in range(NPFEBS)}
+    for (pfeb, tds_ch) in sorted(hits):
+        (value, unknown) = decodeSignature(hits[(pfeb, tds_ch)], nbits)
+        if unknown:
+            ambiguous[pfeb][tds_ch] = candidates(value, unknown, nchans) if len(unknown) <= MAX_UNKNOWN_BITS else []
+            print(f"PFEB {pfeb:02} TDS channel {tds_ch:3}: ambiguous bits {unknown}")
+        elif value >= nchans:
+            ambiguous[pfeb][tds_ch] = []
+            print(f"PFEB {pfeb:02} TDS channel {tds_ch:3}: decoded pad channel {value} out of range")
+        else:
+            mapping[pfeb][tds_ch] = value
+
+    # two TDS channels with the same signature
+    for pfeb in range(NPFEBS):
+        byValue = {}
+        for (tds_ch, value) in mapping[pfeb].items():
+            byValue.setdefault(value, []).append(tds_ch)
+        for (value, tds_chs) in byValue.items():
+            if len(tds_chs) > 1:
+                print(f"PFEB {pfeb:02} TDS channels {tds_chs}: same pad channel {value}")
+                for tds_ch in tds_chs:
+                    del mapping[pfeb][tds_ch]
+                    ambiguous[pfeb][tds_ch] = [value]
+
+    # connected TDS channels without any hit
+    dead = {pfeb: [] for pfeb in range(NPFEBS)}
+    (_, sector, _) = lab_and_sector_and_run()
+    pads = nsw_trigger_mapping.generate_pad_channel_mapping("L" if int(sector[1:]) % 2 == 1 else "S")
+    for pfeb in range(NPFEBS):
+        for (tds_ch, pad) in enumerate(pads[pfeb]):
+            if pad not in ["x", "X"] and (pfeb, tds_ch) not in hits:
+                dead[pfeb].append(tds_ch)
+        if dead[pfeb]:
+            print(f"PFEB {pfeb:02}: no hits on TDS channels {dead[pfeb]}")
+
+    # pulsed one by one in a sTGCPadVMMTDSChannels run with channels=...
+    retry = sorted(set(chan for pfeb in ambiguous for chans in ambiguous[pfeb].values() for chan in chans))
+    undecodable = sum(1 for pfeb in ambiguous for chans in ambiguous[pfeb].values() if not chans)
+    decoded = sum(len(mapping[pfeb]) for pfeb in mapping)
+    print(f"Decoded {decoded} TDS channels, {sum(len(chans) for chans in ambiguous.values())} ambiguous "
+          f"({undecodable} without candidates), {sum(len(chans) for chans in dead.values())} without hits")
+    if retry:
+        print(f"Retry {len(retry)} pad channels with sTGCPadVMMTDSChannels, calibParams:")
+        print(f"channels={','.join(str(chan) for chan in retry)}")
+
+    with open(ofile, "w") as fout:
+        json.dump({"mapping": mapping, "ambiguous": ambiguous, "dead": dead, "retry": retry}, fout, indent=2)
+    print(f"Wrote {ofile}")
+
 def lab_and_sector_and_run():
     ops = options()
     lab, sector = "", ""
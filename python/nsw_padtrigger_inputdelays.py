@@ -94,6 +94,7 @@ def plot(ttree, ofile):
     # fill histograms
     #
     print(f"Entries: {ents}")
+    summarised = bool(ttree.GetBranch("pfeb_bcid_fraction"))
     for ent in range(ents):
         _ = ttree.GetEntry(ent)
 
@@ -110,8 +111,25 @@ def plot(ttree, ofile):
         #
         # fill
         #
-        for (index, bcid) in zip(pfeb_index, pfeb_bcid):
-            hist[index].Fill(delay, bcid)
+        if not summarised:
+            for (index, bcid) in zip(pfeb_index, pfeb_bcid):
+                hist[index].Fill(delay, bcid)
+            continue
+
+        #
+        # an entry summarises nreads reads: the fraction at the most
+        #  frequent BCID, and the others split around it at the spread
+        #  (their exact BCIDs are in the raw file, see raw=1)
+        #
+        nreads   = int(ttree.nreads)
+        spread   = list(ttree.pfeb_bcid_spread)
+        fraction = list(ttree.pfeb_bcid_fraction)
+        for (index, bcid, dist, frac) in zip(pfeb_index, pfeb_bcid, spread, fraction):
+            others = nreads * (1 - frac)
+            hist[index].Fill(delay, bcid, nreads * frac)
+            if others > 0:
+                hist[index].Fill(delay, (bcid + dist) % NBCIDS, others / 2)
+                hist[index].Fill(delay, (bcid - dist) % NBCIDS, others / 2)
 
     #
     # create plots
@@ -0,0 +1,192 @@
+#include "NSWCalibration/BcidStatistics.h"
+
+#include <algorithm>
+
+nsw::BcidStatistics::BcidStatistics(const std::size_t numPfebs, const double stableFraction) :
+  m_numPfebs{numPfebs},
+  m_stableFraction{stableFraction},
+  m_current(numPfebs),
+  m_recorded(numPfebs)
+{}
+
+void nsw::BcidStatistics::reset()
+{
+  for (auto& histogram : m_current) {
+    histogram.clear();
+  }
+}
+
+void nsw::BcidStatistics::add(const std::vector<std::uint32_t>& bcids)
+{
+  for (std::size_t pfeb = 0; pfeb < std::min(bcids.size(), m_numPfebs); pfeb++) {
+    m_current.at(pfeb)[bcids.at(pfeb) % NUM_BCIDS]++;
+  }
+}
+
+void nsw::BcidStatistics::read(const Reader& reader, const std::size_t numReads, const RawCallback& raw)
+{
+  for (std::size_t read = 0; read < numReads; read++) {
+    const auto bcids = reader();
+    add(bcids);
+    if (raw) {
+      raw(read, bcids);
+    }
+  }
+}
+
+nsw::BcidStatistics::Summary nsw::BcidStatistics::summarise(const Histogram& histogram) const
+{
+  Summary summary{};
+  std::size_t atMode{0};
+  for (const auto& [bcid, count] : histogram) {
+    summary.reads += count;
+    if (count > atMode) {
+      summary.mode = bcid;
+      atMode = count;
+    }
+  }
+  if (summary.reads == 0) {
+    return summary;
+  }
+  for (const auto& [bcid, count] : histogram) {
+    const auto distance = (bcid + NUM_BCIDS - summary.mode) % NUM_BCIDS;
+    summary.spread = std::max(summary.spread, std::min(distance, NUM_BCIDS - distance));
+  }
+  summary.fraction = static_cast<double>(atMode) / static_cast<double>(summary.reads);
+  summary.stable = summary.fraction >= m_stableFraction;
+  return summary;
+}
+
+nsw::BcidStatistics::Summary nsw::BcidStatistics::getSummary(const std::size_t pfeb) const
+{
+  return summarise(m_current.at(pfeb));
+}
+
+nsw::BcidStatistics::Columns nsw::BcidStatistics::getColumns() const
+{
+  Columns columns{};
+  for (std::size_t pfeb = 0; pfeb < m_numPfebs; pfeb++) {
+    const auto summary = getSummary(pfeb);
+    columns.mode.push_back(summary.mode);
+    columns.spread.push_back(summary.spread);
+    columns.fraction.push_back(summary.fraction);
+    columns.stable.push_back(summary.stable);
+  }
+  return columns;
+}
+
+void nsw::BcidStatistics::record(const std::vector<std::uint32_t>& settings)
+{
+  for (std::size_t pfeb = 0; pfeb < std::min(settings.size(), m_numPfebs); pfeb++) {
+    auto& recorded = m_recorded.at(pfeb)[settings.at(pfeb)];
+    for (const auto& [bcid, count] : m_current.at(pfeb)) {
+      recorded[bcid] += count;
+    }
+  }
+}
+
+void nsw::BcidStatistics::record(const std::uint32_t setting)
+{
+  record(std::vector<std::uint32_t>(m_numPfebs, setting));
+}
+
+std::vector<std::pair<std::uint32_t, bool>> nsw::BcidStatistics::getGood(const std::size_t pfeb,
+                                                                          const bool circular) const
+{
+  std::vector<std::uint32_t> settings{};
+  std::vector<Summary> summaries{};
+  for (const auto& [setting, histogram] : m_recorded.at(pfeb)) {
+    settings.push_back(setting);
+    summaries.push_back(summarise(histogram));
+  }
+  const auto size = settings.size();
+  const auto agrees = [&](const std::size_t index, const std::size_t other) {
+    return summaries.at(other).stable and summaries.at(other).mode == summaries.at(index).mode;
+  };
+  std::vector<std::pair<std::uint32_t, bool>> good{};
+  for (std::size_t index = 0; index < size; index++) {
+    auto value = summaries.at(index).stable;
+    if (index > 0 or circular) {
+      value = value and agrees(index, (index + size - 1) % size);
+    }
+    if (index + 1 < size or circular) {
+      value = value and agrees(index, (index + 1) % size);
+    }
+    good.emplace_back(settings.at(index), value);
+  }
+  return good;
+}
+
+std::optional<std::size_t> nsw::BcidStatistics::center(const std::vector<bool>& values, const bool circular)
+{
+  const auto size = values.size();
+  if (std::none_of(std::cbegin(values), std::cend(values), [](const bool value) { return value; })) {
+    return std::nullopt;
+  }
+  if (std::all_of(std::cbegin(values), std::cend(values), [](const bool value) { return value; })) {
+    return (size - 1) / 2;
+  }
+  // start after a false value, so that a circular run through the end is not split
+  std::size_t start{0};
+  if (circular) {
+    while (values.at(start)) {
+      start++;
+    }
+    start++;
+  }
+  std::size_t bestStart{0};
+  std::size_t bestLength{0};
+  std::size_t runStart{0};
+  std::size_t length{0};
+  for (std::size_t step = 0; step <= size; step++) {
+    if (step < size and values.at((start + step) % size)) {
+      runStart = length == 0 ? step : runStart;
+      length++;
+      continue;
+    }
+    if (length > bestLength) {
+      bestStart = start + runStart;
+      bestLength = length;
+    }
+    length = 0;
+  }
+  return (bestStart + (bestLength - 1) / 2) % size;
+}
+
+std::optional<std::uint32_t> nsw::BcidStatistics::getBest(const std::size_t pfeb, const bool circular) const
+{
+  const auto good = getGood(pfeb, circular);
+  std::vector<bool> values{};
+  for (const auto& [setting, value] : good) {
+    values.push_back(value);
+  }
+  const auto index = center(values, circular);
+  if (not index) {
+    return std::nullopt;
+  }
+  return good.at(*index).first;
+}
+
+std::optional<std::uint32_t> nsw::BcidStatistics::getBestCommon(const bool circular) const
+{
+  std::map<std::uint32_t, std::size_t> counts{};
+  for (std::size_t pfeb = 0; pfeb < m_numPfebs; pfeb++) {
+    for (const auto& [setting, value] : getGood(pfeb, circular)) {
+      counts[setting] += value ? 1 : 0;
+    }
+  }
+  std::size_t most{0};
+  for (const auto& [setting, count] : counts) {
+    most = std::max(most, count);
+  }
+  if (most == 0) {
+    return std::nullopt;
+  }
+  std::vector<std::uint32_t> settings{};
+  std::vector<bool> values{};
+  for (const auto& [setting, count] : counts) {
+    settings.push_back(setting);
+    values.push_back(count == most);
+  }
+  return settings.at(*center(values, circular));
+}
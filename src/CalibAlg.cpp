@@ -2,6 +2,10 @@
 
 #include <iostream>
 #include <iomanip>
+#include <string_view>
+
+#include <boost/property_tree/ptree.hpp>
+#include <boost/property_tree/json_parser.hpp>
 
 #include <fmt/format.h>
 #include <fmt/chrono.h>
@@ -11,29 +15,35 @@
 #include <is/infodynany.h>
 #include <is/infodictionary.h>
 
-#include <RunControl/Common/OnlineServices.h>
+#include "NSWCalibration/Issues.h"
 
-#include "NSWCalibrationDal/NSWCalibApplication.h"
+#define R__HAS_STD_SPAN
+#include "TFile.h"
+#include "TKey.h"
+#include "TTree.h"
 
 nsw::CalibAlg::CalibAlg(std::string calibType, const hw::DeviceManager& deviceManager) :
   m_calibType(std::move(calibType)),
   m_deviceManager{deviceManager}
-{
-  auto& runCtlOnlServ = daq::rc::OnlineServices::instance();
-  const auto& rcBase = runCtlOnlServ.getApplication();
-  const auto* calibApp = rcBase.cast<nsw::dal::NSWCalibApplication>();
-
-  m_out_path = calibApp->get_CalibOutput();
-}
+{}
 
 void nsw::CalibAlg::setCalibParamsFromIS(const ISInfoDictionary& is_dictionary,
                                          const std::string& is_db_name)
 {}
 
+void nsw::CalibAlg::setCalibParams(const std::string& calibParams)
+{
+  if (not calibParams.empty()) {
+    ers::warning(nsw::calib::Issue(ERS_HERE,
+                                   fmt::format("{} does not take calibration parameters", m_calibType),
+                                   fmt::format("Ignoring '{}'", calibParams)));
+  }
+}
+
 void nsw::CalibAlg::progressbar() {
   std::stringstream msg;
   msg << "Iteration " << m_counter+1 << " / " << m_total;
-  if (m_counter == 0) {
+  if (isFirstIteration()) {
     setStartTime();
     ERS_INFO(msg.str());
     return;
@@ -59,3 +69,166 @@ void nsw::CalibAlg::setCurrentRunParameters(const std::pair<std::uint32_t, std::
   }
   ERS_LOG(fmt::format("Using run identifier {}", m_run_string));
 }
+
+void nsw::CalibAlg::restart()
+{
+  m_counter = 0;
+  m_first_counter = 0;
+  m_resuming = false;
+  m_output_files.clear();
+  m_text_outputs.clear();
+  std::scoped_lock lock(m_stopMutex);
+  if (m_stop.stop_requested()) {
+    m_stop = std::stop_source{};
+  }
+}
+
+void nsw::CalibAlg::checkAbort() const
+{
+  if (aborted()) {
+    throw nsw::calib::Aborted(ERS_HERE, m_calibType, m_counter);
+  }
+}
+
+void nsw::CalibAlg::closeOutputs()
+{
+  // writeTree removes the tree from the list
+  const auto attached = m_attached_trees;
+  for (const auto& [file, tree] : attached) {
+    ERS_INFO(fmt::format("Closing {}", file->GetName()));
+    writeTree(*file, *tree);
+  }
+}
+
+std::filesystem::path nsw::CalibAlg::getCheckpointPath() const
+{
+  // independent of the run, since the resumed calibration runs in a new one
+  return std::filesystem::path(m_out_path) / std::filesystem::path(m_calibType) /
+         fmt::format("{}.checkpoint.json", m_name);
+}
+
+void nsw::CalibAlg::checkpoint()
+{
+  const auto path = getCheckpointPath();
+  if (m_counter >= m_total) {
+    std::filesystem::remove(path);
+    return;
+  }
+
+  for (const auto& [file, tree] : m_attached_trees) {
+    file->cd();
+    tree->AutoSave("SaveSelf");
+  }
+
+  boost::property_tree::ptree outputs;
+  {
+    std::scoped_lock lock{m_output_mutex};
+    for (const auto& [key, fname] : m_output_files) {
+      outputs.push_back({key, boost::property_tree::ptree{fname}});
+    }
+  }
+  boost::property_tree::ptree state;
+  state.put("calibType", m_calibType);
+  state.put("run", m_run_string);
+  state.put("counter", m_counter);
+  state.put("total", m_total);
+  state.add_child("outputs", outputs);
+
+  // write then rename, so that a crash never leaves a truncated checkpoint
+  std::filesystem::create_directories(path.parent_path());
+  const auto tmp = fmt::format("{}.tmp", path.string());
+  boost::property_tree::write_json(tmp, state);
+  std::filesystem::rename(tmp, path);
+}
+
+void nsw::CalibAlg::resume()
+{
+  const auto path = getCheckpointPath();
+  if (not std::filesystem::exists(path)) {
+    throw nsw::calib::Issue(ERS_HERE, "Cannot resume calibration",
+                            fmt::format("No checkpoint found at {}", path.string()));
+  }
+
+  boost::property_tree::ptree state;
+  boost::property_tree::read_json(path.string(), state);
+  const auto calibType = state.get<std::string>("calibType");
+  const auto counter = state.get<std::size_t>("counter");
+  const auto total = state.get<std::size_t>("total");
+  if (calibType != m_calibType or total != m_total or counter >= m_total) {
+    throw nsw::calib::Issue(ERS_HERE, "Cannot resume calibration",
+                            fmt::format("Checkpoint {} is for {} iteration {}/{}, this is {} with {} iterations",
+                                        path.string(), calibType, counter, total, m_calibType, m_total));
+  }
+
+  m_output_files.clear();
+  for (const auto& [key, fname] : state.get_child("outputs")) {
+    m_output_files.emplace(key, fname.data());
+  }
+  m_counter = counter;
+  m_first_counter = counter;
+  m_resuming = true;
+  ERS_INFO(fmt::format("Resuming {} (was {}) at iteration {} / {}",
+                       m_calibType, state.get<std::string>("run"), m_counter + 1, m_total));
+}
+
+std::string nsw::CalibAlg::outputFileName(const std::string& key, const std::string& fname) const
+{
+  std::scoped_lock lock{m_output_mutex};
+  if (m_resuming) {
+    const auto previous = m_output_files.find(key);
+    if (previous != std::cend(m_output_files)) {
+      ERS_INFO(fmt::format("Resuming output {}: {}", key, previous->second));
+      return previous->second;
+    }
+  }
+  m_output_files[key] = fname;
+  return fname;
+}
+
+std::ofstream nsw::CalibAlg::openOutputText(const std::string& key, const std::string& fname) const
+{
+  const auto name = outputFileName(key, fname);
+  bool first{false};
+  {
+    std::scoped_lock lock{m_output_mutex};
+    first = m_text_outputs.insert(key).second;
+  }
+  const auto mode = (first and not m_resuming) ? std::ios_base::trunc : std::ios_base::app;
+  return std::ofstream{name, std::ios_base::out | mode};
+}
+
+void nsw::CalibAlg::attachTree(TFile& file, TTree& tree)
+{
+  if (m_resuming) {
+    // Read the previous tree through its key: the new tree with the same
+    // name is already in memory and would be returned by TFile::Get
+    auto* key = file.GetKey(tree.GetName());
+    if (key != nullptr) {
+      std::unique_ptr<TTree> previous{key->ReadObject<TTree>()};
+      if (previous != nullptr) {
+        const auto nentries = tree.CopyEntries(previous.get());
+        ERS_INFO(fmt::format("Copied {} entries of {} from {}", nentries, tree.GetName(), file.GetName()));
+      }
+    }
+    std::vector<TKey*> stale{};
+    for (auto* obj : *file.GetListOfKeys()) {
+      auto* stale_key = static_cast<TKey*>(obj);
+      if (std::string_view{stale_key->GetName()} == tree.GetName()) {
+        stale.push_back(stale_key);
+      }
+    }
+    for (auto* stale_key : stale) {
+      stale_key->Delete();
+      delete stale_key;
+    }
+  }
+  m_attached_trees.emplace_back(&file, &tree);
+}
+
+void nsw::CalibAlg::writeTree(TFile& file, TTree& tree)
+{
+  std::erase_if(m_attached_trees, [&tree](const auto& attached) { return attached.second == &tree; });
+  file.cd();
+  tree.Write("", TObject::kOverwrite);
+  file.Close();
+}
@@ -0,0 +1,101 @@
+#include "NSWCalibration/CalibAlgFactory.h"
+
+#include <stdexcept>
+
+#include <fmt/core.h>
+
+#include "NSWCalibration/CompositeCalib.h"
+#include "NSWCalibration/MMTriggerCalib.h"
+#include "NSWCalibration/MMTPInputPhase.h"
+#include "NSWCalibration/sTGCTriggerCalib.h"
+#include "NSWCalibration/sTGCPadVMMTDSChannels.h"
+#include "NSWCalibration/sTGCStripsTriggerCalib.h"
+#include "NSWCalibration/sTGCSFEBToRouter.h"
+#include "NSWCalibration/sTGCPadTriggerToSFEB.h"
+#include "NSWCalibration/sTGCPadTriggerInputDelays.h"
+#include "NSWCalibration/sTGCPadsControlPhase.h"
+#include "NSWCalibration/sTGCPadsL1DDCFibers.h"
+#include "NSWCalibration/sTGCPadsRocTds40Mhz.h"
+#include "NSWCalibration/sTGCPadsHitRateL1a.h"
+#include "NSWCalibration/sTGCPadsHitRateSca.h"
+#include "NSWCalibration/sTGCPadTdsBcidOffset.h"
+#include "NSWCalibration/THRCalib.h"
+#include "NSWCalibration/PDOCalib.h"
+#include "NSWCalibration/RocPhaseCalibrationBase.h"
+#include "NSWCalibration/RocPhase40MhzCore.h"
+#include "NSWCalibration/RocPhase160MhzCore.h"
+#include "NSWCalibration/RocPhase160MhzVmm.h"
+
+std::unique_ptr<nsw::CalibAlg> nsw::makeCalibAlg(const std::string& calibType,
+                                                 const hw::DeviceManager& deviceManager)
+{
+  if (calibType=="MMARTConnectivityTest" ||
+      calibType=="MMARTConnectivityTestAllChannels" ||
+      calibType=="MMCableNoise" ||
+      calibType=="MMCableNoiseSampling" ||
+      calibType=="MMARTPhase" ||
+      calibType=="MML1ALatency" ||
+      calibType=="MMStaircase") {
+    return std::make_unique<MMTriggerCalib>(calibType, deviceManager);
+  } else if (calibType=="MMTrackPulserTest") {
+    return std::make_unique<MMTriggerCalib>(calibType, deviceManager);
+  } else if (calibType=="MMTPInputPhase" ||
+             calibType=="MMTPInputPhase_PhaseOnly" ||
+             calibType=="MMTPInputPhase_Validation") {
+    // MMTPInputPhase Phase x AddcOffset 8x8
+    // MMTPInputPhase_PhaseOnly  scan 8 phase, ADDC offset = 0, L1DDC offset = 0.
+    // MMTPInputPhase_Validation scan 8 phase, leave the other two phases as in json
+    return std::make_unique<MMTPInputPhase>(calibType, deviceManager);
+  } else if (calibType=="sTGCPadConnectivity" ||
+             calibType=="sTGCPadConnectivitySca" ||
+             calibType=="sTGCPadConnectivityScaGrouped" ||
+             calibType=="sTGCPadLatency") {
+    return std::make_unique<sTGCTriggerCalib>(calibType, deviceManager);
+  } else if (calibType=="sTGCPadVMMTDSChannels" ||
+             calibType=="sTGCPadVMMTDSChannelsCoded") {
+    return std::make_unique<sTGCPadVMMTDSChannels>(calibType, deviceManager);
+  } else if (calibType=="sTGCSFEBToRouter"   ||
+             calibType=="sTGCSFEBToRouterQ1" ||
+             calibType=="sTGCSFEBToRouterQ2" ||
+             calibType=="sTGCSFEBToRouterQ3" ||
+             calibType=="sTGCSFEBToRouterParallel") {
+    return std::make_unique<sTGCSFEBToRouter>(calibType, deviceManager);
+  } else if (calibType=="sTGCPadTriggerToSFEB") {
+    return std::make_unique<sTGCPadTriggerToSFEB>(calibType, deviceManager);
+  } else if (calibType=="sTGCPadTriggerInputDelays") {
+    return std::make_unique<sTGCPadTriggerInputDelays>(calibType, deviceManager);
+  } else if (calibType=="sTGCStripConnectivity") {
+    return std::make_unique<sTGCStripsTriggerCalib>(calibType, deviceManager);
+  } else if (calibType=="sTGCPadsControlPhase") {
+    return std::make_unique<sTGCPadsControlPhase>(calibType, deviceManager);
+  } else if (calibType=="sTGCPadsL1DDCFibers" ||
+             calibType=="sTGCPadsL1DDCFibers_Separable") {
+    return std::make_unique<sTGCPadsL1DDCFibers>(calibType, deviceManager);
+  } else if (calibType=="sTGCPadsRocTds40Mhz" ||
+             calibType=="sTGCPadsRocTds40MhzSearch") {
+    return std::make_unique<sTGCPadsRocTds40Mhz>(calibType, deviceManager);
+  } else if (calibType == "sTGCPadsHitRateL1a") {
+    return std::make_unique<sTGCPadsHitRateL1a>(calibType, deviceManager);
+  } else if (calibType == "sTGCPadsHitRateSca" ||
+             calibType == "sTGCPadsHitRateScaMultiplexed") {
+    return std::make_unique<sTGCPadsHitRateSca>(calibType, deviceManager);
+  } else if (calibType == "sTGCPadTdsBcidOffset" ||
+             calibType == "sTGCPadTdsBcidOffsetSearch") {
+    return std::make_unique<sTGCPadTdsBcidOffset>(calibType, deviceManager);
+  } else if (calibType=="THRCalib"){
+    return std::make_unique<THRCalib>(calibType, deviceManager);
+  } else if (calibType=="PDOCalib" ||
+             calibType=="TDOCalib"){
+    return std::make_unique<PDOCalib>(calibType, deviceManager);
+  } else if (calibType=="RocPhase40MHzCore") {
+    return std::make_unique<RocPhaseCalibrationBase<RocPhase40MhzCore>>(calibType, deviceManager);
+  } else if (calibType == "RocPhase160MHzCore") {
+    return std::make_unique<RocPhaseCalibrationBase<RocPhase160MhzCore>>(calibType, deviceManager);
+  } else if (calibType == "RocPhase160MHzVmm") {
+    return std::make_unique<RocPhaseCalibrationBase<RocPhase160MhzVmm>>(calibType, deviceManager);
+  } else if (calibType == "Composite") {
+    // sub-calibrations given in the calibration parameters
+    return std::make_unique<CompositeCalib>(calibType, deviceManager);
+  }
+  throw std::runtime_error(fmt::format("Unknown calibration request: {}", calibType));
+}
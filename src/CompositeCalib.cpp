@@ -0,0 +1,310 @@
+#include "NSWCalibration/CompositeCalib.h"
+
+#include <algorithm>
+#include <map>
+
+#include <fmt/core.h>
+#include <fmt/ranges.h>
+
+#include <ers/ers.h>
+
+#include <is/infodynany.h>
+#include <is/infodictionary.h>
+
+#include <boost/algorithm/string/trim.hpp>
+
+#include <TROOT.h>
+
+#include "NSWCalibration/CalibAlgFactory.h"
+
+#include "NSWConfiguration/ConfigReader.h"
+#include "NSWConfiguration/Utility.h"
+
+nsw::CompositeCalib::CompositeCalib(std::string calibType, const hw::DeviceManager& deviceManager) :
+  CalibAlg(std::move(calibType), deviceManager)
+{}
+
+void nsw::CompositeCalib::setCalibParamsFromIS(const ISInfoDictionary& is_dictionary,
+                                               const std::string& is_db_name) {
+  const auto name = fmt::format("{}.Calib.calibParams", is_db_name);
+  if (not is_dictionary.contains(name)) {
+    throw NSWCompositeCalibIssue(ERS_HERE, fmt::format("{} needs the list of sub-calibrations in {}",
+                                                       m_calibType, name));
+  }
+  ISInfoDynAny infoany;
+  is_dictionary.getValue(name, infoany);
+  setCalibParams(infoany.getAttributeValue<std::string>(0));
+}
+
+void nsw::CompositeCalib::setCalibParams(const std::string& calibParams) {
+  m_params = parseCalibParams(calibParams);
+  for (const auto& sub : m_params.subCalibs) {
+    ERS_INFO(fmt::format("Sub-calibration {} on {} with parameters '{}'",
+                         sub.calibType, fmt::join(sub.filters, "+"), sub.calibParams));
+  }
+  ERS_INFO(fmt::format("Sub-calibrations run {}", m_params.independent ? "independently" : "in lockstep"));
+}
+
+nsw::CompositeCalib::Parameters nsw::CompositeCalib::parseCalibParams(const std::string& calibParams) {
+  Parameters params{};
+  for (const auto& token : nsw::tokenizeString(calibParams, ";")) {
+    const auto entry = boost::algorithm::trim_copy(token);
+    if (entry.empty()) {
+      continue;
+    }
+    if (entry.rfind("mode=", 0) == 0) {
+      const auto mode = entry.substr(std::string{"mode="}.size());
+      if (mode != "lockstep" and mode != "independent") {
+        throw NSWCompositeCalibIssue(ERS_HERE, fmt::format("Unknown mode {}, expected lockstep or independent", mode));
+      }
+      params.independent = (mode == "independent");
+      continue;
+    }
+
+    // <calibType>@<filter>[+<filter>...][:<calibParams>]
+    const auto colon = entry.find(':');
+    const auto head = entry.substr(0, colon);
+    const auto at = head.find('@');
+    SubCalibParameters sub{};
+    sub.calibType = boost::algorithm::trim_copy(head.substr(0, at));
+    if (at != std::string::npos) {
+      for (const auto& filter : nsw::tokenizeString(head.substr(at + 1), "+")) {
+        const auto trimmed = boost::algorithm::trim_copy(filter);
+        if (not trimmed.empty()) {
+          sub.filters.push_back(trimmed);
+        }
+      }
+    }
+    if (colon != std::string::npos) {
+      sub.calibParams = entry.substr(colon + 1);
+    }
+    if (sub.calibType.empty() or sub.filters.empty()) {
+      throw NSWCompositeCalibIssue(ERS_HERE, fmt::format("Cannot parse '{}', expected <calibType>@<filter>[+<filter>...][:<calibParams>]", entry));
+    }
+    params.subCalibs.push_back(sub);
+  }
+  if (params.subCalibs.empty()) {
+    throw NSWCompositeCalibIssue(ERS_HERE, fmt::format("No sub-calibration found in '{}'", calibParams));
+  }
+  return params;
+}
+
+void nsw::CompositeCalib::setup(const std::string& db) {
+  // the sub-calibrations fill their TTrees from parallel threads
+  ROOT::EnableThreadSafety();
+  makeSubCalibs(db);
+
+  std::size_t total{0};
+  bool wait4swrod{false};
+  for (auto& sub : m_subCalibs) {
+    sub.calib->setup(db);
+    sub.freeRunning = m_params.independent and sub.calib->getAltiSequences() == nsw::commands::Commands{};
+    if (not sub.freeRunning) {
+      total = std::max(total, sub.calib->total());
+      wait4swrod = wait4swrod or sub.calib->wait4swrod();
+    }
+    ERS_INFO(fmt::format("{}: {} iterations{}", sub.params.calibType, sub.calib->total(),
+                         sub.freeRunning ? ", running independently" : ""));
+  }
+
+  // fails early if the ALTI sequences are not compatible
+  static_cast<void>(getAltiSequences());
+
+  // only free running sub-calibrations: a single iteration waits for them
+  setTotal(std::max(total, std::size_t{1}));
+  setWait4swROD(wait4swrod);
+}
+
+void nsw::CompositeCalib::makeSubCalibs(const std::string& db) {
+  m_subCalibs.clear();
+  nsw::ConfigReader reader(db);
+  reader.readConfig();
+  const auto names = reader.getAllElementNames();
+
+  // the sets of devices must be disjoint
+  std::map<std::string, std::string> owners{};
+  for (const auto& params : m_params.subCalibs) {
+    auto devices = std::make_unique<hw::DeviceManager>();
+    std::size_t ndevices{0};
+    for (const auto& name : names) {
+      const auto selected = std::any_of(std::cbegin(params.filters), std::cend(params.filters),
+                                        [&name](const auto& filter) { return name.find(filter) != std::string::npos; });
+      if (not selected) {
+        continue;
+      }
+      const auto [owner, inserted] = owners.try_emplace(name, params.calibType);
+      if (not inserted) {
+        throw NSWCompositeCalibIssue(ERS_HERE, fmt::format("{} is selected by both {} and {}",
+                                                           name, owner->second, params.calibType));
+      }
+      devices->add(reader.readConfig(name));
+      ++ndevices;
+    }
+    if (ndevices == 0) {
+      throw NSWCompositeCalibIssue(ERS_HERE, fmt::format("No element matches {} for {}",
+                                                         fmt::join(params.filters, "+"), params.calibType));
+    }
+    ERS_INFO(fmt::format("{}: {} elements", params.calibType, ndevices));
+
+    auto calib = nsw::makeCalibAlg(params.calibType, *devices);
+    forwardSettings(*calib);
+    // each sub-calibration publishes its own key
+    calib->setCalibKeyName(fmt::format("{}.{}_{}", calibKeyName(), params.calibType, m_subCalibs.size()));
+    // as for a single calibration, the defaults are kept without parameters
+    if (not params.calibParams.empty()) {
+      calib->setCalibParams(params.calibParams);
+    }
+    m_subCalibs.push_back(SubCalib{params, std::move(devices), std::move(calib)});
+  }
+}
+
+void nsw::CompositeCalib::forwardSettings(CalibAlg& calib) const {
+  calib.setApplicationName(applicationName());
+  calib.setOutputPath(outputPath());
+  calib.setSimulation(simulation());
+  if (not m_run_string.empty()) {
+    calib.setCurrentRunParameters({runNumber(), runStart()});
+  }
+}
+
+nsw::commands::Commands nsw::CompositeCalib::getAltiSequences() const {
+  std::vector<nsw::commands::Commands> sequences{};
+  for (const auto& sub : m_subCalibs) {
+    if (not sub.freeRunning) {
+      sequences.push_back(sub.calib->getAltiSequences());
+    }
+  }
+  return mergeAltiSequences(sequences);
+}
+
+nsw::commands::Commands nsw::CompositeCalib::mergeAltiSequences(const std::vector<nsw::commands::Commands>& sequences) {
+  using Period = std::vector<nsw::commands::Command> nsw::commands::Commands::*;
+  const auto merge = [&sequences](const Period period, const std::string& name) {
+    std::vector<nsw::commands::Command> merged{};
+    for (const auto& sequence : sequences) {
+      const auto& commands = sequence.*period;
+      if (commands.empty()) {
+        continue;
+      }
+      if (merged.empty()) {
+        merged = commands;
+      } else if (merged != commands) {
+        throw NSWCompositeCalibIssue(ERS_HERE, fmt::format("Sub-calibrations request different ALTI commands {} the iteration", name));
+      }
+    }
+    return merged;
+  };
+  return {merge(&nsw::commands::Commands::before, "before"),
+          merge(&nsw::commands::Commands::during, "during"),
+          merge(&nsw::commands::Commands::after, "after")};
+}
+
+bool nsw::CompositeCalib::active(const SubCalib& sub) const {
+  return not sub.freeRunning and sub.calib->counter() < sub.calib->total();
+}
+
+void nsw::CompositeCalib::setCalibKeyToIS(const ISInfoDictionary& is_dictionary) {
+  for (const auto& sub : m_subCalibs) {
+    if (active(sub)) {
+      sub.calib->setCalibKeyToIS(is_dictionary);
+    }
+  }
+}
+
+void nsw::CompositeCalib::abort() {
+  CalibAlg::abort();
+  for (auto& sub : m_subCalibs) {
+    sub.calib->abort();
+  }
+}
+
+void nsw::CompositeCalib::closeOutputs() {
+  // the free running sub-calibrations must be stopped before closing their files
+  for (auto& thread : m_freeRunning) {
+    thread.wait();
+  }
+  for (auto& sub : m_subCalibs) {
+    sub.calib->closeOutputs();
+  }
+}
+
+void nsw::CompositeCalib::configure() {
+  if (isFirstIteration()) {
+    if (resuming()) {
+      throw NSWCompositeCalibIssue(ERS_HERE, "Resuming a composite calibration is not supported");
+    }
+    // the run parameters are only known after setup in the partition
+    for (auto& sub : m_subCalibs) {
+      forwardSettings(*sub.calib);
+      sub.calib->restart();
+    }
+    m_freeRunning.clear();
+    for (auto& sub : m_subCalibs) {
+      if (sub.freeRunning) {
+        m_freeRunning.push_back(std::async(std::launch::async, &nsw::CompositeCalib::runFreely,
+                                           std::ref(*sub.calib)));
+      }
+    }
+  }
+
+  // the devices are disjoint: the sub-calibrations are configured in parallel
+  std::vector<std::future<void>> threads{};
+  for (auto& sub : m_subCalibs) {
+    if (active(sub)) {
+      threads.push_back(std::async(std::launch::async, [&sub]() { sub.calib->configure(); }));
+    }
+  }
+  for (auto& thread : threads) {
+    thread.get();
+  }
+}
+
+void nsw::CompositeCalib::acquire() {
+  std::vector<std::future<void>> threads{};
+  for (auto& sub : m_subCalibs) {
+    if (active(sub)) {
+      threads.push_back(std::async(std::launch::async, [&sub]() { sub.calib->acquire(); }));
+    }
+  }
+  for (auto& thread : threads) {
+    thread.get();
+  }
+}
+
+void nsw::CompositeCalib::unconfigure() {
+  std::vector<std::future<void>> threads{};
+  for (auto& sub : m_subCalibs) {
+    if (active(sub)) {
+      threads.push_back(std::async(std::launch::async, [&sub]() {
+        sub.calib->unconfigure();
+        sub.calib->next();
+      }));
+    }
+  }
+  for (auto& thread : threads) {
+    thread.get();
+  }
+  if (m_counter + 1 == m_total) {
+    joinFreeRunning();
+  }
+}
+
+void nsw::CompositeCalib::runFreely(CalibAlg& calib) {
+  while (calib.counter() < calib.total()) {
+    calib.progressbar();
+    calib.configure();
+    calib.acquire();
+    calib.unconfigure();
+    calib.next();
+  }
+}
+
+void nsw::CompositeCalib::joinFreeRunning() {
+  if (not m_freeRunning.empty()) {
+    ERS_INFO(fmt::format("Waiting for {} independent sub-calibrations", m_freeRunning.size()));
+  }
+  for (auto& thread : m_freeRunning) {
+    thread.get();
+  }
+  m_freeRunning.clear();
+}
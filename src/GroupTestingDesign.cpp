@@ -0,0 +1,239 @@
+#include "NSWCalibration/GroupTestingDesign.h"
+
+#include <algorithm>
+#include <cmath>
+#include <numeric>
+#include <optional>
+#include <random>
+#include <set>
+#include <stdexcept>
+
+#include <fmt/core.h>
+
+namespace {
+  /// Rows of a design, as codewords: one bit per row, without row 0
+  constexpr std::size_t MAX_ROWS{64};
+
+  /// Fixed seed, so that a design is the same in every run
+  constexpr std::uint32_t SEED{20220301};
+
+  std::uint64_t binomial(const std::size_t n, const std::size_t k) {
+    std::uint64_t result{1};
+    for (std::size_t i = 1; i <= k; i++) {
+      result = result * (n - k + i) / i;
+    }
+    return result;
+  }
+
+  /// Solve a x = b (square), by gaussian elimination with partial pivoting
+  std::vector<double> solve(std::vector<std::vector<double>> a, std::vector<double> b) {
+    const auto n = b.size();
+    for (std::size_t col = 0; col < n; col++) {
+      auto pivot = col;
+      for (std::size_t row = col + 1; row < n; row++) {
+        if (std::abs(a.at(row).at(col)) > std::abs(a.at(pivot).at(col))) {
+          pivot = row;
+        }
+      }
+      if (std::abs(a.at(pivot).at(col)) < 1e-12) {
+        throw std::runtime_error("Singular system");
+      }
+      std::swap(a.at(col), a.at(pivot));
+      std::swap(b.at(col), b.at(pivot));
+      for (std::size_t row = col + 1; row < n; row++) {
+        const auto factor = a.at(row).at(col) / a.at(col).at(col);
+        for (std::size_t k = col; k < n; k++) {
+          a.at(row).at(k) -= factor * a.at(col).at(k);
+        }
+        b.at(row) -= factor * b.at(col);
+      }
+    }
+    std::vector<double> x(n, 0);
+    for (std::size_t col = n; col-- > 0;) {
+      auto sum = b.at(col);
+      for (std::size_t k = col + 1; k < n; k++) {
+        sum -= a.at(col).at(k) * x.at(k);
+      }
+      x.at(col) = sum / a.at(col).at(col);
+    }
+    return x;
+  }
+}  // namespace
+
+nsw::GroupTestingDesign::GroupTestingDesign(const std::size_t numChannels, const std::size_t numRows) :
+  m_numChannels{numChannels}
+{
+  if (numRows < minRows(numChannels) or numRows > MAX_ROWS) {
+    throw std::runtime_error(fmt::format("{} channels need between {} and {} rows, got {}",
+                                         numChannels, minRows(numChannels), MAX_ROWS, numRows));
+  }
+  m_rows.resize(numRows, std::vector<bool>(numChannels, false));
+  std::fill(std::begin(m_rows.front()), std::end(m_rows.front()), true);
+
+  // distinct codewords of weight (numRows - 1) / 2, drawn at random
+  const auto length = numRows - 1;
+  const auto weight = length / 2;
+  std::mt19937 generator{SEED};
+  std::set<std::uint64_t> used{};
+  std::vector<std::size_t> positions(length);
+  for (std::size_t channel = 0; channel < numChannels; channel++) {
+    std::uint64_t word{0};
+    do {
+      std::iota(std::begin(positions), std::end(positions), 0);
+      word = 0;
+      for (std::size_t bit = 0; bit < weight; bit++) {
+        const auto pick = bit + generator() % (length - bit);
+        std::swap(positions.at(bit), positions.at(pick));
+        word |= std::uint64_t{1} << positions.at(bit);
+      }
+    } while (used.contains(word));
+    used.insert(word);
+    for (std::size_t bit = 0; bit < length; bit++) {
+      m_rows.at(bit + 1).at(channel) = ((word >> bit) & 1) == 1;
+    }
+  }
+}
+
+std::size_t nsw::GroupTestingDesign::minRows(const std::size_t numChannels)
+{
+  std::size_t length{0};
+  while (binomial(length, length / 2) < numChannels) {
+    length++;
+  }
+  return length + 1;
+}
+
+bool nsw::GroupTestingDesign::isOpen(const std::size_t row, const std::size_t channel) const
+{
+  return m_rows.at(row).at(channel);
+}
+
+std::vector<std::uint32_t> nsw::GroupTestingDesign::getOpenChannels(const std::size_t row) const
+{
+  std::vector<std::uint32_t> channels{};
+  for (std::size_t channel = 0; channel < m_numChannels; channel++) {
+    if (isOpen(row, channel)) {
+      channels.push_back(static_cast<std::uint32_t>(channel));
+    }
+  }
+  return channels;
+}
+
+nsw::GroupTestingDesign::Decoded nsw::GroupTestingDesign::decode(const std::vector<double>& rowRates) const
+{
+  const auto numRows = getNumRows();
+  if (rowRates.size() != numRows) {
+    throw std::runtime_error(fmt::format("Expected {} row rates, got {}", numRows, rowRates.size()));
+  }
+  const auto scale = std::max(1., *std::max_element(std::cbegin(rowRates), std::cend(rowRates)));
+  const auto tolerance = 1e-9 * scale * static_cast<double>(numRows);
+
+  // Lawson-Hanson: x is fitted on the passive channels, the others are 0
+  std::vector<double> x(m_numChannels, 0);
+  std::vector<bool> passive(m_numChannels, false);
+
+  const auto residuals = [&](const std::vector<double>& values) {
+    std::vector<double> result(rowRates);
+    for (std::size_t row = 0; row < numRows; row++) {
+      for (std::size_t channel = 0; channel < m_numChannels; channel++) {
+        if (isOpen(row, channel)) {
+          result.at(row) -= values.at(channel);
+        }
+      }
+    }
+    return result;
+  };
+
+  // least squares on the passive channels, through the normal equations
+  const auto fitPassive = [&]() {
+    std::vector<std::size_t> channels{};
+    for (std::size_t channel = 0; channel < m_numChannels; channel++) {
+      if (passive.at(channel)) {
+        channels.push_back(channel);
+      }
+    }
+    std::vector<std::vector<double>> ata(channels.size(), std::vector<double>(channels.size(), 0));
+    std::vector<double> aty(channels.size(), 0);
+    for (std::size_t i = 0; i < channels.size(); i++) {
+      for (std::size_t row = 0; row < numRows; row++) {
+        if (not isOpen(row, channels.at(i))) {
+          continue;
+        }
+        aty.at(i) += rowRates.at(row);
+        for (std::size_t j = 0; j < channels.size(); j++) {
+          ata.at(i).at(j) += isOpen(row, channels.at(j)) ? 1 : 0;
+        }
+      }
+    }
+    const auto solution = solve(ata, aty);
+    std::vector<double> z(m_numChannels, 0);
+    for (std::size_t i = 0; i < channels.size(); i++) {
+      z.at(channels.at(i)) = solution.at(i);
+    }
+    return z;
+  };
+
+  const auto maxIterations = 3 * m_numChannels;
+  for (std::size_t iteration = 0; iteration < maxIterations; iteration++) {
+    // gradient: the channel which reduces the residual the most
+    const auto residual = residuals(x);
+    std::optional<std::size_t> best{};
+    double bestGradient{tolerance};
+    for (std::size_t channel = 0; channel < m_numChannels; channel++) {
+      if (passive.at(channel)) {
+        continue;
+      }
+      double gradient{0};
+      for (std::size_t row = 0; row < numRows; row++) {
+        gradient += isOpen(row, channel) ? residual.at(row) : 0;
+      }
+      if (gradient > bestGradient) {
+        best = channel;
+        bestGradient = gradient;
+      }
+    }
+    if (not best) {
+      break;
+    }
+    passive.at(*best) = true;
+
+    std::vector<double> z{};
+    try {
+      z = fitPassive();
+    } catch (const std::runtime_error&) {
+      // the channel is a combination of the passive ones, nothing to gain
+      passive.at(*best) = false;
+      break;
+    }
+    // move towards z until a passive channel reaches 0, and drop it
+    while (true) {
+      double alpha{1};
+      for (std::size_t channel = 0; channel < m_numChannels; channel++) {
+        const auto step = x.at(channel) - z.at(channel);
+        if (passive.at(channel) and z.at(channel) <= 0) {
+          alpha = std::min(alpha, step > 0 ? x.at(channel) / step : 0.);
+        }
+      }
+      for (std::size_t channel = 0; channel < m_numChannels; channel++) {
+        x.at(channel) += alpha * (z.at(channel) - x.at(channel));
+      }
+      if (alpha >= 1) {
+        break;
+      }
+      for (std::size_t channel = 0; channel < m_numChannels; channel++) {
+        if (passive.at(channel) and x.at(channel) <= tolerance) {
+          passive.at(channel) = false;
+          x.at(channel) = 0;
+        }
+      }
+      z = fitPassive();
+    }
+  }
+
+  Decoded decoded{};
+  decoded.rates = x;
+  const auto residual = residuals(x);
+  decoded.residual = std::sqrt(std::inner_product(std::cbegin(residual), std::cend(residual),
+                                                  std::cbegin(residual), 0.));
+  return decoded;
+}
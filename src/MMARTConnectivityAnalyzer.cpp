@@ -0,0 +1,245 @@
+#include "NSWCalibration/MMARTConnectivityAnalyzer.h"
+
+#include <algorithm>
+#include <set>
+
+#include <fmt/core.h>
+#include <fmt/ranges.h>
+
+using boost::property_tree::ptree;
+
+namespace {
+  struct Sum {
+    std::size_t pulsed{0};
+    std::size_t responded{0};
+
+    [[nodiscard]] double fraction() const {
+      return pulsed == 0 ? 0. : static_cast<double>(responded) / static_cast<double>(pulsed);
+    }
+  };
+
+  template<typename Channels>
+  Sum sumChannels(const Channels& channels) {
+    Sum sum{};
+    for (const auto& [channel, response] : channels) {
+      sum.pulsed += response.pulsed;
+      sum.responded += response.responded;
+    }
+    return sum;
+  }
+
+  ptree toArray(const std::vector<nsw::MMARTConnectivityAnalyzer::Channel>& channels) {
+    ptree array;
+    for (const auto& channel : channels) {
+      ptree element;
+      element.put("feb", channel.feb);
+      element.put("vmm", channel.vmm);
+      element.put("channel", channel.channel);
+      array.push_back(std::make_pair("", element));
+    }
+    return array;
+  }
+}  // namespace
+
+std::string nsw::MMARTConnectivityAnalyzer::Channel::toString() const
+{
+  return fmt::format("{}/{}/{}", feb, vmm, channel);
+}
+
+nsw::MMARTConnectivityAnalyzer::MMARTConnectivityAnalyzer(const std::uint32_t minHits,
+                                                         const double minEfficiency,
+                                                         const double maxCrosstalk) :
+  m_minHits{minHits}, m_minEfficiency{minEfficiency}, m_maxCrosstalk{maxCrosstalk}
+{}
+
+void nsw::MMARTConnectivityAnalyzer::setBaseline(const Counters& counters)
+{
+  for (const auto& [art, values] : counters) {
+    auto& inputs = m_arts[art];
+    inputs.resize(std::max(inputs.size(), values.size()));
+    for (std::size_t index = 0; index < values.size(); index++) {
+      inputs.at(index).last = values.at(index);
+    }
+  }
+}
+
+std::size_t nsw::MMARTConnectivityAnalyzer::vmmOf(const std::size_t input)
+{
+  return input % nsw::MAX_NUMBER_OF_VMM;
+}
+
+std::size_t nsw::MMARTConnectivityAnalyzer::groupIndex(const mmtrigger::Iteration& iteration)
+{
+  std::set<std::string> names{};
+  for (const auto& set : iteration.febPatterns) {
+    for (const auto& feb : set->febs) {
+      if (feb.countChannels() > 0) {
+        names.insert(feb.name);
+      }
+    }
+  }
+  const auto group = fmt::format("{}", fmt::join(names, ","));
+  const auto found = std::find(std::cbegin(m_groups), std::cend(m_groups), group);
+  if (found != std::cend(m_groups)) {
+    return static_cast<std::size_t>(std::distance(std::cbegin(m_groups), found));
+  }
+  m_groups.push_back(group);
+  return m_groups.size() - 1;
+}
+
+void nsw::MMARTConnectivityAnalyzer::addIteration(const mmtrigger::Iteration& iteration, const Counters& counters)
+{
+  std::set<Channel> channels{};
+  for (const auto& set : iteration.febPatterns) {
+    for (const auto& feb : set->febs) {
+      for (std::size_t vmm = 0; vmm < feb.channels.size(); vmm++) {
+        for (const auto channel : feb.getChannels(vmm)) {
+          channels.insert({feb.name, vmm, channel});
+        }
+      }
+    }
+  }
+
+  const auto group = channels.empty() ? std::size_t{0} : groupIndex(iteration);
+  if (not channels.empty()) {
+    m_iterations++;
+  }
+
+  for (const auto& [art, values] : counters) {
+    auto& inputs = m_arts[art];
+    inputs.resize(std::max(inputs.size(), values.size()));
+    for (std::size_t index = 0; index < values.size(); index++) {
+      auto& input = inputs.at(index);
+      const auto value = values.at(index);
+      const auto increase = value >= input.last ? value - input.last : value;
+      input.last = value;
+      if (channels.empty()) {
+        continue;
+      }
+      auto& responses = input.responses[group];
+      for (const auto& channel : channels) {
+        if (channel.vmm != vmmOf(index)) {
+          continue;
+        }
+        auto& response = responses[channel];
+        response.pulsed++;
+        if (increase >= m_minHits) {
+          response.responded++;
+        }
+      }
+    }
+  }
+}
+
+nsw::MMARTConnectivityAnalyzer::Verdict nsw::MMARTConnectivityAnalyzer::judge(const std::string& art,
+                                                                             const std::size_t index,
+                                                                             const Input& input) const
+{
+  Verdict verdict{};
+  verdict.art = art;
+  verdict.input = index;
+
+  double best{0};
+  for (const auto& [group, channels] : input.responses) {
+    const auto sum = sumChannels(channels);
+    if (sum.responded > 0 and sum.fraction() > best) {
+      best = sum.fraction();
+      verdict.home = group;
+    }
+  }
+  if (not verdict.home) {
+    verdict.status = "dead";
+    return verdict;
+  }
+  verdict.efficiency = best;
+
+  Sum others{};
+  for (const auto& [group, channels] : input.responses) {
+    if (group == *verdict.home) {
+      continue;
+    }
+    const auto sum = sumChannels(channels);
+    others.pulsed += sum.pulsed;
+    others.responded += sum.responded;
+  }
+  verdict.crosstalk = others.fraction();
+
+  for (const auto& [channel, response] : input.responses.at(*verdict.home)) {
+    if (Sum{response.pulsed, response.responded}.fraction() < m_minEfficiency) {
+      verdict.failingChannels.push_back(channel);
+    }
+  }
+
+  if (verdict.crosstalk > m_maxCrosstalk) {
+    verdict.status = "crosstalk";
+  } else if (not verdict.failingChannels.empty()) {
+    verdict.status = "inefficient";
+  } else {
+    verdict.status = "ok";
+  }
+  return verdict;
+}
+
+std::vector<nsw::MMARTConnectivityAnalyzer::Verdict> nsw::MMARTConnectivityAnalyzer::getVerdicts() const
+{
+  std::vector<Verdict> verdicts{};
+  for (const auto& [art, inputs] : m_arts) {
+    for (std::size_t index = 0; index < inputs.size(); index++) {
+      verdicts.push_back(judge(art, index, inputs.at(index)));
+    }
+  }
+  return verdicts;
+}
+
+ptree nsw::MMARTConnectivityAnalyzer::getSummary() const
+{
+  ptree summary;
+  summary.put("iterations", m_iterations);
+
+  ptree groups;
+  for (std::size_t group = 0; group < m_groups.size(); group++) {
+    groups.put(std::to_string(group), m_groups.at(group));
+  }
+  summary.add_child("groups", groups);
+
+  std::map<std::string, std::size_t> statuses{};
+  std::map<std::string, ptree> arts{};
+  for (const auto& verdict : getVerdicts()) {
+    statuses[verdict.status]++;
+
+    ptree response;
+    const auto& input = m_arts.at(verdict.art).at(verdict.input);
+    for (std::size_t group = 0; group < m_groups.size(); group++) {
+      const auto channels = input.responses.find(group);
+      ptree element;
+      element.put("", channels == std::cend(input.responses) ? 0. : sumChannels(channels->second).fraction());
+      response.push_back(std::make_pair("", element));
+    }
+
+    ptree entry;
+    entry.put("status", verdict.status);
+    if (verdict.home) {
+      entry.put("home", *verdict.home);
+    }
+    entry.put("efficiency", verdict.efficiency);
+    entry.put("crosstalk", verdict.crosstalk);
+    entry.add_child("response", response);
+    entry.add_child("failing_channels", toArray(verdict.failingChannels));
+
+    arts[verdict.art].push_back(std::make_pair(std::to_string(verdict.input), entry));
+  }
+
+  ptree counts;
+  for (const auto& [status, count] : statuses) {
+    counts.put(status, count);
+  }
+  summary.add_child("status", counts);
+
+  // ART names contain dots, which put/add_child would take as a path
+  ptree inputs;
+  for (const auto& [art, entries] : arts) {
+    inputs.push_back(std::make_pair(art, entries));
+  }
+  summary.push_back(std::make_pair("inputs", inputs));
+  return summary;
+}
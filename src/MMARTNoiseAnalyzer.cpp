@@ -0,0 +1,158 @@
+#include "NSWCalibration/MMARTNoiseAnalyzer.h"
+
+#include <algorithm>
+#include <cmath>
+#include <numeric>
+#include <set>
+#include <stdexcept>
+
+#include <fmt/core.h>
+
+using boost::property_tree::ptree;
+
+namespace {
+  /// Median of the values, which are reordered
+  double median(std::vector<float>& values) {
+    const auto middle = std::begin(values) + static_cast<std::ptrdiff_t>(values.size() / 2);
+    std::nth_element(std::begin(values), middle, std::end(values));
+    return *middle;
+  }
+
+  /// Gaussian sigma of a median absolute deviation
+  constexpr double MAD_TO_SIGMA{1.4826};
+}  // namespace
+
+nsw::MMARTNoiseAnalyzer::MMARTNoiseAnalyzer(const double threshold) :
+  m_threshold{threshold}
+{
+  if (m_threshold <= 0) {
+    throw std::runtime_error(fmt::format("ART noise burst threshold must be positive, got {}", m_threshold));
+  }
+}
+
+void nsw::MMARTNoiseAnalyzer::addSample(const Counters& counters, const double time)
+{
+  const auto interval = time - m_lastTime;
+  const bool baseline = not m_hasBaseline;
+  if (not baseline) {
+    if (interval <= 0) {
+      throw std::runtime_error(fmt::format("ART noise samples must be in time order, got {} after {}",
+                                           time, m_lastTime));
+    }
+    m_intervals.push_back(interval);
+  }
+  m_hasBaseline = true;
+  m_lastTime = time;
+
+  for (const auto& [art, values] : counters) {
+    auto& inputs = m_arts[art];
+    inputs.resize(std::max(inputs.size(), values.size()));
+    for (std::size_t index = 0; index < values.size(); index++) {
+      auto& input = inputs.at(index);
+      const auto value = values.at(index);
+      const auto previous = input.last;
+      input.last = value;
+      if (baseline) {
+        continue;
+      }
+      // a lower value means that the counter was reset
+      const auto increase = value >= previous ? value - previous : value;
+      const auto rate = static_cast<double>(increase) / interval;
+      input.rates.push_back(static_cast<float>(rate));
+      const auto delta = rate - input.mean;
+      input.mean += delta / static_cast<double>(input.rates.size());
+      input.m2 += delta * (rate - input.mean);
+    }
+  }
+}
+
+std::vector<std::size_t> nsw::MMARTNoiseAnalyzer::findBursts(const Input& input) const
+{
+  if (input.rates.empty()) {
+    return {};
+  }
+  auto values = input.rates;
+  const auto center = median(values);
+  for (auto& value : values) {
+    value = static_cast<float>(std::abs(value - center));
+  }
+  const auto spreadMad = MAD_TO_SIGMA * median(values);
+
+  // poisson error of the median rate, at least one hit per sample
+  const auto interval = getLiveTime() / static_cast<double>(m_intervals.size());
+  const auto spreadPoisson = std::sqrt(std::max(center * interval, 1.)) / interval;
+
+  const auto limit = center + m_threshold * std::max(spreadMad, spreadPoisson);
+  std::vector<std::size_t> bursts{};
+  for (std::size_t sample = 0; sample < input.rates.size(); sample++) {
+    if (input.rates.at(sample) > limit) {
+      bursts.push_back(sample);
+    }
+  }
+  return bursts;
+}
+
+nsw::MMARTNoiseAnalyzer::InputSummary nsw::MMARTNoiseAnalyzer::getInputSummary(const std::string& art,
+                                                                                const std::size_t input) const
+{
+  const auto found = m_arts.find(art);
+  if (found == std::cend(m_arts) or input >= found->second.size()) {
+    throw std::runtime_error(fmt::format("No noise samples of {} input {}", art, input));
+  }
+  const auto& data = found->second.at(input);
+  InputSummary summary{};
+  summary.samples = data.rates.size();
+  summary.mean = data.mean;
+  summary.variance = summary.samples > 1 ? data.m2 / static_cast<double>(summary.samples - 1) : 0.;
+  summary.max = data.rates.empty() ? 0. : *std::max_element(std::cbegin(data.rates), std::cend(data.rates));
+  summary.bursts = findBursts(data);
+  return summary;
+}
+
+double nsw::MMARTNoiseAnalyzer::getLiveTime() const
+{
+  return std::accumulate(std::cbegin(m_intervals), std::cend(m_intervals), 0.);
+}
+
+ptree nsw::MMARTNoiseAnalyzer::getSummary() const
+{
+  ptree summary;
+  summary.put("samples", getNumSamples());
+  summary.put("live_time", getLiveTime());
+  summary.put("burst_threshold", m_threshold);
+
+  // ART names may contain dots, which put/add_child would take as a path
+  ptree arts;
+  for (const auto& [art, inputs] : m_arts) {
+    ptree artTree;
+    ptree inputsTree;
+    double total{0};
+    std::set<std::size_t> burstSamples{};
+    std::size_t burstInputs{0};
+    for (std::size_t index = 0; index < inputs.size(); index++) {
+      const auto input = getInputSummary(art, index);
+      total += input.mean;
+      burstInputs += input.bursts.empty() ? 0 : 1;
+      burstSamples.insert(std::cbegin(input.bursts), std::cend(input.bursts));
+      ptree inputTree;
+      inputTree.put("mean", input.mean);
+      inputTree.put("rms", std::sqrt(input.variance));
+      inputTree.put("max", input.max);
+      inputTree.put("bursts", input.bursts.size());
+      inputsTree.push_back(std::make_pair("", inputTree));
+    }
+    artTree.put("total_rate", total);
+    artTree.put("burst_inputs", burstInputs);
+    ptree samplesTree;
+    for (const auto sample : burstSamples) {
+      ptree element;
+      element.put("", sample);
+      samplesTree.push_back(std::make_pair("", element));
+    }
+    artTree.push_back(std::make_pair("burst_samples", samplesTree));
+    artTree.push_back(std::make_pair("inputs", inputsTree));
+    arts.push_back(std::make_pair(art, artTree));
+  }
+  summary.push_back(std::make_pair("arts", arts));
+  return summary;
+}
@@ -0,0 +1,158 @@
+#include "NSWCalibration/MMARTPhaseScan.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+#include <fmt/core.h>
+
+nsw::MMARTPhaseScan::MMARTPhaseScan(std::vector<std::string> arts,
+                                   std::vector<int> phases,
+                                   const std::size_t width,
+                                   const std::uint32_t minHits,
+                                   const double fraction) :
+  m_phases{std::move(phases)}, m_width{width}, m_minHits{minHits}, m_fraction{fraction}
+{
+  if (m_width == 0 or m_width > m_phases.size()) {
+    throw std::runtime_error(fmt::format("ART phase window width must be between 1 and {}, got {}",
+                                         m_phases.size(), m_width));
+  }
+  for (auto& art : arts) {
+    m_arts.emplace(std::move(art), Art{});
+  }
+}
+
+void nsw::MMARTPhaseScan::setBaseline(const Counters& counters)
+{
+  for (const auto& [name, values] : counters) {
+    const auto art = m_arts.find(name);
+    if (art != std::end(m_arts)) {
+      art->second.last = values;
+    }
+  }
+}
+
+void nsw::MMARTPhaseScan::addPhase(const int phase, const Counters& counters)
+{
+  if (not m_phases.empty() and phase == m_phases.front()) {
+    for (auto& [name, art] : m_arts) {
+      art.scores.clear();
+    }
+  }
+
+  for (const auto& [name, values] : counters) {
+    const auto found = m_arts.find(name);
+    if (found == std::end(m_arts)) {
+      continue;
+    }
+    auto& art = found->second;
+    art.last.resize(values.size());
+    std::size_t score{0};
+    for (std::size_t input = 0; input < values.size(); input++) {
+      const auto value = values.at(input);
+      const auto previous = art.last.at(input);
+      // a lower value means that the counter was reset
+      const auto increase = value >= previous ? value - previous : value;
+      if (increase >= m_minHits) {
+        score++;
+      }
+      art.last.at(input) = value;
+    }
+    if (not art.window) {
+      art.scores[phase] = score;
+      art.window = findWindow(art);
+    }
+  }
+}
+
+std::optional<nsw::MMARTPhaseScan::Window> nsw::MMARTPhaseScan::findWindow(const Art& art) const
+{
+  // phases are scanned in order, so the scanned ones are a prefix of m_phases
+  std::vector<std::size_t> scores{};
+  for (const auto phase : m_phases) {
+    const auto score = art.scores.find(phase);
+    if (score == std::cend(art.scores)) {
+      break;
+    }
+    scores.push_back(score->second);
+  }
+  const auto best = scores.empty() ? std::size_t{0} : *std::max_element(std::cbegin(scores), std::cend(scores));
+  if (best == 0) {
+    return std::nullopt;
+  }
+  const auto isGood = [this, best, &scores](const std::size_t index) {
+    const auto score = scores.at(index);
+    return score > 0 and static_cast<double>(score) >= m_fraction * static_cast<double>(best);
+  };
+
+  // a window must be bracketed by bad phases. once all phases are scanned,
+  // the window can wrap around from the last phase to the first.
+  const auto num = scores.size();
+  const bool complete = (num == m_phases.size());
+  std::optional<std::size_t> firstBad{};
+  for (std::size_t index = 0; index < num; index++) {
+    if (not isGood(index)) {
+      firstBad = index;
+      break;
+    }
+  }
+  if (not firstBad) {
+    return std::nullopt;
+  }
+
+  const auto start = complete ? *firstBad : std::size_t{0};
+  const auto steps = complete ? num + 1 : num;
+  bool inRun{false};
+  std::size_t runStart{0};
+  std::size_t bestStart{0};
+  std::size_t bestLength{0};
+  bool bracketed{complete};
+  for (std::size_t step = 0; step < steps; step++) {
+    const auto index = (start + step) % num;
+    if (isGood(index)) {
+      if (not inRun and bracketed) {
+        inRun = true;
+        runStart = step;
+      }
+      continue;
+    }
+    if (inRun and step - runStart > bestLength) {
+      bestStart = (start + runStart) % num;
+      bestLength = step - runStart;
+    }
+    inRun = false;
+    bracketed = true;
+  }
+
+  if (bestLength < m_width) {
+    return std::nullopt;
+  }
+  return Window{m_phases.at(bestStart),
+                m_phases.at((bestStart + bestLength - 1) % num),
+                m_phases.at((bestStart + (bestLength - 1) / 2) % num)};
+}
+
+bool nsw::MMARTPhaseScan::isConverged(const std::string& art) const
+{
+  const auto found = m_arts.find(art);
+  return found != std::cend(m_arts) and found->second.window.has_value();
+}
+
+bool nsw::MMARTPhaseScan::allConverged() const
+{
+  return numConverged() == m_arts.size();
+}
+
+std::size_t nsw::MMARTPhaseScan::numConverged() const
+{
+  return static_cast<std::size_t>(std::count_if(std::cbegin(m_arts), std::cend(m_arts),
+                                                [](const auto& art) { return art.second.window.has_value(); }));
+}
+
+std::optional<nsw::MMARTPhaseScan::Window> nsw::MMARTPhaseScan::getWindow(const std::string& art) const
+{
+  const auto found = m_arts.find(art);
+  if (found == std::cend(m_arts)) {
+    return std::nullopt;
+  }
+  return found->second.window;
+}
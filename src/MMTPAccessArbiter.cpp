@@ -0,0 +1,65 @@
+#include "NSWCalibration/MMTPAccessArbiter.h"
+
+#include <algorithm>
+
+#include <ers/ers.h>
+
+#include <fmt/core.h>
+
+nsw::MMTPAccessArbiter::Access nsw::MMTPAccessArbiter::acquire(const Priority priority)
+{
+  const auto index = static_cast<std::size_t>(priority);
+  const auto configuration = static_cast<std::size_t>(Priority::Configuration);
+
+  std::unique_lock lock(m_mutex);
+  const auto ticket = m_nextTicket.at(index)++;
+  const auto isTurn = [this, index, configuration, ticket]() {
+    const bool configurationPending = m_served.at(configuration) != m_nextTicket.at(configuration);
+    return not m_busy and m_served.at(index) == ticket and
+           (index == configuration or not configurationPending);
+  };
+
+  const bool contended = not isTurn();
+  const auto start = std::chrono::steady_clock::now();
+  m_condition.wait(lock, isTurn);
+  const auto waited =
+    std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start);
+
+  m_busy = true;
+  m_served.at(index)++;
+
+  auto& statistics = m_statistics.at(index);
+  statistics.accesses++;
+  if (contended) {
+    statistics.contended++;
+    statistics.waited += waited;
+    statistics.maxWaited = std::max(statistics.maxWaited, waited);
+  }
+  return Access{*this};
+}
+
+void nsw::MMTPAccessArbiter::release()
+{
+  {
+    std::scoped_lock lock(m_mutex);
+    m_busy = false;
+  }
+  m_condition.notify_all();
+}
+
+nsw::MMTPAccessArbiter::Statistics nsw::MMTPAccessArbiter::getStatistics(const Priority priority) const
+{
+  std::scoped_lock lock(m_mutex);
+  return m_statistics.at(static_cast<std::size_t>(priority));
+}
+
+void nsw::MMTPAccessArbiter::logStatistics(const std::string& name) const
+{
+  const auto log = [&name](const std::string& type, const Statistics& statistics) {
+    ERS_INFO(fmt::format("{} MMTP {} accesses: {}, waited {} times for {} ms in total, {} ms at most",
+                         name, type, statistics.accesses, statistics.contended,
+                         statistics.waited.count() / 1000., statistics.maxWaited.count() / 1000.));
+  };
+  log("configuration", getStatistics(Priority::Configuration));
+  log("monitoring", getStatistics(Priority::Monitoring));
+}
@@ -38,9 +38,9 @@ void nsw::MMTPInputPhase::setup(const std::string& db) {
 
 void nsw::MMTPInputPhase::setupRootFile() {
   m_now = nsw::calib::utils::strf_time();
-  std::string rname = "tpscax." + std::to_string(runNumber()) + "."
-    + applicationName() + "." + m_now + ".root";
-  m_rfile  = std::make_unique< TFile >(rname.c_str(), "recreate");
+  std::string rname = outputFileName("nsw", "tpscax." + std::to_string(runNumber()) + "."
+    + applicationName() + "." + m_now + ".root");
+  m_rfile  = std::make_unique< TFile >(rname.c_str(), outputFileMode());
   m_rtree  = std::make_shared< TTree >("nsw", "nsw");
   m_align  = std::make_unique< std::vector<int> >();
   m_bcid   = std::make_unique< std::vector<int> >();
@@ -51,6 +51,7 @@ void nsw::MMTPInputPhase::setupRootFile() {
   m_rtree->Branch("fiber_align",  m_align.get());
   m_rtree->Branch("fiber_bcid",   m_bcid.get());
   m_rtree->Branch("fiber_index",  m_fiber.get());
+  attachTree(*m_rfile, *m_rtree);
 }
 
 void nsw::MMTPInputPhase::configure() {
@@ -97,21 +98,24 @@ int nsw::MMTPInputPhase::configure_tp(const nsw::hw::MMTP & tp, const std::uint3
            << " with phase=" << phase
            << " and ADDC offset=" << AddcOffset);
     if (!simulation()) {
-      // always set the phase
-      tp.writeRegister(nsw::mmtp::REG_INPUT_PHASE, phase);
-
-      // set offset during non-validation
-      if(m_calibType != "MMTPInputPhase_Validation") {
-        // in PhaseOnly, ADDC phase will be 0, otherwise, it'll be 0..7
-        tp.writeRegister(nsw::mmtp::REG_INPUT_PHASEADDCOFFSET, AddcOffset);
-        // in Phase Only, make sure to set the L1DDC offset to 0 (this calibration is not designed for scanning over L1DDC offset)
-        if(m_calibType == "MMTPInputPhase_PhaseOnly") {
-          tp.writeRegister(nsw::mmtp::REG_INPUT_PHASEL1DDCOFFSET, 0);
+      {
+        const auto access = m_tpAccess.acquire(MMTPAccessArbiter::Priority::Configuration);
+        // always set the phase
+        tp.writeRegister(nsw::mmtp::REG_INPUT_PHASE, phase);
+
+        // set offset during non-validation
+        if(m_calibType != "MMTPInputPhase_Validation") {
+          // in PhaseOnly, ADDC phase will be 0, otherwise, it'll be 0..7
+          tp.writeRegister(nsw::mmtp::REG_INPUT_PHASEADDCOFFSET, AddcOffset);
+          // in Phase Only, make sure to set the L1DDC offset to 0 (this calibration is not designed for scanning over L1DDC offset)
+          if(m_calibType == "MMTPInputPhase_PhaseOnly") {
+            tp.writeRegister(nsw::mmtp::REG_INPUT_PHASEL1DDCOFFSET, 0);
+          }
         }
       }
       // 64 million BC clock with error it will become 1.
       // 64e6 * 25e-9 = 1.6 seconds
-      std::this_thread::sleep_for(5000ms);
+      sleepFor(5000ms);
     }
     return 0;
 }
@@ -122,9 +126,9 @@ int nsw::MMTPInputPhase::read_tp(const nsw::hw::MMTP & tp, const std::uint32_t p
            << " and ADDC offset=" << AddcOffset);
   // open output file
   // on first iteration
-  if (counter() == 0) {
+  if (isFirstIteration()) {
     setupRootFile();
-    m_myfile.open("tpscax." + std::to_string(runNumber()) + "." + applicationName() + "." + m_now + ".txt");
+    m_myfile = openOutputText("txt", "tpscax." + std::to_string(runNumber()) + "." + applicationName() + "." + m_now + ".txt");
   }
 
   // clear
@@ -136,13 +140,14 @@ int nsw::MMTPInputPhase::read_tp(const nsw::hw::MMTP & tp, const std::uint32_t p
   std::uint32_t data_align{};
   std::vector<uint8_t> data_bcids_total = {};
 
-  // read the 32-bit word of fiber alignment
-  if (!simulation())
+  if (!simulation()) {
+    const auto access = m_tpAccess.acquire(MMTPAccessArbiter::Priority::Monitoring);
+
+    // read the 32-bit word of fiber alignment
     data_align = tp.readRegister(nsw::mmtp::REG_FIBER_ALIGNMENT);
 
-  // read the 4 32-bit words of fiber BCIDs (4 LSB per fiber)
-  for (auto reg : nsw::mmtp::REG_FIBER_BCIDS) {
-    if (!simulation()) {
+    // read the 4 32-bit words of fiber BCIDs (4 LSB per fiber)
+    for (auto reg : nsw::mmtp::REG_FIBER_BCIDS) {
       auto data_bcids = tp.readRegister(reg);
       for (auto byte : nsw::intToByteVector(data_bcids, nsw::NUM_BYTES_IN_WORD32, nsw::scax::SCAX_LITTLE_ENDIAN))
         data_bcids_total.push_back(byte);
@@ -188,8 +193,8 @@ int nsw::MMTPInputPhase::read_tp(const nsw::hw::MMTP & tp, const std::uint32_t p
   // on last iteration
   if (counter() == total()-1) {
     m_myfile.close();
-    m_rtree->Write();
-    m_rfile->Close();
+    writeTree(*m_rfile, *m_rtree);
+    m_tpAccess.logStatistics(m_calibType);
   }
 
   return 0;
@@ -1,6 +1,7 @@
 #include "NSWCalibration/MMTriggerCalib.h"
 
 #include "NSWCalibration/Issues.h"
+#include "NSWCalibration/MonitoringFeed.h"
 #include "NSWCalibration/Utility.h"
 
 #include "NSWConfiguration/ConfigReader.h"
@@ -8,8 +9,11 @@
 #include "NSWConfiguration/TPConstants.h"
 
 #include <unistd.h>
+#include <algorithm>
+#include <fstream>
+#include <iterator>
 #include <iostream>
-#include <regex>
+#include <map>
 #include <set>
 #include <sstream>
 #include <stdexcept>
@@ -17,6 +21,7 @@
 #include <chrono>
 
 #include <boost/property_tree/json_parser.hpp>  // for write_json
+#include <fmt/ranges.h>
 #include "NSWConfiguration/hw/FEB.h"
 #include "NSWConfiguration/hw/ADDC.h"
 #include <ers/ers.h>
@@ -38,6 +43,7 @@ nsw::MMTriggerCalib::MMTriggerCalib(std::string calibType, const hw::DeviceManag
       m_calibType=="MMARTConnectivityTestAllChannels") {
     m_phases = {-1};
     m_connectivity = true;
+    m_analyzeConnectivity = true;
     m_tracks       = false;
     m_noise        = false;
     m_latency      = false;
@@ -56,6 +62,14 @@ nsw::MMTriggerCalib::MMTriggerCalib(std::string calibType, const hw::DeviceManag
     m_noise        = true;
     m_latency      = false;
     m_staircase    = false;
+  } else if (m_calibType=="MMCableNoiseSampling") {
+    m_phases = {-1};
+    m_connectivity = false;
+    m_tracks       = false;
+    m_noise        = false;
+    m_noiseSampling = true;
+    m_latency      = false;
+    m_staircase    = false;
   } else if (m_calibType=="MMARTPhase") {
     m_phases = {0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15};
     m_connectivity = true;
@@ -92,79 +106,128 @@ void nsw::MMTriggerCalib::setup(const std::string& db) {
   m_threads->clear();
 
 
-  m_patterns = patterns();
-  setTotal(m_patterns.size());
+  m_devices = std::make_unique<MMTriggerDeviceIndex>(getDeviceManager());
+  if (m_analyzeConnectivity) {
+    m_analyzer = std::make_unique<MMARTConnectivityAnalyzer>();
+  }
+  if (m_noiseSampling) {
+    m_noiseAnalyzer = std::make_unique<MMARTNoiseAnalyzer>(m_noiseThreshold);
+    ERS_INFO(fmt::format("ART noise sampling: every {}s during {}s, bursts above {} sigma",
+                         m_noisePeriod, m_noiseDuration, m_noiseThreshold));
+  }
+  if (m_calibType == "MMARTPhase" && m_adaptivePhases) {
+    std::vector<std::string> arts{};
+    for (const auto& addc : getDeviceManager().getAddcs())
+      for (const auto& art : addc.getARTs())
+        if (!art.SkipConfigure())
+          arts.push_back(art_key(addc, art));
+    m_phaseScan = std::make_unique<MMARTPhaseScan>(std::move(arts), m_phases, m_phaseWindow,
+                                                   m_phaseMinHits, m_phaseFraction);
+    ERS_INFO(fmt::format("Adaptive ART phase scan: window of {} phases, {} hits, fraction {}",
+                         m_phaseWindow, m_phaseMinHits, m_phaseFraction));
+  }
+  m_plan = makePlan();
+  setTotal(m_plan.size());
+  checkPlanDevices();
 
   ERS_INFO("Found " << getDeviceManager().getFebs().size()     << " MMFE8s");
   ERS_INFO("Found " << getDeviceManager().getAddcs().size()    << " ADDCs");
   ERS_INFO("Found " << getDeviceManager().getMMTps().size()      << " TPs");
   ERS_INFO("Found " << m_phases.size()   << " ART input phases");
-  ERS_INFO("Found " << m_patterns.size() << " patterns");
+  ERS_INFO("Found " << m_plan.size() << " patterns");
 
 }
 
 void nsw::MMTriggerCalib::configure() {
 
-  if (counter() == 0) {
+  if (isFirstIteration()) {
     m_watchdog = std::async(std::launch::async, &nsw::MMTriggerCalib::addc_tp_watchdog, this);
     m_writePattern = std::async(std::launch::async, &nsw::MMTriggerCalib::recordPattern, this);
+    if (m_analyzer != nullptr || m_phaseScan != nullptr) {
+      // counters before the first test pulse
+      try {
+        const auto counters = read_all_art_counters();
+        if (m_analyzer != nullptr)
+          m_analyzer->setBaseline(counters);
+        if (m_phaseScan != nullptr)
+          m_phaseScan->setBaseline(counters);
+      } catch (std::exception & e) {
+        ERS_INFO("ART counter baseline exception: " << e.what());
+      }
+    }
   }
 
-  for (auto toppattkv : m_patterns) {
+  // noise sampling: no test pulse, nothing to configure
+  if (m_noiseSampling) return;
 
-    int ipatt = pattern_number(toppattkv.first);
-    if (ipatt != counter())
-      continue;
-    auto tr = toppattkv.second;
+  const auto& iteration = m_plan.at(counter());
 
-    ERS_INFO("Configure " << toppattkv.first
-             << " with ART phase = " << tr.get<int>("art_input_phase")
-             << " and TP L1A latency = " << tr.get<int>("tp_latency")
-             );
+  // nothing left to learn once the phase window of every ART is known
+  m_skipIteration = m_phaseScan != nullptr && m_phaseScan->allConverged();
+  if (m_skipIteration) {
+    ERS_LOG("All ARTs converged, skipping pattern_" << counter());
+    return;
+  }
 
-    // enable test pulse
-    configure_febs_from_ptree(tr, true);
+  ERS_INFO("Configure pattern_" << counter()
+           << " with ART phase = " << iteration.artInputPhase
+           << " and TP L1A latency = " << iteration.tpLatency
+           );
 
-    // set addc phase
-    configure_addcs_from_ptree(tr);
+  // enable test pulse
+  configure_febs(iteration, true);
 
-    // send TP config ("ECR")
-    configure_tps(tr);
+  // set addc phase
+  configure_addcs(iteration);
 
-    // record some data?
-    if (m_latency)
-      sleep(5);
-  }
+  // send TP config ("ECR")
+  configure_tps();
+
+  // record some data?
+  if (m_latency)
+    sleepFor(5s);
 
 }
 
 void nsw::MMTriggerCalib::acquire() {
+  if (m_skipIteration) return;
+  if (m_noiseSampling) {
+    sample_arts_noise();
+    return;
+  }
   // TODO: remove this after Alti oneshot user command is used (and test) 
-  if(m_calibType != "MMStaircase") std::this_thread::sleep_for(2000ms);
+  if(m_calibType != "MMStaircase") sleepFor(2000ms);
 }
 
 void nsw::MMTriggerCalib::unconfigure() {
 
-  for (auto toppattkv : m_patterns) {
+  if (m_noiseSampling) {
+    write_noise_summary();
+    return;
+  }
 
-    int ipatt = pattern_number(toppattkv.first);
-    if (ipatt != counter())
-      continue;
-    auto tr = toppattkv.second;
+  const auto& iteration = m_plan.at(counter());
+  ERS_INFO("Un-configure pattern_" << counter());
 
-    ERS_INFO("Un-configure " << toppattkv.first);
+  if (m_skipIteration) {
+    // the test pulse may still be enabled if the scan converged within a pattern
+    if (m_febsUnmasked)
+      configure_febs(iteration, false);
+    if (counter() == total() - 1)
+      close_arts_counters();
+    return;
+  }
 
-    // disable test pulse
-    configure_febs_from_ptree(tr, false);
+  // disable test pulse
+  configure_febs(iteration, false);
 
-    // read ARTs counters
-    read_arts_counters();
-  }
+  // read ARTs counters
+  read_arts_counters();
 
 }
 
 nsw::commands::Commands nsw::MMTriggerCalib::getAltiSequences() const {
-  if (!(m_latency || m_staircase)) {
+  if (!(m_latency || m_staircase || m_noiseSampling)) {
     return {{}, // before configure
             {nsw::commands::actionStartPG}, // during (before acquire)
             {} // after (before unconfigure)
@@ -174,22 +237,19 @@ nsw::commands::Commands nsw::MMTriggerCalib::getAltiSequences() const {
 }
 
 int nsw::MMTriggerCalib::wait_until_done() {
+  int sum = 0;
   for (auto& thread : *m_threads)
-    thread.get();
+    sum += thread.get();
   m_threads->clear();
-  return 0;
+  return sum;
 }
 
-int nsw::MMTriggerCalib::pattern_number(const std::string& name) const {
-  return std::stoi( std::regex_replace(name, std::regex("pattern_"), "") );
-}
-
-int nsw::MMTriggerCalib::configure_febs_from_ptree(const ptree& tr, bool unmask) {
+int nsw::MMTriggerCalib::configure_febs(const mmtrigger::Iteration& iteration, bool unmask) {
   //
   // if unmask and first art phase: send configuration
   // if   mask and  last art phase: send configuration
   //
-  auto phase = tr.get<int>("art_input_phase");
+  const auto phase = iteration.artInputPhase;
   if (unmask) {
     if (m_phases.size() > 0 && phase != m_phases.front()) {
       return 0;
@@ -200,124 +260,138 @@ int nsw::MMTriggerCalib::configure_febs_from_ptree(const ptree& tr, bool unmask)
     }
   }
 
-  for (auto pattkv : tr) {
-    auto febpatt_n = pattkv.first;
-    auto febtr     = pattkv.second;
-    if (febpatt_n.find("febpattern_") == std::string::npos)
-      continue;
-    announce(febpatt_n, febtr, unmask);
-    for (const auto & febkv : febtr) {
-      for (const auto & feb : getDeviceManager().getFebs()) {
-        // if new matching "geo_name" doesn't exist, look at old matching, continue if no match.
-        // if new matching "geo_name" exist, look at either old matching or new matching, continue if both not match
-        const auto addr = feb.getScaAddress();
-        if (febkv.second.count("geo_name") == 0) {
-          if (febkv.first != addr) continue;
-        } else {
-          std::string geo_name = febkv.second.get<std::string>("geo_name");
-          if (febkv.first != addr && 
-              addr.compare(addr.size() - geo_name.size(), geo_name.size(), geo_name) != 0 
-              )
-            continue;
-        }
-        m_threads->push_back(std::async(std::launch::async,
-                                        &nsw::MMTriggerCalib::configure_vmms, this,
-                                        feb, febkv.second, unmask));
-        break;
-      }
+  for (const auto& set : iteration.febPatterns) {
+    checkAbort();
+    announce(*set, unmask);
+    for (const auto& febpatt : set->febs) {
+      // match the SCA address, or the geo name if given
+      const auto* feb = m_devices->findFeb(febpatt.name, febpatt.geoName);
+      if (feb == nullptr) continue;
+      m_threads->push_back(std::async(std::launch::async,
+                                      &nsw::MMTriggerCalib::configure_vmms, this,
+                                      *feb, std::cref(febpatt), unmask));
     }
-    wait_until_done();
+    const auto nwrites = wait_until_done();
+    ERS_LOG(fmt::format("{}: {} VMM writes for {} pulsed channels",
+                        set->name, nwrites, set->countChannels()));
   }
+  m_febsUnmasked = unmask;
   return 0;
 }
 
-int nsw::MMTriggerCalib::configure_addcs_from_ptree(const ptree& tr) {
-  std::string name_old = tr.count("addc_old") ? tr.get<std::string>("addc_old") : "";
-  std::string name_geo = tr.count("addc_geo") ? tr.get<std::string>("addc_geo") : "";
+int nsw::MMTriggerCalib::configure_addcs(const mmtrigger::Iteration& iteration) {
+  const auto& name_old = iteration.addcOld;
+  const auto& name_geo = iteration.addcGeo;
   if (name_old != "")
     ERS_INFO("Configuring(Old name):" << name_old);
   if (name_geo != "")
     ERS_INFO("Configuring(New Name):" << name_geo);
-  auto phase = tr.get<int>("art_input_phase");
+  const auto phase = iteration.artInputPhase;
   if (phase != -1) {
     if (m_phases.size() > 0 && phase == m_phases.front())
       std::cout << "ART phase: " << std::endl;
     std::cout << std::hex << phase << std::dec << std::flush;
     if (m_phases.size() > 0 && phase == m_phases.back())
       std::cout << std::endl;
-    for (const auto & addc : getDeviceManager().getAddcs())
-      if (name_old == "" || name_geo == "" || addc.getScaAddress() == name_old || 
-          addc.getScaAddress().find(name_geo) != std::string::npos)
-        m_threads->push_back(std::async(std::launch::async,
-                                        &nsw::MMTriggerCalib::configure_art_input_phase, this,
-                                        addc, phase));
+    for (const auto* addc : m_devices->findAddcs(name_old, name_geo))
+      m_threads->push_back(std::async(std::launch::async,
+                                      &nsw::MMTriggerCalib::configure_art_input_phase, this,
+                                      std::cref(*addc), phase));
     wait_until_done();
+    // the ARTs converged so far now sit at their center phase
+    if (m_phaseScan != nullptr)
+      for (const auto& addc : getDeviceManager().getAddcs())
+        for (const auto& art : addc.getARTs())
+          if (m_phaseScan->isConverged(art_key(addc, art)))
+            m_centeredArts.insert(art_key(addc, art));
   }
   return 0;
 }
 
-int nsw::MMTriggerCalib::configure_tps(const ptree& tr) {
-  for (const auto & tp : getDeviceManager().getMMTps()) {
-    while (m_tpscax_busy) {
-      usleep(1e5);
+
+void nsw::MMTriggerCalib::checkPlanDevices() const {
+  std::set<std::string> missing{};
+  // the sets are shared between iterations, check each once
+  std::set<const mmtrigger::FebPatternSet*> checked{};
+  for (const auto& iteration : m_plan) {
+    for (const auto& set : iteration.febPatterns) {
+      if (not checked.insert(set.get()).second) {
+        continue;
+      }
+      for (const auto& febpatt : set->febs) {
+        if (m_devices->findFeb(febpatt.name, febpatt.geoName) == nullptr) {
+          missing.insert(febpatt.geoName.empty() ? febpatt.name : fmt::format("{} ({})", febpatt.name, febpatt.geoName));
+        }
+      }
+    }
+    // fills the cache of the ADDC search
+    if (not iteration.addcOld.empty() and not iteration.addcGeo.empty() and
+        m_devices->findAddcs(iteration.addcOld, iteration.addcGeo).empty()) {
+      ERS_LOG(fmt::format("No ADDC matches {} / {}", iteration.addcOld, iteration.addcGeo));
     }
-    m_tpscax_busy = true;
+  }
+  if (not missing.empty()) {
+    ERS_INFO(fmt::format("{} MMFE8s of the patterns are not in the configuration and will be skipped: {}",
+                         missing.size(), fmt::join(missing, ", ")));
+  }
+}
+
+int nsw::MMTriggerCalib::configure_tps() {
+  for (const auto & tp : getDeviceManager().getMMTps()) {
+    const auto access = m_tpAccess.acquire(MMTPAccessArbiter::Priority::Configuration);
     if (!m_dry_run) {
       ERS_INFO("MMTP overflow word: " << tp.readRegister(nsw::mmtp::REG_PIPELINE_OVERFLOW));
       tp.writeConfiguration(false);
     }
-    m_tpscax_busy = false;
   }
   return 0;
 }
 
-int nsw::MMTriggerCalib::announce(const std::string& name, const ptree& tr, bool unmask) const {
-  std::cout << " Configure MMFE8s (" << (unmask ? "unmask" : "mask") << ") with " << name << std::endl << std::flush;
-  for (const auto& febkv : tr) {
-    std::cout << "  " << febkv.first;
-    for (const auto& vmmkv : febkv.second) {
-      if (vmmkv.first == "geo_name") continue;
-      std::cout << " " << vmmkv.first;
-      for (const auto& chkv : vmmkv.second)
-        std::cout << "/" << chkv.second.get<unsigned>("");
+int nsw::MMTriggerCalib::announce(const mmtrigger::FebPatternSet& set, bool unmask) const {
+  std::cout << " Configure MMFE8s (" << (unmask ? "unmask" : "mask") << ") with " << set.name << std::endl << std::flush;
+  for (const auto& febpatt : set.febs) {
+    std::cout << "  " << febpatt.name;
+    for (std::size_t vmmid = 0; vmmid < febpatt.channels.size(); vmmid++) {
+      const auto channels = febpatt.getChannels(vmmid);
+      if (channels.empty()) continue;
+      std::cout << " " << vmmid;
+      for (const auto chan : channels)
+        std::cout << "/" << chan;
     }
     std::cout << std::endl << std::flush;
   }
   return 0;
 }
 
-int nsw::MMTriggerCalib::configure_vmms(nsw::hw::FEB feb, const ptree& febpatt, bool unmask) const {
+int nsw::MMTriggerCalib::configure_vmms(nsw::hw::FEB feb, const mmtrigger::FebPattern& febpatt, bool unmask) const {
   //
-  // Example febpatt ptree:
-  // {
-  //   "0": ["0", "1", "2"],
-  //   "1": ["0"],
-  //   "2": ["0"]
-  // }
+  // apply the channel edits of a VMM first, then write it once.
+  // the VMMs of one MMFE8 are written in sequence by this task,
+  // while the tasks of different MMFE8s run concurrently.
   //
+  int nwrites = 0;
+  for (std::size_t vmmid = 0; vmmid < febpatt.channels.size(); vmmid++) {
+    const auto channels = febpatt.getChannels(vmmid);
+    if (channels.empty()) continue;
+    auto& vmm = feb.getVmm(vmmid);
+    for (const auto chan : channels) {
+      vmm.getConfig().setChannelRegisterOneChannel("channel_st", unmask ? 1 : 0, chan);
+      vmm.getConfig().setChannelRegisterOneChannel("channel_sm", unmask ? 0 : 1, chan);
+    }
 
-  int vmmid, chan;
-  for (const auto& vmmkv : febpatt) {
-    if (vmmkv.first == "geo_name") continue;
-    for (const auto& chkv : vmmkv.second) {
-      vmmid = std::stoi(vmmkv.first);
-      chan  = chkv.second.get<int>("");
-      feb.getVmm(vmmid).getConfig().setChannelRegisterOneChannel("channel_st", unmask ? 1 : 0, chan);
-      feb.getVmm(vmmid).getConfig().setChannelRegisterOneChannel("channel_sm", unmask ? 0 : 1, chan);
-
-      if (!m_dry_run) {
-        try {
-          feb.getVmm(vmmid).writeConfiguration(m_reset_vmm);
-        } catch (std::exception & ex) {
-          const auto msg = fmt::format("Allowed VMM config to fail: {}", ex.what());
-          nsw::ConfigIssue issue(ERS_HERE, msg.c_str());
-          ers::warning(issue);
-        }
+    if (!m_dry_run) {
+      try {
+        vmm.writeConfiguration(m_reset_vmm);
+        nwrites++;
+      } catch (std::exception & ex) {
+        const auto msg = fmt::format("Allowed VMM config to fail: {}", ex.what());
+        nsw::ConfigIssue issue(ERS_HERE, msg.c_str());
+        ers::warning(issue);
       }
     }
   }
 
-  return 0;
+  return nwrites;
 }
 
 int nsw::MMTriggerCalib::configure_art_input_phase(const nsw::hw::ADDC& addc, uint phase) const {
@@ -339,9 +413,19 @@ int nsw::MMTriggerCalib::configure_art_input_phase(const nsw::hw::ADDC& addc, ui
     throw std::runtime_error("Gave bad phase to configure_art_input_phase: " + std::to_string(phase));
 
   constexpr size_t art_size = 2;
-  uint8_t this_phase = phase + (phase << 4);
   for (const auto& art : addc.getARTs()) {
-    ERS_LOG("Writing ART phase " << addc.getScaAddress() + "." + art.getConfig().getName() << ": 0x" << std::hex << phase);
+    // a converged ART is set to the center of its window once, then left alone
+    auto art_phase = phase;
+    if (m_phaseScan != nullptr) {
+      const auto key = art_key(addc, art);
+      const auto window = m_phaseScan->getWindow(key);
+      if (window && m_centeredArts.contains(key))
+        continue;
+      if (window)
+        art_phase = static_cast<uint>(window->center);
+    }
+    uint8_t this_phase = art_phase + (art_phase << 4);
+    ERS_LOG("Writing ART phase " << addc.getScaAddress() + "." + art.getConfig().getName() << ": 0x" << std::hex << art_phase);
     for (const auto& reg : nsw::art::REG_INPUT_PHASES) {
       if (!m_dry_run)
         art.writeARTPsRegister(reg, this_phase);
@@ -350,25 +434,32 @@ int nsw::MMTriggerCalib::configure_art_input_phase(const nsw::hw::ADDC& addc, ui
   return 0;
 }
 
-ptree nsw::MMTriggerCalib::patterns() const {
-  ptree patts;
-  int ipatts   = 0;
+nsw::mmtrigger::Plan nsw::MMTriggerCalib::makePlan() const {
+  mmtrigger::Plan plan;
   int ifebpatt = 0;
 
-  if (m_noise) {
+  // a set of FEB patterns, shared by the iterations using it
+  const auto febPatternSet = [&ifebpatt]() {
+    auto set = std::make_shared<mmtrigger::FebPatternSet>();
+    set->name = "febpattern_" + std::to_string(ifebpatt);
+    ifebpatt++;
+    return set;
+  };
+
+  if (m_noiseSampling) {
+    //
+    // cable noise sampling: one iteration, the counters are read during acquire
+    //
+    plan.emplace_back();
+  } else if (m_noise) {
     //
     // cable noise loop: no patterns
     //
     constexpr int npatts = 100;
     for (int i = 0; i < npatts; i++) {
-      ptree feb_patt;
-      ptree top_patt;
-      top_patt.put("tp_latency", -1);
-      top_patt.put("art_input_phase", -1);
-      top_patt.add_child("febpattern_" + std::to_string(ifebpatt), feb_patt);
-      patts.add_child("pattern_" + std::to_string(ipatts), top_patt);
-      ipatts++;
-      ifebpatt++;
+      mmtrigger::Iteration iteration{};
+      iteration.febPatterns.push_back(febPatternSet());
+      plan.push_back(std::move(iteration));
     }
   } else if (m_staircase) {
     //
@@ -376,16 +467,12 @@ ptree nsw::MMTriggerCalib::patterns() const {
     //                 checks for fiber- and bundle-swapping.
     //
     for (const auto & addc: nsw::mmtp::ORDERED_ADDCS) {
-      ptree feb_patt;
-      ptree top_patt;
-      top_patt.put("addc_old", std::string(addc.first));
-      top_patt.put("addc_geo", std::string(addc.second));
-      top_patt.put("tp_latency", -1);
-      top_patt.put("art_input_phase", 0xf);
-      top_patt.add_child("febpattern_" + std::to_string(ifebpatt), feb_patt);
-      patts.add_child("pattern_" + std::to_string(ipatts), top_patt);
-      ipatts++;
-      ifebpatt++;
+      mmtrigger::Iteration iteration{};
+      iteration.addcOld = std::string(addc.first);
+      iteration.addcGeo = std::string(addc.second);
+      iteration.artInputPhase = 0xf;
+      iteration.febPatterns.push_back(febPatternSet());
+      plan.push_back(std::move(iteration));
     }
   } else if (m_latency) {
     //
@@ -395,14 +482,10 @@ ptree nsw::MMTriggerCalib::patterns() const {
     //
     constexpr int npatts = 100;
     for (int i = 0; i < npatts; i++) {
-      ptree feb_patt;
-      ptree top_patt;
-      top_patt.put("tp_latency", i);
-      top_patt.put("art_input_phase", -1);
-      top_patt.add_child("febpattern_" + std::to_string(ifebpatt), feb_patt);
-      patts.add_child("pattern_" + std::to_string(ipatts), top_patt);
-      ipatts++;
-      ifebpatt++;
+      mmtrigger::Iteration iteration{};
+      iteration.tpLatency = i;
+      iteration.febPatterns.push_back(febPatternSet());
+      plan.push_back(std::move(iteration));
     }
   } else if (m_connectivity) {
     //
@@ -420,7 +503,7 @@ ptree nsw::MMTriggerCalib::patterns() const {
           continue;
         if (m_calibType == "MMARTPhase"            && chan % 10 != 0)
           continue;
-        ptree feb_patt;
+        auto feb_patt = febPatternSet();
         for (auto && [name, geoName] : std::map<std::string, std::string>{
              // even
              { "MMFE8_L1P" + pcbstr       + "_HOR",
@@ -490,46 +573,33 @@ ptree nsw::MMTriggerCalib::patterns() const {
              { "MMFE8_L1P" + pcbstr_plus4 + "_IPR",
                fmt::format("L0/R{}", pos+1+8)},
               }) {
-          ptree febtree;
+          mmtrigger::FebPattern febpatt{};
+          febpatt.name    = name;
+          febpatt.geoName = geoName;
           for (size_t vmmid = 0; vmmid < nsw::MAX_NUMBER_OF_VMM; vmmid++) {
-
-            //if (vmm_of_interest >= 0 && vmmid != vmm_of_interest)
-            //  continue;
-
-            // this might seem stupid, and it is, but
-            //   it allows to write a vector of channels per VMM
-            ptree vmmtree;
-            ptree chantree;
-            chantree.put("", chan);
-            vmmtree.push_back(std::make_pair("", chantree));
-            febtree.add_child(std::to_string(vmmid), vmmtree);
-            febtree.put("geo_name", geoName);
+            febpatt.addChannel(vmmid, chan);
           }
-          feb_patt.add_child(name, febtree);
+          feb_patt->febs.push_back(std::move(febpatt));
         }
 
         for (const auto& art_phase : m_phases) {
-          ptree top_patt;
-          top_patt.put("tp_latency", -1);
-          top_patt.put("art_input_phase", art_phase);
-          top_patt.add_child("febpattern_" + std::to_string(ifebpatt), feb_patt);
-          patts.add_child("pattern_" + std::to_string(ipatts), top_patt);
-          ipatts++;
+          mmtrigger::Iteration iteration{};
+          iteration.artInputPhase = art_phase;
+          iteration.febPatterns.push_back(feb_patt);
+          plan.push_back(std::move(iteration));
         }
-
-        ifebpatt++;
       }
     }
   } else if (m_tracks) {
-    read_json(m_trackPatternFile, patts);
+    plan = mmtrigger::readPlan(m_trackPatternFile);
   }
-  return patts;
+  return plan;
 }
 
 int nsw::MMTriggerCalib::addc_tp_watchdog() {
   //
   // Be forewarned: this function reads TP SCAX registers.
-  // Dont race elsewhere.
+  // Any other access must go through m_tpAccess.
   //
 
 
@@ -570,32 +640,46 @@ int nsw::MMTriggerCalib::addc_tp_watchdog() {
   rtree->Branch("art_aligned",  art_aligned.get());
   rtree->Branch("art_bcid",     art_bcid.get());
 
+  // live feed for nsw_calib_monitor, the watchdog runs without it if it cannot be created
+  std::unique_ptr<MonitoringFeed> feed{};
+  try {
+    feed = std::make_unique<MonitoringFeed>("nsw_calib_" + applicationName());
+    ERS_INFO("ADDC-TP watchdog. Monitoring feed: " << feed->getName());
+  } catch (const std::runtime_error& ex) {
+    ERS_INFO("ADDC-TP watchdog. No monitoring feed: " << ex.what());
+  }
+
   // monitor
   try {
-    while (counter() < total()) {
+    while (counter() < total() and not aborted()) {
       now = nsw::calib::utils::strf_time();
       addc_address->clear();
       art_name    ->clear();
       art_fiber   ->clear();
       art_aligned ->clear();
       for (const auto& tp : getDeviceManager().getMMTps()) {
-        while (m_tpscax_busy)
-          usleep(1e5);
-        m_tpscax_busy = true;
-        auto outdata = m_dry_run ? std::uint32_t(0) :
-          tp.readRegister(nsw::mmtp::REG_FIBER_ALIGNMENT);
+        // all registers of a TP are read in one access
+        std::uint32_t outdata{0};
         data_bcids_total.clear();
-        for (const auto& reg : nsw::mmtp::REG_FIBER_BCIDS) {
+        {
+          const auto access = m_tpAccess.acquire(MMTPAccessArbiter::Priority::Monitoring);
           if (!m_dry_run) {
-            auto data_bcids_uint32 = tp.readRegister(reg);
-            data_bcids = nsw::intToByteVector(data_bcids_uint32,
-                nsw::NUM_BYTES_IN_WORD32,
-                nsw::scax::SCAX_LITTLE_ENDIAN);
+            outdata = tp.readRegister(nsw::mmtp::REG_FIBER_ALIGNMENT);
           }
-          for (const auto& byte : data_bcids)
-            data_bcids_total.push_back(byte);
+          for (const auto& reg : nsw::mmtp::REG_FIBER_BCIDS) {
+            if (!m_dry_run) {
+              auto data_bcids_uint32 = tp.readRegister(reg);
+              data_bcids = nsw::intToByteVector(data_bcids_uint32,
+                  nsw::NUM_BYTES_IN_WORD32,
+                  nsw::scax::SCAX_LITTLE_ENDIAN);
+            }
+            for (const auto& byte : data_bcids)
+              data_bcids_total.push_back(byte);
+          }
+        }
+        if (feed) {
+          feed->publishTpAlignment(tp.getScaAddress(), outdata, data_bcids_total);
         }
-        m_tpscax_busy = false;
         for (const auto & addc : getDeviceManager().getAddcs()) {
           for (const auto& art : addc.getARTs()) {
             auto aligned = art.getConfig().IsAlignedWithTP(outdata);
@@ -617,6 +701,7 @@ int nsw::MMTriggerCalib::addc_tp_watchdog() {
 
   // close
   usleep(1e6);
+  m_tpAccess.logStatistics(m_calibType);
   ERS_INFO("Closing " << rfile->GetName());
   rfile->cd();
   rtree->Write();
@@ -627,18 +712,19 @@ int nsw::MMTriggerCalib::addc_tp_watchdog() {
 void nsw::MMTriggerCalib::recordPattern() {
   // do this before the start of run
   const auto now = nsw::calib::utils::strf_time();
-  write_json(fmt::format("Pattern_run{}_{}.json", runNumber(), now), m_patterns);
+  write_json(outputFileName("pattern", fmt::format("Pattern_run{}_{}.json", runNumber(), now)),
+             mmtrigger::toPtree(m_plan));
 }
 
 int nsw::MMTriggerCalib::read_arts_counters() {
 
   // initialize output
   try {
-    if (counter() == 0) {
+    if (isFirstIteration()) {
       // file and tree
-      std::string rname_hit = "art_counters."
-        + std::to_string(runNumber()) + "." + applicationName() + "." + nsw::calib::utils::strf_time() + ".root";
-      m_art_rfile = std::make_unique< TFile >(rname_hit.c_str(), "recreate");
+      std::string rname_hit = outputFileName("art_counters", "art_counters."
+        + std::to_string(runNumber()) + "." + applicationName() + "." + nsw::calib::utils::strf_time() + ".root");
+      m_art_rfile = std::make_unique< TFile >(rname_hit.c_str(), outputFileMode());
       m_art_rtree = std::make_shared< TTree >("nsw", "nsw");
       ERS_INFO("ART hit counter. Output: "  << rname_hit);
 
@@ -655,6 +741,7 @@ int nsw::MMTriggerCalib::read_arts_counters() {
       m_art_rtree->Branch("art_name",     &m_art_name);
       m_art_rtree->Branch("art_index",    &m_art_index);
       m_art_rtree->Branch("art_hits",     m_art_hits.get());
+      attachTree(*m_art_rfile, *m_art_rtree);
     }
   } catch (std::exception & e) {
     ERS_INFO("read_arts_counters exception: " << e.what());
@@ -665,25 +752,10 @@ int nsw::MMTriggerCalib::read_arts_counters() {
   try {
 
     // init
-    auto threads = std::make_unique<
-      std::vector< std::future< std::vector<uint32_t> > >
-      >();
     m_art_event = counter();
     m_art_now   = nsw::calib::utils::strf_time();
+    const auto counters = read_all_art_counters();
 
-    // launch reader threads
-    // https://its.cern.ch/jira/browse/OPCUA-2188
-    for (const auto & addc : getDeviceManager().getAddcs())
-      for (const auto& art: addc.getARTs()) {
-        if(art.SkipConfigure()) {
-          continue;
-        }
-        threads->push_back(std::async(std::launch::async,
-                                      &nsw::MMTriggerCalib::read_art_counters,
-                                      this, art));
-      }
-
-    // get results
     // 1 TTree entry per ART
     size_t it = 0;
     for (const auto & addc : getDeviceManager().getAddcs()) {
@@ -691,19 +763,22 @@ int nsw::MMTriggerCalib::read_arts_counters() {
         if(art.SkipConfigure()) {
           continue;
         }
-        auto result = threads->at(it).get();
         m_addc_address = addc.getScaAddress();
         m_art_name     = art.getName();
         m_art_index    = it;
-        m_art_hits->clear();
-        for (const auto& val : result)
-          m_art_hits->push_back(val);
+        *m_art_hits    = counters.at(art_key(addc, art));
         m_art_rtree->Fill();
         it++;
       }
     }
 
-    threads->clear();
+    if (m_analyzer != nullptr) {
+      m_analyzer->addIteration(m_plan.at(counter()), counters);
+    }
+    if (m_phaseScan != nullptr) {
+      m_phaseScan->addPhase(m_plan.at(counter()).artInputPhase, counters);
+      ERS_LOG(fmt::format("ART phase scan: {} ARTs converged", m_phaseScan->numConverged()));
+    }
 
   } catch (std::exception & e) {
     ERS_INFO("read_arts_counters exception: " << e.what());
@@ -712,23 +787,170 @@ int nsw::MMTriggerCalib::read_arts_counters() {
 
   // close
   if (counter() == total() - 1) {
-    if (m_art_rfile == nullptr || m_art_rtree == nullptr) {
-      ERS_INFO("Cannot close art_rfile or art_rtree!"
-               << " Something wasnt initialized. Skipping.");
-      ERS_INFO("The pointers of interest:"
-               << " m_art_rfile = " << m_art_rfile.get()
-               << " m_art_rtree = " << m_art_rtree.get());
-    } else {
-      ERS_INFO("Closing " << m_art_rfile->GetName());
-      m_art_rfile->cd();
-      m_art_rtree->Write();
-      m_art_rfile->Close();
-    }
+    close_arts_counters();
   }
 
   return 0;
 }
 
+void nsw::MMTriggerCalib::close_arts_counters() {
+  if (m_art_rfile == nullptr || m_art_rtree == nullptr) {
+    ERS_INFO("Cannot close art_rfile or art_rtree!"
+             << " Something wasnt initialized. Skipping.");
+    ERS_INFO("The pointers of interest:"
+             << " m_art_rfile = " << m_art_rfile.get()
+             << " m_art_rtree = " << m_art_rtree.get());
+  } else {
+    ERS_INFO("Closing " << m_art_rfile->GetName());
+    writeTree(*m_art_rfile, *m_art_rtree);
+  }
+  if (m_analyzer != nullptr) {
+    write_connectivity_summary();
+  }
+  if (m_phaseScan != nullptr) {
+    write_art_phase_patch();
+  }
+}
+
+std::string nsw::MMTriggerCalib::art_key(const nsw::hw::ADDC& addc, const nsw::hw::ART& art) {
+  return addc.getScaAddress() + "." + art.getName();
+}
+
+nsw::MMARTConnectivityAnalyzer::Counters nsw::MMTriggerCalib::read_all_art_counters() const {
+  // launch reader threads
+  // https://its.cern.ch/jira/browse/OPCUA-2188
+  std::vector<std::pair<std::string, std::future<std::vector<uint32_t>>>> threads{};
+  for (const auto & addc : getDeviceManager().getAddcs())
+    for (const auto& art: addc.getARTs()) {
+      if(art.SkipConfigure()) {
+        continue;
+      }
+      threads.emplace_back(art_key(addc, art),
+                           std::async(std::launch::async,
+                                      &nsw::MMTriggerCalib::read_art_counters,
+                                      this, art));
+    }
+
+  // get results
+  MMARTConnectivityAnalyzer::Counters counters{};
+  for (auto& [key, thread] : threads)
+    counters.emplace(key, thread.get());
+  return counters;
+}
+
+void nsw::MMTriggerCalib::write_art_phase_patch() const {
+  // ART names may contain dots, which put/add_child would take as a path
+  ptree patch;
+  std::vector<std::string> missing{};
+  for (const auto& addc : getDeviceManager().getAddcs()) {
+    ptree addc_patch;
+    for (const auto& art : addc.getARTs()) {
+      if (art.SkipConfigure()) continue;
+      const auto window = m_phaseScan->getWindow(art_key(addc, art));
+      if (!window) {
+        missing.push_back(art_key(addc, art));
+        continue;
+      }
+      ERS_LOG(fmt::format("{}: good ART phases {:#x} to {:#x}, using {:#x}",
+                          art_key(addc, art), window->first, window->last, window->center));
+      ptree art_patch;
+      art_patch.put("input_phase", window->center);
+      addc_patch.push_back(std::make_pair(art.getName(), art_patch));
+    }
+    if (!addc_patch.empty())
+      patch.push_back(std::make_pair(addc.getScaAddress(), addc_patch));
+  }
+
+  const auto name = fmt::format("art_input_phase.{}.{}.{}.json", runNumber(), applicationName(),
+                                nsw::calib::utils::strf_time());
+  write_json(name, patch);
+  ERS_INFO(fmt::format("ART input phases of {} ARTs written to {}", m_phaseScan->numConverged(), name));
+  if (!missing.empty()) {
+    nsw::NSWMMTriggerCalibIssue issue(ERS_HERE, fmt::format("No good ART phase window found for {}",
+                                                            fmt::join(missing, ", ")));
+    ers::warning(issue);
+  }
+}
+
+void nsw::MMTriggerCalib::sample_arts_noise() {
+  //
+  // Read the counters at a fixed cadence: the time spent reading does not
+  // add up, and the periods missed by a slow reading are skipped.
+  //
+  const auto period = std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+    std::chrono::duration<double>(m_noisePeriod));
+  const auto start = std::chrono::steady_clock::now();
+  const auto stop = start + std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+    std::chrono::duration<double>(m_noiseDuration));
+  const auto seconds = [&start](const std::chrono::steady_clock::time_point time) {
+    return std::chrono::duration<double>(time - start).count();
+  };
+
+  std::size_t missed{0};
+  auto next = start;
+  while (true) {
+    const auto counters = read_all_art_counters();
+    m_noiseAnalyzer->addSample(counters, seconds(std::chrono::steady_clock::now()));
+    next += period;
+    if (next > stop) break;
+    const auto now = std::chrono::steady_clock::now();
+    if (next < now) {
+      const auto behind = (now - next) / period + 1;
+      missed += static_cast<std::size_t>(behind);
+      next += behind * period;
+    }
+    sleepFor(next - std::chrono::steady_clock::now());
+  }
+  ERS_INFO(fmt::format("ART noise sampling: {} samples in {:.1f}s", m_noiseAnalyzer->getNumSamples(),
+                       m_noiseAnalyzer->getLiveTime()));
+  if (missed > 0) {
+    nsw::NSWMMTriggerCalibIssue issue(ERS_HERE, fmt::format("Reading the ART counters is slower than the "
+                                                            "period of {}s, {} samples were skipped",
+                                                            m_noisePeriod, missed));
+    ers::warning(issue);
+  }
+}
+
+void nsw::MMTriggerCalib::write_noise_summary() const {
+  const auto name = fmt::format("art_noise.{}.{}.{}.json", runNumber(), applicationName(),
+                                nsw::calib::utils::strf_time());
+  const auto summary = m_noiseAnalyzer->getSummary();
+  write_json(name, summary);
+
+  std::size_t burstArts{0};
+  for (const auto& [art, tree] : summary.get_child("arts")) {
+    if (tree.get<std::size_t>("burst_inputs") > 0) {
+      burstArts++;
+      ERS_LOG(fmt::format("{}: {} inputs with bursts, total rate {} Hz", art,
+                          tree.get<std::size_t>("burst_inputs"), tree.get<double>("total_rate")));
+    }
+  }
+  ERS_INFO(fmt::format("ART noise of {} ARTs, {} with bursts. Output: {}",
+                       summary.get_child("arts").size(), burstArts, name));
+}
+
+void nsw::MMTriggerCalib::write_connectivity_summary() const {
+  const auto name = fmt::format("art_connectivity.{}.{}.{}", runNumber(), applicationName(),
+                                nsw::calib::utils::strf_time());
+  write_json(name + ".json", m_analyzer->getSummary());
+
+  // one line per failing input: ART, input, status, home group, failing channels
+  std::ofstream failures(name + ".txt");
+  std::map<std::string, std::size_t> statuses{};
+  for (const auto& verdict : m_analyzer->getVerdicts()) {
+    statuses[verdict.status]++;
+    if (verdict.status == "ok") continue;
+    std::vector<std::string> channels{};
+    std::transform(std::cbegin(verdict.failingChannels), std::cend(verdict.failingChannels),
+                   std::back_inserter(channels), [](const auto& channel) { return channel.toString(); });
+    failures << fmt::format("{} {} {} {} {}\n", verdict.art, verdict.input, verdict.status,
+                            verdict.home ? std::to_string(*verdict.home) : "-",
+                            fmt::join(channels, ","));
+  }
+  ERS_INFO(fmt::format("ART connectivity of {} iterations: {}. Output: {}.json, failing inputs: {}.txt",
+                       m_analyzer->getNumIterations(), fmt::join(statuses, ", "), name, name));
+}
+
 // TODO: this function should move to NSWConfiguration
 std::vector<uint32_t> nsw::MMTriggerCalib::read_art_counters(const nsw::hw::ART& art) const {
 
@@ -794,6 +1016,16 @@ std::vector<uint32_t> nsw::MMTriggerCalib::read_art_counters(const nsw::hw::ART&
 void nsw::MMTriggerCalib::setCalibParamsFromIS(const ISInfoDictionary& is_dictionary,
                                                const std::string& is_db_name)
 {
+  if (m_calibType == "MMARTPhase" || m_noiseSampling) {
+    // optional, e.g. "window=3,min_hits=1,fraction=1,adaptive=1" or "period=0.5,duration=100"
+    const auto name = fmt::format("{}.Calib.calibParams", is_db_name);
+    if (is_dictionary.contains(name)) {
+      ISInfoDynAny infoany;
+      is_dictionary.getValue(name, infoany);
+      setCalibParams(infoany.getAttributeValue<std::string>(0));
+    }
+    return;
+  }
   if(!m_tracks) return;
   const auto calib_param_is_name = fmt::format("{}.Calib.trackPatternFile", is_db_name);
   if (is_dictionary.contains(calib_param_is_name)) {
@@ -801,7 +1033,7 @@ void nsw::MMTriggerCalib::setCalibParamsFromIS(const ISInfoDictionary& is_dictio
     is_dictionary.getValue(calib_param_is_name, calib_params_from_is);
     const auto calibParams = calib_params_from_is.getAttributeValue<std::string>(0);
     ERS_INFO(fmt::format("trackPatternFile from IS: {}", calibParams));
-    m_trackPatternFile = std::move(calibParams);
+    setCalibParams(calibParams);
   } else {
     const auto is_cmd = fmt::format("is_write -p ${{TDAQ_PARTITION}} -n {} -t String -v <Track pattern file> -i 0", calib_param_is_name);
     nsw::calib::IsParameterNotFound issue(ERS_HERE, "trackPatternFile", is_cmd);
@@ -809,3 +1041,48 @@ void nsw::MMTriggerCalib::setCalibParamsFromIS(const ISInfoDictionary& is_dictio
     throw issue;
   }
 }
+
+void nsw::MMTriggerCalib::setCalibParams(const std::string& calibParams)
+{
+  if (m_calibType == "MMARTPhase") {
+    for (const auto& [key, value] : nsw::calib::utils::parseKeyValues(calibParams)) {
+      if (key == "adaptive") {
+        m_adaptivePhases = (value != "0" && value != "false");
+      } else if (key == "window") {
+        m_phaseWindow = std::stoul(value);
+      } else if (key == "min_hits") {
+        m_phaseMinHits = static_cast<std::uint32_t>(std::stoul(value));
+      } else if (key == "fraction") {
+        m_phaseFraction = std::stod(value);
+      } else {
+        throw NSWMMTriggerCalibIssue(ERS_HERE, fmt::format("Unknown MMARTPhase parameter {}, expected "
+                                                           "adaptive, window, min_hits or fraction", key));
+      }
+    }
+    return;
+  }
+  if (m_noiseSampling) {
+    for (const auto& [key, value] : nsw::calib::utils::parseKeyValues(calibParams)) {
+      if (key == "period") {
+        m_noisePeriod = std::stod(value);
+      } else if (key == "duration") {
+        m_noiseDuration = std::stod(value);
+      } else if (key == "threshold") {
+        m_noiseThreshold = std::stod(value);
+      } else {
+        throw NSWMMTriggerCalibIssue(ERS_HERE, fmt::format("Unknown MMCableNoiseSampling parameter {}, expected "
+                                                           "period, duration or threshold", key));
+      }
+    }
+    if (m_noisePeriod <= 0 || m_noiseDuration < m_noisePeriod) {
+      throw NSWMMTriggerCalibIssue(ERS_HERE, fmt::format("MMCableNoiseSampling needs 0 < period <= duration, got "
+                                                         "period={} duration={}", m_noisePeriod, m_noiseDuration));
+    }
+    return;
+  }
+  if (!m_tracks) {
+    CalibAlg::setCalibParams(calibParams);
+    return;
+  }
+  m_trackPatternFile = calibParams;
+}
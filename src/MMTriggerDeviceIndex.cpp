@@ -0,0 +1,72 @@
+#include "NSWCalibration/MMTriggerDeviceIndex.h"
+
+#include <ers/ers.h>
+
+#include <fmt/core.h>
+
+#include "NSWConfiguration/hw/ADDC.h"
+#include "NSWConfiguration/hw/FEB.h"
+
+nsw::MMTriggerDeviceIndex::MMTriggerDeviceIndex(const hw::DeviceManager& deviceManager)
+{
+  for (const auto& feb : deviceManager.getFebs()) {
+    const auto& address = feb.getScaAddress();
+    m_febsByAddress.emplace(address, &feb);
+    const auto [duplicate, inserted] = m_febsByGeoName.emplace(geoNameOf(address), &feb);
+    if (not inserted) {
+      ERS_LOG(fmt::format("{} and {} have the same geo name, using the first",
+                          duplicate->second->getScaAddress(), address));
+    }
+  }
+  for (const auto& addc : deviceManager.getAddcs()) {
+    m_addcs.push_back(&addc);
+  }
+}
+
+std::string nsw::MMTriggerDeviceIndex::geoNameOf(const std::string& address)
+{
+  const auto last = address.rfind('/');
+  if (last == std::string::npos or last == 0) {
+    return address;
+  }
+  const auto previous = address.rfind('/', last - 1);
+  return previous == std::string::npos ? address : address.substr(previous + 1);
+}
+
+const nsw::hw::FEB* nsw::MMTriggerDeviceIndex::findFeb(const std::string& name, const std::string& geoName) const
+{
+  const auto byAddress = m_febsByAddress.find(name);
+  if (byAddress != std::cend(m_febsByAddress)) {
+    return byAddress->second;
+  }
+  if (not geoName.empty()) {
+    const auto byGeoName = m_febsByGeoName.find(geoName);
+    if (byGeoName != std::cend(m_febsByGeoName)) {
+      return byGeoName->second;
+    }
+  }
+  return nullptr;
+}
+
+std::vector<const nsw::hw::ADDC*> nsw::MMTriggerDeviceIndex::findAddcs(const std::string& nameOld,
+                                                                     const std::string& nameGeo) const
+{
+  if (nameOld.empty() or nameGeo.empty()) {
+    return m_addcs;
+  }
+
+  std::scoped_lock lock(m_mutex);
+  const auto cached = m_addcSearches.find(nameOld + "|" + nameGeo);
+  if (cached != std::cend(m_addcSearches)) {
+    return cached->second;
+  }
+  std::vector<const hw::ADDC*> addcs{};
+  for (const auto* addc : m_addcs) {
+    const auto& address = addc->getScaAddress();
+    if (address == nameOld or address.find(nameGeo) != std::string::npos) {
+      addcs.push_back(addc);
+    }
+  }
+  m_addcSearches.emplace(nameOld + "|" + nameGeo, addcs);
+  return addcs;
+}
@@ -0,0 +1,417 @@
+#include "NSWCalibration/MMTriggerPlan.h"
+
+#include <algorithm>
+#include <bit>
+#include <cctype>
+#include <fstream>
+#include <functional>
+#include <map>
+#include <numeric>
+#include <stdexcept>
+#include <string_view>
+
+#include <fmt/core.h>
+
+using boost::property_tree::ptree;
+
+namespace {
+  constexpr std::string_view PATTERN_PREFIX{"pattern_"};
+  constexpr std::string_view FEBPATTERN_PREFIX{"febpattern_"};
+
+  bool startsWith(const std::string& str, const std::string_view prefix) {
+    return str.rfind(prefix, 0) == 0;
+  }
+
+  std::size_t patternNumber(const std::string& key) {
+    const auto number = key.substr(std::min(key.size(), PATTERN_PREFIX.size()));
+    if (not startsWith(key, PATTERN_PREFIX) or number.empty() or
+        not std::all_of(std::cbegin(number), std::cend(number), [](const char c) { return std::isdigit(c) != 0; })) {
+      throw std::runtime_error(fmt::format("Unexpected key {} in pattern file", key));
+    }
+    return std::stoul(number);
+  }
+
+  /**
+   * \brief Shares the MMFE8 pattern sets between iterations
+   *
+   * A set is shared if it has the same name and content as a previous one,
+   * so that files reusing the names in every pattern are still read right.
+   */
+  class SetCache {
+  public:
+    std::shared_ptr<const nsw::mmtrigger::FebPatternSet> get(nsw::mmtrigger::FebPatternSet set) {
+      auto& candidates = m_sets[{set.name, hash(set)}];
+      for (const auto& candidate : candidates) {
+        if (*candidate == set) {
+          return candidate;
+        }
+      }
+      return candidates.emplace_back(std::make_shared<const nsw::mmtrigger::FebPatternSet>(std::move(set)));
+    }
+
+  private:
+    static std::size_t hash(const nsw::mmtrigger::FebPatternSet& set) {
+      std::size_t result{set.febs.size()};
+      const auto combine = [&result](const std::size_t value) {
+        result ^= value + 0x9e3779b97f4a7c15 + (result << 6) + (result >> 2);
+      };
+      for (const auto& feb : set.febs) {
+        combine(std::hash<std::string>{}(feb.name));
+        for (const auto mask : feb.channels) {
+          combine(std::hash<std::uint64_t>{}(mask));
+        }
+      }
+      return result;
+    }
+
+    std::map<std::pair<std::string, std::size_t>,
+             std::vector<std::shared_ptr<const nsw::mmtrigger::FebPatternSet>>> m_sets{};
+  };
+
+  /**
+   * \brief Minimal pull parser of json, reading one character at a time
+   *
+   * Objects and arrays are walked with callbacks, and scalars (strings,
+   * numbers, literals) are returned as strings, so that numbers can be
+   * given either way.
+   */
+  class JsonReader {
+  public:
+    explicit JsonReader(std::istream& stream) : m_stream{stream} {}
+
+    /// Read an object, calling \c callback with each key. It must read the value.
+    template<typename Callback>
+    void forEachMember(Callback&& callback) {
+      expect('{');
+      if (peek() == '}') {
+        get();
+        return;
+      }
+      while (true) {
+        if (peek() != '"') {
+          fail("expected a key");
+        }
+        const auto key = readString();
+        expect(':');
+        callback(key);
+        if (next() == '}') {
+          return;
+        }
+      }
+    }
+
+    /// Read an array, calling \c callback for each element. It must read the element.
+    template<typename Callback>
+    void forEachElement(Callback&& callback) {
+      expect('[');
+      if (peek() == ']') {
+        get();
+        return;
+      }
+      while (true) {
+        callback();
+        if (next() == ']') {
+          return;
+        }
+      }
+    }
+
+    std::string readScalar() {
+      if (peek() == '"') {
+        return readString();
+      }
+      std::string token{};
+      while (std::isalnum(m_stream.peek()) != 0 or m_stream.peek() == '-' or m_stream.peek() == '+' or
+             m_stream.peek() == '.') {
+        token.push_back(static_cast<char>(m_stream.get()));
+      }
+      if (token.empty()) {
+        fail("expected a value");
+      }
+      return token;
+    }
+
+    int readInt(const std::string& what) { return toInt(readScalar(), what); }
+
+    int toInt(const std::string& value, const std::string& what) {
+      try {
+        std::size_t pos{0};
+        const auto result = std::stoi(value, &pos);
+        if (pos == value.size()) {
+          return result;
+        }
+      } catch (const std::logic_error&) {
+      }
+      fail(fmt::format("{} is not an integer: {}", what, value));
+    }
+
+    void skipValue() {
+      const auto c = peek();
+      if (c == '{') {
+        forEachMember([this](const std::string&) { skipValue(); });
+      } else if (c == '[') {
+        forEachElement([this]() { skipValue(); });
+      } else {
+        readScalar();
+      }
+    }
+
+    void expectEnd() {
+      if (peek() != std::char_traits<char>::eof()) {
+        fail("unexpected content after the end");
+      }
+    }
+
+  private:
+    int peek() {
+      while (std::isspace(m_stream.peek()) != 0) {
+        if (m_stream.get() == '\n') {
+          m_line++;
+        }
+      }
+      return m_stream.peek();
+    }
+
+    int get() {
+      peek();
+      return m_stream.get();
+    }
+
+    void expect(const char expected) {
+      if (get() != expected) {
+        fail(fmt::format("expected '{}'", expected));
+      }
+    }
+
+    /// Separator after a member or element: ',' or the closing bracket
+    int next() {
+      const auto c = get();
+      if (c != ',' and c != '}' and c != ']') {
+        fail("expected ',' or a closing bracket");
+      }
+      return c;
+    }
+
+    std::string readString() {
+      expect('"');
+      std::string result{};
+      while (true) {
+        auto c = m_stream.get();
+        if (c == std::char_traits<char>::eof() or c == '\n') {
+          fail("unterminated string");
+        }
+        if (c == '"') {
+          return result;
+        }
+        if (c == '\\') {
+          c = m_stream.get();
+          switch (c) {
+            case 'b': c = '\b'; break;
+            case 'f': c = '\f'; break;
+            case 'n': c = '\n'; break;
+            case 'r': c = '\r'; break;
+            case 't': c = '\t'; break;
+            case '"': case '\\': case '/': break;
+            default: fail("unsupported escape sequence in string");
+          }
+        }
+        result.push_back(static_cast<char>(c));
+      }
+    }
+
+    [[noreturn]] void fail(const std::string& message) const {
+      throw std::runtime_error(fmt::format("Invalid pattern file, line {}: {}", m_line, message));
+    }
+
+    std::istream& m_stream;
+    std::size_t m_line{1};
+  };
+}  // namespace
+
+void nsw::mmtrigger::FebPattern::addChannel(const std::size_t vmm, const std::size_t channel) {
+  if (vmm >= channels.size() or channel >= nsw::vmm::NUM_CH_PER_VMM) {
+    throw std::runtime_error(fmt::format("Invalid VMM {} channel {} in pattern of {}", vmm, channel, name));
+  }
+  channels.at(vmm) |= (std::uint64_t{1} << channel);
+}
+
+bool nsw::mmtrigger::FebPattern::hasChannel(const std::size_t vmm, const std::size_t channel) const {
+  return ((channels.at(vmm) >> channel) & std::uint64_t{1}) != 0;
+}
+
+std::vector<std::size_t> nsw::mmtrigger::FebPattern::getChannels(const std::size_t vmm) const {
+  std::vector<std::size_t> result{};
+  for (std::size_t channel = 0; channel < nsw::vmm::NUM_CH_PER_VMM; channel++) {
+    if (hasChannel(vmm, channel)) {
+      result.push_back(channel);
+    }
+  }
+  return result;
+}
+
+std::size_t nsw::mmtrigger::FebPattern::countChannels() const {
+  return std::accumulate(std::cbegin(channels), std::cend(channels), std::size_t{0},
+                         [](const std::size_t sum, const std::uint64_t mask) {
+                           return sum + static_cast<std::size_t>(std::popcount(mask));
+                         });
+}
+
+std::size_t nsw::mmtrigger::FebPatternSet::countChannels() const {
+  return std::accumulate(std::cbegin(febs), std::cend(febs), std::size_t{0},
+                         [](const std::size_t sum, const FebPattern& feb) { return sum + feb.countChannels(); });
+}
+
+ptree nsw::mmtrigger::toPtree(const Plan& plan) {
+  ptree patts;
+  for (std::size_t ipatt = 0; ipatt < plan.size(); ipatt++) {
+    const auto& iteration = plan.at(ipatt);
+    ptree top_patt;
+    if (not iteration.addcOld.empty()) {
+      top_patt.put("addc_old", iteration.addcOld);
+    }
+    if (not iteration.addcGeo.empty()) {
+      top_patt.put("addc_geo", iteration.addcGeo);
+    }
+    top_patt.put("tp_latency", iteration.tpLatency);
+    top_patt.put("art_input_phase", iteration.artInputPhase);
+    for (const auto& set : iteration.febPatterns) {
+      ptree feb_patt;
+      for (const auto& feb : set->febs) {
+        ptree febtree;
+        for (std::size_t vmmid = 0; vmmid < feb.channels.size(); vmmid++) {
+          // a vector of channels per VMM
+          ptree vmmtree;
+          for (const auto chan : feb.getChannels(vmmid)) {
+            ptree chantree;
+            chantree.put("", chan);
+            vmmtree.push_back(std::make_pair("", chantree));
+          }
+          if (not vmmtree.empty()) {
+            febtree.add_child(std::to_string(vmmid), vmmtree);
+          }
+        }
+        if (not feb.geoName.empty()) {
+          febtree.put("geo_name", feb.geoName);
+        }
+        feb_patt.add_child(feb.name, febtree);
+      }
+      top_patt.add_child(set->name, feb_patt);
+    }
+    patts.add_child(fmt::format("{}{}", PATTERN_PREFIX, ipatt), top_patt);
+  }
+  return patts;
+}
+
+nsw::mmtrigger::Plan nsw::mmtrigger::fromPtree(const ptree& tree) {
+  Plan plan(tree.size());
+  std::vector<bool> found(tree.size(), false);
+  SetCache sets{};
+
+  for (const auto& [patternName, top_patt] : tree) {
+    const auto ipatt = patternNumber(patternName);
+    if (ipatt >= plan.size() or found.at(ipatt)) {
+      throw std::runtime_error(fmt::format("Pattern numbers must be unique and between 0 and {}, found {}",
+                                           plan.size() - 1, patternName));
+    }
+    found.at(ipatt) = true;
+
+    auto& iteration = plan.at(ipatt);
+    iteration.tpLatency = top_patt.get<int>("tp_latency", -1);
+    iteration.artInputPhase = top_patt.get<int>("art_input_phase", -1);
+    iteration.addcOld = top_patt.get<std::string>("addc_old", "");
+    iteration.addcGeo = top_patt.get<std::string>("addc_geo", "");
+    for (const auto& [setName, feb_patt] : top_patt) {
+      if (not startsWith(setName, FEBPATTERN_PREFIX)) {
+        continue;
+      }
+      FebPatternSet set{};
+      set.name = setName;
+      for (const auto& [febName, febtree] : feb_patt) {
+        FebPattern feb{};
+        feb.name = febName;
+        feb.geoName = febtree.get<std::string>("geo_name", "");
+        for (const auto& [vmm, vmmtree] : febtree) {
+          if (vmm == "geo_name") {
+            continue;
+          }
+          for (const auto& chkv : vmmtree) {
+            feb.addChannel(std::stoul(vmm), chkv.second.get_value<std::size_t>());
+          }
+        }
+        set.febs.push_back(std::move(feb));
+      }
+      iteration.febPatterns.push_back(sets.get(std::move(set)));
+    }
+  }
+  return plan;
+}
+
+nsw::mmtrigger::Plan nsw::mmtrigger::readPlan(std::istream& stream) {
+  JsonReader json{stream};
+  std::map<std::size_t, Iteration> iterations{};
+  SetCache sets{};
+
+  json.forEachMember([&](const std::string& patternName) {
+    const auto ipatt = patternNumber(patternName);
+    Iteration iteration{};
+    json.forEachMember([&](const std::string& key) {
+      if (key == "tp_latency") {
+        iteration.tpLatency = json.readInt(key);
+      } else if (key == "art_input_phase") {
+        iteration.artInputPhase = json.readInt(key);
+      } else if (key == "addc_old") {
+        iteration.addcOld = json.readScalar();
+      } else if (key == "addc_geo") {
+        iteration.addcGeo = json.readScalar();
+      } else if (startsWith(key, FEBPATTERN_PREFIX)) {
+        FebPatternSet set{};
+        set.name = key;
+        json.forEachMember([&](const std::string& febName) {
+          FebPattern feb{};
+          feb.name = febName;
+          json.forEachMember([&](const std::string& vmm) {
+            if (vmm == "geo_name") {
+              feb.geoName = json.readScalar();
+              return;
+            }
+            const auto vmmid = static_cast<std::size_t>(json.toInt(vmm, "VMM"));
+            json.forEachElement([&]() {
+              feb.addChannel(vmmid, static_cast<std::size_t>(json.readInt("channel")));
+            });
+          });
+          set.febs.push_back(std::move(feb));
+        });
+        iteration.febPatterns.push_back(sets.get(std::move(set)));
+      } else {
+        json.skipValue();
+      }
+    });
+    if (not iterations.emplace(ipatt, std::move(iteration)).second) {
+      throw std::runtime_error(fmt::format("Pattern numbers must be unique, found {} twice", patternName));
+    }
+  });
+  json.expectEnd();
+
+  Plan plan{};
+  plan.reserve(iterations.size());
+  for (auto& [ipatt, iteration] : iterations) {
+    if (ipatt != plan.size()) {
+      throw std::runtime_error(fmt::format("Pattern numbers must be between 0 and {}, found {}{}",
+                                           iterations.size() - 1, PATTERN_PREFIX, ipatt));
+    }
+    plan.push_back(std::move(iteration));
+  }
+  return plan;
+}
+
+nsw::mmtrigger::Plan nsw::mmtrigger::readPlan(const std::string& filename) {
+  std::ifstream stream{filename};
+  if (not stream) {
+    throw std::runtime_error(fmt::format("Cannot open pattern file {}", filename));
+  }
+  try {
+    return readPlan(stream);
+  } catch (const std::runtime_error& ex) {
+    throw std::runtime_error(fmt::format("{}: {}", filename, ex.what()));
+  }
+}
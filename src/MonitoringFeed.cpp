@@ -0,0 +1,205 @@
+#include "NSWCalibration/MonitoringFeed.h"
+
+#include <algorithm>
+#include <bit>
+#include <chrono>
+#include <cstring>
+#include <stdexcept>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <fmt/core.h>
+
+namespace {
+  std::size_t feedSize(const std::uint32_t capacity) {
+    return sizeof(nsw::monitoring::Header) + capacity * sizeof(nsw::monitoring::Record);
+  }
+
+  std::runtime_error systemError(const std::string& what, const std::string& name) {
+    return std::runtime_error(fmt::format("Monitoring feed {}: {} failed: {}", name, what, std::strerror(errno)));
+  }
+}  // namespace
+
+std::string nsw::monitoring::sharedMemoryName(const std::string& name) {
+  auto result = name;
+  std::replace(std::begin(result), std::end(result), '/', '_');
+  return "/" + result;
+}
+
+std::vector<float> nsw::monitoring::Reading::rates() const {
+  std::vector<float> result{};
+  for (const auto word : data) {
+    result.push_back(std::bit_cast<float>(word));
+  }
+  return result;
+}
+
+nsw::MonitoringFeed::MonitoringFeed(const std::string& name, const std::uint32_t capacity) :
+  m_name{monitoring::sharedMemoryName(name)}, m_size{feedSize(capacity)}
+{
+  if (capacity == 0) {
+    throw std::runtime_error(fmt::format("Monitoring feed {}: the capacity must not be 0", m_name));
+  }
+  m_fd = shm_open(m_name.c_str(), O_CREAT | O_RDWR, S_IRUSR | S_IWUSR | S_IRGRP | S_IROTH);
+  if (m_fd < 0) {
+    throw systemError("shm_open", m_name);
+  }
+  if (ftruncate(m_fd, static_cast<off_t>(m_size)) != 0) {
+    close(m_fd);
+    throw systemError("ftruncate", m_name);
+  }
+  void* memory = mmap(nullptr, m_size, PROT_READ | PROT_WRITE, MAP_SHARED, m_fd, 0);
+  if (memory == MAP_FAILED) {
+    close(m_fd);
+    throw systemError("mmap", m_name);
+  }
+
+  // readers only trust the header once the magic number is set
+  std::memset(memory, 0, m_size);
+  m_header = static_cast<monitoring::Header*>(memory);
+  m_records = reinterpret_cast<monitoring::Record*>(static_cast<char*>(memory) + sizeof(monitoring::Header));
+  m_header->version = monitoring::VERSION;
+  m_header->recordSize = static_cast<std::uint16_t>(sizeof(monitoring::Record));
+  m_header->capacity = capacity;
+  m_header->written.store(0, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+  m_header->magic = monitoring::MAGIC;
+}
+
+nsw::MonitoringFeed::~MonitoringFeed() {
+  munmap(m_header, m_size);
+  close(m_fd);
+}
+
+void nsw::MonitoringFeed::publishArtRates(const std::string& source, const std::span<const double> rates) {
+  std::array<std::uint32_t, monitoring::DATA_SIZE> data{};
+  if (rates.size() > data.size()) {
+    throw std::runtime_error(fmt::format("{}: {} ART rates do not fit in a monitoring record of {} words",
+                                         source, rates.size(), data.size()));
+  }
+  const auto size = rates.size();
+  for (std::size_t index = 0; index < size; index++) {
+    data.at(index) = std::bit_cast<std::uint32_t>(static_cast<float>(rates[index]));
+  }
+  publish(monitoring::Kind::ArtRates, source, std::span{data}.first(size));
+}
+
+void nsw::MonitoringFeed::publishTpAlignment(const std::string& source,
+                                             const std::uint32_t alignment,
+                                             const std::span<const std::uint8_t> bcids) {
+  std::array<std::uint32_t, monitoring::DATA_SIZE> data{};
+  if (bcids.size() + 1 > data.size()) {
+    throw std::runtime_error(fmt::format("{}: alignment and {} fiber BCIDs do not fit in a monitoring record of {} words",
+                                         source, bcids.size(), data.size()));
+  }
+  data.at(0) = alignment;
+  const auto size = bcids.size() + 1;
+  for (std::size_t index = 1; index < size; index++) {
+    data.at(index) = bcids[index - 1];
+  }
+  publish(monitoring::Kind::TpAlignment, source, std::span{data}.first(size));
+}
+
+void nsw::MonitoringFeed::publish(const monitoring::Kind kind,
+                                  const std::string& source,
+                                  const std::span<const std::uint32_t> data) {
+  const auto index = m_header->written.load(std::memory_order_relaxed);
+  auto& record = m_records[index % m_header->capacity];
+
+  // odd sequence: the record is being written
+  record.sequence.store(2 * index + 1, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+
+  record.time = static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+    std::chrono::system_clock::now().time_since_epoch()).count());
+  record.kind = kind;
+  record.size = static_cast<std::uint32_t>(data.size());
+  record.source.fill('\0');
+  source.copy(record.source.data(), record.source.size() - 1);
+  record.data.fill(0);
+  std::copy(std::cbegin(data), std::cend(data), std::begin(record.data));
+
+  record.sequence.store(2 * index + 2, std::memory_order_release);
+  m_header->written.store(index + 1, std::memory_order_release);
+}
+
+nsw::MonitoringFeedReader::MonitoringFeedReader(const std::string& name) {
+  const auto shmName = monitoring::sharedMemoryName(name);
+  m_fd = shm_open(shmName.c_str(), O_RDONLY, 0);
+  if (m_fd < 0) {
+    throw systemError("shm_open", shmName);
+  }
+  struct stat status{};
+  if (fstat(m_fd, &status) != 0) {
+    close(m_fd);
+    throw systemError("fstat", shmName);
+  }
+  m_size = static_cast<std::size_t>(status.st_size);
+  if (m_size < sizeof(monitoring::Header)) {
+    close(m_fd);
+    throw std::runtime_error(fmt::format("Monitoring feed {} is not initialized", shmName));
+  }
+  void* memory = mmap(nullptr, m_size, PROT_READ, MAP_SHARED, m_fd, 0);
+  if (memory == MAP_FAILED) {
+    close(m_fd);
+    throw systemError("mmap", shmName);
+  }
+  m_header = static_cast<const monitoring::Header*>(memory);
+  m_records = reinterpret_cast<const monitoring::Record*>(static_cast<const char*>(memory) + sizeof(monitoring::Header));
+  if (m_header->magic != monitoring::MAGIC or m_header->version != monitoring::VERSION or
+      m_header->recordSize != sizeof(monitoring::Record) or m_size < feedSize(m_header->capacity)) {
+    munmap(memory, m_size);
+    close(m_fd);
+    throw std::runtime_error(fmt::format("{} is not a monitoring feed of version {}", shmName, monitoring::VERSION));
+  }
+}
+
+nsw::MonitoringFeedReader::~MonitoringFeedReader() {
+  munmap(const_cast<monitoring::Header*>(m_header), m_size);
+  close(m_fd);
+}
+
+std::vector<nsw::monitoring::Reading> nsw::MonitoringFeedReader::poll() {
+  const auto written = m_header->written.load(std::memory_order_acquire);
+  const auto capacity = m_header->capacity;
+
+  // the writer was restarted
+  if (written < m_next) {
+    m_next = 0;
+  }
+  // the oldest records were overwritten
+  if (written - m_next > capacity) {
+    m_lost += written - capacity - m_next;
+    m_next = written - capacity;
+  }
+
+  std::vector<monitoring::Reading> readings{};
+  for (; m_next < written; m_next++) {
+    const auto& record = m_records[m_next % capacity];
+    const auto expected = 2 * m_next + 2;
+    if (record.sequence.load(std::memory_order_acquire) != expected) {
+      m_lost++;
+      continue;
+    }
+    monitoring::Reading reading{};
+    reading.index = m_next;
+    reading.time = record.time;
+    reading.kind = record.kind;
+    const auto end = std::find(std::cbegin(record.source), std::cend(record.source), '\0');
+    reading.source.assign(std::cbegin(record.source), end);
+    const auto size = std::min<std::size_t>(record.size, record.data.size());
+    reading.data.assign(std::cbegin(record.data), std::cbegin(record.data) + static_cast<std::ptrdiff_t>(size));
+
+    // the writer may have started to overwrite the record during the copy
+    std::atomic_thread_fence(std::memory_order_acquire);
+    if (record.sequence.load(std::memory_order_relaxed) != expected) {
+      m_lost++;
+      continue;
+    }
+    readings.push_back(std::move(reading));
+  }
+  return readings;
+}
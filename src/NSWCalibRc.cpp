@@ -1,5 +1,6 @@
 #include "NSWCalibration/NSWCalibRc.h"
 
+#include <algorithm>
 #include <thread>
 
 #include <RunControl/Common/OnlineServices.h>
@@ -14,30 +15,11 @@
 
 #include <fmt/core.h>
 
+#include "NSWCalibration/CalibAlgFactory.h"
 #include "NSWCalibration/Commands.h"
 #include "NSWCalibration/Issues.h"
 #include "NSWCalibration/Utility.h"
 #include "NSWCalibrationDal/NSWCalibApplication.h"
-#include "NSWCalibration/MMTriggerCalib.h"
-#include "NSWCalibration/MMTPInputPhase.h"
-#include "NSWCalibration/sTGCTriggerCalib.h"
-#include "NSWCalibration/sTGCPadVMMTDSChannels.h"
-#include "NSWCalibration/sTGCStripsTriggerCalib.h"
-#include "NSWCalibration/sTGCSFEBToRouter.h"
-#include "NSWCalibration/sTGCPadTriggerToSFEB.h"
-#include "NSWCalibration/sTGCPadTriggerInputDelays.h"
-#include "NSWCalibration/sTGCPadsControlPhase.h"
-#include "NSWCalibration/sTGCPadsL1DDCFibers.h"
-#include "NSWCalibration/sTGCPadsRocTds40Mhz.h"
-#include "NSWCalibration/sTGCPadsHitRateL1a.h"
-#include "NSWCalibration/sTGCPadsHitRateSca.h"
-#include "NSWCalibration/sTGCPadTdsBcidOffset.h"
-#include "NSWCalibration/THRCalib.h"
-#include "NSWCalibration/PDOCalib.h"
-#include "NSWCalibration/RocPhaseCalibrationBase.h"
-#include "NSWCalibration/RocPhase40MhzCore.h"
-#include "NSWCalibration/RocPhase160MhzCore.h"
-#include "NSWCalibration/RocPhase160MhzVmm.h"
 #include "NSWConfiguration/NSWConfig.h"
 
 #include "NSWConfiguration/NSWConfig.h"
@@ -54,7 +36,6 @@ nsw::NSWCalibRc::NSWCalibRc(bool simulation):m_simulation {simulation} {
     }
     Log::initializeLogging();
     initializeOpen62541LogIt(Log::ERR);
-
 }
 
 void nsw::NSWCalibRc::configure(const daq::rc::TransitionCmd&) {
@@ -81,6 +62,10 @@ void nsw::NSWCalibRc::configure(const daq::rc::TransitionCmd&) {
 
     // Get the IS dictionary for the current partition
     is_dictionary = std::make_unique<ISInfoDictionary>(m_ipcpartition);
+
+    // Get notified of the handshake values instead of polling them
+    m_isReceiver = std::make_unique<ISInfoReceiver>(m_ipcpartition);
+    subscribeHandshake(m_calibCounter_readback);
     std::string g_calibration_type="";
     std::string g_info_server_name="";
     const std::string stateInfoName = g_info_server_name + ".CurrentCalibState";
@@ -131,6 +116,7 @@ void nsw::NSWCalibRc::disconnect(const daq::rc::TransitionCmd&) {
 
 void nsw::NSWCalibRc::unconfigure(const daq::rc::TransitionCmd&) {
     ERS_INFO("Start");
+    unsubscribeHandshakes();
     ERS_INFO("End");
 }
 
@@ -142,27 +128,72 @@ void nsw::NSWCalibRc::stopRecording(const daq::rc::TransitionCmd&) {
 
 void nsw::NSWCalibRc::user(const daq::rc::UserCmd& usrCmd) {
   ERS_LOG("User command received: " << usrCmd.commandName());
+  const auto isStep = usrCmd.commandName() == "configure" or
+                      usrCmd.commandName() == "acquire" or
+                      usrCmd.commandName() == "unconfigure";
+  if (isStep and calib->aborted()) {
+    nsw::NSWCalibIssue issue(ERS_HERE, fmt::format("Calibration was aborted, ignoring {}. Send reset to start again.",
+                                                   usrCmd.commandName()));
+    ers::warning(issue);
+    return;
+  }
   if (usrCmd.commandName() == "enableVmmCaptureInputs") {
     m_NSWConfig->enableVmmCaptureInputs();
+  } else if (usrCmd.commandName() == "abort") {
+    abortCalibration();
   } else if (usrCmd.commandName() == "configure") {
-    publish4swrod();
-    calib->progressbar();
-    calib->setCalibKeyToIS(*is_dictionary);
-    calib->configure();
+    runStep([this]() {
+      publish4swrod();
+      calib->progressbar();
+      calib->setCalibKeyToIS(*is_dictionary);
+      calib->configure();
+    });
   } else if (usrCmd.commandName() == "acquire") {
-    calib->acquire();
+    runStep([this]() { calib->acquire(); });
   } else if (usrCmd.commandName() == "unconfigure") {
-    calib->unconfigure();
-    calib->next();
+    runStep([this]() {
+      calib->unconfigure();
+      calib->next();
+      calib->checkpoint();
+    });
   } else if (usrCmd.commandName() == "reset") {
-    calib->setCounter(0);
-    calib->setCurrentRunParameters(runParamsFromIS());
+    runStep([this]() {
+      calib->restart();
+      calib->setCurrentRunParameters(runParamsFromIS());
+      is_dictionary->checkin(m_startIteration, ISInfoUnsignedLong(calib->counter()));
+    });
+  } else if (usrCmd.commandName() == "resume") {
+    // continue a calibration interrupted by a crash of the application,
+    // the orchestrator restarts its loop from m_startIteration
+    runStep([this]() {
+      calib->setCurrentRunParameters(runParamsFromIS());
+      calib->resume();
+      is_dictionary->checkin(m_startIteration, ISInfoUnsignedLong(calib->counter()));
+    });
   } else {
     nsw::NSWCalibIssue issue(ERS_HERE, fmt::format("Unrecognized UserCmd specified {}", usrCmd.commandName()));
     ers::warning(issue);
   }
 }
 
+void nsw::NSWCalibRc::runStep(const std::function<void()>& step) {
+  try {
+    step();
+  } catch (const nsw::calib::Aborted& ex) {
+    // the step stopped: the output files can be closed safely
+    calib->closeOutputs();
+    ers::warning(ex);
+  }
+}
+
+void nsw::NSWCalibRc::abortCalibration() {
+  if (not calib) {
+    return;
+  }
+  ERS_INFO(fmt::format("Aborting {} at iteration {}", m_calibType, calib->counter()));
+  calib->abort();
+}
+
 void nsw::NSWCalibRc::subTransition(const daq::rc::SubTransitionCmd& cmd) {
     auto main_transition = cmd.mainTransitionCmd();
     auto sub_transition = cmd.subTransition();
@@ -212,73 +243,18 @@ void nsw::NSWCalibRc::handler() {
   // create calib object
   calib.reset();
   m_calibType = calibTypeFromIS();
-  if (m_calibType=="MMARTConnectivityTest" ||
-      m_calibType=="MMARTConnectivityTestAllChannels" ||
-      m_calibType=="MMCableNoise" ||
-      m_calibType=="MMARTPhase" ||
-      m_calibType=="MML1ALatency" ||
-      m_calibType=="MMStaircase") {
-    calib = std::make_unique<MMTriggerCalib>(m_calibType, deviceManager);
-  } else if (m_calibType=="MMTrackPulserTest") {
-    calib = std::make_unique<MMTriggerCalib>(m_calibType, deviceManager);
-  } else if (m_calibType=="MMTPInputPhase" ||
-             m_calibType=="MMTPInputPhase_PhaseOnly" ||
-             m_calibType=="MMTPInputPhase_Validation" 
-             ) {
-    // MMTPInputPhase Phase x AddcOffset 8x8
-    // MMTPInputPhase_PhaseOnly  scan 8 phase, ADDC offset = 0, L1DDC offset = 0.
-    // MMTPInputPhase_Validation scan 8 phase, leave the other two phases as in json
-    calib = std::make_unique<MMTPInputPhase>(m_calibType, deviceManager);
-  } else if (m_calibType=="sTGCPadConnectivity" ||
-             m_calibType=="sTGCPadConnectivitySca" ||
-             m_calibType=="sTGCPadLatency") {
-    calib = std::make_unique<sTGCTriggerCalib>(m_calibType, deviceManager);
-  } else if (m_calibType=="sTGCPadVMMTDSChannels") {
-    calib = std::make_unique<sTGCPadVMMTDSChannels>(m_calibType, deviceManager);
-  } else if (m_calibType=="sTGCSFEBToRouter"   ||
-             m_calibType=="sTGCSFEBToRouterQ1" ||
-             m_calibType=="sTGCSFEBToRouterQ2" ||
-             m_calibType=="sTGCSFEBToRouterQ3") {
-    calib = std::make_unique<sTGCSFEBToRouter>(m_calibType, deviceManager);
-  } else if (m_calibType=="sTGCPadTriggerToSFEB") {
-    calib = std::make_unique<sTGCPadTriggerToSFEB>(m_calibType, deviceManager);
-  } else if (m_calibType=="sTGCPadTriggerInputDelays") {
-    calib = std::make_unique<sTGCPadTriggerInputDelays>(m_calibType, deviceManager);
-  } else if (m_calibType=="sTGCStripConnectivity") {
-    calib = std::make_unique<sTGCStripsTriggerCalib>(m_calibType, deviceManager);
-  } else if (m_calibType=="sTGCPadsControlPhase") {
-    calib = std::make_unique<sTGCPadsControlPhase>(m_calibType, deviceManager);
-  } else if (m_calibType=="sTGCPadsL1DDCFibers") {
-    calib = std::make_unique<sTGCPadsL1DDCFibers>(m_calibType, deviceManager);
-  } else if (m_calibType=="sTGCPadsRocTds40Mhz") {
-    calib = std::make_unique<sTGCPadsRocTds40Mhz>(m_calibType, deviceManager);
-  } else if (m_calibType == "sTGCPadsHitRateL1a") {
-    calib = std::make_unique<sTGCPadsHitRateL1a>(m_calibType, deviceManager);
-  } else if (m_calibType == "sTGCPadsHitRateSca") {
-    calib = std::make_unique<sTGCPadsHitRateSca>(m_calibType, deviceManager);
-  } else if (m_calibType == "sTGCPadTdsBcidOffset") {
-    calib = std::make_unique<sTGCPadTdsBcidOffset>(m_calibType, deviceManager);
-  } else if (m_calibType=="THRCalib"){
-    calib = std::make_unique<THRCalib>(m_calibType, deviceManager);
-  } else if (m_calibType=="PDOCalib" ||
-             m_calibType=="TDOCalib"){
-    calib = std::make_unique<PDOCalib>(m_calibType, deviceManager);
-  } else if (m_calibType=="RocPhase40MHzCore") {
-    calib = std::make_unique<RocPhaseCalibrationBase<RocPhase40MhzCore>>(m_calibType, deviceManager);
-  } else if (m_calibType == "RocPhase160MHzCore") {
-    calib = std::make_unique<RocPhaseCalibrationBase<RocPhase160MhzCore>>(m_calibType, deviceManager);
-  } else if (m_calibType == "RocPhase160MHzVmm") {
-    calib = std::make_unique<RocPhaseCalibrationBase<RocPhase160MhzVmm>>(m_calibType, deviceManager);
-  } else {
-    std::string msg = "Unknown calibration request: " + m_calibType;
-    nsw::NSWCalibIssue issue(ERS_HERE, msg);
+  try {
+    calib = nsw::makeCalibAlg(m_calibType, deviceManager);
+  } catch (const std::runtime_error& ex) {
+    nsw::NSWCalibIssue issue(ERS_HERE, ex.what());
     ers::error(issue);
-    throw std::runtime_error(msg);
+    throw;
   }
 
   // setup
   // FIXME: Alex will remove it in another MR
   calib->setApplicationName(m_appname);
+  calib->setOutputPath(m_nswApp->get_CalibOutput());
   calib->setSimulation(m_simulation);
   calib->setCalibParamsFromIS(*is_dictionary, m_is_db_name);
   calib->setup(m_dbcon);
@@ -304,23 +280,100 @@ void nsw::NSWCalibRc::publish4swrod() {
 
 void nsw::NSWCalibRc::wait4swrod() {
   if (calib->wait4swrod()) {
-    ISInfoInt counter(-1);
     ERS_INFO("calib waiting for swROD...");
-    std::size_t           attempt_i    = 0;
-    constexpr std::size_t attempts_max = 5;
-    while (counter.getValue() != calib->counter()) {
-      try {
-        is_dictionary->getValue(m_calibCounter_readback, counter);
-      } catch (daq::is::Exception& ex) {
-        ers::error(ex);
-      }
-      ERS_INFO("calib waiting for swROD, attempt " << attempt_i);
-      nsw::snooze();
-      attempt_i++;
-      if (attempt_i >= attempts_max)
-        throw std::runtime_error("Waiting for swROD failed");
+    const auto expected = static_cast<int>(calib->counter());
+    const auto start = std::chrono::steady_clock::now();
+    if (not waitForHandshake(m_calibCounter_readback, expected, SWROD_TIMEOUT)) {
+      throw std::runtime_error("Waiting for swROD failed");
+    }
+    const auto latency = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - start);
+    ERS_LOG(fmt::format("swROD handshake for iteration {} took {:.1f} ms", expected, latency.count()));
+    try {
+      is_dictionary->checkin(m_handshakeLatency, ISInfoFloat(latency.count()));
+    } catch (daq::is::Exception& ex) {
+      ers::warning(ex);
+    }
+  }
+}
+
+void nsw::NSWCalibRc::subscribeHandshake(const std::string& name) {
+  try {
+    m_isReceiver->subscribe(name, &nsw::NSWCalibRc::handshakeCallback, this);
+    m_handshakeSubscriptions.push_back(name);
+  } catch (daq::is::Exception& ex) {
+    nsw::NSWCalibIssue issue(ERS_HERE, fmt::format("Cannot subscribe to {}, IS will be polled instead", name), ex);
+    ers::warning(issue);
+  }
+}
+
+void nsw::NSWCalibRc::unsubscribeHandshakes() {
+  for (const auto& name : m_handshakeSubscriptions) {
+    try {
+      m_isReceiver->unsubscribe(name, true);
+    } catch (daq::is::Exception& ex) {
+      ers::warning(ex);
+    }
+  }
+  m_handshakeSubscriptions.clear();
+  std::scoped_lock lock(m_handshakeMutex);
+  m_handshakeValues.clear();
+}
+
+void nsw::NSWCalibRc::handshakeCallback(ISCallbackInfo* isc) {
+  if (isc->reason() == is::Deleted) {
+    return;
+  }
+  ISInfoInt value(-1);
+  isc->value(value);
+  {
+    std::scoped_lock lock(m_handshakeMutex);
+    m_handshakeValues[isc->name()] = value.getValue();
+  }
+  m_handshakeCondition.notify_all();
+}
+
+void nsw::NSWCalibRc::readHandshake(const std::string& name) {
+  ISInfoInt value(-1);
+  try {
+    is_dictionary->getValue(name, value);
+  } catch (daq::is::Exception& ex) {
+    ers::error(ex);
+    return;
+  }
+  std::scoped_lock lock(m_handshakeMutex);
+  m_handshakeValues[name] = value.getValue();
+}
+
+bool nsw::NSWCalibRc::waitForHandshake(const std::string& name,
+                                       const int expected,
+                                       const std::chrono::milliseconds timeout) {
+  const auto deadline = std::chrono::steady_clock::now() + timeout;
+  const auto subscribed = std::find(std::cbegin(m_handshakeSubscriptions),
+                                    std::cend(m_handshakeSubscriptions),
+                                    name) != std::cend(m_handshakeSubscriptions);
+  const auto arrived = [this, &name, expected]() {
+    const auto value = m_handshakeValues.find(name);
+    return value != std::cend(m_handshakeValues) and value->second == expected;
+  };
+
+  // the value may have been published before the subscription was made
+  readHandshake(name);
+
+  std::unique_lock lock(m_handshakeMutex);
+  while (not arrived()) {
+    const auto wakeup = subscribed ?
+      deadline : std::min(deadline, std::chrono::steady_clock::now() + HANDSHAKE_POLL_INTERVAL);
+    if (m_handshakeCondition.wait_until(lock, wakeup, arrived)) {
+      return true;
+    }
+    if (std::chrono::steady_clock::now() >= deadline) {
+      return false;
     }
+    lock.unlock();
+    readHandshake(name);
+    lock.lock();
   }
+  return true;
 }
 
 std::string nsw::NSWCalibRc::calibTypeFromIS() {
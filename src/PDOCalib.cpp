@@ -100,7 +100,7 @@ void nsw::PDOCalib::acquire()
 {
   // Time to acquire data during each iteration
   ERS_INFO(fmt::format("Recording data for {}", m_trecord));
-  std::this_thread::sleep_for(m_trecord);
+  sleepFor(m_trecord);
 }
 
 void nsw::PDOCalib::unconfigure()
@@ -113,7 +113,7 @@ void nsw::PDOCalib::unconfigure()
   }
 
   // waiting for all the data to be transferred & l1a to be sent
-  std::this_thread::sleep_for(4000ms);
+  sleepFor(4000ms);
 
   const auto chanIterStop = std::chrono::high_resolution_clock::now();
   const auto chanElapsed{chanIterStop - m_chanIterStart};
@@ -320,12 +320,7 @@ void nsw::PDOCalib::setCalibParamsFromIS(const ISInfoDictionary& is_dictionary,
     const auto calibParams = calib_params_from_is.getAttributeValue<std::string>(0);
     ERS_INFO(fmt::format("Calibration parameters from IS: {}", calibParams));
 
-    const auto runParams = parseCalibParams(calibParams);
-
-    m_trecord = runParams.trecord;
-    m_numChPerGroup = runParams.channels;
-    m_calibRegs = std::move(runParams.values);
-    m_pedestalPoint = runParams.pedestalPoint;
+    setCalibParams(calibParams);
 
   } catch (const nsw::PDOParameterIssue& is) {
     std::vector<std::size_t> reg_values{};
@@ -360,9 +355,19 @@ void nsw::PDOCalib::setCalibParamsFromIS(const ISInfoDictionary& is_dictionary,
 
 }
 
+void nsw::PDOCalib::setCalibParams(const std::string& calibParams)
+{
+  auto runParams = parseCalibParams(calibParams);
+
+  m_trecord = runParams.trecord;
+  m_numChPerGroup = runParams.channels;
+  m_calibRegs = std::move(runParams.values);
+  m_pedestalPoint = runParams.pedestalPoint;
+}
+
 void nsw::PDOCalib::setCalibKeyToIS(const ISInfoDictionary& is_dictionary) {
   // write IS first before configure(), to allow concurrent IS_Publish to happen during send_pulsing_config
-  is_dictionary.checkin("Monitoring.NSWCalibration.triggerCalibrationKey", ISInfoInt((m_currentCalibReg << 12) + (m_numChPerGroup  << 6) + m_currentChannel));
+  is_dictionary.checkin(calibKeyName(), ISInfoInt((m_currentCalibReg << 12) + (m_numChPerGroup  << 6) + m_currentChannel));
 }
 
 nsw::PDOCalib::RunParameters nsw::PDOCalib::parseCalibParams(const std::string& calibParams)
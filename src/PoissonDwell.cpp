@@ -0,0 +1,75 @@
+#include "NSWCalibration/PoissonDwell.h"
+
+#include <algorithm>
+#include <cmath>
+#include <functional>
+#include <iterator>
+#include <limits>
+#include <numeric>
+#include <stdexcept>
+
+#include <fmt/core.h>
+
+nsw::PoissonDwell::PoissonDwell(const double target,
+                                const std::chrono::milliseconds minTime,
+                                const std::chrono::milliseconds maxTime) :
+  m_target{target},
+  m_minTime{minTime},
+  m_maxTime{maxTime}
+{
+  if (not(m_target > 0) or m_minTime.count() < 0 or m_maxTime < m_minTime) {
+    throw std::runtime_error(fmt::format("Invalid Poisson dwell: target {}, from {} ms to {} ms",
+                                         m_target, m_minTime.count(), m_maxTime.count()));
+  }
+}
+
+void nsw::PoissonDwell::add(const std::vector<double>& hits, const std::chrono::milliseconds elapsed)
+{
+  if (m_hits.empty()) {
+    m_hits.resize(hits.size(), 0);
+  }
+  if (hits.size() != m_hits.size()) {
+    throw std::runtime_error(fmt::format("Poisson dwell counts {} channels, got {}", m_hits.size(), hits.size()));
+  }
+  std::transform(std::cbegin(m_hits), std::cend(m_hits), std::cbegin(hits), std::begin(m_hits), std::plus{});
+  m_liveTime += elapsed;
+}
+
+void nsw::PoissonDwell::addRates(const std::vector<double>& rates, const std::chrono::milliseconds elapsed)
+{
+  const auto seconds = std::chrono::duration<double>(elapsed).count();
+  std::vector<double> hits{};
+  std::transform(std::cbegin(rates), std::cend(rates), std::back_inserter(hits),
+                 [seconds](const double rate) { return rate * seconds; });
+  add(hits, elapsed);
+}
+
+double nsw::PoissonDwell::getHits() const
+{
+  return std::accumulate(std::cbegin(m_hits), std::cend(m_hits), 0.);
+}
+
+double nsw::PoissonDwell::getMinHits() const
+{
+  if (m_hits.empty()) {
+    return 0;
+  }
+  return *std::min_element(std::cbegin(m_hits), std::cend(m_hits));
+}
+
+double nsw::PoissonDwell::getRelativeError() const
+{
+  const auto hits = getMinHits();
+  if (hits <= 0) {
+    return std::numeric_limits<double>::infinity();
+  }
+  return 1 / std::sqrt(hits);
+}
+
+bool nsw::PoissonDwell::done() const
+{
+  if (m_liveTime >= m_maxTime) {
+    return true;
+  }
+  return m_liveTime >= m_minTime and getRelativeError() <= m_target;
+}
@@ -16,8 +16,6 @@
 
 #include <ers/ers.h>
 
-#include <RunControl/Common/OnlineServices.h>
-
 #include "NSWConfiguration/ConfigReader.h"
 #include "NSWConfiguration/Constants.h"
 #include "NSWConfiguration/FEBConfig.h"
@@ -32,8 +30,6 @@
 #include "NSWCalibration/RocPhase160MhzCore.h"
 #include "NSWCalibration/RocPhase160MhzVmm.h"
 
-#include "NSWCalibrationDal/NSWCalibApplication.h"
-
 using namespace std::chrono_literals;
 
 template<typename Specialized>
@@ -43,23 +39,25 @@ RocPhaseCalibrationBase<Specialized>::RocPhaseCalibrationBase(
   const std::vector<std::uint8_t>& values) :
   nsw::CalibAlg("RocPhase", deviceManager),
   m_initTime(nsw::calib::utils::strf_time()),
-  m_outputPath(getOutputPath()),
   m_outputFilenameBase(std::move(outputFilenameBase)),
   m_specialized(values)
 {
-  std::filesystem::create_directories(std::filesystem::path(m_outputPath));
   setTotal(getNumberOfIterations());
 }
 
 template<typename Specialized>
 void RocPhaseCalibrationBase<Specialized>::setup(const std::string& /*db*/)
 {
+  // the output path is only known once the calibration has been created
+  m_outputPath = outputPath();
+  std::filesystem::create_directories(std::filesystem::path(m_outputPath));
+
   // look in header for documentation of executeFunc
   executeFunc([this](const nsw::hw::ROC& roc) {
     m_specialized.configure(roc);
     const auto filename = getFileName(roc);
     ERS_LOG("Opening file " << filename);
-    writeFileHeader(filename);
+    writeFileHeader(roc);
   });
 }
 
@@ -71,18 +69,18 @@ void RocPhaseCalibrationBase<Specialized>::configure()
   }
 
   executeFunc([this](const nsw::hw::ROC& roc) { setRegisters(roc); });
-  std::this_thread::sleep_for(100ms);
+  sleepFor(100ms);
 }
 
 template<typename Specialized>
 void RocPhaseCalibrationBase<Specialized>::acquire()
 {
-  std::this_thread::sleep_for(1000ms);
+  sleepFor(1000ms);
 
   // check the result
   executeFunc([this](const nsw::hw::ROC& roc) {
     const auto result = checkStatusRegisters(roc);
-    saveResult(result, getFileName(roc));
+    saveResult(result, roc);
   });
 }
 
@@ -119,10 +117,9 @@ template<typename Specialized>
 
 template<typename Specialized>
 void RocPhaseCalibrationBase<Specialized>::saveResult(const StatusRegisters& result,
-                                                      const std::string& filename) const
+                                                      const nsw::hw::ROC& roc) const
 {
-  std::ofstream filestream;
-  filestream.open(filename, std::ios::app);
+  auto filestream = openOutputText(roc.getScaAddress(), getFileName(roc));
   const auto& vmmStatuses = result.m_vmmStatus;
   const auto& parities = result.m_vmmParity;
   const auto& srocStatuses = result.m_srocStatus;
@@ -144,10 +141,13 @@ void RocPhaseCalibrationBase<Specialized>::saveResult(const StatusRegisters& res
 }
 
 template<typename Specialized>
-void RocPhaseCalibrationBase<Specialized>::writeFileHeader(const std::string& filename) const
+void RocPhaseCalibrationBase<Specialized>::writeFileHeader(const nsw::hw::ROC& roc) const
 {
-  std::ofstream filestream;
-  filestream.open(filename);
+  // the interrupted process wrote it
+  auto filestream = openOutputText(roc.getScaAddress(), getFileName(roc));
+  if (resuming()) {
+    return;
+  }
   filestream << "Value";
   for (std::size_t vmmId = 0; vmmId < nsw::MAX_NUMBER_OF_VMM; vmmId++) {
     filestream << fmt::format(";Capture Status VMM {}", vmmId);
@@ -162,16 +162,6 @@ void RocPhaseCalibrationBase<Specialized>::writeFileHeader(const std::string& fi
   filestream.close();
 }
 
-template<typename Specialized>
-std::string RocPhaseCalibrationBase<Specialized>::getOutputPath() const
-{
-  auto& runCtlOnlServ = daq::rc::OnlineServices::instance();
-  const auto& rcBase = runCtlOnlServ.getApplication();
-  const auto* calibApp = rcBase.cast<nsw::dal::NSWCalibApplication>();
-
-  return calibApp->get_CalibOutput();
-}
-
 template<typename Specialized>
 std::string RocPhaseCalibrationBase<Specialized>::getFileName(const nsw::hw::ROC& roc) const
 {
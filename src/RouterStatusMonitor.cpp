@@ -0,0 +1,120 @@
+#include "NSWCalibration/RouterStatusMonitor.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+#include <fmt/core.h>
+
+nsw::RouterStatusMonitor::RouterStatusMonitor(const std::size_t numLinks,
+                                              Reader reader,
+                                              const std::chrono::milliseconds poll) :
+  m_reader{std::move(reader)},
+  m_poll{poll},
+  m_start{Clock::now()},
+  m_links(numLinks)
+{
+  for (std::size_t link = 0; link < numLinks; link++) {
+    m_threads.emplace_back([this, link](const std::stop_token& stop) { this->poll(stop, link); });
+  }
+}
+
+void nsw::RouterStatusMonitor::poll(const std::stop_token& stop, const std::size_t link)
+{
+  while (not stop.stop_requested()) {
+    std::uint64_t value{0};
+    try {
+      value = m_reader(link);
+    } catch (const std::exception& ex) {
+      std::scoped_lock lock{m_mutex};
+      m_error = fmt::format("Reading link {} failed: {}", link, ex.what());
+      m_condition.notify_all();
+      return;
+    }
+    std::unique_lock lock{m_mutex};
+    auto& state = m_links.at(link);
+    if (not state.read or state.value != value) {
+      state.value = value;
+      state.read = true;
+      state.changed = Clock::now();
+      m_condition.notify_all();
+    }
+    m_condition.wait_for(lock, stop, m_poll, []() { return false; });
+  }
+}
+
+void nsw::RouterStatusMonitor::checkError() const
+{
+  if (m_error) {
+    throw std::runtime_error(*m_error);
+  }
+}
+
+bool nsw::RouterStatusMonitor::waitFor(const Predicate& predicate, const std::chrono::milliseconds timeout)
+{
+  std::unique_lock lock{m_mutex};
+  const auto satisfied = m_condition.wait_for(lock, timeout, [this, &predicate]() {
+    if (m_error) {
+      return true;
+    }
+    if (not std::all_of(std::cbegin(m_links), std::cend(m_links), [](const Link& link) { return link.read; })) {
+      return false;
+    }
+    std::vector<std::uint64_t> values{};
+    for (const auto& link : m_links) {
+      values.push_back(link.value);
+    }
+    return predicate(values);
+  });
+  checkError();
+  return satisfied;
+}
+
+bool nsw::RouterStatusMonitor::waitForStable(const std::chrono::milliseconds interval,
+                                             const std::chrono::milliseconds timeout)
+{
+  const auto deadline = Clock::now() + timeout;
+  std::unique_lock lock{m_mutex};
+  while (true) {
+    checkError();
+    const auto now = Clock::now();
+    const auto allRead =
+      std::all_of(std::cbegin(m_links), std::cend(m_links), [](const Link& link) { return link.read; });
+    auto lastChange = m_start;
+    for (const auto& link : m_links) {
+      lastChange = std::max(lastChange, link.changed);
+    }
+    if (allRead and now - lastChange >= interval) {
+      return true;
+    }
+    if (now >= deadline) {
+      return false;
+    }
+    const auto wakeUp = allRead ? std::min(deadline, lastChange + interval) : deadline;
+    // woken up by any change, the stability is checked again from the start
+    m_condition.wait_until(lock, wakeUp);
+  }
+}
+
+std::vector<std::uint64_t> nsw::RouterStatusMonitor::getValues() const
+{
+  std::scoped_lock lock{m_mutex};
+  std::vector<std::uint64_t> values{};
+  for (const auto& link : m_links) {
+    values.push_back(link.value);
+  }
+  return values;
+}
+
+std::vector<std::optional<std::chrono::milliseconds>> nsw::RouterStatusMonitor::getLockTimes() const
+{
+  std::scoped_lock lock{m_mutex};
+  std::vector<std::optional<std::chrono::milliseconds>> times{};
+  for (const auto& link : m_links) {
+    if (link.read) {
+      times.emplace_back(std::chrono::duration_cast<std::chrono::milliseconds>(link.changed - m_start));
+    } else {
+      times.emplace_back(std::nullopt);
+    }
+  }
+  return times;
+}
@@ -20,8 +20,6 @@
 #include <is/infodynany.h>
 #include <is/infodictionary.h>
 
-#include <RunControl/Common/OnlineServices.h>
-
 #include <boost/property_tree/ptree.hpp>
 #include <boost/property_tree/json_parser.hpp>
 
@@ -52,9 +50,7 @@ void nsw::THRCalib::setup(const std::string& db)
 {
   m_configFile = db;
 
-  auto& runCtlOnlServ = daq::rc::OnlineServices::instance();
-
-  m_app_name = runCtlOnlServ.applicationName();
+  m_app_name = applicationName();
 
   const auto tokens = [](std::string str, const char token = '-') {
     std::replace(str.begin(), str.end(), token, ' ');
@@ -275,12 +271,7 @@ void nsw::THRCalib::setCalibParamsFromIS(const ISInfoDictionary& is_dictionary,
     const auto calibParams = calib_params_from_is.getAttributeValue<std::string>(0);
     ERS_INFO(fmt::format("Calibration Parameters from IS: {}", calibParams));
 
-    const auto run_params{nsw::THRCalib::parseCalibParams(calibParams)};
-
-    m_n_samples = run_params.samples;
-    m_rms_factor = run_params.factor;
-    m_run_type = run_params.type;
-    m_debug = run_params.debug;
+    setCalibParams(calibParams);
   } catch (const nsw::THRParameterIssue& is) {
     const auto is_cmd = fmt::format("is_write -p ${{TDAQ_PARTITION}} -n {} -t String -v Type,samples,xRMS,debug -i 0", calib_param_is_name);
     nsw::calib::IsParameterNotFoundUseDefault issue(ERS_HERE, "calibParams", is_cmd, "Running a threshold scan using default n_sample(100/chan)/m_rms_factor(x6)/ settings");
@@ -292,6 +283,16 @@ void nsw::THRCalib::setCalibParamsFromIS(const ISInfoDictionary& is_dictionary,
   std::this_thread::sleep_for(500ms);
 }
 
+void nsw::THRCalib::setCalibParams(const std::string& calibParams)
+{
+  const auto run_params{nsw::THRCalib::parseCalibParams(calibParams)};
+
+  m_n_samples = run_params.samples;
+  m_rms_factor = run_params.factor;
+  m_run_type = run_params.type;
+  m_debug = run_params.debug;
+}
+
 nsw::THRCalib::RunParameters nsw::THRCalib::parseCalibParams(const std::string& calibParams)
 {
   const auto tokens{nsw::tokenizeString(calibParams, ",")};
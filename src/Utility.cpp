@@ -2,10 +2,15 @@
 
 #include <ctime>
 #include <numeric>
+#include <stdexcept>
+
+#include <boost/algorithm/string/trim.hpp>
 
 #include <fmt/core.h>
 #include <fmt/chrono.h>
 
+#include "NSWConfiguration/Utility.h"
+
 std::string nsw::calib::utils::strf_time()
 {
   return fmt::format("{:%Y_%m_%d_%Hh%Mm%Ss}", fmt::localtime(std::time(nullptr)));
@@ -33,3 +38,24 @@ std::string nsw::calib::utils::commandToString(
                            return fmt::format("{}:{}", std::move(ss), s);
                          });
 }
+
+std::map<std::string, std::string> nsw::calib::utils::parseKeyValues(const std::string& params,
+                                                                    const std::string& separator) {
+  std::map<std::string, std::string> result{};
+  for (const auto& token : nsw::tokenizeString(params, separator)) {
+    const auto entry = boost::algorithm::trim_copy(token);
+    if (entry.empty()) {
+      continue;
+    }
+    const auto equal = entry.find('=');
+    if (equal == std::string::npos) {
+      throw std::runtime_error(fmt::format("Expected key=value, found '{}' in '{}'", entry, params));
+    }
+    const auto key = boost::algorithm::trim_copy(entry.substr(0, equal));
+    const auto value = boost::algorithm::trim_copy(entry.substr(equal + 1));
+    if (not result.emplace(key, value).second) {
+      throw std::runtime_error(fmt::format("Parameter {} given twice in '{}'", key, params));
+    }
+  }
+  return result;
+}
@@ -0,0 +1,122 @@
+#include "NSWCalibration/sTGCPadConnectivityDecoder.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+#include <fmt/core.h>
+
+nsw::sTGCPadConnectivityDecoder::sTGCPadConnectivityDecoder(const std::size_t numPfebs, const double fraction) :
+  m_numPfebs{numPfebs},
+  m_fraction{fraction}
+{
+  // signatures 1 to numPfebs
+  while ((std::size_t{1} << m_numBits) <= m_numPfebs) {
+    m_numBits++;
+  }
+  m_rates.resize(getNumIterations(), std::vector<std::uint32_t>(m_numPfebs, 0));
+}
+
+bool nsw::sTGCPadConnectivityDecoder::isPulsed(const std::size_t iteration, const std::size_t pfeb) const
+{
+  const auto bit = iteration / 2;
+  const auto set = ((pfeb + 1) >> bit) & 1;
+  return (set == 1) == (iteration % 2 == 0);
+}
+
+void nsw::sTGCPadConnectivityDecoder::addRates(const std::size_t iteration, const std::vector<std::uint32_t>& rates)
+{
+  if (iteration >= getNumIterations()) {
+    throw std::runtime_error(fmt::format("Pad connectivity: iteration {} out of {}", iteration, getNumIterations()));
+  }
+  auto& stored = m_rates.at(iteration);
+  for (std::size_t input = 0; input < std::min(rates.size(), m_numPfebs); input++) {
+    stored.at(input) = rates.at(input);
+  }
+}
+
+std::vector<nsw::sTGCPadConnectivityDecoder::Result> nsw::sTGCPadConnectivityDecoder::decode() const
+{
+  std::vector<Result> results(m_numPfebs);
+  for (std::size_t input = 0; input < m_numPfebs; input++) {
+    std::uint32_t busiest{0};
+    for (const auto& rates : m_rates) {
+      busiest = std::max(busiest, rates.at(input));
+    }
+    auto& result = results.at(input);
+    if (busiest == 0) {
+      continue;
+    }
+    const auto hits = [&](const std::size_t iteration) {
+      return static_cast<double>(m_rates.at(iteration).at(input)) >= m_fraction * busiest;
+    };
+    std::size_t signature{0};
+    bool consistent{true};
+    for (std::size_t bit = 0; bit < m_numBits; bit++) {
+      const auto set = hits(2 * bit);
+      const auto clear = hits(2 * bit + 1);
+      consistent = consistent and set != clear;
+      signature |= set ? std::size_t{1} << bit : 0;
+    }
+    if (not consistent or signature == 0 or signature > m_numPfebs) {
+      result.status = Status::Collision;
+      continue;
+    }
+    result.pfeb = signature - 1;
+    result.status = *result.pfeb == input ? Status::Connected : Status::Swapped;
+  }
+  return results;
+}
+
+std::vector<std::size_t> nsw::sTGCPadConnectivityDecoder::getRetests() const
+{
+  std::vector<std::size_t> found(m_numPfebs, 0);
+  for (const auto& result : decode()) {
+    if (result.pfeb) {
+      found.at(*result.pfeb)++;
+    }
+  }
+  std::vector<std::size_t> retests{};
+  for (std::size_t pfeb = 0; pfeb < m_numPfebs; pfeb++) {
+    if (found.at(pfeb) != 1) {
+      retests.push_back(pfeb);
+    }
+  }
+  return retests;
+}
+
+std::vector<std::size_t> nsw::sTGCPadConnectivityDecoder::inputsWithHits(const std::vector<std::uint32_t>& rates) const
+{
+  const auto busiest = rates.empty() ? 0 : *std::max_element(std::cbegin(rates), std::cend(rates));
+  std::vector<std::size_t> inputs{};
+  for (std::size_t input = 0; input < std::min(rates.size(), m_numPfebs) and busiest > 0; input++) {
+    if (static_cast<double>(rates.at(input)) >= m_fraction * busiest) {
+      inputs.push_back(input);
+    }
+  }
+  return inputs;
+}
+
+void nsw::sTGCPadConnectivityDecoder::addRetest(const std::size_t pfeb, const std::vector<std::uint32_t>& rates)
+{
+  m_retests.insert_or_assign(pfeb, inputsWithHits(rates));
+}
+
+std::optional<std::vector<std::size_t>> nsw::sTGCPadConnectivityDecoder::getRetest(const std::size_t pfeb) const
+{
+  const auto found = m_retests.find(pfeb);
+  if (found == std::cend(m_retests)) {
+    return std::nullopt;
+  }
+  return found->second;
+}
+
+std::string nsw::sTGCPadConnectivityDecoder::toString(const Status status)
+{
+  switch (status) {
+    case Status::Connected: return "connected";
+    case Status::Swapped: return "swapped";
+    case Status::Collision: return "collision";
+    case Status::Dead: return "dead";
+  }
+  return "unknown";
+}
@@ -1,14 +1,24 @@
 #include "NSWCalibration/sTGCPadTdsBcidOffset.h"
 
+#include <algorithm>
+#include <stdexcept>
+
+#include <boost/property_tree/json_parser.hpp>
+
 #include <fmt/core.h>
 
 #include <ers/ers.h>
 
+#include <is/infodynany.h>
+#include <is/infodictionary.h>
+
 #include "NSWCalibration/Utility.h"
+#include "NSWConfiguration/Utility.h"
 
 nsw::sTGCPadTdsBcidOffset::sTGCPadTdsBcidOffset(std::string calibType,
                                             const hw::DeviceManager& deviceManager):
-  CalibAlg(std::move(calibType), deviceManager)
+  CalibAlg(std::move(calibType), deviceManager),
+  m_search{m_calibType == "sTGCPadTdsBcidOffsetSearch"}
 {
   setTotal(m_numBcPerOrbit);
 }
@@ -18,10 +28,72 @@ void nsw::sTGCPadTdsBcidOffset::setup(const std::string& /* db */) {
   for (const auto& dev: getDeviceManager().getPadTriggers()) {
     m_pad_trigger_bcid_offset = dev.readSubRegister("000_control_reg", "conf_bcid_offset");
   }
+  if (m_search) {
+    mapPfebs();
+    m_searchState = std::make_unique<sTGCPadTdsBcidOffsetSearch>(nsw::padtrigger::NUM_PFEBS,
+                                                                 static_cast<std::uint32_t>(m_numBcPerOrbit),
+                                                                 m_searchStep, m_searchVerify, m_searchSweep);
+    for (std::size_t pfeb = 0; pfeb < nsw::padtrigger::NUM_PFEBS; pfeb++) {
+      const auto mapped = std::any_of(std::cbegin(m_pfebIndex), std::cend(m_pfebIndex),
+                                      [pfeb](const auto& entry) { return entry.second == pfeb; });
+      if (not mapped) {
+        m_searchState->exclude(pfeb);
+      }
+    }
+    setTotal(m_searchState->getNumIterations());
+    if (m_searchSweep) {
+      ERS_INFO(fmt::format("Searching the TDS BCID offset of {} PFEBs in {} iterations (step {}, then all offsets)",
+                           m_pfebIndex.size(), total(), m_searchStep));
+    } else {
+      ERS_INFO(fmt::format("Searching the TDS BCID offset of {} PFEBs in {} iterations (step {}, {} verifications)",
+                           m_pfebIndex.size(), total(), m_searchStep, m_searchVerify));
+    }
+  }
+}
+
+void nsw::sTGCPadTdsBcidOffset::setCalibParamsFromIS(const ISInfoDictionary& is_dictionary,
+                                                     const std::string& is_db_name) {
+  if (not m_search) {
+    return;
+  }
+  // optional, e.g. "step=16,verify=3,sweep=0"
+  const auto name = fmt::format("{}.Calib.calibParams", is_db_name);
+  if (is_dictionary.contains(name)) {
+    ISInfoDynAny infoany;
+    is_dictionary.getValue(name, infoany);
+    setCalibParams(infoany.getAttributeValue<std::string>(0));
+  }
+}
+
+void nsw::sTGCPadTdsBcidOffset::setCalibParams(const std::string& calibParams) {
+  if (not m_search) {
+    CalibAlg::setCalibParams(calibParams);
+    return;
+  }
+  for (const auto& [key, value] : nsw::calib::utils::parseKeyValues(calibParams)) {
+    if (key == "step") {
+      m_searchStep = static_cast<std::uint32_t>(std::stoul(value));
+    } else if (key == "verify") {
+      m_searchVerify = std::stoul(value);
+    } else if (key == "sweep") {
+      m_searchSweep = std::stoul(value) != 0;
+    } else {
+      throw NSWsTGCPadTdsBcidOffsetIssue(ERS_HERE, fmt::format("Unknown {} parameter {}, expected step, verify or sweep",
+                                                               m_calibType, key));
+    }
+  }
+  if (m_searchStep == 0 or m_searchStep >= m_numBcPerOrbit) {
+    throw NSWsTGCPadTdsBcidOffsetIssue(ERS_HERE, fmt::format("{} needs 0 < step < {}, got {}",
+                                                             m_calibType, m_numBcPerOrbit, m_searchStep));
+  }
 }
 
 void nsw::sTGCPadTdsBcidOffset::configure() {
-  if (counter() == 0) {
+  if (isFirstIteration()) {
+    if (m_search and resuming()) {
+      // the search of the next offsets depends on all previous reads
+      throw NSWsTGCPadTdsBcidOffsetIssue(ERS_HERE, fmt::format("{} cannot be resumed, restart it", m_calibType));
+    }
     openTree();
   }
   setTdsBcidOffsets();
@@ -32,6 +104,14 @@ void nsw::sTGCPadTdsBcidOffset::acquire() {
     dev.togglePFEBBcidResetTrigger();
     const std::string rname{"017_pfeb_bcid_error_READONLY"};
     const auto val = dev.readSubRegister(rname, "pfeb_bcid_error");
+    if (m_search) {
+      ERS_INFO(fmt::format("Found {} reg{:#04x} = {:#010x} when pad offset = {:#05x} ({} stage)",
+                           dev.getName(), dev.addressFromRegisterName(rname), val, m_pad_trigger_bcid_offset,
+                           m_searchState->getStage(counter())));
+      fillTree(val);
+      m_searchState->addResult(val, readPfebHits(dev));
+      continue;
+    }
     ERS_INFO(fmt::format("Found {} reg{:#04x} = {:#010x} when pad offset = {:#05x} and TDS offset = {:#05x}",
                          dev.getName(), dev.addressFromRegisterName(rname), val, m_pad_trigger_bcid_offset, counter()));
     fillTree(val);
@@ -41,6 +121,9 @@ void nsw::sTGCPadTdsBcidOffset::acquire() {
 void nsw::sTGCPadTdsBcidOffset::unconfigure() {
   if (counter() == total() - 1) {
     closeTree();
+    if (m_search) {
+      writePatch();
+    }
   }
 }
 
@@ -52,11 +135,20 @@ void nsw::sTGCPadTdsBcidOffset::checkObjects() const {
   if (npads != std::size_t{1}) {
     const auto msg = std::string("Requires 1 pad trigger");
     ers::error(nsw::NSWsTGCPadTdsBcidOffsetIssue(ERS_HERE, msg));
+    if (m_search) {
+      // the search moves to its next iteration with each error word
+      throw std::runtime_error(msg);
+    }
   }
 }
 
 void nsw::sTGCPadTdsBcidOffset::setTdsBcidOffsets() const {
-  ERS_INFO(fmt::format("Write {:#010x} to tds register {}", counter(), m_tdsReg));
+  if (m_search) {
+    ERS_INFO(fmt::format("Write per-PFEB offsets to tds register {} ({} stage)", m_tdsReg,
+                         m_searchState->getStage(counter())));
+  } else {
+    ERS_INFO(fmt::format("Write {:#010x} to tds register {}", counter(), m_tdsReg));
+  }
   auto threads = std::vector< std::future<void> >();
   threads.reserve(std::size(getDeviceManager().getFebs()));
   for (const auto& dev: getDeviceManager().getFebs()) {
@@ -71,8 +163,94 @@ void nsw::sTGCPadTdsBcidOffset::setTdsBcidOffset(const nsw::hw::FEB& dev) const
   if (nsw::getElementType(dev.getScaAddress()) != "PFEB") {
     return;
   }
+  const auto offset = getTdsBcidOffset(dev);
   for (const auto& tds : dev.getTdss()) {
-    tds.writeValue(std::string{m_tdsReg}, static_cast<unsigned int>(counter()));
+    tds.writeValue(std::string{m_tdsReg}, offset);
+  }
+}
+
+std::uint64_t nsw::sTGCPadTdsBcidOffset::readPfebHits(const nsw::hw::PadTrigger& dev) const {
+  if (simulation()) {
+    return ~std::uint64_t{0};
+  }
+  const auto rates = dev.readPFEBRates();
+  std::uint64_t hits{0};
+  for (std::size_t pfeb = 0; pfeb < rates.size(); pfeb++) {
+    if (rates.at(pfeb) > 0) {
+      hits |= (std::uint64_t{1} << pfeb);
+    }
+  }
+  return hits;
+}
+
+std::uint32_t nsw::sTGCPadTdsBcidOffset::getTdsBcidOffset(const nsw::hw::FEB& dev) const {
+  if (not m_search) {
+    return static_cast<std::uint32_t>(counter());
+  }
+  const auto found = m_pfebIndex.find(dev.getScaAddress());
+  if (found == std::cend(m_pfebIndex)) {
+    // not read by the pad trigger, keep it at the first offset
+    return 0;
+  }
+  return m_searchState->getOffsets().at(found->second);
+}
+
+void nsw::sTGCPadTdsBcidOffset::mapPfebs() {
+  m_pfebIndex.clear();
+  for (const auto& feb: getDeviceManager().getFebs()) {
+    if (nsw::getElementType(feb.getScaAddress()) != "PFEB") {
+      continue;
+    }
+    for (std::size_t it = 0; it < nsw::padtrigger::NUM_PFEBS; it++) {
+      const auto nameCore = std::string(nsw::padtrigger::ORDERED_PFEBS.at(it));
+      const auto nameStar = std::string(nsw::padtrigger::ORDERED_PFEBS_GEOID.at(it));
+      if (nsw::contains(feb.getScaAddress(), nameCore) or nsw::contains(feb.getScaAddress(), nameStar)) {
+        m_pfebIndex.emplace(feb.getScaAddress(), it);
+        break;
+      }
+    }
+    if (m_pfebIndex.count(feb.getScaAddress()) == 0) {
+      ers::warning(NSWsTGCPadTdsBcidOffsetIssue(ERS_HERE, fmt::format("{} is not a pad trigger input, "
+                                                                      "its offset is not searched",
+                                                                      feb.getScaAddress())));
+    }
+  }
+}
+
+void nsw::sTGCPadTdsBcidOffset::writePatch() const {
+  using boost::property_tree::ptree;
+  // SCA addresses contain dots, which put/add_child would take as a path
+  ptree patch;
+  std::vector<std::string> failed{};
+  for (const auto& feb: getDeviceManager().getFebs()) {
+    const auto found = m_pfebIndex.find(feb.getScaAddress());
+    if (found == std::cend(m_pfebIndex)) {
+      continue;
+    }
+    const auto& result = m_searchState->getResult(found->second);
+    ERS_INFO(fmt::format("{}: {}, good offsets {:#05x} to {:#05x} ({} coarse windows), using {:#05x}",
+                         feb.getScaAddress(), sTGCPadTdsBcidOffsetSearch::toString(result.status),
+                         result.first, result.last, result.windows, result.offset));
+    if (result.status != sTGCPadTdsBcidOffsetSearch::Status::Verified) {
+      failed.push_back(fmt::format("{} ({})", feb.getScaAddress(),
+                                   sTGCPadTdsBcidOffsetSearch::toString(result.status)));
+      continue;
+    }
+    ptree febPatch;
+    for (std::size_t tds = 0; tds < feb.getTdss().size(); tds++) {
+      ptree tdsPatch;
+      tdsPatch.put(std::string{m_tdsReg}, result.offset);
+      febPatch.push_back(std::make_pair(fmt::format("tds{}", tds), tdsPatch));
+    }
+    patch.push_back(std::make_pair(feb.getScaAddress(), febPatch));
+  }
+
+  const auto name = fmt::format("{}.{}.{}.{}.json", m_calibType, runNumber(), applicationName(),
+                                nsw::calib::utils::strf_time());
+  write_json(name, patch);
+  ERS_INFO(fmt::format("TDS BCID offsets of {} PFEBs written to {}", patch.size(), name));
+  for (const auto& pfeb : failed) {
+    ers::warning(NSWsTGCPadTdsBcidOffsetIssue(ERS_HERE, fmt::format("No verified TDS BCID offset for {}", pfeb)));
   }
 }
 
@@ -80,28 +258,37 @@ void nsw::sTGCPadTdsBcidOffset::openTree() {
   m_runnumber = runNumber();
   const auto app_name = applicationName();
   const auto now = nsw::calib::utils::strf_time();
-  m_rname = fmt::format("{}.{}.{}.{}.root", m_calibType, m_runnumber, app_name, now);
+  m_rname = outputFileName("nsw", fmt::format("{}.{}.{}.{}.root", m_calibType, m_runnumber, app_name, now));
   ERS_INFO(fmt::format("Opening TFile/TTree {}", m_rname));
-  m_rfile = std::make_unique< TFile >(m_rname.c_str(), "recreate");
+  m_rfile = std::make_unique< TFile >(m_rname.c_str(), outputFileMode());
   m_rtree = std::make_shared< TTree >("nsw", "nsw");
   m_rtree->Branch("runnumber",               &m_runnumber);
   m_rtree->Branch("pad_trigger",             &m_pad_trigger);
   m_rtree->Branch("pad_trigger_bcid_offset", &m_pad_trigger_bcid_offset);
   m_rtree->Branch("tds_bcid_offset",         &m_tds_bcid_offset);
+  if (m_search) {
+    m_rtree->Branch("tds_bcid_offsets",      &m_tds_bcid_offsets);
+    m_rtree->Branch("stage",                 &m_stage);
+  }
   m_rtree->Branch("pfeb_bcid_error",         &m_pfeb_bcid_error);
   for (const auto& dev: getDeviceManager().getPadTriggers()) {
     m_pad_trigger = dev.getName();
   }
+  attachTree(*m_rfile, *m_rtree);
 }
 
 void nsw::sTGCPadTdsBcidOffset::closeTree() {
   ERS_INFO("Closing TFile/TTree");
-  m_rtree->Write();
-  m_rfile->Close();
+  writeTree(*m_rfile, *m_rtree);
 }
 
 void nsw::sTGCPadTdsBcidOffset::fillTree(const std::uint64_t bcid_error) {
   m_pfeb_bcid_error = bcid_error;
   m_tds_bcid_offset = counter();
+  if (m_search) {
+    const auto& offsets = m_searchState->getOffsets();
+    m_tds_bcid_offsets.assign(std::cbegin(offsets), std::cend(offsets));
+    m_stage = m_searchState->getStage(counter());
+  }
   m_rtree->Fill();
 }
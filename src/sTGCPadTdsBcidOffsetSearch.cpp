@@ -0,0 +1,317 @@
+#include "NSWCalibration/sTGCPadTdsBcidOffsetSearch.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+#include <fmt/core.h>
+
+nsw::sTGCPadTdsBcidOffsetSearch::sTGCPadTdsBcidOffsetSearch(const std::size_t numPfebs,
+                                                           const std::uint32_t numOffsets,
+                                                           const std::uint32_t step,
+                                                           const std::size_t numVerify,
+                                                           const bool sweep) :
+  m_numOffsets{numOffsets},
+  m_step{step},
+  m_sweep{sweep},
+  m_numVerify{sweep ? 0 : numVerify},
+  m_numCoarse{step == 0 ? 0 : (numOffsets + step - 1) / step},
+  m_numSweep{sweep ? numOffsets - m_numCoarse : 0},
+  m_pfebs(numPfebs),
+  m_offsets(numPfebs, 0)
+{
+  if (m_step == 0 or m_step >= m_numOffsets) {
+    throw std::runtime_error(fmt::format("TDS BCID offset search step must be between 1 and {}, got {}",
+                                         m_numOffsets - 1, m_step));
+  }
+  for (auto& pfeb : m_pfebs) {
+    pfeb.coarse.resize(m_numCoarse, false);
+    pfeb.good.resize(m_numOffsets, false);
+  }
+  prepare();
+}
+
+void nsw::sTGCPadTdsBcidOffsetSearch::exclude(const std::size_t pfeb)
+{
+  if (m_iteration != 0) {
+    throw std::runtime_error("PFEBs can only be excluded before the first result of the TDS BCID offset search");
+  }
+  m_pfebs.at(pfeb).result.status = Status::Excluded;
+}
+
+std::size_t nsw::sTGCPadTdsBcidOffsetSearch::numBisections() const
+{
+  if (m_sweep) {
+    return 0;
+  }
+  // each bisection halves the distance between the offsets around the edge
+  std::size_t num{0};
+  for (auto dist = m_step; dist > 1; dist = (dist + 1) / 2) {
+    num++;
+  }
+  return num;
+}
+
+std::size_t nsw::sTGCPadTdsBcidOffsetSearch::getNumIterations() const
+{
+  return m_numCoarse + m_numSweep + 2 * numBisections() + m_numVerify;
+}
+
+std::string nsw::sTGCPadTdsBcidOffsetSearch::getStage(const std::size_t iteration) const
+{
+  if (iteration < m_numCoarse) {
+    return "coarse";
+  }
+  if (iteration < m_numCoarse + m_numSweep) {
+    return "sweep";
+  }
+  if (iteration < m_numCoarse + m_numSweep + numBisections()) {
+    return "lower_edge";
+  }
+  if (iteration < m_numCoarse + m_numSweep + 2 * numBisections()) {
+    return "upper_edge";
+  }
+  return "verify";
+}
+
+std::uint32_t nsw::sTGCPadTdsBcidOffsetSearch::distance(const std::uint32_t from, const std::uint32_t to) const
+{
+  return (to + m_numOffsets - from) % m_numOffsets;
+}
+
+std::uint32_t nsw::sTGCPadTdsBcidOffsetSearch::advance(const std::uint32_t from, const std::uint32_t steps) const
+{
+  return (from + steps) % m_numOffsets;
+}
+
+std::uint32_t nsw::sTGCPadTdsBcidOffsetSearch::coarseOffset(const std::size_t index) const
+{
+  return static_cast<std::uint32_t>((index % m_numCoarse) * m_step);
+}
+
+std::uint32_t nsw::sTGCPadTdsBcidOffsetSearch::sweepOffset(const std::size_t index) const
+{
+  // the offsets between two coarse offsets, gap by gap
+  const auto gap = m_step - 1;
+  return static_cast<std::uint32_t>((index / gap) * m_step + 1 + index % gap);
+}
+
+void nsw::sTGCPadTdsBcidOffsetSearch::findWindow(Pfeb& pfeb) const
+{
+  auto& result = pfeb.result;
+  if (result.status != Status::Searching) {
+    return;
+  }
+  if (not pfeb.hits) {
+    result.status = Status::Dead;
+    return;
+  }
+  const auto& coarse = pfeb.coarse;
+  std::optional<std::size_t> firstBad{};
+  bool anyGood{false};
+  for (std::size_t index = 0; index < m_numCoarse; index++) {
+    if (coarse.at(index)) {
+      anyGood = true;
+    } else if (not firstBad) {
+      firstBad = index;
+    }
+  }
+  if (not anyGood) {
+    result.status = Status::NoWindow;
+    return;
+  }
+  if (not firstBad) {
+    result.status = Status::NoTransition;
+    return;
+  }
+
+  // longest run of good coarse offsets, starting after a bad one so that
+  // a run through the end of the orbit is not split
+  std::size_t bestStart{0};
+  std::size_t bestLength{0};
+  bool inRun{false};
+  std::size_t runStart{0};
+  for (std::size_t step = 1; step <= m_numCoarse; step++) {
+    const auto index = (*firstBad + step) % m_numCoarse;
+    if (coarse.at(index)) {
+      if (not inRun) {
+        inRun = true;
+        runStart = step;
+        result.windows++;
+      }
+      continue;
+    }
+    if (inRun and step - runStart > bestLength) {
+      bestStart = (*firstBad + runStart) % m_numCoarse;
+      bestLength = step - runStart;
+    }
+    inRun = false;
+  }
+
+  result.first = coarseOffset(bestStart);
+  result.last = coarseOffset(bestStart + bestLength - 1);
+  pfeb.from = coarseOffset(bestStart + m_numCoarse - 1);
+  pfeb.to = result.first;
+  pfeb.after = coarseOffset(bestStart + bestLength);
+}
+
+void nsw::sTGCPadTdsBcidOffsetSearch::findSweptWindow(Pfeb& pfeb) const
+{
+  auto& result = pfeb.result;
+  if (result.status != Status::Searching) {
+    return;
+  }
+  if (not pfeb.hits) {
+    result.status = Status::Dead;
+    return;
+  }
+  const auto& good = pfeb.good;
+  const auto firstBad = std::find(std::cbegin(good), std::cend(good), false);
+  if (firstBad == std::cend(good)) {
+    result.status = Status::NoTransition;
+    return;
+  }
+  if (std::find(std::cbegin(good), std::cend(good), true) == std::cend(good)) {
+    result.status = Status::NoWindow;
+    return;
+  }
+
+  // longest run of good offsets, starting after a bad one so that a run
+  // through the end of the orbit is not split
+  const auto start = static_cast<std::uint32_t>(std::distance(std::cbegin(good), firstBad));
+  std::uint32_t bestLength{0};
+  bool inRun{false};
+  std::uint32_t runStart{0};
+  for (std::uint32_t step = 1; step <= m_numOffsets; step++) {
+    const auto offset = advance(start, step);
+    if (good.at(offset)) {
+      if (not inRun) {
+        inRun = true;
+        runStart = offset;
+        result.windows++;
+      }
+      continue;
+    }
+    if (inRun and distance(runStart, offset) > bestLength) {
+      result.first = runStart;
+      bestLength = distance(runStart, offset);
+    }
+    inRun = false;
+  }
+  result.swept = true;
+  result.last = advance(result.first, bestLength - 1);
+  result.offset = advance(result.first, (bestLength - 1) / 2);
+}
+
+void nsw::sTGCPadTdsBcidOffsetSearch::prepare()
+{
+  if (done()) {
+    return;
+  }
+  const auto stage = getStage(m_iteration);
+  const auto previous = m_iteration == 0 ? std::string{} : getStage(m_iteration - 1);
+  const auto stageStart = previous != stage;
+  for (std::size_t index = 0; index < m_pfebs.size(); index++) {
+    auto& pfeb = m_pfebs.at(index);
+    auto& result = pfeb.result;
+    if (stage == "coarse") {
+      m_offsets.at(index) = coarseOffset(m_iteration);
+      continue;
+    }
+    if (stage == "sweep") {
+      m_offsets.at(index) = sweepOffset(m_iteration - m_numCoarse);
+      continue;
+    }
+    // with a step of 1, the coarse stage is followed by the verification
+    if (stageStart and previous == "coarse") {
+      findWindow(pfeb);
+    }
+    const auto bisected = result.status == Status::Searching;
+    if (stageStart and bisected and (stage == "upper_edge" or (stage == "verify" and previous != "upper_edge"))) {
+      // the lower bisection ends on the first good offset
+      result.first = pfeb.to;
+      pfeb.from = result.last;
+      pfeb.to = pfeb.after;
+    }
+    if (stageStart and bisected and stage == "verify") {
+      // the upper bisection ends on the last good offset
+      result.last = pfeb.from;
+      result.offset = advance(result.first, distance(result.first, result.last) / 2);
+    }
+
+    if (result.status != Status::Searching or stage == "verify") {
+      m_offsets.at(index) = result.offset;
+    } else if (distance(pfeb.from, pfeb.to) > 1) {
+      m_offsets.at(index) = advance(pfeb.from, distance(pfeb.from, pfeb.to) / 2);
+    } else {
+      // edge found, nothing left to test
+      m_offsets.at(index) = stage == "lower_edge" ? pfeb.to : pfeb.from;
+    }
+  }
+}
+
+void nsw::sTGCPadTdsBcidOffsetSearch::addResult(const std::uint64_t errors, const std::uint64_t hits)
+{
+  if (done()) {
+    throw std::runtime_error("TDS BCID offset search is already done");
+  }
+  const auto stage = getStage(m_iteration);
+  for (std::size_t index = 0; index < m_pfebs.size(); index++) {
+    auto& pfeb = m_pfebs.at(index);
+    auto& result = pfeb.result;
+    const auto good = ((errors >> index) & std::uint64_t{1}) == 0;
+    const auto offset = m_offsets.at(index);
+    if (stage == "coarse") {
+      pfeb.coarse.at(m_iteration) = good;
+      pfeb.good.at(offset) = good;
+      pfeb.hits = pfeb.hits or ((hits >> index) & std::uint64_t{1}) != 0;
+    } else if (stage == "sweep") {
+      pfeb.good.at(offset) = good;
+    } else if (result.status != Status::Searching) {
+      continue;
+    } else if (stage == "verify") {
+      if (not good) {
+        result.status = Status::Failed;
+      }
+    } else if (distance(pfeb.from, pfeb.to) > 1) {
+      // at the lower edge, "to" is good and "from" is bad; the other way at the upper edge
+      const auto likeTo = (stage == "lower_edge") == good;
+      if (likeTo) {
+        pfeb.to = offset;
+      } else {
+        pfeb.from = offset;
+      }
+    }
+  }
+
+  next();
+}
+
+void nsw::sTGCPadTdsBcidOffsetSearch::next()
+{
+  m_iteration++;
+  if (done()) {
+    for (auto& pfeb : m_pfebs) {
+      if (m_sweep) {
+        findSweptWindow(pfeb);
+      }
+      if (pfeb.result.status == Status::Searching) {
+        pfeb.result.status = Status::Verified;
+      }
+    }
+  }
+  prepare();
+}
+
+std::string nsw::sTGCPadTdsBcidOffsetSearch::toString(const Status status)
+{
+  switch (status) {
+    case Status::Searching: return "searching";
+    case Status::NoWindow: return "no_window";
+    case Status::NoTransition: return "no_transition";
+    case Status::Failed: return "failed";
+    case Status::Verified: return "verified";
+    case Status::Excluded: return "excluded";
+    case Status::Dead: return "dead";
+  }
+  return "unknown";
+}
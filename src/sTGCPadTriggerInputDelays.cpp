@@ -1,9 +1,13 @@
 #include "NSWCalibration/sTGCPadTriggerInputDelays.h"
 #include <unistd.h>
 #include <stdexcept>
+#include <boost/property_tree/json_parser.hpp>
 #include "ers/ers.h"
 #include "NSWCalibration/Utility.h"
 
+#include <is/infodynany.h>
+#include <is/infodictionary.h>
+
 nsw::sTGCPadTriggerInputDelays::sTGCPadTriggerInputDelays(std::string calibType,
                                                           const hw::DeviceManager& deviceManager):
   CalibAlg(std::move(calibType), deviceManager)
@@ -12,17 +16,55 @@ nsw::sTGCPadTriggerInputDelays::sTGCPadTriggerInputDelays(std::string calibType,
   setTotal(nsw::padtrigger::NUM_INPUT_DELAYS);
 }
 
+void nsw::sTGCPadTriggerInputDelays::setup(const std::string& /* db */) {
+  m_stats = std::make_unique<BcidStatistics>(nsw::padtrigger::NUM_PFEBS, m_stableFraction);
+}
+
+void nsw::sTGCPadTriggerInputDelays::setCalibParamsFromIS(const ISInfoDictionary& is_dictionary,
+                                                          const std::string& is_db_name) {
+  // optional, e.g. "raw=1"
+  const auto name = fmt::format("{}.Calib.calibParams", is_db_name);
+  if (is_dictionary.contains(name)) {
+    ISInfoDynAny infoany;
+    is_dictionary.getValue(name, infoany);
+    setCalibParams(infoany.getAttributeValue<std::string>(0));
+  }
+}
+
+void nsw::sTGCPadTriggerInputDelays::setCalibParams(const std::string& calibParams) {
+  for (const auto& [key, value] : nsw::calib::utils::parseKeyValues(calibParams)) {
+    if (key == "raw") {
+      m_raw = std::stoul(value) != 0;
+    } else if (key == "stable") {
+      m_stableFraction = std::stod(value);
+    } else {
+      throw NSWsTGCPadTriggerInputDelaysIssue(ERS_HERE, fmt::format("Unknown {} parameter {}, expected raw or stable",
+                                                                    m_calibType, key));
+    }
+  }
+}
+
 void nsw::sTGCPadTriggerInputDelays::configure() {
   ERS_INFO("sTGCPadTriggerInputDelays::configure " << counter());
-  if (counter() == 0) {
+  if (isFirstIteration()) {
     setupTree();
+    if (m_raw) {
+      setupRawTree();
+    }
   }
   for (const auto& pt: getDeviceManager().getPadTriggers()) {
     setDelays(pt);
-    for (std::uint32_t i = 0; i < nsw::padtrigger::NUM_PFEB_BCID_READS; i++) {
-      m_bcid = pt.readPFEBBCIDs();
-      fillTree();
-    }
+    m_stats->reset();
+    m_delay = counter();
+    const auto raw = m_raw ? BcidStatistics::RawCallback{
+      [this](const std::size_t read, const std::vector<std::uint32_t>& bcids) {
+        m_read = static_cast<std::uint32_t>(read);
+        m_bcid = bcids;
+        m_raw_rtree->Fill();
+      }} : BcidStatistics::RawCallback{};
+    m_stats->read([&pt]() { return pt.readPFEBBCIDs(); }, nsw::padtrigger::NUM_PFEB_BCID_READS, raw);
+    m_stats->record(counter());
+    fillTree();
   }
 }
 
@@ -30,6 +72,7 @@ void nsw::sTGCPadTriggerInputDelays::unconfigure() {
   ERS_INFO("sTGCPadTriggerInputDelays::unconfigure " << counter());
   if (counter() == total() - 1) {
     closeTree();
+    writePatch();
   }
 }
 
@@ -40,6 +83,29 @@ void nsw::sTGCPadTriggerInputDelays::setDelays(const nsw::hw::PadTrigger& pt) co
   }
 }
 
+void nsw::sTGCPadTriggerInputDelays::writePatch() const {
+  // the delays read before a resume are not in the statistics
+  for (std::size_t it = 0; it < nsw::padtrigger::NUM_PFEBS; it++) {
+    const auto best = m_stats->getBest(it, false);
+    ERS_INFO(fmt::format("PFEB {:02}: {}", it, best ? fmt::format("best delay {:#x}", *best) : "no stable delay"));
+  }
+  const auto delay = m_stats->getBestCommon(false);
+  if (not delay) {
+    ers::warning(NSWsTGCPadTriggerInputDelaysIssue(ERS_HERE, "No delay with a stable PFEB, no patch written"));
+    return;
+  }
+  boost::property_tree::ptree patch;
+  for (const auto& pt: getDeviceManager().getPadTriggers()) {
+    boost::property_tree::ptree ptPatch;
+    ptPatch.put("pfeb_common_delay", *delay);
+    patch.push_back(std::make_pair(pt.getName(), ptPatch));
+  }
+  const auto name = fmt::format("{}.{}.{}.{}.json", m_calibType, runNumber(), applicationName(),
+                                nsw::calib::utils::strf_time());
+  write_json(name, patch);
+  ERS_INFO(fmt::format("Pad trigger input delay {:#x} written to {}", *delay, name));
+}
+
 void nsw::sTGCPadTriggerInputDelays::checkObjects() {
   const auto npts = getDeviceManager().getPadTriggers().size();
   ERS_INFO(fmt::format("Found {} pad triggers", npts));
@@ -56,28 +122,49 @@ void nsw::sTGCPadTriggerInputDelays::fillTree() {
     break;
   }
   m_now = nsw::calib::utils::strf_time();
-  m_delay = counter();
+  m_columns = m_stats->getColumns();
   m_rtree->Fill();
 }
 
 void nsw::sTGCPadTriggerInputDelays::setupTree() {
   m_now = nsw::calib::utils::strf_time();
-  m_rname = fmt::format("{}.{}.{}.{}.root", m_calibType, runNumber(), applicationName(), m_now);
+  m_reads = nsw::padtrigger::NUM_PFEB_BCID_READS;
+  m_rname = outputFileName("nsw", fmt::format("{}.{}.{}.{}.root", m_calibType, runNumber(), applicationName(), m_now));
   ERS_INFO(fmt::format("Opening ROOT file/tree: {}", m_rname));
-  m_rfile = std::make_unique< TFile >(m_rname.c_str(), "recreate");
+  m_rfile = std::make_unique< TFile >(m_rname.c_str(), outputFileMode());
   m_rtree = std::make_shared< TTree >("nsw", "nsw");
   m_rtree->Branch("opcserverip", &m_opcserverip);
   m_rtree->Branch("address",     &m_address);
   m_rtree->Branch("time",        &m_now);
   m_rtree->Branch("delay",       &m_delay);
-  m_rtree->Branch("pfeb_bcid",   &m_bcid);
+  m_rtree->Branch("nreads",      &m_reads);
+  m_rtree->Branch("pfeb_bcid",   &m_columns.mode);
+  m_rtree->Branch("pfeb_bcid_spread",   &m_columns.spread);
+  m_rtree->Branch("pfeb_bcid_fraction", &m_columns.fraction);
+  m_rtree->Branch("pfeb_bcid_stable",   &m_columns.stable);
   m_rtree->Branch("pfeb_index",  &m_pfeb);
   m_pfeb.resize(nsw::padtrigger::NUM_PFEBS);
   std::iota(std::begin(m_pfeb), std::end(m_pfeb), 0);
+  attachTree(*m_rfile, *m_rtree);
+}
+
+void nsw::sTGCPadTriggerInputDelays::setupRawTree() {
+  m_raw_rname = outputFileName("raw", fmt::format("{}.{}.{}.{}.raw.root", m_calibType, runNumber(),
+                                                  applicationName(), m_now));
+  ERS_INFO(fmt::format("Opening ROOT file/tree: {}", m_raw_rname));
+  m_raw_rfile = std::make_unique< TFile >(m_raw_rname.c_str(), outputFileMode());
+  m_raw_rtree = std::make_shared< TTree >("nsw", "nsw");
+  m_raw_rtree->Branch("delay",       &m_delay);
+  m_raw_rtree->Branch("read",        &m_read);
+  m_raw_rtree->Branch("pfeb_bcid",   &m_bcid);
+  m_raw_rtree->Branch("pfeb_index",  &m_pfeb);
+  attachTree(*m_raw_rfile, *m_raw_rtree);
 }
 
 void nsw::sTGCPadTriggerInputDelays::closeTree() {
   ERS_INFO("Closing ");
-  m_rtree->Write();
-  m_rfile->Close();
+  writeTree(*m_rfile, *m_rtree);
+  if (m_raw_rtree != nullptr) {
+    writeTree(*m_raw_rfile, *m_raw_rtree);
+  }
 }
@@ -56,7 +56,7 @@ void nsw::sTGCPadTriggerToSFEB::configure() {
   ERS_INFO("sTGCPadTriggerToSFEB::configure " << counter());
   constexpr int seconds = 600;
   for (int second = 0; second < seconds; second++) {
-    nsw::snooze(std::chrono::milliseconds(100));
+    sleepFor(std::chrono::milliseconds(100));
     ERS_INFO("sTGCPadTriggerToSFEB::sleeping " << second+1 << " / " << seconds);
 
     // check on the watchdog
@@ -116,15 +116,14 @@ int nsw::sTGCPadTriggerToSFEB::sfeb_watchdog() const {
 
   // output file and announce
   const auto now = nsw::calib::utils::strf_time();
-  std::string fname = "sfeb_register15." + std::to_string(runNumber()) + "." + applicationName() + "." + now + ".txt";
-  std::ofstream myfile;
-  myfile.open(fname);
+  const auto fname = outputFileName("txt", "sfeb_register15." + std::to_string(runNumber()) + "." + applicationName() + "." + now + ".txt");
+  auto myfile = openOutputText("txt", fname);
   ERS_INFO("SFEB watchdog. Output: " << fname);
 
   // monitor
   // pointer < sfebs < threads < tds < register15 > > > >
   auto threads = std::make_unique<std::vector< std::future< std::vector<uint32_t> > > >();
-  while (counter() < total()) {
+  while (counter() < total() and not aborted()) {
     myfile << "Time " << nsw::calib::utils::strf_time() << std::endl;
     for (auto & feb : m_sfebs)
       threads->push_back( std::async(std::launch::async,
@@ -1,17 +1,58 @@
 #include "NSWCalibration/sTGCPadVMMTDSChannels.h"
+#include "NSWCalibration/Utility.h"
 #include "NSWConfiguration/ConfigReader.h"
 #include "NSWConfiguration/ConfigSender.h"
 #include "NSWConfiguration/Utility.h"
 #include "ers/ers.h"
+#include <is/infodynany.h>
+#include <is/infodictionary.h>
+#include <fmt/ranges.h>
 #include <future>
 #include <execution>
+#include <sstream>
 
 using namespace std::chrono_literals;
 
 void nsw::sTGCPadVMMTDSChannels::setup(const std::string& db) {
   ERS_INFO(fmt::format("setup {}", db));
   checkObjects();
-  setTotal(nsw::NUM_PAD_VMM_PER_PFEB * nsw::vmm::NUM_CH_PER_VMM);
+  if (not m_channels.empty()) {
+    setTotal(m_channels.size());
+    ERS_INFO(fmt::format("Pulsing pad channels {}", fmt::join(m_channels, ", ")));
+  } else if (m_coded) {
+    setTotal(2 * getNumBits());
+  } else {
+    setTotal(m_numPadChannels);
+  }
+}
+
+void nsw::sTGCPadVMMTDSChannels::setCalibParamsFromIS(const ISInfoDictionary& is_dictionary,
+                                                      const std::string& is_db_name) {
+  // optional, e.g. "channels=12,75"
+  const auto name = fmt::format("{}.Calib.calibParams", is_db_name);
+  if (is_dictionary.contains(name)) {
+    ISInfoDynAny infoany;
+    is_dictionary.getValue(name, infoany);
+    setCalibParams(infoany.getAttributeValue<std::string>(0));
+  }
+}
+
+void nsw::sTGCPadVMMTDSChannels::setCalibParams(const std::string& calibParams) {
+  for (const auto& [key, value] : nsw::calib::utils::parseKeyValues(calibParams, ";")) {
+    if (key != "channels") {
+      throw NSWsTGCPadVMMTDSChannelsIssue(ERS_HERE, fmt::format("Unknown {} parameter {}, expected channels",
+                                                                m_calibType, key));
+    }
+    m_channels.clear();
+    std::istringstream channels{value};
+    for (std::string channel; std::getline(channels, channel, ',');) {
+      m_channels.push_back(std::stoul(channel));
+      if (m_channels.back() >= m_numPadChannels) {
+        throw NSWsTGCPadVMMTDSChannelsIssue(ERS_HERE, fmt::format("Pad channel {} out of range, expected < {}",
+                                                                  m_channels.back(), m_numPadChannels));
+      }
+    }
+  }
 }
 
 void nsw::sTGCPadVMMTDSChannels::configure() {
@@ -32,13 +73,18 @@ void nsw::sTGCPadVMMTDSChannels::configurePfeb(const nsw::hw::FEB& feb) const {
   }
   ERS_INFO(fmt::format("Configuring {}", feb.getScaAddress()));
 
-  // choose the VMM channel to pulse
-  const std::size_t vmmId = counter() / nsw::vmm::NUM_CH_PER_VMM + nsw::PFEB_FIRST_PAD_VMM;
-  const std::size_t chan  = counter() % nsw::vmm::NUM_CH_PER_VMM;
-  ERS_INFO(fmt::format("Enable VMM {}, channel {}", vmmId, chan));
+  // choose the VMM channels to pulse
+  const auto pulsed = getPulsedChannels();
+  if (pulsed.size() == 1) {
+    const auto padChannel = *std::cbegin(pulsed);
+    ERS_INFO(fmt::format("Enable VMM {}, channel {}", padChannel / nsw::vmm::NUM_CH_PER_VMM + nsw::PFEB_FIRST_PAD_VMM,
+                         padChannel % nsw::vmm::NUM_CH_PER_VMM));
+  } else {
+    ERS_INFO(fmt::format("Enable {} pad channels", pulsed.size()));
+  }
 
   // mask all channels, and
-  // test pulse and unmask the channel of interest
+  // test pulse and unmask the channels of interest
   for (const auto& vmmDev: feb.getVmms()) {
     if (vmmDev.getVmmId() == nsw::PFEB_WIRE_VMM) {
       continue;
@@ -46,9 +92,14 @@ void nsw::sTGCPadVMMTDSChannels::configurePfeb(const nsw::hw::FEB& feb) const {
     auto vmmConf = nsw::VMMConfig{vmmDev.getConfig()};
     vmmConf.setChannelRegisterAllChannels("channel_st", false);
     vmmConf.setChannelRegisterAllChannels("channel_sm", true);
-    if (vmmDev.getVmmId() == vmmId) {
-      vmmConf.setChannelRegisterOneChannel("channel_st", true,  chan);
-      vmmConf.setChannelRegisterOneChannel("channel_sm", false, chan);
+    if (vmmDev.getVmmId() >= nsw::PFEB_FIRST_PAD_VMM) {
+      const std::size_t first = (vmmDev.getVmmId() - nsw::PFEB_FIRST_PAD_VMM) * nsw::vmm::NUM_CH_PER_VMM;
+      for (std::size_t chan = 0; chan < nsw::vmm::NUM_CH_PER_VMM; chan++) {
+        if (pulsed.contains(first + chan)) {
+          vmmConf.setChannelRegisterOneChannel("channel_st", true,  chan);
+          vmmConf.setChannelRegisterOneChannel("channel_sm", false, chan);
+        }
+      }
     }
     vmmDev.writeConfiguration(vmmConf);
   }
@@ -57,10 +108,38 @@ void nsw::sTGCPadVMMTDSChannels::configurePfeb(const nsw::hw::FEB& feb) const {
 void nsw::sTGCPadVMMTDSChannels::configurePadTrigger() const {
   for (const auto& pt: getDeviceManager().getPadTriggers()) {
     ERS_INFO(fmt::format("Configuring {}", pt.getName()));
+    pt.writeFPGARegister(nsw::padtrigger::REG_CONTROL2, counter());
     pt.writeReadoutEnableTemporarily(10ms);
   }
 }
 
+std::set<std::size_t> nsw::sTGCPadVMMTDSChannels::getPulsedChannels() const {
+  if (not m_channels.empty()) {
+    return {m_channels.at(counter())};
+  }
+  if (not m_coded) {
+    return {counter()};
+  }
+  // bit k set in iteration 2k, clear in 2k+1
+  const auto bit = counter() / 2;
+  const auto set = counter() % 2 == 0;
+  std::set<std::size_t> pulsed{};
+  for (std::size_t padChannel = 0; padChannel < m_numPadChannels; padChannel++) {
+    if ((((padChannel >> bit) & 1) == 1) == set) {
+      pulsed.insert(padChannel);
+    }
+  }
+  return pulsed;
+}
+
+std::size_t nsw::sTGCPadVMMTDSChannels::getNumBits() {
+  std::size_t bits{0};
+  while ((std::size_t{1} << bits) < m_numPadChannels) {
+    bits++;
+  }
+  return bits;
+}
+
 void nsw::sTGCPadVMMTDSChannels::checkObjects() const {
   const auto npads = getDeviceManager().getPadTriggers().size();
   const auto nfebs = getDeviceManager().getFebs().size();
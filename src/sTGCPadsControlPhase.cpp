@@ -12,13 +12,13 @@ nsw::sTGCPadsControlPhase::sTGCPadsControlPhase(std::string calibType,
 }
 
 void nsw::sTGCPadsControlPhase::configure() {
-  if (counter() == 0) {
+  if (isFirstIteration()) {
     setupTree();
     maskPFEBs();
   }
   m_delay = counter();
   setROCPhases();
-  nsw::snooze(2 * nsw::padtrigger::PFEB_HIT_RATE_TIME);
+  sleepFor(2 * nsw::padtrigger::PFEB_HIT_RATE_TIME);
   for (const auto& pt: getDeviceManager().getPadTriggers()) {
     ERS_INFO("Reading PFEB hit rates...");
     const auto rates = pt.readPFEBRates();
@@ -110,8 +110,8 @@ void nsw::sTGCPadsControlPhase::setupTree() {
   m_runnumber = runNumber();
   m_app_name  = applicationName();
   m_now = nsw::calib::utils::strf_time();
-  m_rname = fmt::format("{}.{}.{}.{}.root", m_calibType, m_runnumber, m_app_name, m_now);
-  m_rfile = std::make_unique< TFile >(m_rname.c_str(), "recreate");
+  m_rname = outputFileName("nsw", fmt::format("{}.{}.{}.{}.root", m_calibType, m_runnumber, m_app_name, m_now));
+  m_rfile = std::make_unique< TFile >(m_rname.c_str(), outputFileMode());
   m_rtree = std::make_shared< TTree >("nsw", "nsw");
   m_rtree->Branch("runnumber",   &m_runnumber);
   m_rtree->Branch("appname",     &m_app_name);
@@ -129,6 +129,7 @@ void nsw::sTGCPadsControlPhase::setupTree() {
     m_pt_address     = pt.getName();
     break;
   }
+  attachTree(*m_rfile, *m_rtree);
 }
 
 void nsw::sTGCPadsControlPhase::fillTree() {
@@ -138,7 +139,6 @@ void nsw::sTGCPadsControlPhase::fillTree() {
 
 void nsw::sTGCPadsControlPhase::closeTree() {
   ERS_INFO("Closing TFile/TTree");
-  m_rtree->Write();
-  m_rfile->Close();
+  writeTree(*m_rfile, *m_rtree);
 }
 
@@ -1,9 +1,14 @@
 #include "NSWCalibration/sTGCPadsHitRateL1a.h"
+#include <algorithm>
+#include <fstream>
 #include <fmt/core.h>
 #include <fmt/chrono.h>
 #include <ers/ers.h>
 #include <is/infodynany.h>
 #include <is/infodictionary.h>
+#include "NSWCalibration/Issues.h"
+#include "NSWCalibration/Utility.h"
+#include "NSWConfiguration/Utility.h"
 
 nsw::sTGCPadsHitRateL1a::sTGCPadsHitRateL1a(std::string calibType,
                                       const hw::DeviceManager& deviceManager):
@@ -12,6 +17,11 @@ nsw::sTGCPadsHitRateL1a::sTGCPadsHitRateL1a(std::string calibType,
   setTotal(m_thresholdAdjustments.size());
 }
 
+void nsw::sTGCPadsHitRateL1a::setup(const std::string& /* db */) {
+  checkObjects();
+  mapPfebs();
+}
+
 void nsw::sTGCPadsHitRateL1a::configure() {
   setPadTriggerSector();
   setFebThresholds();
@@ -22,12 +32,110 @@ void nsw::sTGCPadsHitRateL1a::acquire() {
     ERS_INFO(fmt::format("Enable readout for {}", dev.getName()));
     dev.writeReadoutEnable();
   }
-  ERS_INFO(fmt::format("Acquiring data for {}", m_acquire_time));
-  nsw::snooze(std::chrono::seconds{m_acquire_time});
+  const auto disableReadout = [this]() {
+    for (const auto& dev: getDeviceManager().getPadTriggers()) {
+      ERS_INFO(fmt::format("Disable readout for {}", dev.getName()));
+      dev.writeReadoutDisable();
+    }
+  };
+  const auto start = std::chrono::steady_clock::now();
+  std::optional<PoissonDwell> dwell{};
+  try {
+    // the simulated pad trigger counts no hits, the precision would never be reached
+    if (m_precision and not simulation()) {
+      dwell = acquireAdaptive();
+    } else {
+      ERS_INFO(fmt::format("Acquiring data for {}", m_acquire_time));
+      sleepFor(m_acquire_time);
+    }
+  } catch (const nsw::calib::Aborted&) {
+    disableReadout();
+    throw;
+  }
+  disableReadout();
+  writeLiveTime(std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start),
+                dwell);
+}
+
+nsw::PoissonDwell nsw::sTGCPadsHitRateL1a::acquireAdaptive() const {
+  ERS_INFO(fmt::format("Acquiring data until a precision of {} or for {}", *m_precision, m_max_time));
+  auto dwell = PoissonDwell{*m_precision, m_poll, m_max_time};
+  while (not dwell.done()) {
+    const auto start = std::chrono::steady_clock::now();
+    sleepFor(m_poll);
+    const auto rates = readPadTriggerRates();
+    dwell.addRates(rates, std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start));
+  }
+  ERS_INFO(fmt::format("Acquired {:.0f} hits in {}, at least {:.0f} per PFEB, relative uncertainty {:.3f}",
+                       dwell.getHits(), dwell.getLiveTime(), dwell.getMinHits(), dwell.getRelativeError()));
+  if (dwell.getRelativeError() > *m_precision) {
+    // the channels are ordered like the rates: by pad trigger, then by input
+    const auto& hits = dwell.getChannelHits();
+    std::size_t channel{0};
+    for (const auto& dev: getDeviceManager().getPadTriggers()) {
+      for (const auto input: m_inputs) {
+        if (channel < hits.size() and hits.at(channel) == 0) {
+          ers::warning(NSWsTGCPadsHitRateL1aIssue(ERS_HERE, fmt::format(
+            "No hits from {} in {} after {}, the precision cannot be reached",
+            nsw::padtrigger::ORDERED_PFEBS.at(input), dev.getName(), dwell.getLiveTime())));
+        }
+        channel++;
+      }
+    }
+  }
+  return dwell;
+}
+
+std::vector<double> nsw::sTGCPadsHitRateL1a::readPadTriggerRates() const {
+  std::vector<double> rates{};
+  if (simulation()) {
+    return rates;
+  }
   for (const auto& dev: getDeviceManager().getPadTriggers()) {
-    ERS_INFO(fmt::format("Disable readout for {}", dev.getName()));
-    dev.writeReadoutDisable();
+    const auto pfebRates = dev.readPFEBRates();
+    for (const auto input: m_inputs) {
+      rates.push_back(static_cast<double>(pfebRates.at(input)));
+    }
+  }
+  return rates;
+}
+
+void nsw::sTGCPadsHitRateL1a::mapPfebs() {
+  // the pad trigger inputs of the PFEBs in the configuration, others never count hits
+  m_inputs.clear();
+  for (std::size_t it = 0; it < nsw::padtrigger::NUM_PFEBS; it++) {
+    const auto nameCore = std::string(nsw::padtrigger::ORDERED_PFEBS.at(it));
+    const auto nameStar = std::string(nsw::padtrigger::ORDERED_PFEBS_GEOID.at(it));
+    const auto& febs = getDeviceManager().getFebs();
+    const auto connected = std::any_of(std::cbegin(febs), std::cend(febs), [&nameCore, &nameStar](const auto& feb) {
+      return nsw::getElementType(feb.getScaAddress()) == "PFEB" and
+        (nsw::contains(feb.getScaAddress(), nameCore) or nsw::contains(feb.getScaAddress(), nameStar));
+    });
+    if (connected) {
+      m_inputs.push_back(it);
+    }
+  }
+  if (m_inputs.empty()) {
+    ers::warning(NSWsTGCPadsHitRateL1aIssue(ERS_HERE, "No PFEB is a pad trigger input, the precision is never reached"));
+  }
+  ERS_INFO(fmt::format("Counting the hits of {} pad trigger inputs", m_inputs.size()));
+}
+
+void nsw::sTGCPadsHitRateL1a::writeLiveTime(const std::chrono::milliseconds liveTime,
+                                            const std::optional<PoissonDwell>& dwell) const {
+  const auto fname = fmt::format("{}.{}.{}.livetime.txt", m_calibType, runNumber(), applicationName());
+  if (isFirstIteration()) {
+    ERS_LOG("Opening " << fname);
+  }
+  auto myfile = openOutputText("livetime", fname);
+  myfile << fmt::format("Iteration {:02} Adjustment {} LiveTimeMs {}", counter(),
+                        m_thresholdAdjustments.at(counter()), liveTime.count());
+  if (dwell) {
+    myfile << fmt::format(" Hits {:.0f} MinHits {:.0f} RelativeError {:.4f}",
+                          dwell->getHits(), dwell->getMinHits(), dwell->getRelativeError());
   }
+  myfile << std::endl;
+  myfile.close();
 }
 
 void nsw::sTGCPadsHitRateL1a::checkObjects() const {
@@ -35,8 +143,8 @@ void nsw::sTGCPadsHitRateL1a::checkObjects() const {
   const std::size_t nfebs = getDeviceManager().getFebs().size();
   ERS_INFO(fmt::format("Found {} pad triggers", npads));
   ERS_INFO(fmt::format("Found {} FEBs", nfebs));
-  if (npads != std::size_t{1}) {
-    const auto msg = std::string("Requires 1 pad trigger");
+  if (npads == 0) {
+    const auto msg = std::string("Requires at least 1 pad trigger");
     ers::error(nsw::NSWsTGCPadsHitRateL1aIssue(ERS_HERE, msg));
   }
 }
@@ -89,9 +197,38 @@ void nsw::sTGCPadsHitRateL1a::setCalibParamsFromIS(const ISInfoDictionary& is_di
   if (is_dictionary.contains(name)) {
     ISInfoDynAny infoany;
     is_dictionary.getValue(name, infoany);
-    const auto val = std::stoul(infoany.getAttributeValue<std::string>(0));
+    setCalibParams(infoany.getAttributeValue<std::string>(0));
+  }
+}
+
+void nsw::sTGCPadsHitRateL1a::setCalibParams(const std::string& calibParams) {
+  // a plain number of seconds, as before the key=value parameters
+  if (calibParams.find('=') == std::string::npos) {
+    const auto val = std::stoul(calibParams);
     m_acquire_time = std::chrono::seconds(val);
-    ERS_INFO(fmt::format("Found acquire time in IS: {}", m_acquire_time));
+    ERS_INFO(fmt::format("Found acquire time: {}", m_acquire_time));
+    return;
+  }
+  for (const auto& [key, value] : nsw::calib::utils::parseKeyValues(calibParams)) {
+    if (key == "time") {
+      m_acquire_time = std::chrono::seconds(std::stoul(value));
+    } else if (key == "precision") {
+      m_precision = std::stod(value);
+    } else if (key == "max_time") {
+      m_max_time = std::chrono::seconds(std::stoul(value));
+    } else if (key == "poll") {
+      m_poll = std::chrono::milliseconds(std::stoul(value));
+    } else {
+      throw NSWsTGCPadsHitRateL1aIssue(ERS_HERE, fmt::format("Unknown {} parameter {}, expected time, "
+                                                             "precision, max_time or poll", m_calibType, key));
+    }
+  }
+  if (m_precision) {
+    // throws if inconsistent
+    PoissonDwell{*m_precision, m_poll, m_max_time};
+    ERS_INFO(fmt::format("Found precision {}, polling every {} for at most {}", *m_precision, m_poll, m_max_time));
+  } else {
+    ERS_INFO(fmt::format("Found acquire time: {}", m_acquire_time));
   }
 }
 
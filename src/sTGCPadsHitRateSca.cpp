@@ -1,16 +1,70 @@
 #include "NSWCalibration/sTGCPadsHitRateSca.h"
 #include <fmt/core.h>
 #include <ers/ers.h>
+#include <is/infodynany.h>
+#include <is/infodictionary.h>
 #include "NSWCalibration/Utility.h"
 
 nsw::sTGCPadsHitRateSca::sTGCPadsHitRateSca(std::string calibType,
                                             const hw::DeviceManager& deviceManager):
-  CalibAlg(std::move(calibType), deviceManager)
+  CalibAlg(std::move(calibType), deviceManager),
+  m_multiplexed{m_calibType == "sTGCPadsHitRateScaMultiplexed"}
 {
   setTotal(m_thresholdAdjustments.size() * nsw::tds::NUM_CH_PER_PAD_TDS);
 }
 
+void nsw::sTGCPadsHitRateSca::setup(const std::string& /* db */) {
+  if (not m_multiplexed) {
+    return;
+  }
+  m_design = std::make_unique<GroupTestingDesign>(nsw::tds::NUM_CH_PER_PAD_TDS, m_numRows);
+  std::size_t iterations{0};
+  for (std::size_t threshold = 0; threshold < m_thresholdAdjustments.size(); threshold++) {
+    iterations += getNumIterationsPerThreshold(threshold);
+  }
+  setTotal(iterations);
+  ERS_INFO(fmt::format("Measuring {} TDS channels in {} sets per threshold from the nominal one, "
+                       "one channel at a time below, {} iterations",
+                       nsw::tds::NUM_CH_PER_PAD_TDS, m_numRows, total()));
+}
+
+void nsw::sTGCPadsHitRateSca::setCalibParamsFromIS(const ISInfoDictionary& is_dictionary,
+                                                   const std::string& is_db_name) {
+  if (not m_multiplexed) {
+    return;
+  }
+  // optional, e.g. "rows=13,residual=0.1"
+  const auto name = fmt::format("{}.Calib.calibParams", is_db_name);
+  if (is_dictionary.contains(name)) {
+    ISInfoDynAny infoany;
+    is_dictionary.getValue(name, infoany);
+    setCalibParams(infoany.getAttributeValue<std::string>(0));
+  }
+}
+
+void nsw::sTGCPadsHitRateSca::setCalibParams(const std::string& calibParams) {
+  if (not m_multiplexed) {
+    CalibAlg::setCalibParams(calibParams);
+    return;
+  }
+  for (const auto& [key, value] : nsw::calib::utils::parseKeyValues(calibParams)) {
+    if (key == "rows") {
+      m_numRows = std::stoul(value);
+    } else if (key == "residual") {
+      m_maxResidual = std::stod(value);
+    } else {
+      throw NSWsTGCPadsHitRateScaIssue(ERS_HERE, fmt::format("Unknown {} parameter {}, expected rows or residual",
+                                                             m_calibType, key));
+    }
+  }
+}
+
 void nsw::sTGCPadsHitRateSca::configure() {
+  if (isMultiplexed(getCurrentVmmThreshold()) and resuming() and isFirstIteration() and not updateVmmThresholds()) {
+    // the rates of the previous sets of this threshold are lost
+    throw NSWsTGCPadsHitRateScaIssue(ERS_HERE, fmt::format("{} can only be resumed at a threshold change",
+                                                           m_calibType));
+  }
   if (updateVmmThresholds()) {
     setVmmThresholds();
   }
@@ -18,16 +72,27 @@ void nsw::sTGCPadsHitRateSca::configure() {
 }
 
 void nsw::sTGCPadsHitRateSca::acquire() {
-  if (counter() == 0) {
+  if (isFirstIteration()) {
     setupTree();
+    if (m_multiplexed) {
+      setupRawTree();
+    }
   }
-  nsw::snooze(2 * nsw::padtrigger::PFEB_HIT_RATE_TIME);
+  sleepFor(2 * nsw::padtrigger::PFEB_HIT_RATE_TIME);
+  const auto multiplexed = isMultiplexed(getCurrentVmmThreshold());
   for (const auto& dev: getDeviceManager().getPadTriggers()) {
     const auto rates = dev.readPFEBRates();
     for (std::size_t pfeb = 0; pfeb < rates.size(); pfeb++) {
-      fillTree(pfeb, rates.at(pfeb));
+      if (multiplexed) {
+        fillRawTree(pfeb, rates.at(pfeb));
+      } else {
+        fillTree(pfeb, rates.at(pfeb));
+      }
     }
   }
+  if (multiplexed and getCurrentTdsChannel() == getNumIterationsPerThreshold(getCurrentVmmThreshold()) - 1) {
+    decodeRates();
+  }
   if (counter() == total() - 1) {
     closeTree();
   }
@@ -49,22 +114,30 @@ void nsw::sTGCPadsHitRateSca::setupTree() {
   m_app_name = applicationName();
   m_sector = nsw::guessSector(m_app_name);
   m_now = nsw::calib::utils::strf_time();
-  m_rname = fmt::format("{}.{}.{}.{}.root", m_calibType, m_runnumber, m_app_name, m_now);
+  m_rname = outputFileName("nsw", fmt::format("{}.{}.{}.{}.root", m_calibType, m_runnumber, m_app_name, m_now));
   ERS_INFO(fmt::format("Opening TFile/TTree {}", m_rname));
-  m_rfile = std::make_unique< TFile >(m_rname.c_str(), "recreate");
+  m_rfile = std::make_unique< TFile >(m_rname.c_str(), outputFileMode());
   m_rtree = std::make_shared< TTree >("nsw", "nsw");
   m_rtree->Branch("runnumber",   &m_runnumber);
   m_rtree->Branch("appname",     &m_app_name);
   m_rtree->Branch("sector",      &m_sector);
   m_rtree->Branch("name",        &m_pt_name);
   m_rtree->Branch("time",        &m_now);
-  m_rtree->Branch("rate",        &m_rate);
+  if (m_multiplexed) {
+    m_rtree->Branch("rate",      &m_decoded_rate);
+    m_rtree->Branch("decoded",   &m_decoded);
+    m_rtree->Branch("residual",  &m_residual);
+    m_rtree->Branch("large_residual", &m_large_residual);
+  } else {
+    m_rtree->Branch("rate",      &m_rate);
+  }
   m_rtree->Branch("threshold",   &m_threshold);
   m_rtree->Branch("pfeb_addr",   &m_pfeb);
   m_rtree->Branch("tds_chan",    &m_tds_chan);
   for (const auto& dev: getDeviceManager().getPadTriggers()) {
     m_pt_name = dev.getName();
   }
+  attachTree(*m_rfile, *m_rtree);
 }
 
 void nsw::sTGCPadsHitRateSca::fillTree(const std::uint32_t pfeb,
@@ -73,13 +146,74 @@ void nsw::sTGCPadsHitRateSca::fillTree(const std::uint32_t pfeb,
   m_tds_chan = getCurrentTdsChannel();
   m_pfeb = pfeb;
   m_rate = rate;
+  // measured one channel at a time, also below the nominal threshold in multiplexed mode
+  m_decoded_rate = rate;
+  m_decoded = false;
+  m_residual = 0;
+  m_large_residual = false;
   m_rtree->Fill();
 }
 
 void nsw::sTGCPadsHitRateSca::closeTree() {
   ERS_INFO("Closing TFile/TTree");
-  m_rtree->Write();
-  m_rfile->Close();
+  writeTree(*m_rfile, *m_rtree);
+  if (m_multiplexed) {
+    writeTree(*m_raw_rfile, *m_raw_rtree);
+  }
+}
+
+void nsw::sTGCPadsHitRateSca::setupRawTree() {
+  m_raw_rname = outputFileName("raw", fmt::format("{}.{}.{}.{}.raw.root", m_calibType, m_runnumber, m_app_name, m_now));
+  ERS_INFO(fmt::format("Opening TFile/TTree {}", m_raw_rname));
+  m_raw_rfile = std::make_unique< TFile >(m_raw_rname.c_str(), outputFileMode());
+  m_raw_rtree = std::make_shared< TTree >("nsw", "nsw");
+  m_raw_rtree->Branch("runnumber",   &m_runnumber);
+  m_raw_rtree->Branch("name",        &m_pt_name);
+  m_raw_rtree->Branch("rate",        &m_rate);
+  m_raw_rtree->Branch("threshold",   &m_threshold);
+  m_raw_rtree->Branch("pfeb_addr",   &m_pfeb);
+  m_raw_rtree->Branch("row",         &m_row);
+  m_raw_rtree->Branch("tds_chans",   &m_tds_chans);
+  attachTree(*m_raw_rfile, *m_raw_rtree);
+}
+
+void nsw::sTGCPadsHitRateSca::fillRawTree(const std::uint32_t pfeb,
+                                          const std::uint32_t rate) {
+  m_threshold = getCurrentVmmThreshold();
+  m_row = getCurrentTdsChannel();
+  m_tds_chans = m_design->getOpenChannels(m_row);
+  m_pfeb = pfeb;
+  m_rate = rate;
+  m_raw_rtree->Fill();
+  m_rowRates.resize(std::max(m_rowRates.size(), std::size_t{pfeb} + 1),
+                    std::vector<double>(m_design->getNumRows(), 0));
+  m_rowRates.at(pfeb).at(m_row) = rate;
+}
+
+void nsw::sTGCPadsHitRateSca::decodeRates() {
+  m_threshold = getCurrentVmmThreshold();
+  for (std::size_t pfeb = 0; pfeb < m_rowRates.size(); pfeb++) {
+    const auto decoded = m_design->decode(m_rowRates.at(pfeb));
+    const auto total = m_rowRates.at(pfeb).front();
+    ERS_LOG(fmt::format("PFEB {} at threshold {}: total rate {}, residual {:.1f}",
+                        pfeb, m_threshold, total, decoded.residual));
+    m_pfeb = pfeb;
+    m_decoded = true;
+    m_residual = decoded.residual;
+    // the rates of the channels do not explain the rates of the sets, e.g. too many active channels
+    m_large_residual = decoded.residual > m_maxResidual * total;
+    if (m_large_residual) {
+      ers::warning(NSWsTGCPadsHitRateScaIssue(ERS_HERE, fmt::format(
+        "PFEB {} at threshold {}: residual {:.1f} above {} of the total rate {}, its decoded rates are flagged",
+        pfeb, m_threshold, decoded.residual, m_maxResidual, total)));
+    }
+    for (std::size_t chan = 0; chan < decoded.rates.size(); chan++) {
+      m_tds_chan = chan;
+      m_decoded_rate = decoded.rates.at(chan);
+      m_rtree->Fill();
+    }
+  }
+  m_rowRates.clear();
 }
 
 void nsw::sTGCPadsHitRateSca::setCurrentTdsChannels() const {
@@ -107,6 +241,19 @@ void nsw::sTGCPadsHitRateSca::setCurrentTdsChannel(const nsw::hw::FEB& dev) cons
 }
 
 __uint128_t nsw::sTGCPadsHitRateSca::getCurrentTdsChannelMask() const {
+  if (isMultiplexed(getCurrentVmmThreshold())) {
+    // masked channels are set
+    std::uint64_t lsbs{~std::uint64_t{0}};
+    std::uint64_t msbs{~std::uint64_t{0}};
+    for (const auto chan : m_design->getOpenChannels(getCurrentTdsChannel())) {
+      if (chan >= nsw::NUM_BITS_IN_WORD64) {
+        msbs &= ~(std::uint64_t{1} << (chan - nsw::NUM_BITS_IN_WORD64));
+      } else {
+        lsbs &= ~(std::uint64_t{1} << chan);
+      }
+    }
+    return nsw::constructUint128t(msbs, lsbs);
+  }
   const auto currentChan = getCurrentTdsChannel();
   const bool inMsbs = currentChan >= nsw::NUM_BITS_IN_WORD64;
   const std::uint64_t one{1};
@@ -117,16 +264,37 @@ __uint128_t nsw::sTGCPadsHitRateSca::getCurrentTdsChannelMask() const {
   return nsw::constructUint128t(msbs, lsbs);
 }
 
+// dense rates below the nominal threshold would be smeared by the decoding
+bool nsw::sTGCPadsHitRateSca::isMultiplexed(const std::size_t threshold) const {
+  return m_multiplexed and m_thresholdAdjustments.at(threshold) >= 0;
+}
+
+std::size_t nsw::sTGCPadsHitRateSca::getNumIterationsPerThreshold(const std::size_t threshold) const {
+  return isMultiplexed(threshold) ? m_design->getNumRows() : nsw::tds::NUM_CH_PER_PAD_TDS;
+}
+
 std::size_t nsw::sTGCPadsHitRateSca::getCurrentVmmThreshold() const {
-  return counter() / nsw::tds::NUM_CH_PER_PAD_TDS;
+  std::size_t start{0};
+  for (std::size_t threshold = 0; threshold < m_thresholdAdjustments.size(); threshold++) {
+    start += getNumIterationsPerThreshold(threshold);
+    if (counter() < start) {
+      return threshold;
+    }
+  }
+  return m_thresholdAdjustments.size() - 1;
 }
 
+// in multiplexed mode, the row of the design
 std::size_t nsw::sTGCPadsHitRateSca::getCurrentTdsChannel() const {
-  return counter() % nsw::tds::NUM_CH_PER_PAD_TDS;
+  std::size_t start{0};
+  for (std::size_t threshold = 0; threshold < getCurrentVmmThreshold(); threshold++) {
+    start += getNumIterationsPerThreshold(threshold);
+  }
+  return counter() - start;
 }
 
 bool nsw::sTGCPadsHitRateSca::updateVmmThresholds() const {
-  return counter() % nsw::tds::NUM_CH_PER_PAD_TDS == 0;
+  return getCurrentTdsChannel() == 0;
 }
 
 void nsw::sTGCPadsHitRateSca::setVmmThresholds() const {
@@ -1,10 +1,15 @@
 #include "NSWCalibration/sTGCPadsL1DDCFibers.h"
+#include <algorithm>
 #include <stdexcept>
+#include <boost/property_tree/json_parser.hpp>
 #include <fmt/core.h>
 #include <ers/ers.h>
 #include "NSWCalibration/Utility.h"
 #include "NSWConfiguration/I2cMasterConfig.h"
 
+#include <is/infodynany.h>
+#include <is/infodictionary.h>
+
 nsw::sTGCPadsL1DDCFibers::sTGCPadsL1DDCFibers(std::string calibType,
                                               const hw::DeviceManager& deviceManager) :
   CalibAlg(std::move(calibType), deviceManager)
@@ -12,34 +17,162 @@ nsw::sTGCPadsL1DDCFibers::sTGCPadsL1DDCFibers(std::string calibType,
   checkObjects();
 
   // set number of iterations
-  // N(phases per L-side) * N(phases per R-side)
-  setTotal(nsw::roc::NUM_PHASES_EPLL_TDS_40MHZ / m_phaseStep *
-           nsw::roc::NUM_PHASES_EPLL_TDS_40MHZ / m_phaseStep);
+  // full:      N(phases per L-side) * N(phases per R-side)
+  // separable: N(phases), the same for both sides
+  m_separable = (m_calibType == "sTGCPadsL1DDCFibers_Separable");
+  const auto nphases = nsw::roc::NUM_PHASES_EPLL_TDS_40MHZ / m_phaseStep;
+  setTotal(m_separable ? nphases : nphases * nphases);
+}
+
+void nsw::sTGCPadsL1DDCFibers::setup(const std::string& /* db */) {
+  m_stats = std::make_unique<BcidStatistics>(nsw::padtrigger::NUM_PFEBS, m_stableFraction);
+  m_separableColumns.clear();
+}
+
+void nsw::sTGCPadsL1DDCFibers::setCalibParamsFromIS(const ISInfoDictionary& is_dictionary,
+                                                    const std::string& is_db_name) {
+  // optional, e.g. "raw=1"
+  const auto name = fmt::format("{}.Calib.calibParams", is_db_name);
+  if (is_dictionary.contains(name)) {
+    ISInfoDynAny infoany;
+    is_dictionary.getValue(name, infoany);
+    setCalibParams(infoany.getAttributeValue<std::string>(0));
+  }
+}
+
+void nsw::sTGCPadsL1DDCFibers::setCalibParams(const std::string& calibParams) {
+  for (const auto& [key, value] : nsw::calib::utils::parseKeyValues(calibParams)) {
+    if (key == "raw") {
+      m_raw = std::stoul(value) != 0;
+    } else if (key == "stable") {
+      m_stableFraction = std::stod(value);
+    } else {
+      throw NSWsTGCPadsL1DDCFibersIssue(ERS_HERE, fmt::format("Unknown {} parameter {}, expected raw or stable",
+                                                              m_calibType, key));
+    }
+  }
 }
 
 void nsw::sTGCPadsL1DDCFibers::configure() {
-  if (counter() == 0) {
+  if (isFirstIteration()) {
     setupTree();
+    if (m_raw) {
+      setupRawTree();
+    }
   }
   setPhases();
   setROCPhases();
-  for (auto i = m_numReads; i > 0; i--) {
-    m_bcid = getPadTriggerBCIDs();
+  m_stats->reset();
+  const auto raw = m_raw ? BcidStatistics::RawCallback{
+    [this](const std::size_t read, const std::vector<std::uint32_t>& bcids) {
+      m_read = static_cast<std::uint32_t>(read);
+      m_bcid = bcids;
+      m_raw_rtree->Fill();
+    }} : BcidStatistics::RawCallback{};
+  m_stats->read([this]() { return getPadTriggerBCIDs(); }, m_numReads, raw);
+
+  // the BCID of a PFEB only depends on the phase of its own side
+  std::vector<std::uint32_t> phases{};
+  for (std::size_t it = 0; it < nsw::padtrigger::NUM_PFEBS; it++) {
+    const auto left = it < m_left.size() and m_left.at(it);
+    phases.push_back(left ? m_phase_L : m_phase_R);
+  }
+  m_stats->record(phases);
+
+  if (m_separable) {
+    m_separableColumns.insert_or_assign(m_phase_L, m_stats->getColumns());
+  } else {
+    m_columns = m_stats->getColumns();
     fillTree();
   }
 }
 
 void nsw::sTGCPadsL1DDCFibers::unconfigure() {
   if (counter() == total() - 1) {
+    if (m_separable) {
+      fillSeparableTree();
+    }
     closeTree();
+    writePatch();
   }
 }
 
 void nsw::sTGCPadsL1DDCFibers::setPhases() {
+  if (m_separable) {
+    m_phase_L = counter() * m_phaseStep;
+    m_phase_R = m_phase_L;
+    return;
+  }
   m_phase_L = (counter() / (nsw::roc::NUM_PHASES_EPLL_TDS_40MHZ / m_phaseStep)) * m_phaseStep;
   m_phase_R = (counter() % (nsw::roc::NUM_PHASES_EPLL_TDS_40MHZ / m_phaseStep)) * m_phaseStep;
 }
 
+void nsw::sTGCPadsL1DDCFibers::fillSeparableTree() {
+  //
+  // The BCID of a PFEB only depends on the phase of its own side.
+  // Every (L, R) pair of the full scan is rebuilt from the L-side PFEBs
+  //   at phase L and the R-side PFEBs at phase R, so that the tree is the
+  //   same as for the full scan.
+  //
+  ERS_INFO(fmt::format("Combining {} phases into {} (L, R) pairs",
+                       m_separableColumns.size(), m_separableColumns.size() * m_separableColumns.size()));
+  for (const auto& [phase_L, columns_L]: m_separableColumns) {
+    for (const auto& [phase_R, columns_R]: m_separableColumns) {
+      m_phase_L = phase_L;
+      m_phase_R = phase_R;
+      m_columns = BcidStatistics::Columns{};
+      for (std::size_t it = 0; it < std::min(columns_L.mode.size(), columns_R.mode.size()); it++) {
+        const auto left = it < m_left.size() and m_left.at(it);
+        const auto& columns = left ? columns_L : columns_R;
+        m_columns.mode.push_back(columns.mode.at(it));
+        m_columns.spread.push_back(columns.spread.at(it));
+        m_columns.fraction.push_back(columns.fraction.at(it));
+        m_columns.stable.push_back(columns.stable.at(it));
+      }
+      fillTree();
+    }
+  }
+}
+
+void nsw::sTGCPadsL1DDCFibers::writePatch() const {
+  // SCA addresses and register names contain dots, which put/add_child would take as a path
+  boost::property_tree::ptree patch;
+  std::vector<std::string> failed{};
+  for (const auto& feb: getDeviceManager().getFebs()) {
+    if (feb.getGeoInfo().resourceType() != "PFEB") {
+      continue;
+    }
+    for (std::size_t it = 0; it < nsw::padtrigger::NUM_PFEBS; it++) {
+      const auto nameCore = std::string(nsw::padtrigger::ORDERED_PFEBS.at(it));
+      const auto nameStar = std::string(nsw::padtrigger::ORDERED_PFEBS_GEOID.at(it));
+      if (not nsw::contains(feb.getScaAddress(), nameCore) and not nsw::contains(feb.getScaAddress(), nameStar)) {
+        continue;
+      }
+      const auto phase = m_stats->getBest(it, true);
+      if (not phase) {
+        failed.push_back(feb.getScaAddress());
+        break;
+      }
+      ERS_INFO(fmt::format("{}: best phase {}", feb.getScaAddress(), *phase));
+      boost::property_tree::ptree value;
+      value.put_value(*phase);
+      boost::property_tree::ptree rocPatch;
+      rocPatch.push_back(std::make_pair(m_reg, value));
+      boost::property_tree::ptree febPatch;
+      febPatch.push_back(std::make_pair("roc", rocPatch));
+      patch.push_back(std::make_pair(feb.getScaAddress(), febPatch));
+      break;
+    }
+  }
+  const auto name = fmt::format("{}.{}.{}.{}.json", m_calibType, runNumber(), applicationName(),
+                                nsw::calib::utils::strf_time());
+  write_json(name, patch);
+  ERS_INFO(fmt::format("ROC 40MHz phases written to {}", name));
+  for (const auto& feb: failed) {
+    ers::warning(NSWsTGCPadsL1DDCFibersIssue(ERS_HERE, fmt::format("No stable phase for {}", feb)));
+  }
+}
+
 void nsw::sTGCPadsL1DDCFibers::setROCPhases() const {
   ERS_INFO(fmt::format("Config L-(R-)side PFEBs {} with {} ({})", m_reg, m_phase_L, m_phase_R));
   auto threads = std::vector< std::future<void> >();
@@ -127,9 +260,9 @@ void nsw::sTGCPadsL1DDCFibers::setupTree() {
   m_now = nsw::calib::utils::strf_time();
   m_reads = m_numReads;
   m_step  = m_phaseStep;
-  m_rname = fmt::format("{}.{}.{}.{}.root",
-            m_calibType, m_runnumber, m_app_name, m_now);
-  m_rfile = std::make_unique< TFile >(m_rname.c_str(), "recreate");
+  m_rname = outputFileName("nsw", fmt::format("{}.{}.{}.{}.root",
+            m_calibType, m_runnumber, m_app_name, m_now));
+  m_rfile = std::make_unique< TFile >(m_rname.c_str(), outputFileMode());
   m_rtree = std::make_shared< TTree >("nsw", "nsw");
   m_pfeb  = std::vector<std::uint32_t>();
   m_bcid  = std::vector<std::uint32_t>();
@@ -141,9 +274,13 @@ void nsw::sTGCPadsL1DDCFibers::setupTree() {
   m_rtree->Branch("time",        &m_now);
   m_rtree->Branch("nreads",      &m_reads);
   m_rtree->Branch("phase_step",  &m_step);
+  m_rtree->Branch("separable",   &m_separable);
   m_rtree->Branch("phase_L",     &m_phase_L);
   m_rtree->Branch("phase_R",     &m_phase_R);
-  m_rtree->Branch("pfeb_bcid",   &m_bcid);
+  m_rtree->Branch("pfeb_bcid",   &m_columns.mode);
+  m_rtree->Branch("pfeb_bcid_spread",   &m_columns.spread);
+  m_rtree->Branch("pfeb_bcid_fraction", &m_columns.fraction);
+  m_rtree->Branch("pfeb_bcid_stable",   &m_columns.stable);
   m_rtree->Branch("pfeb_index",  &m_pfeb);
   m_rtree->Branch("pfeb_mask",   &m_mask);
   m_rtree->Branch("pfeb_left",   &m_left);
@@ -158,6 +295,7 @@ void nsw::sTGCPadsL1DDCFibers::setupTree() {
     m_mask.push_back(existsInDB(std::string(nameCore)) or existsInDB(std::string(nameStar)));
     m_left.push_back(isLeftStripped(std::string(nameCore)) or isLeftStripped(std::string(nameStar)));
   }
+  attachTree(*m_rfile, *m_rtree);
 }
 
 bool nsw::sTGCPadsL1DDCFibers::existsInDB(const std::string& name) const {
@@ -172,9 +310,24 @@ bool nsw::sTGCPadsL1DDCFibers::existsInDB(const std::string& name) const {
   return false;
 }
 
+void nsw::sTGCPadsL1DDCFibers::setupRawTree() {
+  m_raw_rname = outputFileName("raw", fmt::format("{}.{}.{}.{}.raw.root",
+                m_calibType, m_runnumber, m_app_name, m_now));
+  m_raw_rfile = std::make_unique< TFile >(m_raw_rname.c_str(), outputFileMode());
+  m_raw_rtree = std::make_shared< TTree >("nsw", "nsw");
+  m_raw_rtree->Branch("phase_L",     &m_phase_L);
+  m_raw_rtree->Branch("phase_R",     &m_phase_R);
+  m_raw_rtree->Branch("read",        &m_read);
+  m_raw_rtree->Branch("pfeb_bcid",   &m_bcid);
+  m_raw_rtree->Branch("pfeb_index",  &m_pfeb);
+  attachTree(*m_raw_rfile, *m_raw_rtree);
+}
+
 void nsw::sTGCPadsL1DDCFibers::closeTree() {
   ERS_INFO("Closing TFile/TTree");
-  m_rtree->Write();
-  m_rfile->Close();
+  writeTree(*m_rfile, *m_rtree);
+  if (m_raw_rtree != nullptr) {
+    writeTree(*m_raw_rfile, *m_raw_rtree);
+  }
 }
 
@@ -1,81 +1,330 @@
 #include "NSWCalibration/sTGCPadsRocTds40Mhz.h"
 #include "NSWCalibration/Utility.h"
+#include "NSWConfiguration/Utility.h"
+
+#include <algorithm>
+
+#include <boost/property_tree/json_parser.hpp>
 
 #include <fmt/core.h>
 
 #include <ers/ers.h>
 
+#include <is/infodynany.h>
+#include <is/infodictionary.h>
+
 nsw::sTGCPadsRocTds40Mhz::sTGCPadsRocTds40Mhz(std::string calibType,
                                               const hw::DeviceManager& deviceManager) :
-  CalibAlg(std::move(calibType), deviceManager)
+  CalibAlg(std::move(calibType), deviceManager),
+  m_search{m_calibType == "sTGCPadsRocTds40MhzSearch"}
 {
   checkObjects();
   setTotal(m_totalPhases * nsw::padtrigger::NUM_INPUT_DELAYS * m_numTdsBcidOffsets);
 }
 
+void nsw::sTGCPadsRocTds40Mhz::setup(const std::string& /* db */) {
+  m_written.clear();
+  m_writtenDelay.reset();
+  m_stats = std::make_unique<BcidStatistics>(nsw::padtrigger::NUM_PFEBS, m_stableFraction);
+  mapPfebs();
+  if (not m_search) {
+    return;
+  }
+  m_searchState = std::make_unique<sTGCPadsRocTds40MhzSearch>(nsw::padtrigger::NUM_PFEBS, m_totalPhases, m_phaseStep,
+                                                              nsw::padtrigger::NUM_INPUT_DELAYS, m_numTdsBcidOffsets,
+                                                              m_nominalDelay);
+  for (std::size_t pfeb = 0; pfeb < nsw::padtrigger::NUM_PFEBS; pfeb++) {
+    const auto mapped = std::any_of(std::cbegin(m_pfebIndex), std::cend(m_pfebIndex),
+                                    [pfeb](const auto& entry) { return entry.second == pfeb; });
+    if (not mapped) {
+      // an input without PFEB must not vote for the target BCID
+      m_searchState->exclude(pfeb);
+    }
+  }
+  setTotal(m_searchState->getNumIterations());
+  ERS_INFO(fmt::format("Searching the phases of {} PFEBs at delay {}, then the delays, in {} iterations",
+                       m_pfebIndex.size(), m_nominalDelay, total()));
+}
+
+void nsw::sTGCPadsRocTds40Mhz::setCalibParamsFromIS(const ISInfoDictionary& is_dictionary,
+                                                    const std::string& is_db_name) {
+  // optional, e.g. "delay=4"
+  const auto name = fmt::format("{}.Calib.calibParams", is_db_name);
+  if (is_dictionary.contains(name)) {
+    ISInfoDynAny infoany;
+    is_dictionary.getValue(name, infoany);
+    setCalibParams(infoany.getAttributeValue<std::string>(0));
+  }
+}
+
+void nsw::sTGCPadsRocTds40Mhz::setCalibParams(const std::string& calibParams) {
+  for (const auto& [key, value] : nsw::calib::utils::parseKeyValues(calibParams)) {
+    if (key == "delay" and m_search) {
+      m_nominalDelay = static_cast<std::uint32_t>(std::stoul(value));
+    } else if (key == "raw") {
+      m_raw = std::stoul(value) != 0;
+    } else if (key == "stable") {
+      m_stableFraction = std::stod(value);
+    } else {
+      throw NSWsTGCPadsRocTds40MhzIssue(ERS_HERE, fmt::format("Unknown {} parameter {}, expected {}raw or stable",
+                                                              m_calibType, key, m_search ? "delay, " : ""));
+    }
+  }
+  if (m_nominalDelay >= nsw::padtrigger::NUM_INPUT_DELAYS) {
+    throw NSWsTGCPadsRocTds40MhzIssue(ERS_HERE, fmt::format("{} needs delay < {}, got {}", m_calibType,
+                                                            nsw::padtrigger::NUM_INPUT_DELAYS, m_nominalDelay));
+  }
+}
+
 void nsw::sTGCPadsRocTds40Mhz::configure() {
-  if (counter() == 0) {
+  if (isFirstIteration()) {
+    if (m_search and resuming()) {
+      // the windows of the delay stage come from all previous reads
+      throw NSWsTGCPadsRocTds40MhzIssue(ERS_HERE, fmt::format("{} cannot be resumed, restart it", m_calibType));
+    }
     openTree();
+    if (m_raw) {
+      openRawTree();
+    }
+  }
+  if (m_search) {
+    m_stage    = m_searchState->getStage(counter());
+    m_pt_delay = m_searchState->getDelay();
+    m_offset   = m_searchState->getOffset();
+    m_phase    = 0;
+    m_pfeb_phase = m_searchState->getPhases();
+  } else {
+    m_pt_delay = ((counter() % nsw::padtrigger::NUM_INPUT_DELAYS));
+    m_phase    = ((counter() / nsw::padtrigger::NUM_INPUT_DELAYS) % (m_totalPhases)) * m_phaseStep;
+    m_offset   = ((counter() / nsw::padtrigger::NUM_INPUT_DELAYS) / (m_totalPhases));
   }
-  m_pt_delay = ((counter() % nsw::padtrigger::NUM_INPUT_DELAYS));
-  m_phase    = ((counter() / nsw::padtrigger::NUM_INPUT_DELAYS) % (m_totalPhases)) * m_phaseStep;
-  m_offset   = ((counter() / nsw::padtrigger::NUM_INPUT_DELAYS) / (m_totalPhases));
   setFebsParameters();
   setPadTriggerDelays();
-  nsw::snooze(std::chrono::milliseconds{100});
+  sleepFor(std::chrono::milliseconds{100});
 }
 
 void nsw::sTGCPadsRocTds40Mhz::acquire() {
   m_error = getPadTriggerBcidErrors();
-  m_bcid = getPadTriggerBcids();
+  m_stats->reset();
+  const auto raw = m_raw ? BcidStatistics::RawCallback{
+    [this](const std::size_t read, const std::vector<std::uint32_t>& bcids) {
+      m_read = static_cast<std::uint32_t>(read);
+      m_raw_bcid = bcids;
+      m_raw_rtree->Fill();
+    }} : BcidStatistics::RawCallback{};
+  m_stats->read([this]() { return getPadTriggerBcids(); }, m_numReads, raw);
+  m_columns = m_stats->getColumns();
   fillTree();
+  if (m_search) {
+    m_searchState->addResult(m_columns.mode);
+  } else if (m_pt_delay == 0 and m_offset == 0) {
+    // the phase window does not depend on the delay and offset, which only shift the BCID
+    m_stats->record(m_phase);
+  }
 }
 
 void nsw::sTGCPadsRocTds40Mhz::unconfigure() {
   if (counter() == total() - 1) {
     closeTree();
+    if (m_search) {
+      writePatch();
+    } else {
+      writePhasePatch();
+    }
   }
 }
 
-void nsw::sTGCPadsRocTds40Mhz::setPadTriggerDelays() const {
+void nsw::sTGCPadsRocTds40Mhz::setPadTriggerDelays() {
+  if (m_writtenDelay == m_pt_delay) {
+    return;
+  }
   ERS_INFO(fmt::format("Setting pad trigger input delays to {}", m_pt_delay));
   for (const auto& dev: getDeviceManager().getPadTriggers()) {
     dev.writePFEBCommonDelay(m_pt_delay);
   }
+  m_writtenDelay = m_pt_delay;
 }
 
-void nsw::sTGCPadsRocTds40Mhz::setFebsParameters() const {
-  ERS_INFO(fmt::format("Config PFEB ROCs {} with {} and TDSs {} with {}",
-                       m_rocTds40, m_phase, m_tdsBcidOffset, m_offset));
-  auto threads = std::vector< std::future<void> >();
+void nsw::sTGCPadsRocTds40Mhz::setFebsParameters() {
+  if (m_search) {
+    ERS_INFO(fmt::format("Config PFEB ROCs {} ({} stage) and TDSs {} with {}",
+                         m_rocTds40, m_stage, m_tdsBcidOffset, m_offset));
+  } else {
+    ERS_INFO(fmt::format("Config PFEB ROCs {} with {} and TDSs {} with {}",
+                         m_rocTds40, m_phase, m_tdsBcidOffset, m_offset));
+  }
+  auto threads = std::vector< std::future<bool> >();
+  auto settings = std::vector< std::pair<std::string, std::optional<FebSettings>> >();
   for (const auto& feb: getDeviceManager().getFebs()) {
     threads.push_back(
       std::async(std::launch::async, &nsw::sTGCPadsRocTds40Mhz::setFebParameters, this, feb)
     );
+    settings.emplace_back(feb.getScaAddress(), getFebSettings(feb));
   }
-  for (auto& thr: threads) {
-    thr.get();
+  // the threads read the written settings: wait for all of them before updating
+  auto done = std::vector<bool>();
+  done.reserve(threads.size());
+  for (auto& thread: threads) {
+    done.push_back(thread.get());
+  }
+  for (std::size_t it = 0; it < settings.size(); it++) {
+    const auto& [name, setting] = settings.at(it);
+    if (done.at(it) and setting) {
+      m_written.insert_or_assign(name, *setting);
+    }
   }
 }
 
-void nsw::sTGCPadsRocTds40Mhz::setFebParameters(const nsw::hw::FEB& feb) const {
-  if (feb.getGeoInfo().resourceType() != "PFEB") {
-    return;
+bool nsw::sTGCPadsRocTds40Mhz::setFebParameters(const nsw::hw::FEB& feb) const {
+  const auto settings = getFebSettings(feb);
+  if (not settings) {
+    return false;
+  }
+  const auto written = m_written.find(feb.getScaAddress());
+  const auto writePhase  = written == std::cend(m_written) or written->second.phase  != settings->phase;
+  const auto writeOffset = written == std::cend(m_written) or written->second.offset != settings->offset;
+  if (not writePhase and not writeOffset) {
+    return true;
   }
   ERS_INFO(fmt::format("Config {}", feb.getScaAddress()));
   if (feb.getRoc().ping() == nsw::hw::ScaStatus::REACHABLE) {
-    feb.getRoc().writeValue(std::string{m_rocTds40}, m_phase);
-    for (const auto& tds: feb.getTdss()) {
-      tds.writeValue(std::string{m_tdsBcidOffset}, m_offset);
+    if (writePhase) {
+      feb.getRoc().writeValue(std::string{m_rocTds40}, settings->phase);
     }
-  } else {
-    ERS_INFO(fmt::format("Skipping unreachable {}", feb.getScaAddress()));
+    if (writeOffset) {
+      for (const auto& tds: feb.getTdss()) {
+        tds.writeValue(std::string{m_tdsBcidOffset}, settings->offset);
+      }
+    }
+    return true;
+  }
+  ERS_INFO(fmt::format("Skipping unreachable {}", feb.getScaAddress()));
+  return false;
+}
+
+std::optional<nsw::sTGCPadsRocTds40Mhz::FebSettings>
+nsw::sTGCPadsRocTds40Mhz::getFebSettings(const nsw::hw::FEB& feb) const {
+  if (feb.getGeoInfo().resourceType() != "PFEB") {
+    return std::nullopt;
+  }
+  if (not m_search) {
+    return FebSettings{m_phase, m_offset};
+  }
+  const auto found = m_pfebIndex.find(feb.getScaAddress());
+  if (found == std::cend(m_pfebIndex)) {
+    return std::nullopt;
+  }
+  return FebSettings{m_searchState->getPhases().at(found->second), m_offset};
+}
+
+void nsw::sTGCPadsRocTds40Mhz::mapPfebs() {
+  m_pfebIndex.clear();
+  for (const auto& feb: getDeviceManager().getFebs()) {
+    if (feb.getGeoInfo().resourceType() != "PFEB") {
+      continue;
+    }
+    for (std::size_t it = 0; it < nsw::padtrigger::NUM_PFEBS; it++) {
+      const auto nameCore = std::string(nsw::padtrigger::ORDERED_PFEBS.at(it));
+      const auto nameStar = std::string(nsw::padtrigger::ORDERED_PFEBS_GEOID.at(it));
+      if (nsw::contains(feb.getScaAddress(), nameCore) or nsw::contains(feb.getScaAddress(), nameStar)) {
+        m_pfebIndex.emplace(feb.getScaAddress(), it);
+        break;
+      }
+    }
+    if (m_pfebIndex.count(feb.getScaAddress()) == 0) {
+      ers::warning(NSWsTGCPadsRocTds40MhzIssue(ERS_HERE, fmt::format("{} is not a pad trigger input, "
+                                                                     "it is not configured", feb.getScaAddress())));
+    }
+  }
+}
+
+void nsw::sTGCPadsRocTds40Mhz::writePatch() const {
+  using boost::property_tree::ptree;
+  using Status = sTGCPadsRocTds40MhzSearch::Status;
+  const auto delay = m_searchState->getBestDelay().value_or(m_nominalDelay);
+  ERS_INFO(fmt::format("Pad trigger input delay {}, target BCID {:#x}", delay,
+                       m_searchState->getTargetBcid().value_or(0)));
+
+  // SCA addresses and register names contain dots, which put/add_child would take as a path
+  ptree patch;
+  std::vector<std::string> failed{};
+  for (const auto& feb: getDeviceManager().getFebs()) {
+    const auto found = m_pfebIndex.find(feb.getScaAddress());
+    if (found == std::cend(m_pfebIndex)) {
+      continue;
+    }
+    const auto& result = m_searchState->getResult(found->second);
+    ERS_INFO(fmt::format("{}: {}, stable phases {} to {}, using phase {} and offset {}",
+                         feb.getScaAddress(), sTGCPadsRocTds40MhzSearch::toString(result.status),
+                         result.first, result.last, result.phase, result.offset));
+    if (result.status != Status::Aligned) {
+      failed.push_back(fmt::format("{} ({})", feb.getScaAddress(), sTGCPadsRocTds40MhzSearch::toString(result.status)));
+      continue;
+    }
+    ptree rocPatch;
+    ptree phase;
+    phase.put_value(result.phase);
+    rocPatch.push_back(std::make_pair(std::string{m_rocTds40}, phase));
+    ptree febPatch;
+    febPatch.push_back(std::make_pair("roc", rocPatch));
+    for (std::size_t tds = 0; tds < feb.getTdss().size(); tds++) {
+      ptree tdsPatch;
+      tdsPatch.put(std::string{m_tdsBcidOffset}, result.offset);
+      febPatch.push_back(std::make_pair(fmt::format("tds{}", tds), tdsPatch));
+    }
+    patch.push_back(std::make_pair(feb.getScaAddress(), febPatch));
+  }
+  for (const auto& dev: getDeviceManager().getPadTriggers()) {
+    ptree ptPatch;
+    ptPatch.put("pfeb_common_delay", delay);
+    patch.push_back(std::make_pair(dev.getName(), ptPatch));
+  }
+
+  const auto name = fmt::format("{}.{}.{}.{}.json", m_calibType, runNumber(), applicationName(),
+                                nsw::calib::utils::strf_time());
+  write_json(name, patch);
+  ERS_INFO(fmt::format("ROC/TDS 40MHz settings written to {}", name));
+  for (const auto& pfeb : failed) {
+    ers::warning(NSWsTGCPadsRocTds40MhzIssue(ERS_HERE, fmt::format("No ROC/TDS 40MHz settings for {}", pfeb)));
+  }
+}
+
+void nsw::sTGCPadsRocTds40Mhz::writePhasePatch() const {
+  using boost::property_tree::ptree;
+  // SCA addresses and register names contain dots, which put/add_child would take as a path
+  ptree patch;
+  std::vector<std::string> failed{};
+  for (const auto& feb: getDeviceManager().getFebs()) {
+    const auto found = m_pfebIndex.find(feb.getScaAddress());
+    if (found == std::cend(m_pfebIndex)) {
+      continue;
+    }
+    const auto phase = m_stats->getBest(found->second, true);
+    if (not phase) {
+      failed.push_back(feb.getScaAddress());
+      continue;
+    }
+    ERS_INFO(fmt::format("{}: best phase {}", feb.getScaAddress(), *phase));
+    ptree value;
+    value.put_value(*phase);
+    ptree rocPatch;
+    rocPatch.push_back(std::make_pair(std::string{m_rocTds40}, value));
+    ptree febPatch;
+    febPatch.push_back(std::make_pair("roc", rocPatch));
+    patch.push_back(std::make_pair(feb.getScaAddress(), febPatch));
+  }
+  const auto name = fmt::format("{}.{}.{}.{}.json", m_calibType, runNumber(), applicationName(),
+                                nsw::calib::utils::strf_time());
+  write_json(name, patch);
+  ERS_INFO(fmt::format("ROC/TDS 40MHz phases written to {}", name));
+  for (const auto& pfeb : failed) {
+    ers::warning(NSWsTGCPadsRocTds40MhzIssue(ERS_HERE, fmt::format("No stable phase for {}", pfeb)));
   }
 }
 
 std::vector<std::uint32_t> nsw::sTGCPadsRocTds40Mhz::getPadTriggerBcids() const {
   for (const auto& dev: getDeviceManager().getPadTriggers()) {
-    return dev.readMedianPFEBBCIDs(m_numReads);
+    return dev.readPFEBBCIDs();
   }
   return std::vector<std::uint32_t>();
 }
@@ -118,12 +367,11 @@ void nsw::sTGCPadsRocTds40Mhz::openTree() {
   m_now = nsw::calib::utils::strf_time();
   m_reads = m_numReads;
   m_step  = m_phaseStep;
-  m_rname = fmt::format("{}.{}.{}.{}.root",
-            m_calibType, m_runnumber, m_app_name, m_now);
-  m_rfile = std::make_unique< TFile >(m_rname.c_str(), "recreate");
+  m_rname = outputFileName("nsw", fmt::format("{}.{}.{}.{}.root",
+            m_calibType, m_runnumber, m_app_name, m_now));
+  m_rfile = std::make_unique< TFile >(m_rname.c_str(), outputFileMode());
   m_rtree = std::make_shared< TTree >("nsw", "nsw");
   m_pfeb  = std::vector<std::uint32_t>();
-  m_bcid  = std::vector<std::uint32_t>();
   m_error = std::vector<std::uint32_t>();
   m_rtree->Branch("runnumber",   &m_runnumber);
   m_rtree->Branch("appname",     &m_app_name);
@@ -134,9 +382,16 @@ void nsw::sTGCPadsRocTds40Mhz::openTree() {
   m_rtree->Branch("phase",       &m_phase);
   m_rtree->Branch("bcid_offset", &m_offset);
   m_rtree->Branch("pad_delay",   &m_pt_delay);
-  m_rtree->Branch("pfeb_bcid",   &m_bcid);
+  m_rtree->Branch("pfeb_bcid",   &m_columns.mode);
+  m_rtree->Branch("pfeb_bcid_spread",   &m_columns.spread);
+  m_rtree->Branch("pfeb_bcid_fraction", &m_columns.fraction);
+  m_rtree->Branch("pfeb_bcid_stable",   &m_columns.stable);
   m_rtree->Branch("pfeb_error",  &m_error);
   m_rtree->Branch("pfeb_index",  &m_pfeb);
+  if (m_search) {
+    m_rtree->Branch("pfeb_phase",  &m_pfeb_phase);
+    m_rtree->Branch("stage",       &m_stage);
+  }
   for (const auto& dev: getDeviceManager().getPadTriggers()) {
     m_pt_name = dev.getName();
     break;
@@ -144,11 +399,31 @@ void nsw::sTGCPadsRocTds40Mhz::openTree() {
   for (std::size_t it = 0; it < nsw::padtrigger::NUM_PFEBS; it++) {
     m_pfeb.push_back(m_pfeb.size());
   }
+  attachTree(*m_rfile, *m_rtree);
+}
+
+void nsw::sTGCPadsRocTds40Mhz::openRawTree() {
+  m_raw_rname = outputFileName("raw", fmt::format("{}.{}.{}.{}.raw.root",
+                m_calibType, m_runnumber, m_app_name, m_now));
+  m_raw_rfile = std::make_unique< TFile >(m_raw_rname.c_str(), outputFileMode());
+  m_raw_rtree = std::make_shared< TTree >("nsw", "nsw");
+  m_raw_rtree->Branch("phase",       &m_phase);
+  m_raw_rtree->Branch("bcid_offset", &m_offset);
+  m_raw_rtree->Branch("pad_delay",   &m_pt_delay);
+  m_raw_rtree->Branch("read",        &m_read);
+  m_raw_rtree->Branch("pfeb_bcid",   &m_raw_bcid);
+  m_raw_rtree->Branch("pfeb_index",  &m_pfeb);
+  if (m_search) {
+    m_raw_rtree->Branch("pfeb_phase",  &m_pfeb_phase);
+  }
+  attachTree(*m_raw_rfile, *m_raw_rtree);
 }
 
 void nsw::sTGCPadsRocTds40Mhz::closeTree() {
   ERS_INFO("Closing TFile/TTree");
-  m_rtree->Write();
-  m_rfile->Close();
+  writeTree(*m_rfile, *m_rtree);
+  if (m_raw_rtree != nullptr) {
+    writeTree(*m_raw_rfile, *m_raw_rtree);
+  }
 }
 
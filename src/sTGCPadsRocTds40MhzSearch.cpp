@@ -0,0 +1,235 @@
+#include "NSWCalibration/sTGCPadsRocTds40MhzSearch.h"
+
+#include <map>
+#include <set>
+#include <stdexcept>
+
+#include <fmt/core.h>
+
+nsw::sTGCPadsRocTds40MhzSearch::sTGCPadsRocTds40MhzSearch(const std::size_t numPfebs,
+                                                         const std::uint32_t numPhases,
+                                                         const std::uint32_t phaseStep,
+                                                         const std::uint32_t numDelays,
+                                                         const std::uint32_t numOffsets,
+                                                         const std::uint32_t nominalDelay) :
+  m_numPhases{numPhases},
+  m_phaseStep{phaseStep},
+  m_numDelays{numDelays},
+  m_numOffsets{numOffsets},
+  m_nominalDelay{nominalDelay},
+  m_pfebs(numPfebs),
+  m_phases(numPfebs, 0)
+{
+  if (m_numPhases < 3) {
+    throw std::runtime_error(fmt::format("ROC/TDS 40MHz search needs at least 3 phases, got {}", m_numPhases));
+  }
+  if (m_nominalDelay >= m_numDelays or m_numOffsets == 0) {
+    throw std::runtime_error(fmt::format("ROC/TDS 40MHz search: nominal delay {} must be below {}, with {} offsets",
+                                         m_nominalDelay, m_numDelays, m_numOffsets));
+  }
+  for (auto& pfeb : m_pfebs) {
+    pfeb.phaseBcids.resize(m_numPhases, 0);
+    pfeb.delayBcids.resize(m_numOffsets, std::vector<std::uint32_t>(m_numDelays, 0));
+  }
+  prepare();
+}
+
+void nsw::sTGCPadsRocTds40MhzSearch::exclude(const std::size_t pfeb)
+{
+  if (m_iteration != 0) {
+    throw std::runtime_error("PFEBs can only be excluded before the first result of the ROC/TDS 40MHz search");
+  }
+  m_pfebs.at(pfeb).result.status = Status::Excluded;
+}
+
+std::size_t nsw::sTGCPadsRocTds40MhzSearch::getNumIterations() const
+{
+  return m_numPhases + static_cast<std::size_t>(m_numDelays) * m_numOffsets;
+}
+
+std::string nsw::sTGCPadsRocTds40MhzSearch::getStage(const std::size_t iteration) const
+{
+  return iteration < m_numPhases ? "phase" : "delay";
+}
+
+void nsw::sTGCPadsRocTds40MhzSearch::findWindow(Pfeb& pfeb) const
+{
+  auto& result = pfeb.result;
+  if (result.status != Status::Searching) {
+    return;
+  }
+  const auto& bcids = pfeb.phaseBcids;
+  std::vector<bool> stable(m_numPhases, false);
+  for (std::uint32_t index = 0; index < m_numPhases; index++) {
+    const auto before = bcids.at((index + m_numPhases - 1) % m_numPhases);
+    const auto after = bcids.at((index + 1) % m_numPhases);
+    stable.at(index) = bcids.at(index) == before and bcids.at(index) == after;
+  }
+
+  std::optional<std::uint32_t> firstUnstable{};
+  for (std::uint32_t index = 0; index < m_numPhases and not firstUnstable; index++) {
+    if (not stable.at(index)) {
+      firstUnstable = index;
+    }
+  }
+  if (not firstUnstable) {
+    result.status = Status::NoTransition;
+    result.first = 0;
+    result.last = (m_numPhases - 1) * m_phaseStep;
+    result.phase = (m_numPhases / 2) * m_phaseStep;
+    return;
+  }
+
+  // longest run of stable phases, starting after an unstable one so that
+  // a run through the end of the range is not split
+  std::uint32_t bestStart{0};
+  std::uint32_t bestLength{0};
+  bool inRun{false};
+  std::uint32_t runStart{0};
+  for (std::uint32_t step = 1; step <= m_numPhases; step++) {
+    const auto index = (*firstUnstable + step) % m_numPhases;
+    if (stable.at(index)) {
+      if (not inRun) {
+        inRun = true;
+        runStart = step;
+      }
+      continue;
+    }
+    if (inRun and step - runStart > bestLength) {
+      bestStart = (*firstUnstable + runStart) % m_numPhases;
+      bestLength = step - runStart;
+    }
+    inRun = false;
+  }
+  if (bestLength == 0) {
+    result.status = Status::NoWindow;
+    return;
+  }
+  result.first = bestStart * m_phaseStep;
+  result.last = ((bestStart + bestLength - 1) % m_numPhases) * m_phaseStep;
+  result.phase = ((bestStart + (bestLength - 1) / 2) % m_numPhases) * m_phaseStep;
+}
+
+std::pair<std::uint32_t, std::size_t> nsw::sTGCPadsRocTds40MhzSearch::findTarget(const std::uint32_t delay) const
+{
+  // PFEBs with a phase window which reach each BCID with at least one offset
+  std::map<std::uint32_t, std::size_t> reached{};
+  for (const auto& pfeb : m_pfebs) {
+    if (pfeb.result.status != Status::Searching) {
+      continue;
+    }
+    std::set<std::uint32_t> bcids{};
+    for (std::uint32_t offset = 0; offset < m_numOffsets; offset++) {
+      bcids.insert(pfeb.delayBcids.at(offset).at(delay));
+    }
+    for (const auto bcid : bcids) {
+      reached[bcid]++;
+    }
+  }
+  std::pair<std::uint32_t, std::size_t> best{0, 0};
+  for (const auto& [bcid, count] : reached) {
+    if (count > best.second) {
+      best = {bcid, count};
+    }
+  }
+  return best;
+}
+
+void nsw::sTGCPadsRocTds40MhzSearch::finish()
+{
+  // longest run of delays with the most PFEBs aligned on the same BCID
+  std::size_t bestCount{0};
+  std::uint32_t bestStart{0};
+  std::uint32_t bestLength{0};
+  std::uint32_t runStart{0};
+  std::optional<std::pair<std::uint32_t, std::size_t>> previous{};
+  for (std::uint32_t delay = 0; delay < m_numDelays; delay++) {
+    const auto target = findTarget(delay);
+    if (not previous or *previous != target) {
+      runStart = delay;
+    }
+    previous = target;
+    const auto length = delay - runStart + 1;
+    if (target.second > bestCount or (target.second == bestCount and length > bestLength)) {
+      bestCount = target.second;
+      bestStart = runStart;
+      bestLength = length;
+    }
+  }
+  m_bestDelay = bestStart + (bestLength - 1) / 2;
+  m_target = findTarget(*m_bestDelay).first;
+
+  for (auto& pfeb : m_pfebs) {
+    auto& result = pfeb.result;
+    if (result.status != Status::Searching) {
+      continue;
+    }
+    std::optional<std::uint32_t> offset{};
+    for (std::uint32_t candidate = 0; candidate < m_numOffsets and not offset; candidate++) {
+      if (pfeb.delayBcids.at(candidate).at(*m_bestDelay) == *m_target) {
+        offset = candidate;
+      }
+    }
+    result.offset = offset.value_or(0);
+    result.status = offset ? Status::Aligned : Status::Misaligned;
+  }
+}
+
+void nsw::sTGCPadsRocTds40MhzSearch::prepare()
+{
+  if (done()) {
+    return;
+  }
+  if (getStage(m_iteration) == "phase") {
+    std::fill(std::begin(m_phases), std::end(m_phases), static_cast<std::uint32_t>(m_iteration) * m_phaseStep);
+    m_delay = m_nominalDelay;
+    m_offset = 0;
+    return;
+  }
+  const auto index = m_iteration - m_numPhases;
+  if (index == 0) {
+    for (std::size_t pfeb = 0; pfeb < m_pfebs.size(); pfeb++) {
+      findWindow(m_pfebs.at(pfeb));
+      m_phases.at(pfeb) = m_pfebs.at(pfeb).result.phase;
+    }
+  }
+  m_delay = static_cast<std::uint32_t>(index % m_numDelays);
+  m_offset = static_cast<std::uint32_t>(index / m_numDelays);
+}
+
+void nsw::sTGCPadsRocTds40MhzSearch::addResult(const std::vector<std::uint32_t>& bcids)
+{
+  if (done()) {
+    throw std::runtime_error("ROC/TDS 40MHz search is already done");
+  }
+  if (bcids.size() < m_pfebs.size()) {
+    throw std::runtime_error(fmt::format("Expected {} BCIDs, got {}", m_pfebs.size(), bcids.size()));
+  }
+  const auto phaseStage = getStage(m_iteration) == "phase";
+  for (std::size_t index = 0; index < m_pfebs.size(); index++) {
+    auto& pfeb = m_pfebs.at(index);
+    if (phaseStage) {
+      pfeb.phaseBcids.at(m_iteration) = bcids.at(index);
+    } else {
+      pfeb.delayBcids.at(m_offset).at(m_delay) = bcids.at(index);
+    }
+  }
+  m_iteration++;
+  if (done()) {
+    finish();
+  }
+  prepare();
+}
+
+std::string nsw::sTGCPadsRocTds40MhzSearch::toString(const Status status)
+{
+  switch (status) {
+    case Status::Searching: return "searching";
+    case Status::NoWindow: return "no_window";
+    case Status::NoTransition: return "no_transition";
+    case Status::Misaligned: return "misaligned";
+    case Status::Aligned: return "aligned";
+    case Status::Excluded: return "excluded";
+  }
+  return "unknown";
+}
@@ -1,16 +1,25 @@
 #include "NSWCalibration/sTGCSFEBToRouter.h"
+#include "NSWCalibration/RouterStatusMonitor.h"
 #include "NSWCalibration/Utility.h"
 
 #include "NSWConfiguration/ConfigReader.h"
 #include "NSWConfiguration/ConfigSender.h"
 #include "NSWConfiguration/I2cMasterConfig.h"
 
+#include <algorithm>
+#include <bit>
 #include <cstdlib>
+#include <functional>
+#include <map>
 #include <unistd.h>
 #include <sstream>
 #include <fstream>
 #include <stdexcept>
 #include <fmt/core.h>
+#include <fmt/ranges.h>
+
+#include <is/infodynany.h>
+#include <is/infodictionary.h>
 
 #include "ers/ers.h"
 
@@ -21,8 +30,10 @@ void nsw::sTGCSFEBToRouter::setup(const std::string& db) {
   if (m_calibType=="sTGCSFEBToRouter"   ||
       m_calibType=="sTGCSFEBToRouterQ1" ||
       m_calibType=="sTGCSFEBToRouterQ2" ||
-      m_calibType=="sTGCSFEBToRouterQ3") {
+      m_calibType=="sTGCSFEBToRouterQ3" ||
+      m_calibType=="sTGCSFEBToRouterParallel") {
     ERS_INFO("Calib type: " << m_calibType);
+    m_parallel = m_calibType=="sTGCSFEBToRouterParallel";
   } else {
     std::stringstream msg;
     msg << "Unknown calibration request for sTGCSFEBToRouter: "
@@ -44,7 +55,8 @@ void nsw::sTGCSFEBToRouter::setup(const std::string& db) {
 
   // set number of iterations
   gather_sfebs();
-  setTotal(m_sfebs_ordered.size());
+  group_sfebs();
+  setTotal(m_sfebs_pulsed.size());
 
   nsw::snooze();
 
@@ -63,18 +75,42 @@ void nsw::sTGCSFEBToRouter::setup(const std::string& db) {
   }
 }
 
+void nsw::sTGCSFEBToRouter::setCalibParamsFromIS(const ISInfoDictionary& is_dictionary,
+                                                 const std::string& is_db_name) {
+  // optional, e.g. "timeout=120"
+  const auto name = fmt::format("{}.Calib.calibParams", is_db_name);
+  if (is_dictionary.contains(name)) {
+    ISInfoDynAny infoany;
+    is_dictionary.getValue(name, infoany);
+    setCalibParams(infoany.getAttributeValue<std::string>(0));
+  }
+}
+
+void nsw::sTGCSFEBToRouter::setCalibParams(const std::string& calibParams) {
+  for (const auto& [key, value] : nsw::calib::utils::parseKeyValues(calibParams)) {
+    if (key == "timeout") {
+      m_router_timeout = std::chrono::seconds(std::stoul(value));
+    } else {
+      throw NSWsTGCSFEBToRouterIssue(ERS_HERE, fmt::format("Unknown {} parameter {}, expected timeout",
+                                                           m_calibType, key));
+    }
+  }
+  if (m_router_timeout.count() == 0) {
+    throw NSWsTGCSFEBToRouterIssue(ERS_HERE, fmt::format("{} needs a Router timeout of at least 1s", m_calibType));
+  }
+  ERS_INFO(fmt::format("Waiting at most {}s for the Routers to be ready", m_router_timeout.count()));
+}
+
 void nsw::sTGCSFEBToRouter::configure() {
   ERS_INFO("sTGCSFEBToRouter::configure " << counter());
   const bool prbs  = true;
-  const bool open  = counter() == 0;
+  const bool open  = isFirstIteration();
   const bool close = false;
-  const auto name = m_sfebs_ordered.at(counter());
-  for (const auto & sfeb: m_sfebs)
-    if (sfeb.getAddress().find(name) != std::string::npos)
-      configure_tds(sfeb, prbs);
+  const auto pulsed = m_sfebs_pulsed.at(counter()).size();
+  configure_sfebs(prbs);
   configure_routers();
-  wait_for_routers(m_routers_at_start - 1);
-  router_watchdog(open, close);
+  wait_for_routers(m_routers_at_start > pulsed ? m_routers_at_start - pulsed : 0);
+  router_watchdog(open, close, prbs);
 }
 
 void nsw::sTGCSFEBToRouter::unconfigure() {
@@ -82,13 +118,18 @@ void nsw::sTGCSFEBToRouter::unconfigure() {
   const bool prbs  = false;
   const bool open  = false;
   const bool close = counter() == total() - 1;
-  const auto name = m_sfebs_ordered.at(counter());
-  for (const auto & sfeb: m_sfebs)
-    if (sfeb.getAddress().find(name) != std::string::npos)
-      configure_tds(sfeb, prbs);
+  configure_sfebs(prbs);
   configure_routers();
   wait_for_routers(m_routers_at_start);
-  router_watchdog(open, close);
+  router_watchdog(open, close, prbs);
+}
+
+int nsw::sTGCSFEBToRouter::configure_sfebs(bool enable) const {
+  for (const auto & name: m_sfebs_pulsed.at(counter()))
+    for (const auto & sfeb: m_sfebs)
+      if (sfeb.getAddress().find(name) != std::string::npos)
+        configure_tds(sfeb, enable);
+  return 0;
 }
 
 int nsw::sTGCSFEBToRouter::configure_routers() const {
@@ -156,8 +197,13 @@ void nsw::sTGCSFEBToRouter::gather_sfebs() {
     m_sfebs_ordered.push_back("L4Q1_IP");
   } else {
     // 191
-    if (m_calibType=="sTGCSFEBToRouter" ||
-        m_calibType=="sTGCSFEBToRouterQ1") {
+    if (m_parallel) {
+      for (const std::string quadrant: {"Q1", "Q2", "Q3"})
+        for (const std::string wedge: {"_IP", "_HO"})
+          for (const std::string layer: {"L1", "L2", "L3", "L4"})
+            m_sfebs_ordered.push_back(layer + quadrant + wedge);
+    } else if (m_calibType=="sTGCSFEBToRouter" ||
+               m_calibType=="sTGCSFEBToRouterQ1") {
       m_sfebs_ordered.push_back("L1Q1_IP");
       m_sfebs_ordered.push_back("L2Q1_IP");
       m_sfebs_ordered.push_back("L3Q1_IP");
@@ -194,7 +240,99 @@ void nsw::sTGCSFEBToRouter::gather_sfebs() {
   }
 }
 
-int nsw::sTGCSFEBToRouter::router_watchdog(bool open, bool close) {
+void nsw::sTGCSFEBToRouter::group_sfebs() {
+  //
+  // one SFEB per iteration, or
+  // each SFEB in the iterations of its code
+  //
+  if (!m_parallel) {
+    for (const auto & name: m_sfebs_ordered)
+      m_sfebs_pulsed.push_back({name});
+    return;
+  }
+  std::map<std::string, std::vector<std::string>> routers;
+  for (const auto & name: m_sfebs_ordered)
+    routers[router_key(name)].push_back(name);
+  const auto iterations = assign_codes(routers);
+  m_sfebs_pulsed.resize(iterations);
+  for (const auto & name: m_sfebs_ordered) {
+    const auto code = m_sfeb_codes.at(name);
+    m_router_codes[router_key(name)] |= code;
+    for (std::size_t it = 0; it < iterations; it++)
+      if ((code >> it) & 1)
+        m_sfebs_pulsed.at(it).push_back(name);
+  }
+  for (std::size_t it = 0; it < m_sfebs_pulsed.size(); it++)
+    ERS_INFO(fmt::format("Gather SFEBs: iteration {} pulses {}",
+                         it, fmt::join(m_sfebs_pulsed.at(it), " ")));
+}
+
+std::size_t nsw::sTGCSFEBToRouter::assign_codes(const std::map<std::string, std::vector<std::string>>& routers) {
+  //
+  // Codes of the same weight, so that no code is contained in another,
+  //   and disjoint within a Router, so that its drops are the union of
+  //   the codes of its SFEBs: a Router connected to another SFEB misses
+  //   some iterations of the expected one.
+  // The fewest iterations are found by a depth-first search, with a
+  //   budget so that a hopeless number of iterations is given up.
+  // One iteration per SFEB always works.
+  //
+  std::vector<std::pair<std::string, std::string>> sfebs;
+  std::size_t per_router = 1;
+  for (const auto & [key, names]: routers) {
+    per_router = std::max(per_router, names.size());
+    for (const auto & name: names)
+      sfebs.emplace_back(key, name);
+  }
+  constexpr std::size_t budget = 100000;
+  for (std::size_t bits = 1; bits <= std::min(sfebs.size(), std::size_t{63}); bits++) {
+    for (std::size_t weight = 1; weight * per_router <= bits; weight++) {
+      std::vector<std::uint64_t> codes;
+      for (std::uint64_t code = 0; code < (std::uint64_t{1} << bits) && codes.size() < sfebs.size() * 4; code++)
+        if (static_cast<std::size_t>(std::popcount(code)) == weight)
+          codes.push_back(code);
+      if (codes.size() < sfebs.size())
+        continue;
+      std::vector<bool> used(codes.size(), false);
+      std::map<std::string, std::uint64_t> router_codes;
+      std::size_t steps = 0;
+      std::function<bool(std::size_t)> assign = [&](const std::size_t index) {
+        if (index == sfebs.size())
+          return true;
+        const auto & [key, name] = sfebs.at(index);
+        for (std::size_t ic = 0; ic < codes.size() && steps++ < budget; ic++) {
+          if (used.at(ic) || (router_codes[key] & codes.at(ic)) != 0)
+            continue;
+          used.at(ic) = true;
+          router_codes[key] |= codes.at(ic);
+          m_sfeb_codes[name] = codes.at(ic);
+          if (assign(index + 1))
+            return true;
+          used.at(ic) = false;
+          router_codes[key] &= ~codes.at(ic);
+        }
+        return false;
+      };
+      if (assign(0)) {
+        for (const auto & [name, code]: m_sfeb_codes)
+          ERS_INFO(fmt::format("Gather SFEBs: {} code {:0{}b}", name, code, bits));
+        return bits;
+      }
+      m_sfeb_codes.clear();
+    }
+  }
+  throw std::runtime_error(fmt::format("Cannot assign PRBS codes to {} SFEBs", sfebs.size()));
+}
+
+std::string nsw::sTGCSFEBToRouter::router_key(const std::string& sfeb) {
+  // e.g. L1Q1_IP -> L1_IP
+  const auto quadrant = sfeb.find('Q');
+  if (quadrant == std::string::npos || quadrant + 2 > sfeb.size())
+    return sfeb;
+  return sfeb.substr(0, quadrant) + sfeb.substr(quadrant + 2);
+}
+
+int nsw::sTGCSFEBToRouter::router_watchdog(bool open, bool close, bool prbs) {
   //
   // Be forewarned: this function reads Router SCA registers.
   // Dont race elsewhere.
@@ -205,42 +343,121 @@ int nsw::sTGCSFEBToRouter::router_watchdog(bool open, bool close) {
   // output file and announce
   if (open) {
     const auto now = nsw::calib::utils::strf_time();
-    m_fname = "router_ClkReady." + std::to_string(runNumber()) + "." + applicationName() + "." + now + ".txt";
-    m_myfile.open(m_fname);
+    m_fname = outputFileName("txt", "router_ClkReady." + std::to_string(runNumber()) + "." + applicationName() + "." + now + ".txt");
+    m_myfile = openOutputText("txt", m_fname);
     ERS_INFO("Router ClkReady watchdog. Output: " << m_fname);
   }
 
   // read once
   auto threads = std::make_unique<std::vector< std::future<bool> > >();
   m_myfile << "Time " << nsw::calib::utils::strf_time() << std::endl;
+  if (m_parallel && prbs)
+    m_myfile << fmt::format("SFEBs {}", fmt::join(m_sfebs_pulsed.at(counter()), " ")) << std::endl;
   for (const auto & router : m_routers.get())
     threads->push_back( std::async(std::launch::async,
                                    &nsw::sTGCSFEBToRouter::router_ClkReady,
                                    this,
                                    router) );
+  m_router_drops.resize(m_routers.get().size(), 0);
   for (size_t ir = 0; ir < m_routers.get().size(); ir++) {
     auto name = m_routers.get().at(ir).getConfig().getAddress();
     auto val  = threads ->at(ir).get();
     m_myfile << name << " " << val << std::endl;
+    if (m_parallel && prbs && !val)
+      m_router_drops.at(ir) |= std::uint64_t{1} << counter();
   }
   threads->clear();
+  if (m_parallel && prbs)
+    m_observed |= std::uint64_t{1} << counter();
 
   // close
-  if (close) {
-    ERS_INFO("Closing " << m_fname);
-    m_myfile.close();
-  }
+  if (close)
+    close_watchdog();
 
   return 0;
 }
 
-void nsw::sTGCSFEBToRouter::wait_for_routers(size_t expectation) const {
-  size_t count = 0;
-  while (count < expectation) {
-    ERS_INFO("Waiting for Routers to be ready. Currently: "
-             << count << " of " << expectation << " ok");
-    count = count_ready_routers();
-    std::this_thread::sleep_for(std::chrono::seconds{1});
+void nsw::sTGCSFEBToRouter::close_watchdog() {
+  if (!m_myfile.is_open())
+    return;
+  if (m_parallel && m_observed != 0)
+    decode_routers();
+  ERS_INFO("Closing " << m_fname);
+  m_myfile.close();
+}
+
+void nsw::sTGCSFEBToRouter::closeOutputs() {
+  CalibAlg::closeOutputs();
+  close_watchdog();
+}
+
+void nsw::sTGCSFEBToRouter::decode_routers() {
+  //
+  // The drops of each Router, over the iterations read in this run,
+  //   should be the union of the codes of the SFEBs of one Router key.
+  // Otherwise, the SFEBs whose codes are in the drops are listed.
+  //
+  for (size_t ir = 0; ir < m_routers.get().size(); ir++) {
+    const auto name  = m_routers.get().at(ir).getConfig().getAddress();
+    const auto drops = m_router_drops.at(ir) & m_observed;
+    std::vector<std::string> keys;
+    for (const auto & [key, code]: m_router_codes)
+      if ((code & m_observed) == drops)
+        keys.push_back(key);
+    std::vector<std::string> sfebs;
+    for (const auto & [sfeb, code]: m_sfeb_codes)
+      if ((code & m_observed) != 0 && (code & m_observed & ~drops) == 0)
+        sfebs.push_back(sfeb);
+    m_myfile << fmt::format("Decoded {} drops {:b} SFEBs {}", name, drops, fmt::join(sfebs, " ")) << std::endl;
+    const auto own = std::find_if(std::cbegin(m_router_codes), std::cend(m_router_codes),
+                                  [&name](const auto& router) { return nsw::contains(name, router.first); });
+    const bool expected = own == std::cend(m_router_codes) ?
+      keys.size() == 1 :
+      std::find(std::cbegin(keys), std::cend(keys), own->first) != std::cend(keys);
+    if (!expected)
+      ers::warning(nsw::NSWsTGCSFEBToRouterIssue(ERS_HERE,
+        fmt::format("{} dropped ClkReady in iterations {:b}, not as the SFEBs of one Router: {}",
+                    name, drops, sfebs.empty() ? std::string{"none"} : fmt::format("{}", fmt::join(sfebs, " ")))));
+  }
+}
+
+void nsw::sTGCSFEBToRouter::wait_for_routers(size_t expectation) {
+  //
+  // Each Router is read in its own thread, and the wait returns
+  // as soon as enough of them are ready. Abort is checked every second.
+  // After the timeout, the iteration fails: the output is closed first.
+  //
+  ERS_INFO("Waiting for Routers to be ready: expecting " << expectation);
+  const auto& routers = m_routers.get();
+  nsw::RouterStatusMonitor monitor{routers.size(),
+                                   [this, &routers](const std::size_t index) -> std::uint64_t {
+                                     return read_ClkReady(routers.at(index)) ? 1 : 0;
+                                   },
+                                   m_router_poll};
+  const auto count_ready = [](const std::vector<std::uint64_t>& values) {
+    return static_cast<std::size_t>(std::count(std::cbegin(values), std::cend(values), 1));
+  };
+  const auto enough = [&count_ready, expectation](const std::vector<std::uint64_t>& values) {
+    return count_ready(values) >= expectation;
+  };
+  bool ok = false;
+  const auto start = std::chrono::steady_clock::now();
+  while (!ok && std::chrono::steady_clock::now() - start < m_router_timeout) {
+    checkAbort();
+    ok = monitor.waitFor(enough, std::chrono::seconds{1});
+  }
+  const auto values = monitor.getValues();
+  const auto count = count_ready(values);
+  if (!ok) {
+    for (std::size_t ir = 0; ir < routers.size(); ir++)
+      if (values.at(ir) == 0)
+        ERS_INFO("ClkReady=0 for " << routers.at(ir).getName());
+    nsw::NSWsTGCSFEBToRouterIssue issue(ERS_HERE,
+      fmt::format("Timeout after {}s waiting for Routers to be ready: {} of {} ok",
+                  m_router_timeout.count(), count, expectation));
+    ers::error(issue);
+    closeOutputs();
+    throw issue;
   }
   ERS_INFO(fmt::format("Finished waiting for Routers to be ready: {} of {} ok",
                        count, expectation));
@@ -271,11 +488,15 @@ size_t nsw::sTGCSFEBToRouter::count_ready_routers() const {
 }
 
 bool nsw::sTGCSFEBToRouter::router_ClkReady(const nsw::hw::Router& router) const {
-  const auto rx_val = simulation() ? true : router.readGPIO("rxClkReady");
-  const auto tx_val = simulation() ? true : router.readGPIO("txClkReady");
-  const bool ok = rx_val && tx_val;
+  const bool ok = read_ClkReady(router);
   if (!ok) {
     ERS_INFO("ClkReady=0 for " << router.getName());
   }
   return ok;
 }
+
+bool nsw::sTGCSFEBToRouter::read_ClkReady(const nsw::hw::Router& router) const {
+  const auto rx_val = simulation() ? true : router.readGPIO("rxClkReady");
+  const auto tx_val = simulation() ? true : router.readGPIO("txClkReady");
+  return rx_val && tx_val;
+}
@@ -15,15 +15,25 @@
 //
 
 #include "NSWCalibration/sTGCStripsTriggerCalib.h"
+#include "NSWCalibration/RouterStatusMonitor.h"
+#include "NSWCalibration/Utility.h"
 
 #include "NSWConfiguration/ConfigReader.h"
 #include "NSWConfiguration/ConfigSender.h"
 
+#include <algorithm>
 #include <cstdlib>
-#include <unistd.h>
+#include <fstream>
 #include <regex>
 #include <stdexcept>
 
+#include <fmt/core.h>
+#include <fmt/chrono.h>
+#include <fmt/ranges.h>
+
+#include <is/infodynany.h>
+#include <is/infodictionary.h>
+
 #include "ers/ers.h"
 
 void nsw::sTGCStripsTriggerCalib::setup(const std::string& db) {
@@ -90,24 +100,105 @@ void nsw::sTGCStripsTriggerCalib::unconfigure() {
 int nsw::sTGCStripsTriggerCalib::configure_tds(const std::string& name,
                                                const std::vector<std::string>& tdss,
                                                bool prbs_e, bool pause) {
-  for (auto & sfeb: m_sfebs) {
-    if (name == simplified(sfeb.getAddress())) {
-      for (auto & tds: tdss) {
-        if (dont_touch(name, tds)) {
-          ERS_INFO("Skipping " << name << " " << tds << " (Router clk)");
-        } else {
-          configure_tds(sfeb, tds, prbs_e);
+  const auto toggle = [this, &name, &tdss, prbs_e]() {
+    for (auto & sfeb: m_sfebs) {
+      if (name == simplified(sfeb.getAddress())) {
+        for (auto & tds: tdss) {
+          if (dont_touch(name, tds)) {
+            ERS_INFO("Skipping " << name << " " << tds << " (Router clk)");
+          } else {
+            configure_tds(sfeb, tds, prbs_e);
+          }
         }
       }
     }
+  };
+  if (pause)
+    wait_for_lock(name, tdss, prbs_e, toggle);
+  else
+    toggle();
+  return 0;
+}
+
+void nsw::sTGCStripsTriggerCalib::setCalibParamsFromIS(const ISInfoDictionary& is_dictionary,
+                                                       const std::string& is_db_name) {
+  const auto name = fmt::format("{}.Calib.calibParams", is_db_name);
+  if (is_dictionary.contains(name)) {
+    ISInfoDynAny infoany;
+    is_dictionary.getValue(name, infoany);
+    setCalibParams(infoany.getAttributeValue<std::string>(0));
+  }
+}
+
+void nsw::sTGCStripsTriggerCalib::setCalibParams(const std::string& calibParams) {
+  for (const auto& [key, value] : nsw::calib::utils::parseKeyValues(calibParams)) {
+    if (key == "pause") {
+      m_pause = std::chrono::milliseconds(std::stoul(value));
+    } else if (key == "poll") {
+      m_poll = std::chrono::milliseconds(std::stoul(value));
+    } else {
+      throw NSWsTGCStripsTriggerCalibIssue(ERS_HERE, fmt::format("Unknown {} parameter {}, expected pause or poll",
+                                                                 m_calibType, key));
+    }
   }
-  if (pause) {
-    if (simulation())
-      usleep(prbs_e ? 1e6 : 1e6);
-    else
-      usleep(prbs_e ? 15e6 : 15e6);
+  if (m_pause) {
+    ERS_INFO(fmt::format("Pausing {} after each PRBS toggle, polling the Routers every {}", *m_pause, m_poll));
   }
-  return 0;
+}
+
+void nsw::sTGCStripsTriggerCalib::wait_for_lock(const std::string& name,
+                                                const std::vector<std::string>& tdss,
+                                                bool prbs_e,
+                                                const std::function<void()>& toggle) const {
+  //
+  // Neither the TDS PRBS lock nor a Router PRBS or error counter can be
+  //   read, and the Router recovering its clock is never toggled (see
+  //   dont_touch): the lock is waited for with a fixed pause.
+  // The Routers are read from before the toggle, and their status and
+  //   time to lock are only recorded.
+  //
+  const auto pause = m_pause.value_or(simulation() ? std::chrono::milliseconds{1000}
+                                                   : std::chrono::milliseconds{15000});
+  const auto& routers = getDeviceManager().getRouters();
+  if (routers.empty()) {
+    toggle();
+    sleepFor(pause);
+    return;
+  }
+  nsw::RouterStatusMonitor monitor{routers.size(),
+                                   [this, &routers](const std::size_t index) {
+                                     return link_status(routers.at(index));
+                                   },
+                                   m_poll};
+  monitor.waitFor([](const std::vector<std::uint64_t>&) { return true; }, pause);
+  const auto before = monitor.getValues();
+  toggle();
+  sleepFor(pause);
+
+  // diagnostics: status and time to lock of each Router
+  const auto values = monitor.getValues();
+  const auto times = monitor.getLockTimes();
+  const auto fname = fmt::format("{}.{}.{}.locktime.txt", m_calibType, runNumber(), applicationName());
+  if (isFirstIteration() && prbs_e == false)
+    ERS_LOG("Opening " << fname);
+  auto myfile = openOutputText("locktime", fname);
+  myfile << fmt::format("Iteration {:02} SFEB {} TDS {} PRBS_e {} Changed {} PauseMs {}",
+                        counter(), name, fmt::join(tdss, ","), prbs_e, values != before, pause.count()) << std::endl;
+  for (std::size_t ir = 0; ir < routers.size(); ir++) {
+    myfile << fmt::format("{} Status {} LockTimeMs {}",
+                          routers.at(ir).getConfig().getAddress(), values.at(ir),
+                          times.at(ir) ? times.at(ir)->count() : -1) << std::endl;
+  }
+  myfile.close();
+}
+
+std::uint64_t nsw::sTGCStripsTriggerCalib::link_status(const nsw::hw::Router& router) const {
+  // bit 0: rxClkReady, bit 1: txClkReady
+  if (simulation())
+    return 3;
+  const std::uint64_t rx_val = router.readGPIO("rxClkReady") ? 1 : 0;
+  const std::uint64_t tx_val = router.readGPIO("txClkReady") ? 1 : 0;
+  return rx_val | (tx_val << 1);
 }
 
 int nsw::sTGCStripsTriggerCalib::configure_tds(const nsw::FEBConfig& feb,
@@ -1,39 +1,98 @@
 #include "NSWCalibration/sTGCTriggerCalib.h"
+#include "NSWCalibration/Issues.h"
+#include "NSWCalibration/Utility.h"
 
 #include "NSWConfiguration/Constants.h"
 
+#include <algorithm>
 #include <cstdlib>
+#include <iterator>
 #include <unistd.h>
 #include <stdexcept>
 
+#include <boost/property_tree/json_parser.hpp>
+#include <fmt/ranges.h>
+
+#include <is/infodynany.h>
+#include <is/infodictionary.h>
+
 #include "ers/ers.h"
 
 using namespace std::chrono_literals;
 
 nsw::sTGCTriggerCalib::sTGCTriggerCalib(std::string calibType, const nsw::hw::DeviceManager& deviceManager):
   CalibAlg(std::move(calibType), deviceManager),
-  m_latencyScan{m_calibType == "sTGCPadLatency"}
+  m_latencyScan{m_calibType == "sTGCPadLatency"},
+  m_grouped{m_calibType == "sTGCPadConnectivityScaGrouped"}
 {
   checkCalibType();
   checkObjects();
-  setTotal(m_latencyScan ? getLatencyScanNBC() : nsw::padtrigger::NUM_PFEBS);
+  if (m_grouped) {
+    // the number of iterations is published before the run: reserve a few retests
+    setTotal(sTGCPadConnectivityDecoder{nsw::padtrigger::NUM_PFEBS}.getNumIterations() + m_numRetests);
+  } else {
+    setTotal(m_latencyScan ? getLatencyScanNBC() : nsw::padtrigger::NUM_PFEBS);
+  }
+}
+
+void nsw::sTGCTriggerCalib::setCalibParamsFromIS(const ISInfoDictionary& is_dictionary,
+                                                 const std::string& is_db_name) {
+  if (not m_grouped) {
+    return;
+  }
+  // optional, e.g. "retests=4"
+  const auto name = fmt::format("{}.Calib.calibParams", is_db_name);
+  if (is_dictionary.contains(name)) {
+    ISInfoDynAny infoany;
+    is_dictionary.getValue(name, infoany);
+    setCalibParams(infoany.getAttributeValue<std::string>(0));
+  }
+}
+
+void nsw::sTGCTriggerCalib::setCalibParams(const std::string& calibParams) {
+  if (not m_grouped) {
+    CalibAlg::setCalibParams(calibParams);
+    return;
+  }
+  for (const auto& [key, value] : nsw::calib::utils::parseKeyValues(calibParams)) {
+    if (key == "retests") {
+      m_numRetests = std::min<std::size_t>(std::stoul(value), nsw::padtrigger::NUM_PFEBS);
+    } else {
+      throw NSWsTGCTriggerCalibIssue(ERS_HERE, fmt::format("Unknown {} parameter {}, expected retests",
+                                                           m_calibType, key));
+    }
+  }
+  setTotal(sTGCPadConnectivityDecoder{nsw::padtrigger::NUM_PFEBS}.getNumIterations() + m_numRetests);
+}
+
+void nsw::sTGCTriggerCalib::setup(const std::string& /* db */) {
+  m_retests.clear();
+  m_notRetested.clear();
+  m_pulsed.clear();
+  if (m_grouped) {
+    m_decoder = std::make_unique<sTGCPadConnectivityDecoder>(nsw::padtrigger::NUM_PFEBS);
+  }
 }
 
 void nsw::sTGCTriggerCalib::configure() {
+  if (m_grouped) {
+    configureGrouped();
+    return;
+  }
   ERS_INFO("Current feb: " << getCurrentFebName());
   if (m_latencyScan) {
     // test pulse all pfebs
-    if (counter() == 0) {
+    if (isFirstIteration()) {
       ERS_LOG("sTGCTriggerCalib::configure all pFEBs");
       for (const auto& feb: getDeviceManager().getFebs()) {
         configureVMMs(feb, m_unmask);
       }
     }
     configurePadTrigger();
-    nsw::snooze();
+    sleepFor(1s);
   } else {
     // mask everything to start
-    if (counter() == 0) {
+    if (isFirstIteration()) {
       ERS_LOG("Masking all PFEB VMM channels");
       for (const auto& feb: getDeviceManager().getFebs()) {
         configureVMMs(feb, m_mask);
@@ -42,17 +101,111 @@ void nsw::sTGCTriggerCalib::configure() {
     // test pulse one pfeb
     try {
       configureVMMs(getCurrentFeb(), m_unmask);
+    } catch (const nsw::calib::Aborted&) {
+      throw;
     } catch (const std::exception& ex) {
       ERS_LOG(fmt::format("{} is absent, continuing",
                           getCurrentFebName()));
     }
     configurePadTrigger();
-    nsw::snooze();
+    sleepFor(1s);
   }
 }
 
+void nsw::sTGCTriggerCalib::configureGrouped() {
+  if (isFirstIteration()) {
+    if (resuming()) {
+      // the decoding needs the rates of all groups
+      throw NSWsTGCTriggerCalibIssue(ERS_HERE, fmt::format("{} cannot be resumed, restart it", m_calibType));
+    }
+    ERS_LOG("Masking all PFEB VMM channels");
+    for (const auto& feb: getDeviceManager().getFebs()) {
+      configureVMMs(feb, m_mask);
+    }
+  }
+  const auto numGroups = m_decoder->getNumIterations();
+  if (counter() == numGroups) {
+    m_retests = m_decoder->getRetests();
+    ERS_INFO(fmt::format("{} PFEBs to pulse on their own", m_retests.size()));
+    if (m_retests.size() > m_numRetests) {
+      m_notRetested.assign(std::next(std::cbegin(m_retests), static_cast<std::ptrdiff_t>(m_numRetests)),
+                           std::cend(m_retests));
+      m_retests.resize(m_numRetests);
+      ers::warning(NSWsTGCTriggerCalibIssue(ERS_HERE, fmt::format(
+        "{} PFEBs are not found on exactly one input, only {} are pulsed again. "
+        "Increase retests, or use sTGCPadConnectivitySca, to check the others",
+        m_retests.size() + m_notRetested.size(), m_numRetests)));
+    }
+  }
+  m_pulsed = getGroupedPfebs();
+  if (m_pulsed.empty()) {
+    ERS_LOG(fmt::format("Nothing to pulse in iteration {}, skipping", counter()));
+    return;
+  }
+  ERS_INFO(fmt::format("Iteration {}: pulsing {} PFEBs", counter(), m_pulsed.size()));
+  for (const auto pfeb: m_pulsed) {
+    const auto name = nsw::padtrigger::ORDERED_PFEBS_GEOID.at(pfeb);
+    try {
+      configureVMMs(getFeb(name), m_unmask);
+    } catch (const nsw::calib::Aborted&) {
+      throw;
+    } catch (const std::exception& ex) {
+      ERS_LOG(fmt::format("{} is absent, continuing", name));
+    }
+  }
+  // only one pad trigger is supported, see checkObjects
+  auto rates = std::vector<std::uint32_t>(nsw::padtrigger::NUM_PFEBS);
+  for (const auto& pt: getDeviceManager().getPadTriggers()) {
+    rates = readPadTriggerRates(pt);
+  }
+  if (counter() < numGroups) {
+    m_decoder->addRates(counter(), rates);
+  } else {
+    m_decoder->addRetest(m_pulsed.front(), rates);
+  }
+  sleepFor(1s);
+}
+
+std::vector<std::size_t> nsw::sTGCTriggerCalib::getGroupedPfebs() const {
+  const auto numGroups = m_decoder->getNumIterations();
+  if (counter() >= numGroups) {
+    const auto retest = counter() - numGroups;
+    if (retest >= m_retests.size()) {
+      return {};
+    }
+    return {m_retests.at(retest)};
+  }
+  std::vector<std::size_t> pfebs{};
+  for (std::size_t pfeb = 0; pfeb < nsw::padtrigger::NUM_PFEBS; pfeb++) {
+    if (m_decoder->isPulsed(counter(), pfeb)) {
+      pfebs.push_back(pfeb);
+    }
+  }
+  return pfebs;
+}
+
 void nsw::sTGCTriggerCalib::unconfigure() {
   ERS_LOG("sTGCTriggerCalib::unconfigure " << counter());
+  if (m_grouped) {
+    for (const auto pfeb: m_pulsed) {
+      const auto name = nsw::padtrigger::ORDERED_PFEBS_GEOID.at(pfeb);
+      try {
+        configureVMMs(getFeb(name), m_mask);
+      } catch (const nsw::calib::Aborted&) {
+        throw;
+      } catch (const std::exception& ex) {
+        ERS_LOG(fmt::format("{} is absent, continuing", name));
+      }
+    }
+    if (not m_pulsed.empty()) {
+      sleepFor(1s);
+    }
+    m_pulsed.clear();
+    if (counter() == total() - 1) {
+      writeGroupedResults();
+    }
+    return;
+  }
   if (m_latencyScan) {
     // mask pulse all pfebs
     if (counter() == total() - 1) {
@@ -64,7 +217,9 @@ void nsw::sTGCTriggerCalib::unconfigure() {
   } else {
     try {
       configureVMMs(getCurrentFeb(), m_mask);
-      nsw::snooze();
+      sleepFor(1s);
+    } catch (const nsw::calib::Aborted&) {
+      throw;
     } catch (const std::exception& ex) {
       ERS_LOG(fmt::format("Current feb {} is absent, continuing", getCurrentFebName()));
     }
@@ -76,15 +231,19 @@ std::string_view nsw::sTGCTriggerCalib::getCurrentFebName() const {
 }
 
 const nsw::hw::FEB& nsw::sTGCTriggerCalib::getCurrentFeb() const {
+  return getFeb(getCurrentFebName());
+}
+
+const nsw::hw::FEB& nsw::sTGCTriggerCalib::getFeb(const std::string_view name) const {
   for (const auto& feb: getDeviceManager().getFebs()) {
     if (feb.getGeoInfo().resourceType() != "PFEB") {
       continue;
     }
-    if (nsw::contains(feb.getScaAddress(), getCurrentFebName())) {
+    if (nsw::contains(feb.getScaAddress(), name)) {
       return feb;
     }
   }
-  throw std::runtime_error("Couldnt get current FEB");
+  throw std::runtime_error(fmt::format("Couldnt get FEB {}", name));
 }
 
 void nsw::sTGCTriggerCalib::configureVMMs(const nsw::hw::FEB& feb, bool unmask) const {
@@ -95,6 +254,7 @@ void nsw::sTGCTriggerCalib::configureVMMs(const nsw::hw::FEB& feb, bool unmask)
     ERS_LOG("Skipping unreachable " << feb.getScaAddress());
     return;
   }
+  checkAbort();
   ERS_LOG(fmt::format("Configuring {} ({})", feb.getScaAddress(), (unmask ? "pulsing" : "masking")));
   for (const auto& vmmDev: feb.getVmms()) {
     if (vmmDev.getVmmId() == nsw::PFEB_WIRE_VMM) {
@@ -125,21 +285,88 @@ void nsw::sTGCTriggerCalib::configurePadTrigger() const {
       pt.writeReadoutEnableTemporarily(50ms);
     // SCA based
     } else {
-      nsw::snooze(3s);
-      const auto rates = simulation() ?
-        std::vector<std::uint32_t>(nsw::padtrigger::NUM_PFEBS) : pt.readPFEBRates();
-      writeToFile(rates);
+      readPadTriggerRates(pt);
     }
   }
 }
 
+std::vector<std::uint32_t> nsw::sTGCTriggerCalib::readPadTriggerRates(const nsw::hw::PadTrigger& pt) const {
+  sleepFor(3s);
+  const auto rates = simulation() ?
+    std::vector<std::uint32_t>(nsw::padtrigger::NUM_PFEBS) : pt.readPFEBRates();
+  writeToFile(rates);
+  return rates;
+}
+
+void nsw::sTGCTriggerCalib::writeGroupedResults() const {
+  using boost::property_tree::ptree;
+  using Status = sTGCPadConnectivityDecoder::Status;
+  const auto& pfebs = nsw::padtrigger::ORDERED_PFEBS_GEOID;
+  const auto nameOf = [&pfebs](const std::size_t pfeb) { return std::string{pfebs.at(pfeb)}; };
+
+  // PFEB names may contain dots, which put/add_child would take as a path
+  ptree results;
+  std::vector<std::string> problems{};
+  const auto decoded = m_decoder->decode();
+  for (std::size_t input = 0; input < decoded.size(); input++) {
+    const auto& result = decoded.at(input);
+    ptree entry;
+    entry.put("status", sTGCPadConnectivityDecoder::toString(result.status));
+    entry.put("pfeb", result.pfeb ? nameOf(*result.pfeb) : "");
+    if (result.status != Status::Connected) {
+      problems.push_back(fmt::format("input {} ({}): {}{}", input, nameOf(input),
+                                     sTGCPadConnectivityDecoder::toString(result.status),
+                                     result.pfeb ? fmt::format(" {}", nameOf(*result.pfeb)) : ""));
+    }
+    results.push_back(std::make_pair(nameOf(input), entry));
+  }
+
+  // inputs with hits when pulsing each PFEB on its own
+  ptree retests;
+  for (const auto pfeb: m_retests) {
+    const auto inputs = m_decoder->getRetest(pfeb);
+    if (not inputs) {
+      continue;
+    }
+    ptree names;
+    std::vector<std::string> found{};
+    for (const auto input: *inputs) {
+      ptree name;
+      name.put_value(nameOf(input));
+      names.push_back(std::make_pair("", name));
+      found.push_back(nameOf(input));
+    }
+    retests.push_back(std::make_pair(nameOf(pfeb), names));
+    problems.push_back(fmt::format("{} alone: hits on [{}]", nameOf(pfeb), fmt::join(found, ", ")));
+  }
+
+  ptree notRetested;
+  for (const auto pfeb: m_notRetested) {
+    ptree name;
+    name.put_value(nameOf(pfeb));
+    notRetested.push_back(std::make_pair("", name));
+    problems.push_back(fmt::format("{} is not found on exactly one input, and was not pulsed alone", nameOf(pfeb)));
+  }
+
+  ptree tree;
+  tree.push_back(std::make_pair("inputs", results));
+  tree.push_back(std::make_pair("retests", retests));
+  tree.push_back(std::make_pair("not_retested", notRetested));
+  const auto name = fmt::format("{}.{}.{}.{}.json", m_calibType, runNumber(), applicationName(),
+                                nsw::calib::utils::strf_time());
+  write_json(name, tree);
+  ERS_INFO(fmt::format("Pad trigger connectivity written to {}", name));
+  for (const auto& problem: problems) {
+    ers::warning(NSWsTGCTriggerCalibIssue(ERS_HERE, problem));
+  }
+}
+
 void nsw::sTGCTriggerCalib::writeToFile(const std::vector<std::uint32_t>& rates) const {
   const auto fname = fmt::format("{}.{}.{}.txt", m_calibType, runNumber(), applicationName());
-  if (counter() == 0) {
+  if (isFirstIteration()) {
     ERS_LOG("Opening " << fname);
   }
-  std::ofstream myfile;
-  myfile.open(fname, std::ios_base::app);
+  auto myfile = openOutputText("txt", fname);
   std::size_t pfeb{0};
   for (const auto& rate: rates) {
     myfile << fmt::format("Iteration {:02} PFEB {:02} {}", counter(), pfeb, rate) << std::endl;
@@ -175,6 +402,7 @@ std::uint32_t nsw::sTGCTriggerCalib::getLatencyScanNBC() const {
 void nsw::sTGCTriggerCalib::checkCalibType() const {
   if (m_calibType == "sTGCPadConnectivity" or
       m_calibType == "sTGCPadConnectivitySca" or
+      m_calibType == "sTGCPadConnectivityScaGrouped" or
       m_calibType == "sTGCPadLatency") {
     ERS_INFO(m_calibType);
   } else {
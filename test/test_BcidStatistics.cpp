@@ -0,0 +1,85 @@
+/// Test suite for testing the pad trigger BCID statistics
+
+#include "NSWCalibration/BcidStatistics.h"
+
+#define BOOST_TEST_MODULE BcidStatistics_tests
+#define BOOST_TEST_DYN_LINK
+
+#include <boost/test/unit_test.hpp>
+
+BOOST_AUTO_TEST_CASE(Summary)
+{
+  nsw::BcidStatistics stats{2, 0.9};
+  std::size_t reads{0};
+  std::vector<std::size_t> raw{};
+  stats.read([&reads]() -> std::vector<std::uint32_t> {
+    reads++;
+    // PFEB 1 flips between 15 and 0 every other read
+    return {3, reads % 2 == 0 ? 0u : 15u};
+  }, 10, [&raw](const std::size_t read, const std::vector<std::uint32_t>&) { raw.push_back(read); });
+  BOOST_TEST(reads == 10);
+  BOOST_TEST(raw.size() == 10);
+  BOOST_TEST(raw.back() == 9);
+
+  const auto first = stats.getSummary(0);
+  BOOST_TEST(first.mode == 3);
+  BOOST_TEST(first.spread == 0);
+  BOOST_TEST(first.fraction == 1.0);
+  BOOST_TEST(first.reads == 10);
+  BOOST_TEST(first.stable);
+
+  const auto second = stats.getSummary(1);
+  BOOST_TEST(second.spread == 1);
+  BOOST_TEST(second.fraction == 0.5);
+  BOOST_TEST(not second.stable);
+
+  const auto columns = stats.getColumns();
+  BOOST_TEST(columns.mode.size() == 2);
+  BOOST_TEST(columns.stable.at(0));
+  BOOST_TEST(not columns.stable.at(1));
+
+  stats.reset();
+  BOOST_TEST(stats.getSummary(0).reads == 0);
+  BOOST_TEST(not stats.getSummary(0).stable);
+}
+
+BOOST_AUTO_TEST_CASE(BestLinear)
+{
+  // PFEB 0 changes BCID at delay 5 and is noisy at 12, PFEB 1 changes BCID at delay 10
+  nsw::BcidStatistics stats{2};
+  for (std::uint32_t delay = 0; delay < 16; delay++) {
+    stats.reset();
+    for (std::uint32_t read = 0; read < 4; read++) {
+      const auto noisy = delay == 12 and read == 0;
+      stats.add({(delay < 5 ? 1u : 2u) + (noisy ? 1u : 0u), delay < 10 ? 7u : 8u});
+    }
+    stats.record(delay);
+  }
+  // PFEB 0: good at 0-3, 6-10 and 14-15
+  BOOST_TEST(stats.getBest(0, false).value_or(99) == 8);
+  // PFEB 1: good at 0-8 and 11-15
+  BOOST_TEST(stats.getBest(1, false).value_or(99) == 4);
+  // both good at 0-3 and 6-8
+  BOOST_TEST(stats.getBestCommon(false).value_or(99) == 1);
+}
+
+BOOST_AUTO_TEST_CASE(BestCircular)
+{
+  // the BCID of PFEB 0 is different from phase 16 to 28, and the window wraps around the end
+  nsw::BcidStatistics stats{2};
+  for (std::uint32_t phase = 0; phase < 64; phase += 4) {
+    stats.reset();
+    stats.add({phase >= 16 and phase <= 28 ? 5u : 4u, 0});
+    // PFEB 1 is only read at the first 4 phases
+    stats.record({phase, phase < 16 ? phase : 0});
+  }
+  // PFEB 0: good at 36-60 and 0-8 when circular, and at 36-60 only otherwise
+  BOOST_TEST(stats.getBest(0, true).value_or(99) == 52);
+  BOOST_TEST(stats.getBest(0, false).value_or(99) == 48);
+  // PFEB 1 merges all its reads at phase 0 with the ones of 4, 8 and 12
+  BOOST_TEST(stats.getBest(1, true).value_or(99) == 4);
+
+  nsw::BcidStatistics empty{1};
+  BOOST_TEST(not empty.getBest(0, true).has_value());
+  BOOST_TEST(not empty.getBestCommon(true).has_value());
+}
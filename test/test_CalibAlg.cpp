@@ -0,0 +1,70 @@
+/// Test suite for testing the checkpoint and resume of CalibAlg
+
+#include "NSWCalibration/CalibAlg.h"
+
+#include <filesystem>
+
+#include "NSWCalibration/Issues.h"
+
+#define BOOST_TEST_MODULE CalibAlg_tests
+#define BOOST_TEST_DYN_LINK
+
+#include <boost/test/unit_test.hpp>
+
+namespace {
+  // sets its total in setup, like most calibrations
+  class TotalInSetup : public nsw::CalibAlg {
+  public:
+    using nsw::CalibAlg::CalibAlg;
+    void setup(const std::string& /* db */) override { setTotal(5); }
+    void configure() override {}
+  };
+
+  struct OutputPath {
+    OutputPath() : path{std::filesystem::temp_directory_path() / "test_CalibAlg"} {
+      std::filesystem::remove_all(path);
+    }
+    ~OutputPath() { std::filesystem::remove_all(path); }
+    std::filesystem::path path;
+  };
+
+  void prepare(nsw::CalibAlg& calib, const OutputPath& output) {
+    calib.setApplicationName("test");
+    calib.setOutputPath(output.path.string());
+    calib.setCurrentRunParameters({1, 0});
+  }
+}
+
+BOOST_AUTO_TEST_CASE(Resume_TotalSetInSetup)
+{
+  const OutputPath output{};
+  const nsw::hw::DeviceManager deviceManager{};
+  {
+    TotalInSetup calib{"TotalInSetup", deviceManager};
+    prepare(calib, output);
+    calib.setup("");
+    calib.next();
+    calib.next();
+    calib.checkpoint();
+  }
+
+  TotalInSetup calib{"TotalInSetup", deviceManager};
+  prepare(calib, output);
+  // the total is only known after setup
+  BOOST_CHECK_THROW(calib.resume(), nsw::calib::Issue);
+  calib.setup("");
+  calib.resume();
+  BOOST_TEST(calib.resuming());
+  BOOST_TEST(calib.counter() == 2);
+  BOOST_TEST(calib.total() == 5);
+}
+
+BOOST_AUTO_TEST_CASE(Resume_NoCheckpoint)
+{
+  const OutputPath output{};
+  const nsw::hw::DeviceManager deviceManager{};
+  TotalInSetup calib{"TotalInSetup", deviceManager};
+  prepare(calib, output);
+  calib.setup("");
+  BOOST_CHECK_THROW(calib.resume(), nsw::calib::Issue);
+}
@@ -0,0 +1,92 @@
+/// Test suite for testing the pooled channel measurements
+
+#include "NSWCalibration/GroupTestingDesign.h"
+
+#include <algorithm>
+#include <set>
+#include <stdexcept>
+
+#define BOOST_TEST_MODULE GroupTestingDesign_tests
+#define BOOST_TEST_DYN_LINK
+
+#include <boost/test/unit_test.hpp>
+
+namespace {
+  /// Rates of the rows for the channel rates
+  std::vector<double> measure(const nsw::GroupTestingDesign& design, const std::vector<double>& rates)
+  {
+    std::vector<double> rows(design.getNumRows(), 0);
+    for (std::size_t row = 0; row < rows.size(); row++) {
+      for (const auto channel : design.getOpenChannels(row)) {
+        rows.at(row) += rates.at(channel);
+      }
+    }
+    return rows;
+  }
+}  // namespace
+
+BOOST_AUTO_TEST_CASE(Design)
+{
+  BOOST_TEST(nsw::GroupTestingDesign::minRows(104) == 10);
+  BOOST_CHECK_THROW(nsw::GroupTestingDesign(104, 9), std::runtime_error);
+  BOOST_CHECK_THROW(nsw::GroupTestingDesign(104, 65), std::runtime_error);
+
+  const nsw::GroupTestingDesign design{104, 13};
+  BOOST_TEST(design.getNumRows() == 13);
+  BOOST_TEST(design.getOpenChannels(0).size() == 104);
+
+  // distinct channels of constant weight
+  std::set<std::vector<bool>> columns{};
+  for (std::size_t channel = 0; channel < 104; channel++) {
+    std::vector<bool> column{};
+    for (std::size_t row = 1; row < design.getNumRows(); row++) {
+      column.push_back(design.isOpen(row, channel));
+    }
+    BOOST_TEST(std::count(std::cbegin(column), std::cend(column), true) == 6);
+    columns.insert(column);
+  }
+  BOOST_TEST(columns.size() == 104);
+
+  // the same in every run
+  const nsw::GroupTestingDesign other{104, 13};
+  for (std::size_t row = 0; row < design.getNumRows(); row++) {
+    BOOST_TEST(design.getOpenChannels(row) == other.getOpenChannels(row));
+  }
+}
+
+BOOST_AUTO_TEST_CASE(DecodeSparse)
+{
+  const nsw::GroupTestingDesign design{104, 13};
+  BOOST_CHECK_THROW(static_cast<void>(design.decode({1., 2.})), std::runtime_error);
+
+  const auto silent = design.decode(std::vector<double>(13, 0));
+  BOOST_TEST(silent.residual == 0.);
+  for (const auto rate : silent.rates) {
+    BOOST_TEST(rate == 0.);
+  }
+
+  for (const std::vector<std::size_t>& noisy : std::vector<std::vector<std::size_t>>{{7}, {0, 103}, {5, 50, 77}}) {
+    std::vector<double> rates(104, 0);
+    for (std::size_t index = 0; index < noisy.size(); index++) {
+      rates.at(noisy.at(index)) = 1000. * static_cast<double>(index + 1);
+    }
+    const auto decoded = design.decode(measure(design, rates));
+    BOOST_TEST(decoded.residual < 1e-6);
+    for (std::size_t channel = 0; channel < 104; channel++) {
+      BOOST_TEST(decoded.rates.at(channel) == rates.at(channel), boost::test_tools::tolerance(1e-6));
+    }
+  }
+}
+
+BOOST_AUTO_TEST_CASE(DecodeInconsistent)
+{
+  // more in one row than in all channels: cannot be fitted
+  const nsw::GroupTestingDesign design{104, 13};
+  std::vector<double> rows(13, 0);
+  rows.at(1) = 100;
+  const auto decoded = design.decode(rows);
+  BOOST_TEST(decoded.residual > 1.);
+  for (const auto rate : decoded.rates) {
+    BOOST_TEST(rate >= 0.);
+  }
+}
@@ -0,0 +1,91 @@
+/// Test suite for testing the online analysis of MMARTConnectivityTest
+
+#include "NSWCalibration/MMARTConnectivityAnalyzer.h"
+
+#define BOOST_TEST_MODULE MMARTConnectivityAnalyzer_tests
+#define BOOST_TEST_DYN_LINK
+
+#include <boost/test/unit_test.hpp>
+
+namespace {
+  /// One channel pulsed on all VMMs of the given MMFE8s
+  nsw::mmtrigger::Iteration makeIteration(const std::vector<std::string>& febs, const std::size_t channel)
+  {
+    auto set = std::make_shared<nsw::mmtrigger::FebPatternSet>();
+    for (const auto& name : febs) {
+      nsw::mmtrigger::FebPattern feb{};
+      feb.name = name;
+      for (std::size_t vmm = 0; vmm < feb.channels.size(); vmm++) {
+        feb.addChannel(vmm, channel);
+      }
+      set->febs.push_back(feb);
+    }
+    nsw::mmtrigger::Iteration iteration{};
+    iteration.febPatterns.push_back(set);
+    return iteration;
+  }
+
+  /// Run two groups of two channels: input 0 is ok, 1 dead, 2 (VMM 2) misses channel 1 and 3 responds to both groups
+  nsw::MMARTConnectivityAnalyzer makeAnalyzer()
+  {
+    nsw::MMARTConnectivityAnalyzer analyzer{};
+    std::vector<std::uint32_t> counters{100, 0, 5, 0};
+    analyzer.setBaseline({{"ADDC.art0", counters}});
+    const auto pulse = [&analyzer, &counters](const std::vector<std::string>& febs, const std::size_t channel,
+                                              const std::vector<std::uint32_t>& hits) {
+      for (std::size_t input = 0; input < counters.size(); input++) {
+        counters.at(input) += hits.at(input);
+      }
+      analyzer.addIteration(makeIteration(febs, channel), {{"ADDC.art0", counters}});
+    };
+    pulse({"MMFE8_L1P1_HOR"}, 0, {10, 0, 10, 10});
+    pulse({"MMFE8_L1P1_HOR"}, 1, {10, 0, 0, 10});
+    pulse({"MMFE8_L1P2_HOR"}, 0, {0, 0, 0, 10});
+    pulse({"MMFE8_L1P2_HOR"}, 1, {0, 0, 0, 0});
+    return analyzer;
+  }
+}  // namespace
+
+BOOST_AUTO_TEST_CASE(Verdicts)
+{
+  const auto analyzer = makeAnalyzer();
+  BOOST_TEST(analyzer.getNumIterations() == 4);
+  BOOST_TEST(analyzer.getGroups().size() == 2);
+
+  const auto verdicts = analyzer.getVerdicts();
+  BOOST_TEST(verdicts.size() == 4);
+  BOOST_TEST(verdicts.at(0).status == "ok");
+  BOOST_TEST(verdicts.at(0).home.value() == 0);
+  BOOST_TEST(verdicts.at(0).efficiency == 1.);
+  BOOST_TEST(verdicts.at(1).status == "dead");
+  BOOST_TEST(not verdicts.at(1).home.has_value());
+  BOOST_TEST(verdicts.at(2).status == "inefficient");
+  BOOST_TEST(verdicts.at(2).failingChannels.size() == 1);
+  BOOST_TEST(verdicts.at(2).failingChannels.front().toString() == "MMFE8_L1P1_HOR/2/1");
+  BOOST_TEST(verdicts.at(3).status == "crosstalk");
+  BOOST_TEST(verdicts.at(3).crosstalk == 0.5);
+}
+
+BOOST_AUTO_TEST_CASE(CounterReset)
+{
+  nsw::MMARTConnectivityAnalyzer analyzer{};
+  analyzer.setBaseline({{"ADDC.art0", {1000}}});
+  analyzer.addIteration(makeIteration({"MMFE8_L1P1_HOR"}, 0), {{"ADDC.art0", {20}}});
+  BOOST_TEST(analyzer.getVerdicts().at(0).status == "ok");
+}
+
+BOOST_AUTO_TEST_CASE(Summary)
+{
+  const auto summary = makeAnalyzer().getSummary();
+  BOOST_TEST(summary.get<std::size_t>("iterations") == 4);
+  BOOST_TEST(summary.get<std::string>("groups.1") == "MMFE8_L1P2_HOR");
+  BOOST_TEST(summary.get<std::size_t>("status.ok") == 1);
+  const auto& art = summary.get_child("inputs").front();
+  BOOST_TEST(art.first == "ADDC.art0");
+  BOOST_TEST(art.second.get<std::string>("3.status") == "crosstalk");
+  BOOST_TEST(art.second.get_child("3.response").size() == 2);
+  const auto& failing = art.second.get_child("2.failing_channels").front().second;
+  BOOST_TEST(failing.get<std::string>("feb") == "MMFE8_L1P1_HOR");
+  BOOST_TEST(failing.get<std::size_t>("vmm") == 2);
+  BOOST_TEST(failing.get<std::size_t>("channel") == 1);
+}
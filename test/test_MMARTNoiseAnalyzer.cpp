@@ -0,0 +1,83 @@
+/// Test suite for testing the ART noise sampling analysis
+
+#include "NSWCalibration/MMARTNoiseAnalyzer.h"
+
+#define BOOST_TEST_MODULE MMARTNoiseAnalyzer_tests
+#define BOOST_TEST_DYN_LINK
+
+#include <boost/test/unit_test.hpp>
+
+namespace {
+  /// Read the counters of one ART every second, adding \c increases
+  nsw::MMARTNoiseAnalyzer sample(const std::vector<std::vector<std::uint32_t>>& increases,
+                                 std::uint32_t start = 0)
+  {
+    nsw::MMARTNoiseAnalyzer analyzer{};
+    std::vector<std::uint32_t> counters(increases.front().size(), start);
+    analyzer.addSample({{"art", counters}}, 0.);
+    for (std::size_t index = 0; index < increases.size(); index++) {
+      for (std::size_t input = 0; input < counters.size(); input++) {
+        counters.at(input) += increases.at(index).at(input);
+      }
+      analyzer.addSample({{"art", counters}}, static_cast<double>(index + 1));
+    }
+    return analyzer;
+  }
+}  // namespace
+
+BOOST_AUTO_TEST_CASE(MeanAndVariance)
+{
+  const auto analyzer = sample({{10, 0}, {20, 0}, {30, 0}, {20, 0}});
+  BOOST_TEST(analyzer.getNumSamples() == 4);
+  BOOST_TEST(analyzer.getLiveTime() == 4.);
+  const auto input = analyzer.getInputSummary("art", 0);
+  BOOST_TEST(input.samples == 4);
+  BOOST_TEST(input.mean == 20., boost::test_tools::tolerance(1e-9));
+  BOOST_TEST(input.variance == 200. / 3., boost::test_tools::tolerance(1e-9));
+  BOOST_TEST(input.max == 30.);
+  BOOST_TEST(input.bursts.empty());
+  BOOST_TEST(analyzer.getInputSummary("art", 1).mean == 0.);
+}
+
+BOOST_AUTO_TEST_CASE(BurstIsFound)
+{
+  std::vector<std::vector<std::uint32_t>> increases(20, {100, 0});
+  increases.at(3) = {101, 1};
+  increases.at(7) = {99, 0};
+  increases.at(12) = {1000, 50};
+  const auto analyzer = sample(increases);
+  BOOST_TEST(analyzer.getInputSummary("art", 0).bursts == std::vector<std::size_t>({12}));
+  BOOST_TEST(analyzer.getInputSummary("art", 1).bursts == std::vector<std::size_t>({12}));
+
+  const auto summary = analyzer.getSummary();
+  const auto& art = summary.get_child("arts").begin()->second;
+  BOOST_TEST(art.get<std::size_t>("burst_inputs") == 2);
+  BOOST_TEST(art.get_child("burst_samples").size() == 1);
+  BOOST_TEST(art.get_child("inputs").size() == 2);
+}
+
+BOOST_AUTO_TEST_CASE(SingleHitsAreNotBursts)
+{
+  std::vector<std::vector<std::uint32_t>> increases(20, {0});
+  increases.at(5) = {2};
+  const auto analyzer = sample(increases);
+  BOOST_TEST(analyzer.getInputSummary("art", 0).bursts.empty());
+}
+
+BOOST_AUTO_TEST_CASE(CounterReset)
+{
+  nsw::MMARTNoiseAnalyzer analyzer{};
+  analyzer.addSample({{"art", {100}}}, 0.);
+  analyzer.addSample({{"art", {110}}}, 1.);
+  analyzer.addSample({{"art", {4}}}, 2.);
+  BOOST_TEST(analyzer.getInputSummary("art", 0).mean == 7.);
+}
+
+BOOST_AUTO_TEST_CASE(Errors)
+{
+  BOOST_CHECK_THROW(nsw::MMARTNoiseAnalyzer{0.}, std::runtime_error);
+  nsw::MMARTNoiseAnalyzer analyzer{};
+  analyzer.addSample({{"art", {0}}}, 1.);
+  BOOST_CHECK_THROW(analyzer.addSample({{"art", {0}}}, 1.), std::runtime_error);
+  BOOST_CHECK_THROW(static_cast<void>(analyzer.getInputSummary("other", 0)), std::runtime_error);
+}
@@ -0,0 +1,84 @@
+/// Test suite for testing the adaptive ART input phase scan
+
+#include <algorithm>
+
+#include "NSWCalibration/MMARTPhaseScan.h"
+
+#define BOOST_TEST_MODULE MMARTPhaseScan_tests
+#define BOOST_TEST_DYN_LINK
+
+#include <boost/test/unit_test.hpp>
+
+namespace {
+  const std::vector<int> PHASES{0, 1, 2, 3, 4, 5, 6, 7};
+
+  /// Scan phases of one pattern, the ART responding on all inputs in the good phases
+  void scan(nsw::MMARTPhaseScan& phaseScan,
+            std::vector<std::uint32_t>& counters,
+            const std::vector<int>& good,
+            const std::size_t numPhases = PHASES.size())
+  {
+    for (std::size_t index = 0; index < numPhases; index++) {
+      const auto phase = PHASES.at(index);
+      if (std::find(std::cbegin(good), std::cend(good), phase) != std::cend(good)) {
+        for (auto& counter : counters) {
+          counter += 10;
+        }
+      }
+      phaseScan.addPhase(phase, {{"art", counters}});
+    }
+  }
+}  // namespace
+
+BOOST_AUTO_TEST_CASE(Converges_WhenBracketed)
+{
+  nsw::MMARTPhaseScan phaseScan{{"art"}, PHASES, 3};
+  std::vector<std::uint32_t> counters(4, 0);
+  phaseScan.setBaseline({{"art", counters}});
+
+  scan(phaseScan, counters, {2, 3, 4, 5}, 5);
+  BOOST_TEST(not phaseScan.allConverged());
+
+  phaseScan.addPhase(5, {{"art", counters}});
+  BOOST_TEST(phaseScan.allConverged());
+  const auto window = phaseScan.getWindow("art").value();
+  BOOST_TEST(window.first == 2);
+  BOOST_TEST(window.last == 4);
+  BOOST_TEST(window.center == 3);
+}
+
+BOOST_AUTO_TEST_CASE(NotConverged_WindowTooNarrow)
+{
+  nsw::MMARTPhaseScan phaseScan{{"art"}, PHASES, 3};
+  std::vector<std::uint32_t> counters(4, 0);
+  scan(phaseScan, counters, {3, 4});
+  BOOST_TEST(not phaseScan.isConverged("art"));
+  BOOST_TEST(not phaseScan.getWindow("art").has_value());
+}
+
+BOOST_AUTO_TEST_CASE(Converges_WrappedWindow)
+{
+  nsw::MMARTPhaseScan phaseScan{{"art"}, PHASES, 3};
+  std::vector<std::uint32_t> counters(4, 0);
+  scan(phaseScan, counters, {0, 1, 6, 7});
+  const auto window = phaseScan.getWindow("art").value();
+  BOOST_TEST(window.first == 6);
+  BOOST_TEST(window.last == 1);
+  BOOST_TEST(window.center == 7);
+}
+
+BOOST_AUTO_TEST_CASE(AllConverged_NeedsEveryArt)
+{
+  nsw::MMARTPhaseScan phaseScan{{"art", "other"}, PHASES, 2};
+  std::vector<std::uint32_t> counters(4, 0);
+  scan(phaseScan, counters, {1, 2, 3});
+  BOOST_TEST(phaseScan.isConverged("art"));
+  BOOST_TEST(phaseScan.numConverged() == 1);
+  BOOST_TEST(not phaseScan.allConverged());
+}
+
+BOOST_AUTO_TEST_CASE(InvalidWidth)
+{
+  BOOST_CHECK_THROW((nsw::MMARTPhaseScan{{"art"}, PHASES, 0}), std::runtime_error);
+  BOOST_CHECK_THROW((nsw::MMARTPhaseScan{{"art"}, PHASES, 9}), std::runtime_error);
+}
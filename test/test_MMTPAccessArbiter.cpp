@@ -0,0 +1,59 @@
+/// Test suite for testing the MMTP access arbiter
+
+#include <chrono>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "NSWCalibration/MMTPAccessArbiter.h"
+
+#define BOOST_TEST_MODULE MMTPAccessArbiter_tests
+#define BOOST_TEST_DYN_LINK
+
+#include <boost/test/unit_test.hpp>
+
+using namespace std::chrono_literals;
+using Priority = nsw::MMTPAccessArbiter::Priority;
+
+BOOST_AUTO_TEST_CASE(Acquire_Uncontended)
+{
+  nsw::MMTPAccessArbiter arbiter{};
+  {
+    const auto access = arbiter.acquire(Priority::Monitoring);
+  }
+  {
+    const auto access = arbiter.acquire(Priority::Configuration);
+  }
+  BOOST_TEST(arbiter.getStatistics(Priority::Monitoring).accesses == 1);
+  BOOST_TEST(arbiter.getStatistics(Priority::Monitoring).contended == 0);
+  BOOST_TEST(arbiter.getStatistics(Priority::Configuration).accesses == 1);
+}
+
+BOOST_AUTO_TEST_CASE(Acquire_ConfigurationFirst)
+{
+  nsw::MMTPAccessArbiter arbiter{};
+  std::mutex mutex{};
+  std::vector<Priority> order{};
+  const auto access = [&arbiter, &mutex, &order](const Priority priority) {
+    const auto granted = arbiter.acquire(priority);
+    std::scoped_lock lock(mutex);
+    order.push_back(priority);
+  };
+
+  std::vector<std::thread> threads{};
+  {
+    const auto held = arbiter.acquire(Priority::Monitoring);
+    threads.emplace_back(access, Priority::Monitoring);
+    std::this_thread::sleep_for(50ms);
+    threads.emplace_back(access, Priority::Configuration);
+    std::this_thread::sleep_for(50ms);
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+
+  BOOST_TEST((order == std::vector<Priority>{Priority::Configuration, Priority::Monitoring}));
+  BOOST_TEST(arbiter.getStatistics(Priority::Monitoring).contended == 1);
+  BOOST_TEST(arbiter.getStatistics(Priority::Configuration).contended == 1);
+  BOOST_TEST(arbiter.getStatistics(Priority::Configuration).maxWaited.count() > 0);
+}
@@ -0,0 +1,133 @@
+/// Test suite for testing the MMTriggerCalib pattern plan
+
+#include <sstream>
+
+#include "NSWCalibration/MMTriggerPlan.h"
+
+#define BOOST_TEST_MODULE MMTriggerPlan_tests
+#define BOOST_TEST_DYN_LINK
+
+#include <boost/test/unit_test.hpp>
+
+#include <boost/property_tree/json_parser.hpp>
+
+namespace pt = boost::property_tree;
+
+pt::ptree read_patterns(const std::string& json)
+{
+  pt::ptree tree{};
+  auto input = std::istringstream(json);
+  pt::read_json(input, tree);
+  return tree;
+}
+
+BOOST_AUTO_TEST_CASE(FromPtree_OrderedByPatternNumber)
+{
+  const auto plan = nsw::mmtrigger::fromPtree(read_patterns(R"({
+    "pattern_1": {"tp_latency": "-1", "art_input_phase": "3", "febpattern_0": {}},
+    "pattern_0": {"tp_latency": "-1", "art_input_phase": "2", "febpattern_0": {}}
+})"));
+  BOOST_TEST(plan.size() == 2);
+  BOOST_TEST(plan.at(0).artInputPhase == 2);
+  BOOST_TEST(plan.at(1).artInputPhase == 3);
+}
+
+BOOST_AUTO_TEST_CASE(FromPtree_SharedFebPatterns)
+{
+  const auto plan = nsw::mmtrigger::fromPtree(read_patterns(R"({
+    "pattern_0": {"tp_latency": "-1", "art_input_phase": "0",
+                  "febpattern_0": {"MMFE8_L1P1_HOR": {"0": ["0", "63"], "7": ["10"], "geo_name": "L7/R0"}}},
+    "pattern_1": {"tp_latency": "-1", "art_input_phase": "1",
+                  "febpattern_0": {"MMFE8_L1P1_HOR": {"0": ["0", "63"], "7": ["10"], "geo_name": "L7/R0"}}}
+})"));
+  BOOST_TEST(plan.at(0).febPatterns.at(0) == plan.at(1).febPatterns.at(0));
+  const auto& feb = plan.at(0).febPatterns.at(0)->febs.at(0);
+  BOOST_TEST(feb.name == "MMFE8_L1P1_HOR");
+  BOOST_TEST(feb.geoName == "L7/R0");
+  BOOST_TEST(feb.getChannels(0) == (std::vector<std::size_t>{0, 63}));
+  BOOST_TEST(feb.getChannels(7) == (std::vector<std::size_t>{10}));
+  BOOST_TEST(feb.getChannels(1).empty());
+  BOOST_TEST(feb.countChannels() == 3);
+  BOOST_TEST(plan.at(0).febPatterns.at(0)->countChannels() == 3);
+}
+
+BOOST_AUTO_TEST_CASE(ToPtree_RoundTrip)
+{
+  const auto tree = read_patterns(R"({
+    "pattern_0": {"addc_old": "ADDC_L1P3_HOL", "addc_geo": "L0/R4", "tp_latency": "-1", "art_input_phase": "15",
+                  "febpattern_0": {"MMFE8_L1P1_HOR": {"3": ["5", "6"], "geo_name": "L7/R0"}}}
+})");
+  const auto plan = nsw::mmtrigger::fromPtree(tree);
+  const auto again = nsw::mmtrigger::fromPtree(nsw::mmtrigger::toPtree(plan));
+  BOOST_TEST(again.at(0).addcOld == "ADDC_L1P3_HOL");
+  BOOST_TEST(again.at(0).addcGeo == "L0/R4");
+  BOOST_TEST(again.at(0).artInputPhase == 15);
+  BOOST_TEST(again.at(0).febPatterns.at(0)->name == "febpattern_0");
+  BOOST_TEST(again.at(0).febPatterns.at(0)->febs.at(0).channels == plan.at(0).febPatterns.at(0)->febs.at(0).channels);
+}
+
+BOOST_AUTO_TEST_CASE(FromPtree_MissingPatternNumber)
+{
+  BOOST_CHECK_THROW(nsw::mmtrigger::fromPtree(read_patterns(R"({
+    "pattern_0": {"tp_latency": "-1", "art_input_phase": "0"},
+    "pattern_2": {"tp_latency": "-1", "art_input_phase": "0"}
+})")), std::runtime_error);
+}
+
+BOOST_AUTO_TEST_CASE(FromPtree_InvalidChannel)
+{
+  BOOST_CHECK_THROW(nsw::mmtrigger::fromPtree(read_patterns(R"({
+    "pattern_0": {"tp_latency": "-1", "art_input_phase": "0",
+                  "febpattern_0": {"MMFE8_L1P1_HOR": {"0": ["64"]}}}
+})")), std::runtime_error);
+}
+
+BOOST_AUTO_TEST_CASE(ReadPlan_SameAsFromPtree)
+{
+  const std::string json = R"({
+    "pattern_1": {"addc_old": "ADDC_L1P3_HOL", "addc_geo": "L0/R4", "tp_latency": 12, "art_input_phase": "3",
+                  "comment": {"skipped": [1, 2, {"a": null}]},
+                  "febpattern_0": {"MMFE8_L1P1_HOR": {"0": ["0", 63], "7": [10], "geo_name": "L7/R0"}}},
+    "pattern_0": {"tp_latency": "-1", "art_input_phase": 2,
+                  "febpattern_0": {"MMFE8_L1P1_HOR": {"0": ["0", 63], "7": [10], "geo_name": "L7/R0"}}}
+})";
+  auto input = std::istringstream(json);
+  const auto plan = nsw::mmtrigger::readPlan(input);
+  const auto expected = nsw::mmtrigger::fromPtree(read_patterns(json));
+  BOOST_REQUIRE(plan.size() == 2);
+  for (std::size_t ipatt = 0; ipatt < plan.size(); ipatt++) {
+    BOOST_TEST(plan.at(ipatt).tpLatency == expected.at(ipatt).tpLatency);
+    BOOST_TEST(plan.at(ipatt).artInputPhase == expected.at(ipatt).artInputPhase);
+    BOOST_TEST(plan.at(ipatt).addcOld == expected.at(ipatt).addcOld);
+    BOOST_TEST(plan.at(ipatt).addcGeo == expected.at(ipatt).addcGeo);
+    BOOST_TEST((*plan.at(ipatt).febPatterns.at(0) == *expected.at(ipatt).febPatterns.at(0)));
+  }
+  BOOST_TEST(plan.at(0).febPatterns.at(0) == plan.at(1).febPatterns.at(0));
+}
+
+BOOST_AUTO_TEST_CASE(ReadPlan_SameSetNameDifferentContent)
+{
+  auto input = std::istringstream(R"({
+    "pattern_0": {"febpattern_0": {"MMFE8_L1P1_HOR": {"0": [1]}}},
+    "pattern_1": {"febpattern_0": {"MMFE8_L1P1_HOR": {"0": [2]}}}
+})");
+  const auto plan = nsw::mmtrigger::readPlan(input);
+  BOOST_TEST(plan.at(0).febPatterns.at(0) != plan.at(1).febPatterns.at(0));
+  BOOST_TEST(plan.at(1).febPatterns.at(0)->febs.at(0).getChannels(0) == (std::vector<std::size_t>{2}));
+}
+
+BOOST_AUTO_TEST_CASE(ReadPlan_Errors)
+{
+  const auto read = [](const std::string& json) {
+    auto input = std::istringstream(json);
+    return nsw::mmtrigger::readPlan(input);
+  };
+  BOOST_TEST(read("{}").empty());
+  BOOST_CHECK_THROW(read(R"({"pattern_0": {}, "pattern_2": {}})"), std::runtime_error);
+  BOOST_CHECK_THROW(read(R"({"pattern_0": {}, "pattern_0": {}})"), std::runtime_error);
+  BOOST_CHECK_THROW(read(R"({"patterns": {}})"), std::runtime_error);
+  BOOST_CHECK_THROW(read(R"({"pattern_0": {"tp_latency": "x"}})"), std::runtime_error);
+  BOOST_CHECK_THROW(read(R"({"pattern_0": {"febpattern_0": {"MMFE8": {"0": [64]}}}})"), std::runtime_error);
+  BOOST_CHECK_THROW(read(R"({"pattern_0": {"tp_latency": 1})"), std::runtime_error);
+  BOOST_CHECK_THROW(read(R"({"pattern_0": {}} x)"), std::runtime_error);
+}
@@ -0,0 +1,120 @@
+/// Test suite for testing the shared memory monitoring feed
+
+#include <memory>
+#include <numeric>
+#include <string>
+#include <vector>
+
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include "NSWCalibration/MonitoringFeed.h"
+
+#define BOOST_TEST_MODULE MonitoringFeed_tests
+#define BOOST_TEST_DYN_LINK
+
+#include <boost/test/unit_test.hpp>
+
+namespace {
+  /// Unique feed name, removed at the end of the test
+  struct FeedName {
+    std::string name{"nsw_test_monitoring_feed_" + std::to_string(getpid())};
+    ~FeedName() { shm_unlink(nsw::monitoring::sharedMemoryName(name).c_str()); }
+  };
+}  // namespace
+
+BOOST_AUTO_TEST_CASE(SharedMemoryName_test) {
+  BOOST_TEST(nsw::monitoring::sharedMemoryName("feed") == "/feed");
+  BOOST_TEST(nsw::monitoring::sharedMemoryName("calib/MMG/A14") == "/calib_MMG_A14");
+}
+
+BOOST_AUTO_TEST_CASE(Reader_throws_without_writer_test) {
+  const FeedName feed{};
+  BOOST_CHECK_THROW(nsw::MonitoringFeedReader{feed.name}, std::runtime_error);
+}
+
+BOOST_AUTO_TEST_CASE(Roundtrip_test) {
+  const FeedName feed{};
+  nsw::MonitoringFeed writer{feed.name, 8};
+  nsw::MonitoringFeedReader reader{feed.name};
+  BOOST_TEST(reader.poll().empty());
+
+  const std::vector<double> rates{0., 10., 2.5};
+  writer.publishArtRates("MMFE8_L1P1_IPL.art0", rates);
+  const std::vector<std::uint8_t> bcids{1, 2, 3};
+  writer.publishTpAlignment("SCA_TP", 0xff, bcids);
+
+  const auto readings = reader.poll();
+  BOOST_REQUIRE(readings.size() == 2);
+  BOOST_TEST(readings.at(0).index == 0);
+  BOOST_TEST((readings.at(0).kind == nsw::monitoring::Kind::ArtRates));
+  BOOST_TEST(readings.at(0).source == "MMFE8_L1P1_IPL.art0");
+  BOOST_TEST(readings.at(0).rates() == std::vector<float>({0.F, 10.F, 2.5F}));
+  BOOST_TEST((readings.at(1).kind == nsw::monitoring::Kind::TpAlignment));
+  BOOST_TEST(readings.at(1).data == std::vector<std::uint32_t>({0xff, 1, 2, 3}));
+  BOOST_TEST(readings.at(1).time >= readings.at(0).time);
+
+  BOOST_TEST(reader.poll().empty());
+  BOOST_TEST(reader.getLost() == 0);
+}
+
+BOOST_AUTO_TEST_CASE(All_tp_fibers_fit_test) {
+  const FeedName feed{};
+  nsw::MonitoringFeed writer{feed.name, 8};
+  nsw::MonitoringFeedReader reader{feed.name};
+
+  std::vector<std::uint8_t> bcids(32);
+  std::iota(std::begin(bcids), std::end(bcids), std::uint8_t{1});
+  writer.publishTpAlignment("SCA_TP", 0xffffffff, bcids);
+  const auto readings = reader.poll();
+  BOOST_REQUIRE(readings.size() == 1);
+  BOOST_TEST(readings.at(0).data.size() == 33);
+  BOOST_TEST(readings.at(0).data.back() == 32);
+
+  bcids.resize(nsw::monitoring::DATA_SIZE);
+  BOOST_CHECK_THROW(writer.publishTpAlignment("SCA_TP", 0, bcids), std::runtime_error);
+  const std::vector<double> rates(nsw::monitoring::DATA_SIZE + 1);
+  BOOST_CHECK_THROW(writer.publishArtRates("MMFE8_L1P1_IPL.art0", rates), std::runtime_error);
+}
+
+BOOST_AUTO_TEST_CASE(Long_source_is_truncated_test) {
+  const FeedName feed{};
+  nsw::MonitoringFeed writer{feed.name, 8};
+  nsw::MonitoringFeedReader reader{feed.name};
+  writer.publishArtRates(std::string(100, 'a'), std::vector<double>{1.});
+  const auto readings = reader.poll();
+  BOOST_REQUIRE(readings.size() == 1);
+  BOOST_TEST(readings.at(0).source == std::string(nsw::monitoring::SOURCE_SIZE - 1, 'a'));
+}
+
+BOOST_AUTO_TEST_CASE(Overwritten_records_are_lost_test) {
+  const FeedName feed{};
+  nsw::MonitoringFeed writer{feed.name, 4};
+  nsw::MonitoringFeedReader reader{feed.name};
+  for (int index = 0; index < 10; index++) {
+    writer.publishTpAlignment("SCA_TP", static_cast<std::uint32_t>(index), {});
+  }
+  const auto readings = reader.poll();
+  BOOST_REQUIRE(readings.size() == 4);
+  BOOST_TEST(readings.front().index == 6);
+  BOOST_TEST(readings.front().data.front() == 6);
+  BOOST_TEST(readings.back().data.front() == 9);
+  BOOST_TEST(reader.getLost() == 6);
+}
+
+BOOST_AUTO_TEST_CASE(Writer_restart_test) {
+  const FeedName feed{};
+  std::unique_ptr<nsw::MonitoringFeedReader> reader{};
+  {
+    nsw::MonitoringFeed writer{feed.name, 4};
+    reader = std::make_unique<nsw::MonitoringFeedReader>(feed.name);
+    writer.publishTpAlignment("SCA_TP", 1, {});
+    writer.publishTpAlignment("SCA_TP", 2, {});
+    BOOST_TEST(reader->poll().size() == 2);
+  }
+  nsw::MonitoringFeed writer{feed.name, 4};
+  writer.publishTpAlignment("SCA_TP", 3, {});
+  const auto readings = reader->poll();
+  BOOST_REQUIRE(readings.size() == 1);
+  BOOST_TEST(readings.front().data.front() == 3);
+}
@@ -0,0 +1,66 @@
+/// Test suite for testing the Poisson precision acquisition time
+
+#include "NSWCalibration/PoissonDwell.h"
+
+#include <cmath>
+#include <stdexcept>
+
+#define BOOST_TEST_MODULE PoissonDwell_tests
+#define BOOST_TEST_DYN_LINK
+
+#include <boost/test/unit_test.hpp>
+
+using namespace std::chrono_literals;
+
+BOOST_AUTO_TEST_CASE(Invalid)
+{
+  BOOST_CHECK_THROW(nsw::PoissonDwell(0, 0ms, 1s), std::runtime_error);
+  BOOST_CHECK_THROW(nsw::PoissonDwell(0.1, 2s, 1s), std::runtime_error);
+  BOOST_CHECK_NO_THROW(nsw::PoissonDwell(0.1, 1s, 1s));
+}
+
+BOOST_AUTO_TEST_CASE(HighRate)
+{
+  // 0.05 needs 400 hits, reached in the first poll but not before the minimum time
+  nsw::PoissonDwell dwell{0.05, 200ms, 10s};
+  BOOST_TEST(not dwell.done());
+  dwell.addRate(10000, 100ms);
+  BOOST_TEST(dwell.getHits() == 1000, boost::test_tools::tolerance(1e-9));
+  BOOST_TEST(dwell.getRelativeError() < 0.05);
+  BOOST_TEST(not dwell.done());
+  dwell.addRate(10000, 100ms);
+  BOOST_TEST(dwell.done());
+  BOOST_TEST(dwell.getLiveTime().count() == 200);
+}
+
+BOOST_AUTO_TEST_CASE(LowRate)
+{
+  nsw::PoissonDwell dwell{0.05, 0ms, 3s};
+  for (int poll = 0; poll < 2; poll++) {
+    dwell.add(10, 1s);
+    BOOST_TEST(not dwell.done());
+  }
+  dwell.add(10, 1s);
+  BOOST_TEST(dwell.done());
+  BOOST_TEST(dwell.getRelativeError() > 0.05);
+
+  nsw::PoissonDwell silent{0.05, 0ms, 1s};
+  silent.add(0, 500ms);
+  BOOST_TEST(std::isinf(silent.getRelativeError()));
+  BOOST_TEST(not silent.done());
+}
+
+BOOST_AUTO_TEST_CASE(PerChannel)
+{
+  // the quiet channel decides, however many hits the others have
+  nsw::PoissonDwell dwell{0.1, 0ms, 10s};
+  dwell.addRates({10000, 10000, 50}, 1s);
+  BOOST_TEST(dwell.getHits() == 20050, boost::test_tools::tolerance(1e-9));
+  BOOST_TEST(dwell.getMinHits() == 50, boost::test_tools::tolerance(1e-9));
+  BOOST_TEST(not dwell.done());
+  dwell.addRates({10000, 10000, 50}, 1s);
+  BOOST_TEST(dwell.getMinHits() == 100, boost::test_tools::tolerance(1e-9));
+  BOOST_TEST(dwell.done());
+
+  BOOST_CHECK_THROW(dwell.add(std::vector<double>{1, 1}, 1s), std::runtime_error);
+}
@@ -0,0 +1,82 @@
+/// Test suite for testing the router status monitor
+
+#include "NSWCalibration/RouterStatusMonitor.h"
+
+#include <atomic>
+#include <chrono>
+#include <numeric>
+#include <stdexcept>
+#include <vector>
+
+#define BOOST_TEST_MODULE RouterStatusMonitor_tests
+#define BOOST_TEST_DYN_LINK
+
+#include <boost/test/unit_test.hpp>
+
+using namespace std::chrono_literals;
+
+namespace {
+  /// Link i reads 1 after i * step
+  auto readyAfter(const std::chrono::milliseconds step)
+  {
+    const auto start = std::chrono::steady_clock::now();
+    return [start, step](const std::size_t link) -> std::uint64_t {
+      return std::chrono::steady_clock::now() - start >= link * step ? 1 : 0;
+    };
+  }
+
+  auto countReady(const std::size_t expected)
+  {
+    return [expected](const std::vector<std::uint64_t>& values) {
+      return static_cast<std::size_t>(std::accumulate(std::cbegin(values), std::cend(values), std::uint64_t{0})) >=
+             expected;
+    };
+  }
+}  // namespace
+
+BOOST_AUTO_TEST_CASE(WaitFor)
+{
+  nsw::RouterStatusMonitor monitor{4, readyAfter(50ms), 5ms};
+  BOOST_TEST(monitor.waitFor(countReady(4), 5s));
+  BOOST_TEST(monitor.getValues() == std::vector<std::uint64_t>(4, 1));
+  const auto times = monitor.getLockTimes();
+  BOOST_TEST(times.at(0).has_value());
+  BOOST_TEST(times.at(3)->count() >= 150);
+  BOOST_TEST(times.at(3)->count() > times.at(1)->count());
+}
+
+BOOST_AUTO_TEST_CASE(Timeout)
+{
+  nsw::RouterStatusMonitor monitor{2, [](std::size_t) -> std::uint64_t { return 0; }, 5ms};
+  const auto start = std::chrono::steady_clock::now();
+  BOOST_TEST(not monitor.waitFor(countReady(1), 100ms));
+  BOOST_TEST((std::chrono::steady_clock::now() - start >= 100ms));
+}
+
+BOOST_AUTO_TEST_CASE(Stable)
+{
+  // the error counter of a link counts up until it locks after 100 ms, read every 5 ms
+  const auto start = std::chrono::steady_clock::now();
+  std::atomic<std::uint64_t> errors{0};
+  nsw::RouterStatusMonitor monitor{2,
+                                   [&](const std::size_t link) -> std::uint64_t {
+                                     if (link == 1 and std::chrono::steady_clock::now() - start < 100ms) {
+                                       return ++errors;
+                                     }
+                                     return errors;
+                                   },
+                                   5ms};
+  BOOST_TEST(monitor.waitForStable(50ms, 5s));
+  BOOST_TEST((std::chrono::steady_clock::now() - start >= 140ms));
+  BOOST_TEST(monitor.getLockTimes().at(1)->count() >= 90);
+
+  nsw::RouterStatusMonitor unstable{1, [&](std::size_t) -> std::uint64_t { return ++errors; }, 5ms};
+  BOOST_TEST(not unstable.waitForStable(50ms, 200ms));
+}
+
+BOOST_AUTO_TEST_CASE(ReadError)
+{
+  nsw::RouterStatusMonitor monitor{1, [](std::size_t) -> std::uint64_t { throw std::runtime_error("no SCA"); }, 5ms};
+  BOOST_CHECK_THROW(monitor.waitFor(countReady(1), 5s), std::runtime_error);
+  BOOST_CHECK_THROW(monitor.waitForStable(10ms, 5s), std::runtime_error);
+}
@@ -0,0 +1,33 @@
+/// Test suite for testing the calibration utilities
+
+#include "NSWCalibration/Utility.h"
+
+#define BOOST_TEST_MODULE Utility_tests
+#define BOOST_TEST_DYN_LINK
+
+#include <boost/test/unit_test.hpp>
+
+BOOST_AUTO_TEST_CASE(ParseKeyValues_Correct)
+{
+  const auto params = nsw::calib::utils::parseKeyValues(" window = 3,min_hits=10,,");
+  BOOST_TEST(params.size() == 2);
+  BOOST_TEST(params.at("window") == "3");
+  BOOST_TEST(params.at("min_hits") == "10");
+}
+
+BOOST_AUTO_TEST_CASE(ParseKeyValues_Empty)
+{
+  BOOST_TEST(nsw::calib::utils::parseKeyValues("").empty());
+}
+
+BOOST_AUTO_TEST_CASE(ParseKeyValues_Separator)
+{
+  const auto params = nsw::calib::utils::parseKeyValues("a=1;b=x=y", ";");
+  BOOST_TEST(params.at("b") == "x=y");
+}
+
+BOOST_AUTO_TEST_CASE(ParseKeyValues_Invalid)
+{
+  BOOST_CHECK_THROW(nsw::calib::utils::parseKeyValues("window"), std::runtime_error);
+  BOOST_CHECK_THROW(nsw::calib::utils::parseKeyValues("a=1,a=2"), std::runtime_error);
+}
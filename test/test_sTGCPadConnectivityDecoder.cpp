@@ -0,0 +1,121 @@
+/// Test suite for testing the decoding of grouped pad connectivity pulses
+
+#include "NSWCalibration/sTGCPadConnectivityDecoder.h"
+
+#include <functional>
+#include <stdexcept>
+
+#define BOOST_TEST_MODULE sTGCPadConnectivityDecoder_tests
+#define BOOST_TEST_DYN_LINK
+
+#include <boost/test/unit_test.hpp>
+
+namespace {
+  using Status = nsw::sTGCPadConnectivityDecoder::Status;
+
+  /// PFEBs feeding each input
+  using Cabling = std::vector<std::vector<std::size_t>>;
+
+  std::vector<std::uint32_t> rates(const Cabling& cabling, const std::function<bool(std::size_t)>& pulsed)
+  {
+    std::vector<std::uint32_t> result(cabling.size(), 0);
+    for (std::size_t input = 0; input < cabling.size(); input++) {
+      for (const auto pfeb : cabling.at(input)) {
+        result.at(input) += pulsed(pfeb) ? 1000 : 0;
+      }
+    }
+    return result;
+  }
+
+  void run(nsw::sTGCPadConnectivityDecoder& decoder, const Cabling& cabling)
+  {
+    for (std::size_t iteration = 0; iteration < decoder.getNumIterations(); iteration++) {
+      decoder.addRates(iteration, rates(cabling, [&](const std::size_t pfeb) {
+        return decoder.isPulsed(iteration, pfeb);
+      }));
+    }
+  }
+}  // namespace
+
+BOOST_AUTO_TEST_CASE(Iterations)
+{
+  const nsw::sTGCPadConnectivityDecoder decoder{24};
+  BOOST_TEST(decoder.getNumIterations() == 10);
+  for (std::size_t iteration = 0; iteration < decoder.getNumIterations(); iteration += 2) {
+    for (std::size_t pfeb = 0; pfeb < 24; pfeb++) {
+      BOOST_TEST(decoder.isPulsed(iteration, pfeb) != decoder.isPulsed(iteration + 1, pfeb));
+    }
+  }
+  BOOST_TEST(nsw::sTGCPadConnectivityDecoder{3}.getNumIterations() == 4);
+  BOOST_TEST(nsw::sTGCPadConnectivityDecoder{4}.getNumIterations() == 6);
+  nsw::sTGCPadConnectivityDecoder other{24};
+  BOOST_CHECK_THROW(other.addRates(10, {}), std::runtime_error);
+}
+
+BOOST_AUTO_TEST_CASE(Connected)
+{
+  Cabling cabling(24);
+  for (std::size_t input = 0; input < cabling.size(); input++) {
+    cabling.at(input) = {input};
+  }
+  nsw::sTGCPadConnectivityDecoder decoder{24};
+  run(decoder, cabling);
+  const auto results = decoder.decode();
+  for (std::size_t input = 0; input < cabling.size(); input++) {
+    BOOST_TEST((results.at(input).status == Status::Connected));
+    BOOST_TEST(results.at(input).pfeb.value_or(99) == input);
+  }
+  BOOST_TEST(decoder.getRetests().empty());
+}
+
+BOOST_AUTO_TEST_CASE(Faults)
+{
+  Cabling cabling(24);
+  for (std::size_t input = 0; input < cabling.size(); input++) {
+    cabling.at(input) = {input};
+  }
+  cabling.at(3) = {5};
+  cabling.at(5) = {3};
+  cabling.at(7) = {};
+  cabling.at(10) = {10, 11};
+  cabling.at(11) = {};
+  nsw::sTGCPadConnectivityDecoder decoder{24};
+  run(decoder, cabling);
+  const auto results = decoder.decode();
+  BOOST_TEST((results.at(3).status == Status::Swapped));
+  BOOST_TEST(results.at(3).pfeb.value_or(99) == 5);
+  BOOST_TEST((results.at(5).status == Status::Swapped));
+  BOOST_TEST(results.at(5).pfeb.value_or(99) == 3);
+  BOOST_TEST((results.at(7).status == Status::Dead));
+  BOOST_TEST((results.at(10).status == Status::Collision));
+  BOOST_TEST((results.at(11).status == Status::Dead));
+  BOOST_TEST(decoder.getRetests() == std::vector<std::size_t>({7, 10, 11}));
+
+  for (const auto pfeb : decoder.getRetests()) {
+    BOOST_TEST(not decoder.getRetest(pfeb).has_value());
+    decoder.addRetest(pfeb, rates(cabling, [&](const std::size_t other) { return other == pfeb; }));
+  }
+  BOOST_TEST(decoder.getRetest(7)->empty());
+  BOOST_TEST(*decoder.getRetest(10) == std::vector<std::size_t>({10}));
+  BOOST_TEST(*decoder.getRetest(11) == std::vector<std::size_t>({10}));
+}
+
+BOOST_AUTO_TEST_CASE(Noise)
+{
+  Cabling cabling(24);
+  for (std::size_t input = 0; input < cabling.size(); input++) {
+    cabling.at(input) = {input};
+  }
+  nsw::sTGCPadConnectivityDecoder decoder{24};
+  for (std::size_t iteration = 0; iteration < decoder.getNumIterations(); iteration++) {
+    auto values = rates(cabling, [&](const std::size_t pfeb) { return decoder.isPulsed(iteration, pfeb); });
+    // small background everywhere
+    for (auto& value : values) {
+      value += 50;
+    }
+    decoder.addRates(iteration, values);
+  }
+  for (const auto& result : decoder.decode()) {
+    BOOST_TEST((result.status == Status::Connected));
+  }
+}
@@ -0,0 +1,151 @@
+/// Test suite for testing the pad TDS BCID offset search
+
+#include <functional>
+
+#include "NSWCalibration/sTGCPadTdsBcidOffsetSearch.h"
+
+#define BOOST_TEST_MODULE sTGCPadTdsBcidOffsetSearch_tests
+#define BOOST_TEST_DYN_LINK
+
+#include <boost/test/unit_test.hpp>
+
+namespace {
+  constexpr std::uint32_t NUM_OFFSETS{3564};
+
+  using Search = nsw::sTGCPadTdsBcidOffsetSearch;
+  using Good = std::function<bool(std::size_t pfeb, std::uint32_t offset)>;
+
+  /// Run the search, the pad trigger flagging the offsets for which \c good is false
+  Search run(const std::size_t numPfebs, const Good& good, const std::uint32_t step = 16, const bool sweep = false)
+  {
+    Search search{numPfebs, NUM_OFFSETS, step, 3, sweep};
+    while (not search.done()) {
+      std::uint64_t errors{0};
+      for (std::size_t pfeb = 0; pfeb < numPfebs; pfeb++) {
+        if (not good(pfeb, search.getOffsets().at(pfeb))) {
+          errors |= (std::uint64_t{1} << pfeb);
+        }
+      }
+      search.addResult(errors);
+    }
+    return search;
+  }
+
+  /// Good offsets in [first, last], modulo the orbit
+  bool inWindow(const std::uint32_t offset, const std::uint32_t first, const std::uint32_t last)
+  {
+    return (offset + NUM_OFFSETS - first) % NUM_OFFSETS <= (last + NUM_OFFSETS - first) % NUM_OFFSETS;
+  }
+}  // namespace
+
+BOOST_AUTO_TEST_CASE(NumIterations)
+{
+  const Search search{24, NUM_OFFSETS, 16, 3};
+  BOOST_TEST(search.getNumIterations() == 223 + 2 * 4 + 3);
+  BOOST_TEST(search.getStage(0) == "coarse");
+  BOOST_TEST(search.getStage(223) == "lower_edge");
+  BOOST_TEST(search.getStage(227) == "upper_edge");
+  BOOST_TEST(search.getStage(231) == "verify");
+  BOOST_CHECK_THROW((Search{24, NUM_OFFSETS, 0, 3}), std::runtime_error);
+
+  // the sweep mode measures every offset once, no more
+  const Search sweep{24, NUM_OFFSETS, 16, 3, true};
+  BOOST_TEST(sweep.getNumIterations() == NUM_OFFSETS);
+  BOOST_TEST(sweep.getStage(222) == "coarse");
+  BOOST_TEST(sweep.getStage(223) == "sweep");
+  BOOST_TEST(sweep.getStage(NUM_OFFSETS - 1) == "sweep");
+}
+
+BOOST_AUTO_TEST_CASE(IndependentWindows)
+{
+  // windows of different widths, one through the end of the orbit
+  const std::vector<std::pair<std::uint32_t, std::uint32_t>> windows{
+    {100, 120}, {1001, 1017}, {3550, 5}, {2000, 2016}, {7, 40}};
+  const auto search = run(windows.size(), [&windows](const std::size_t pfeb, const std::uint32_t offset) {
+    return inWindow(offset, windows.at(pfeb).first, windows.at(pfeb).second);
+  });
+  for (std::size_t pfeb = 0; pfeb < windows.size(); pfeb++) {
+    const auto& result = search.getResult(pfeb);
+    BOOST_TEST_CONTEXT("PFEB " << pfeb) {
+      BOOST_TEST((result.status == Search::Status::Verified));
+      BOOST_TEST(result.first == windows.at(pfeb).first);
+      BOOST_TEST(result.last == windows.at(pfeb).second);
+      BOOST_TEST(inWindow(result.offset, result.first, result.last));
+      BOOST_TEST(result.windows == 1);
+    }
+  }
+  BOOST_TEST(search.getResult(0).offset == 110);
+  BOOST_TEST(search.getResult(2).offset == 3559);
+}
+
+BOOST_AUTO_TEST_CASE(NarrowWindowIsFoundBySweep)
+{
+  // PFEB 0 has a window narrower than the step, PFEB 1 none, PFEB 2 a normal one, PFEB 3 one through the orbit end
+  const auto good = [](const std::size_t pfeb, const std::uint32_t offset) {
+    return (pfeb == 0 and (offset >= 1234 and offset <= 1240)) or (pfeb == 2 and inWindow(offset, 500, 600)) or
+      (pfeb == 3 and inWindow(offset, 3550, 5));
+  };
+  const auto coarse = run(4, good);
+  BOOST_TEST((coarse.getResult(0).status == Search::Status::NoWindow));
+  BOOST_TEST((coarse.getResult(1).status == Search::Status::NoWindow));
+  BOOST_TEST((coarse.getResult(2).status == Search::Status::Verified));
+  BOOST_TEST(not coarse.getResult(2).swept);
+
+  const auto search = run(4, good, 16, true);
+  BOOST_TEST((search.getResult(0).status == Search::Status::Verified));
+  BOOST_TEST(search.getResult(0).swept);
+  BOOST_TEST(search.getResult(0).first == 1234);
+  BOOST_TEST(search.getResult(0).last == 1240);
+  BOOST_TEST(search.getResult(0).offset == 1237);
+  BOOST_TEST((search.getResult(1).status == Search::Status::NoWindow));
+  BOOST_TEST((search.getResult(2).status == Search::Status::Verified));
+  BOOST_TEST(search.getResult(2).first == 500);
+  BOOST_TEST(search.getResult(2).last == 600);
+  BOOST_TEST(search.getResult(3).first == 3550);
+  BOOST_TEST(search.getResult(3).last == 5);
+  BOOST_TEST(search.getResult(3).offset == 3559);
+
+  const auto fine = run(1, [](std::size_t, const std::uint32_t offset) { return offset == 1234; }, 1);
+  BOOST_TEST((fine.getResult(0).status == Search::Status::Verified));
+  BOOST_TEST(fine.getResult(0).offset == 1234);
+}
+
+BOOST_AUTO_TEST_CASE(DeadPfeb)
+{
+  // PFEB 1 sends no hits and always flags an error
+  for (const auto sweep : {false, true}) {
+    Search search{2, NUM_OFFSETS, 16, 3, sweep};
+    while (not search.done()) {
+      search.addResult(inWindow(search.getOffsets().at(0), 100, 200) ? 0b10 : 0b11, 0b01);
+    }
+    BOOST_TEST_CONTEXT("sweep " << sweep) {
+      BOOST_TEST((search.getResult(0).status == Search::Status::Verified));
+      BOOST_TEST((search.getResult(1).status == Search::Status::Dead));
+    }
+  }
+}
+
+BOOST_AUTO_TEST_CASE(ExcludedInput)
+{
+  Search search{2, NUM_OFFSETS, 16, 3};
+  search.exclude(1);
+  while (not search.done()) {
+    // input 1 always flags an error
+    search.addResult(inWindow(search.getOffsets().at(0), 100, 200) ? 0b10 : 0b11);
+  }
+  BOOST_TEST((search.getResult(0).status == Search::Status::Verified));
+  BOOST_TEST((search.getResult(1).status == Search::Status::Excluded));
+  BOOST_CHECK_THROW(search.exclude(0), std::runtime_error);
+}
+
+BOOST_AUTO_TEST_CASE(NoTransitionAndFailedVerification)
+{
+  const auto always = run(1, [](std::size_t, std::uint32_t) { return true; });
+  BOOST_TEST((always.getResult(0).status == Search::Status::NoTransition));
+
+  // good at the coarse offsets around 320 only: the edges are found, the center fails
+  const auto search = run(1, [](std::size_t, const std::uint32_t offset) {
+    return offset == 320 or offset == 336 or offset == 300 or offset == 350;
+  });
+  BOOST_TEST((search.getResult(0).status == Search::Status::Failed));
+}
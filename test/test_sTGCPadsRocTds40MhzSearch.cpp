@@ -0,0 +1,113 @@
+/// Test suite for testing the adaptive ROC/TDS 40MHz search
+
+#include "NSWCalibration/sTGCPadsRocTds40MhzSearch.h"
+
+#include <functional>
+#include <stdexcept>
+
+#define BOOST_TEST_MODULE sTGCPadsRocTds40MhzSearch_tests
+#define BOOST_TEST_DYN_LINK
+
+#include <boost/test/unit_test.hpp>
+
+namespace {
+  using Status = nsw::sTGCPadsRocTds40MhzSearch::Status;
+
+  /// BCID of a PFEB for a phase, delay and offset
+  using Response = std::function<std::uint32_t(std::size_t pfeb, std::uint32_t phase,
+                                               std::uint32_t delay, std::uint32_t offset)>;
+
+  void run(nsw::sTGCPadsRocTds40MhzSearch& search, const std::size_t numPfebs, const Response& response)
+  {
+    while (not search.done()) {
+      std::vector<std::uint32_t> bcids{};
+      for (std::size_t pfeb = 0; pfeb < numPfebs; pfeb++) {
+        bcids.push_back(response(pfeb, search.getPhases().at(pfeb), search.getDelay(), search.getOffset()));
+      }
+      search.addResult(bcids);
+    }
+  }
+}  // namespace
+
+BOOST_AUTO_TEST_CASE(Iterations)
+{
+  BOOST_CHECK_THROW(nsw::sTGCPadsRocTds40MhzSearch(2, 2, 2, 8, 2, 4), std::runtime_error);
+  BOOST_CHECK_THROW(nsw::sTGCPadsRocTds40MhzSearch(2, 64, 2, 8, 2, 8), std::runtime_error);
+  const nsw::sTGCPadsRocTds40MhzSearch search{2, 64, 2, 8, 2, 4};
+  BOOST_TEST(search.getNumIterations() == 64 + 16);
+  BOOST_TEST(search.getStage(63) == "phase");
+  BOOST_TEST(search.getStage(64) == "delay");
+  BOOST_TEST(search.getDelay() == 4);
+  BOOST_TEST(not search.getBestDelay().has_value());
+}
+
+BOOST_AUTO_TEST_CASE(Align)
+{
+  // 16 phases of step 2, with jitter at the BCID transitions:
+  //   PFEB 0: BCID 3 at phases 10 to 16, 4 elsewhere, stable from 22 to 6
+  //   PFEB 1: BCID 3 below phase 20, 4 above, stable from 2 to 16
+  // Delays 2 to 5 keep the BCID, the others shift it differently per PFEB.
+  const auto response = [](const std::size_t pfeb, const std::uint32_t phase, const std::uint32_t delay,
+                           const std::uint32_t offset) -> std::uint32_t {
+    const auto index = phase / 2;
+    std::uint32_t bcid{0};
+    if (pfeb == 0) {
+      bcid = index == 9 ? 99 : (index >= 5 and index < 9 ? 3 : 4);
+    } else {
+      bcid = index == 10 ? 99 : (index < 10 ? 3 : 4);
+    }
+    if (delay < 2 or delay > 5) {
+      bcid += 50 + 10 * delay + 5 * static_cast<std::uint32_t>(pfeb);
+    }
+    return bcid + offset;
+  };
+  nsw::sTGCPadsRocTds40MhzSearch search{2, 16, 2, 8, 2, 4};
+  run(search, 2, response);
+
+  BOOST_TEST(search.getBestDelay().value() == 3);
+  BOOST_TEST(search.getTargetBcid().value() == 4);
+
+  // through the end of the phase range
+  const auto& first = search.getResult(0);
+  BOOST_TEST((first.status == Status::Aligned));
+  BOOST_TEST(first.first == 22);
+  BOOST_TEST(first.last == 6);
+  BOOST_TEST(first.phase == 30);
+  BOOST_TEST(first.offset == 0);
+
+  const auto& second = search.getResult(1);
+  BOOST_TEST((second.status == Status::Aligned));
+  BOOST_TEST(second.first == 2);
+  BOOST_TEST(second.last == 16);
+  BOOST_TEST(second.phase == 8);
+  BOOST_TEST(second.offset == 1);
+}
+
+BOOST_AUTO_TEST_CASE(NoWindow)
+{
+  // PFEBs 0 and 1 have a constant BCID, the BCID of PFEB 2 changes at every phase,
+  // PFEB 3 has a window, and input 4 is excluded
+  const auto response = [](const std::size_t pfeb, const std::uint32_t phase, const std::uint32_t,
+                           const std::uint32_t offset) -> std::uint32_t {
+    switch (pfeb) {
+      case 0:
+      case 1:
+      case 4: return 5;
+      case 2: return phase;
+      default: return (phase < 16 ? 7 : 8) + offset;
+    }
+  };
+  nsw::sTGCPadsRocTds40MhzSearch search{5, 16, 2, 4, 1, 0};
+  search.exclude(4);
+  run(search, 5, response);
+  BOOST_TEST((search.getResult(0).status == Status::NoTransition));
+  BOOST_TEST(search.getResult(0).phase == 16);
+  BOOST_TEST((search.getResult(1).status == Status::NoTransition));
+  BOOST_TEST((search.getResult(2).status == Status::NoWindow));
+  BOOST_TEST((search.getResult(3).status == Status::Aligned));
+  BOOST_TEST((search.getResult(4).status == Status::Excluded));
+  // the constant BCIDs do not outvote the PFEB with a window
+  BOOST_TEST(search.getTargetBcid().value() == 7);
+  BOOST_TEST(nsw::sTGCPadsRocTds40MhzSearch::toString(Status::NoWindow) == "no_window");
+  BOOST_CHECK_THROW(search.exclude(0), std::runtime_error);
+}